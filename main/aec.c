@@ -0,0 +1,259 @@
+#include "aec.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define AEC_MU              0.25f   // NLMS step size
+#define AEC_MIN_ENERGY      (AEC_TAPS * 16.0f * 16.0f)  // far end quieter than this: no adaptation
+#define AEC_GEIGEL          2.0f    // near end talks when |mic| > 2 × the learnt echo peak
+#define AEC_LEARN_SAMPLES   4000    // far-end samples before double talk is judged (250 ms)
+#define AEC_PEAK_DECAY      0.995f  // ref peak hold, ~AEC_TAPS samples to fall 6 dB
+#define AEC_DT_HOLD         1600    // samples adaptation stays frozen after double talk (100 ms)
+#define AEC_REF_GUARD       256     // ref slots the TX ISR may be overwriting (> one DMA buffer)
+#define AEC_REF_WAIT_MS     30      // max wait for the reference of the newest mic samples
+#define AEC_IDLE_LEVEL      16      // reference within ±this over a chunk and its tail: silent
+#define AEC_AGO_MAX_US      1000000 // clamp for the offset stamp, keeps the Q16 product in 32 bits
+
+// ── Reference (written by the I2S ISRs) ─────────────────────────────────────
+// Both counters are free-running sample counts.  s_offset maps a mic sample
+// index to the index of the reference sample playing when it was captured.
+
+static int16_t           s_ref[AEC_REF_SAMPLES];
+static volatile uint32_t s_ref_head;      // reference samples pushed
+static volatile uint32_t s_ref_t_us;      // when the newest one finished playing (low 32 bits)
+static volatile uint32_t s_rx_count;      // mic samples received by the RX DMA
+static volatile uint32_t s_rx_lost;       // of those, dropped before the reader saw them
+static volatile int32_t  s_offset;
+static volatile bool     s_offset_valid;
+static int               s_rate;
+static uint32_t          s_us_to_samples; // s_rate / 1e6, Q16
+
+// The reader sleeps on s_ref_sem until the TX ISR has pushed s_ref_need
+static SemaphoreHandle_t s_ref_sem;
+static StaticSemaphore_t s_ref_sem_buf;
+static volatile uint32_t s_ref_need;
+static volatile bool     s_ref_waiting;
+
+// ── Filter (reader task only) ────────────────────────────────────────────────
+// History is stored twice so the newest-first window is always contiguous.
+
+static float    s_w[AEC_TAPS];
+static float    s_x[2 * AEC_TAPS];
+static int      s_xpos;
+static float    s_xenergy;       // Σ x² over the window
+static float    s_xpeak;         // decaying max |x|
+static float    s_dpeak;         // decaying max |mic|
+static float    s_path_gain;     // mic peak / ref peak with the far end alone
+static uint32_t s_learn;         // far-end samples seen this session
+static int      s_hold;          // double-talk hangover (samples)
+static float    s_pd, s_pe;      // smoothed mic / residual power, far end active
+static uint32_t s_mic_idx;       // mic samples accounted for (processed + lost)
+static uint32_t s_lost_seen;
+static uint32_t s_dt_samples;
+static bool     s_idle;          // last chunk skipped: history cleared
+static aec_stats_t s_stats;
+
+void aec_reset(int sample_rate)
+{
+    s_ref_head     = 0;
+    s_ref_t_us     = 0;
+    s_rx_count     = 0;
+    s_rx_lost      = 0;
+    s_offset       = 0;
+    s_offset_valid = false;
+    s_rate         = sample_rate;
+    s_us_to_samples = (uint32_t)(((uint64_t)sample_rate << 16) / 1000000);
+    s_ref_waiting  = false;
+    if (!s_ref_sem) s_ref_sem = xSemaphoreCreateBinaryStatic(&s_ref_sem_buf);
+
+    memset(s_w, 0, sizeof(s_w));
+    memset(s_x, 0, sizeof(s_x));
+    s_xpos       = 0;
+    s_xenergy    = 0;
+    s_xpeak      = 0;
+    s_dpeak      = 0;
+    s_path_gain  = 0;
+    s_learn      = 0;
+    s_hold       = 0;
+    s_pd = s_pe  = 0;
+    s_mic_idx    = 0;
+    s_lost_seen  = 0;
+    s_dt_samples = 0;
+    s_idle       = true;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+bool IRAM_ATTR aec_ref_push(const int16_t *pcm, size_t n)
+{
+    uint32_t head = s_ref_head;
+    for (size_t i = 0; i < n; i++) {
+        s_ref[(head + i) & (AEC_REF_SAMPLES - 1)] = pcm[i];
+    }
+    s_ref_t_us = (uint32_t)esp_timer_get_time();
+    s_ref_head = head + n;
+
+    BaseType_t woken = pdFALSE;
+    if (s_ref_waiting && (int32_t)(head + n - s_ref_need) >= 0) {
+        s_ref_waiting = false;
+        xSemaphoreGiveFromISR(s_ref_sem, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+void IRAM_ATTR aec_rx_mark(size_t n)
+{
+    s_rx_count += n;
+    if (!s_offset_valid && s_ref_head > 0) {
+        // The newest mic sample arrived just now; the reference sample playing
+        // now is the one `ago` past the end of the last completed TX buffer
+        uint32_t ago = (uint32_t)esp_timer_get_time() - s_ref_t_us;
+        if (ago > AEC_AGO_MAX_US) ago = AEC_AGO_MAX_US;
+        s_offset = (int32_t)(s_ref_head + ((ago * s_us_to_samples) >> 16) - s_rx_count);
+        s_offset_valid = true;
+    }
+}
+
+void IRAM_ATTR aec_rx_lost(size_t n)
+{
+    s_rx_lost += n;
+}
+
+static int16_t aec_sample(float x, float d)
+{
+    // Shift the reference into the history; keep the window energy running
+    s_xpos = s_xpos == 0 ? AEC_TAPS - 1 : s_xpos - 1;
+    float old = s_x[s_xpos];
+    s_x[s_xpos] = s_x[s_xpos + AEC_TAPS] = x;
+    s_xenergy += x * x - old * old;
+    if (s_xenergy < 0) s_xenergy = 0;
+
+    const float *xv = &s_x[s_xpos];
+    float y = 0;
+    for (int k = 0; k < AEC_TAPS; k++) y += s_w[k] * xv[k];
+    float e = d - y;
+
+    float ax = fabsf(x), ad = fabsf(d);
+    s_xpeak = ax > s_xpeak ? ax : s_xpeak * AEC_PEAK_DECAY;
+    s_dpeak = ad > s_dpeak ? ad : s_dpeak * AEC_PEAK_DECAY;
+
+    // Geigel: with the far end alone, mic peaks track ref peaks × the echo
+    // path gain.  The gain is learnt while no one talks and only creeps up
+    // during double talk, so an underestimate cannot lock adaptation out.
+    bool active = s_xenergy > AEC_MIN_ENERGY;
+    if (active && s_xpeak > 0) {
+        float pg = s_dpeak / s_xpeak;
+        if (s_learn < AEC_LEARN_SAMPLES) {
+            s_learn++;
+            s_path_gain += 0.01f * (pg - s_path_gain);
+        } else if (ad > AEC_GEIGEL * s_path_gain * s_xpeak) {
+            s_hold = AEC_DT_HOLD;   // near-end speech: the error is not echo
+        }
+        if (s_hold == 0)            s_path_gain += 0.001f  * (pg - s_path_gain);
+        else if (pg > s_path_gain)  s_path_gain += 0.0001f * (pg - s_path_gain);
+    }
+
+    if (s_hold > 0) {
+        s_hold--;
+        s_dt_samples++;
+    } else if (active) {
+        float g = AEC_MU * e / (s_xenergy + 1.0f);
+        for (int k = 0; k < AEC_TAPS; k++) s_w[k] += g * xv[k];
+        s_pd += 0.001f * (d * d - s_pd);
+        s_pe += 0.001f * (e * e - s_pe);
+    }
+
+    if (e >  32767.0f) e =  32767.0f;
+    if (e < -32768.0f) e = -32768.0f;
+    return (int16_t)e;
+}
+
+// Reference sample r, 0 if not yet (or no longer) in the history
+static inline bool ref_at(uint32_t head, uint32_t r, float *x)
+{
+    int32_t age = (int32_t)(head - r);   // 1 = newest reference sample
+    if (age > 0 && age <= AEC_REF_SAMPLES - AEC_REF_GUARD) {
+        *x = s_ref[r & (AEC_REF_SAMPLES - 1)];
+        return true;
+    }
+    *x = 0;
+    return false;
+}
+
+// Speaker silent for this chunk and the AEC_TAPS before it: there is no echo
+// to cancel and the filter would not adapt (window energy under
+// AEC_MIN_ENERGY), so the chunk passes through untouched
+static bool ref_silent(uint32_t head, uint32_t r0, size_t n)
+{
+    for (uint32_t r = r0 - (AEC_TAPS - 1); r != r0 + (uint32_t)n; r++) {
+        float x;
+        ref_at(head, r, &x);
+        if (x > AEC_IDLE_LEVEL || x < -AEC_IDLE_LEVEL) return false;
+    }
+    return true;
+}
+
+// Blocks until the TX ISR has pushed reference sample `need`, or the timeout
+static void wait_ref(uint32_t need)
+{
+    if ((int32_t)(need - s_ref_head) <= 0) return;
+    xSemaphoreTake(s_ref_sem, 0);   // a give that raced the last timeout
+    s_ref_need    = need;
+    s_ref_waiting = true;
+    if ((int32_t)(need - s_ref_head) > 0) {
+        xSemaphoreTake(s_ref_sem, pdMS_TO_TICKS(AEC_REF_WAIT_MS));
+    }
+    s_ref_waiting = false;
+}
+
+void aec_process(int16_t *mic, size_t n)
+{
+    uint32_t lost = s_rx_lost;
+    s_mic_idx  += lost - s_lost_seen;
+    s_lost_seen = lost;
+
+    if (!s_offset_valid) {   // TX has not completed a buffer yet
+        s_mic_idx += (uint32_t)n;
+        return;
+    }
+
+    // The echo in the newest samples comes from reference that may still be
+    // in the TX DMA; it completes within one buffer
+    uint32_t r0 = s_mic_idx + (uint32_t)s_offset;
+    wait_ref(r0 + (uint32_t)n);
+
+    uint32_t head = s_ref_head;
+    if (ref_silent(head, r0, n)) {
+        // Only the index moves.  The history restarts from zeros, which is
+        // what it held within AEC_IDLE_LEVEL; the filter keeps its weights.
+        if (!s_idle) {
+            memset(s_x, 0, sizeof(s_x));
+            s_xenergy = 0;
+            s_xpeak   = 0;
+            s_dpeak   = 0;
+            s_idle    = true;
+        }
+        s_mic_idx += (uint32_t)n;
+        return;
+    }
+    s_idle = false;
+
+    for (size_t i = 0; i < n; i++) {
+        float x;
+        if (!ref_at(head, r0 + (uint32_t)i, &x)) s_stats.ref_missing++;
+        mic[i] = aec_sample(x, mic[i]);
+    }
+    s_mic_idx += (uint32_t)n;
+
+    s_stats.erle_db = s_pe > 1.0f ? (int32_t)(10.0f * log10f(s_pd / s_pe)) : 0;
+    s_stats.doubletalk_ms = s_rate ? (uint32_t)((uint64_t)s_dt_samples * 1000 / s_rate) : 0;
+}
+
+void aec_get_stats(aec_stats_t *out)
+{
+    *out = s_stats;
+}
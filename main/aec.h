@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Acoustic echo canceller for the full-duplex conversation path.
+//
+// The reference is exactly what the speaker played: the I2S TX ISR pushes
+// every DMA buffer as it completes (silence included).  The mic side is
+// aligned to it by sample count — TX and RX share one I2S port and clock, so
+// once the offset between the two counters is stamped from the ISRs it never
+// drifts.  A normalised-LMS filter of AEC_TAPS then models speaker → mic and
+// subtracts the estimate from each mic sample, freezing adaptation while the
+// near end talks (Geigel double-talk detector) so barge-in speech survives.
+
+#define AEC_TAPS         256    // 16 ms echo tail at 16 kHz
+#define AEC_REF_SAMPLES  2048   // reference history (power of two), ~128 ms
+
+typedef struct {
+    int32_t  erle_db;         // echo return loss enhancement while far end plays
+    uint32_t doubletalk_ms;   // time adaptation was frozen for near-end speech
+    uint32_t ref_missing;     // mic samples processed without reference
+} aec_stats_t;
+
+// Both sides restart at sample 0 (new duplex session).  Not ISR-safe.
+void aec_reset(int sample_rate);
+
+// ISR side: n played samples (mono), and n mic samples received / dropped by
+// the RX DMA (in units of what the caller later passes to aec_process()).
+// aec_ref_push() returns true if it woke a task (the ISR should yield).
+bool aec_ref_push(const int16_t *pcm, size_t n);
+void aec_rx_mark(size_t n);
+void aec_rx_lost(size_t n);
+
+// Cancel echo in place, mic samples in arrival order.  May block up to one DMA
+// buffer for the reference of the newest samples to be played (woken by
+// aec_ref_push()).  While the speaker is silent only the sample index is
+// kept: no filtering, no adaptation.
+void aec_process(int16_t *mic, size_t n);
+
+void aec_get_stats(aec_stats_t *out);
@@ -4,6 +4,7 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
+#include <string.h>
 
 #include "events.h"
 #include "config.h"
@@ -15,47 +16,93 @@
 #include "wifi_prov.h"
 #include "power.h"
 #include "http.h"
+#include "http_pool.h"
+#include "mem_budget.h"
 #include "mqtt.h"
 #include "audio.h"
+#include "knob.h"
 #include "record.h"
 #include "stream_player.h"
+#include "io_expander.h"
 #include "battery.h"
 #include "improv.h"
+#include "i2c_bus.h"
+#include "boot_graph.h"
+#include "time_sync.h"
 
 static const char *TAG = "main";
 
 EventGroupHandle_t g_events;
 
-void app_main(void)
-{
-    ESP_LOGI(TAG, "=== CipherDolls Watcher ===");
+#define WIFI_CONNECT_TIMEOUT_MS  20000
 
-    // Core init
-    ESP_ERROR_CHECK(nvs_flash_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    g_events = xEventGroupCreate();
+// ── Boot stages ──────────────────────────────────────────────────────────────
+//
+// Declared as a graph (boot_graph.c): each stage starts as soon as what it
+// needs is up.  The display's power-on delay, Wi-Fi association and the
+// audio buffers no longer wait on one another, and MQTT and the player
+// start connecting as soon as the RAM budget exists.  Both of them wait for
+// EVT_DOLL_READY themselves, so the doll sync is not a stage they depend on.
 
-    // Load saved config
-    config_store_load();
+enum {
+    ST_I2C, ST_DISPLAY, ST_IOEXP, ST_BATTERY, ST_LED, ST_IMPROV, ST_WIFI,
+    ST_SNTP, ST_AUDIO, ST_KNOB, ST_MEM, ST_HTTP, ST_SYNC, ST_MQTT, ST_RECORD,
+    ST_PLAYER, ST_POWER, ST_COUNT,
+};
 
-    // Display (includes IO expander power-on + LVGL)
-    ESP_ERROR_CHECK(display_init());
-    display_set_state(DISPLAY_STATE_BOOT, "Starting...");
+static bool stage_i2c(void)
+{
+    return i2c_bus_init() == ESP_OK;
+}
 
-    // Battery monitor (ADC + display label, 30s interval)
-    battery_init();
+static bool stage_display(void)
+{
+    // Includes IO expander LCD power-on + LVGL
+    if (display_init() != ESP_OK) return false;
+    if (xEventGroupGetBits(g_events) & EVT_WIFI_GOT_IP) {
+        display_set_state(DISPLAY_STATE_WIFI_OK, "Connected!");
+    } else if (g_config.provisioned) {
+        display_set_state(DISPLAY_STATE_WIFI_CONNECTING, g_config.ssid);
+    } else {
+        display_set_state(DISPLAY_STATE_BOOT, "Starting...");
+    }
+    return true;
+}
 
-    // LED (solid white, deep sleep turns it off)
-    xTaskCreatePinnedToCore(led_task_fn, "led", 4096, NULL, 3, NULL, 1);
+static bool stage_ioexp(void)
+{
+    io_exp_init();   // a missing expander only costs the knob button
+    return true;
+}
 
-    // WiFi init (always needed)
-    wifi_mgr_init();
+static bool stage_battery(void)
+{
+    battery_init();  // ADC + display label, 30s interval
+    return true;
+}
+
+static bool stage_led(void)
+{
+    // Solid white, deep sleep turns it off
+    xTaskCreatePinnedToCore(led_task_fn, "led", 4096, NULL, 3, NULL, 1);
+    return true;
+}
 
+static bool stage_improv(void)
+{
     // Improv Wi-Fi Serial — always running so browser can provision via USB
     xTaskCreate(improv_task_fn, "improv", 4096, NULL, 3, NULL);
+    return true;
+}
+
+// Provisioned: connect and wait for an address.  First boot: run the
+// provisioning flow instead, and fail so nothing network-bound starts.
+static bool stage_wifi(void)
+{
+    wifi_mgr_init();
 
     if (!g_config.provisioned || strlen(g_config.ssid) == 0) {
-        // First boot — run provisioning flow
+        boot_graph_wait(ST_DISPLAY, portMAX_DELAY);
         display_set_state(DISPLAY_STATE_WIFI_PROV, "Setup WiFi");
         // Touch init (needed for keyboard input)
         touch_init();
@@ -64,29 +111,137 @@ void app_main(void)
         // Wait for provisioning to complete
         xEventGroupWaitBits(g_events, EVT_PROV_DONE, pdFALSE, pdFALSE, portMAX_DELAY);
         ESP_LOGI(TAG, "Provisioning done");
-    } else {
-        // Reconnect with saved credentials
-        display_set_state(DISPLAY_STATE_WIFI_CONNECTING, g_config.ssid);
-        wifi_mgr_connect(g_config.ssid, g_config.password);
-
-        EventBits_t bits = xEventGroupWaitBits(g_events,
-            EVT_WIFI_GOT_IP | EVT_WIFI_DISCONNECTED,
-            pdFALSE, pdFALSE, pdMS_TO_TICKS(20000));
-
-        if (bits & EVT_WIFI_GOT_IP) {
-            display_set_state(DISPLAY_STATE_WIFI_OK, "Connected!");
-            audio_init();
-            http_sync_doll();
-            mqtt_start();
-            record_init();
-            stream_player_init();
-        } else {
-            display_set_state(DISPLAY_STATE_ERROR, "WiFi failed\nHold button to re-setup");
-        }
+        return false;
     }
 
+    // Reconnect with saved credentials
+    wifi_mgr_connect(g_config.ssid, g_config.password);
+    EventBits_t bits = xEventGroupWaitBits(g_events,
+        EVT_WIFI_GOT_IP | EVT_WIFI_DISCONNECTED,
+        pdFALSE, pdFALSE, pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+    if (!(bits & EVT_WIFI_GOT_IP)) {
+        boot_graph_wait(ST_DISPLAY, portMAX_DELAY);
+        display_set_state(DISPLAY_STATE_ERROR, "WiFi failed\nHold button to re-setup");
+        return false;
+    }
+    display_set_state(DISPLAY_STATE_WIFI_OK, "Connected!");
+    return true;
+}
+
+static bool stage_sntp(void)
+{
+    // Refines the restored clock in the background; nothing waits for it
+    time_sync_start();
+    return true;
+}
+
+static bool stage_audio(void)
+{
+    audio_init();
+    return true;
+}
+
+static bool stage_knob(void)
+{
+    return knob_init();
+}
+
+static bool stage_mem(void)
+{
+    // Baseline: internal RAM free once Wi-Fi, the display and the audio
+    // buffers are up (boot worker stacks still count: errs on the low side)
+    mem_budget_init();
+    return true;
+}
+
+static bool stage_http(void)
+{
+    http_pool_init();
+    return true;
+}
+
+static bool stage_sync(void)
+{
+    http_sync_doll();
+    return true;
+}
+
+static bool stage_mqtt(void)
+{
+    mqtt_start();
+    return true;
+}
+
+static bool stage_record(void)
+{
+    record_init();
+    return true;
+}
+
+static bool stage_player(void)
+{
+    stream_player_init();
+    return true;
+}
+
+static bool stage_power(void)
+{
+    // Not while provisioning: it would blank the display mid-entry, and the
+    // device restarts once the credentials are saved
+    if (!g_config.provisioned || strlen(g_config.ssid) == 0) return true;
+
     // Power management (deep sleep on inactivity)
     xTaskCreate(power_task_fn, "power", 4096, NULL, 1, NULL);
+    return true;
+}
+
+#define D(x) BOOT_DEP(ST_##x)
+
+static const boot_stage_t k_stages[ST_COUNT] = {
+    [ST_I2C]     = { "i2c",      stage_i2c,      0 },
+    [ST_DISPLAY] = { "display",  stage_display,  D(I2C),                   40 * 1024 },
+    [ST_IOEXP]   = { "ioExp",    stage_ioexp,    D(I2C) },
+    [ST_BATTERY] = { "battery",  stage_battery,  D(DISPLAY) | D(IOEXP) },
+    [ST_LED]     = { "led",      stage_led,      0 },
+    [ST_IMPROV]  = { "improv",   stage_improv,   0 },
+    [ST_WIFI]    = { "wifi",     stage_wifi,     0,                        64 * 1024 },
+    [ST_SNTP]    = { "sntp",     stage_sntp,     D(WIFI) },
+    [ST_AUDIO]   = { "audio",    stage_audio,    D(I2C) },
+    [ST_KNOB]    = { "knob",     stage_knob,     D(AUDIO) },
+    [ST_MEM]     = { "memBudget", stage_mem,     D(WIFI) | D(AUDIO) | D(DISPLAY) },
+    [ST_HTTP]    = { "httpPool", stage_http,     D(MEM) },
+    [ST_SYNC]    = { "dollSync", stage_sync,     D(HTTP) | D(DISPLAY) },
+    [ST_MQTT]    = { "mqtt",     stage_mqtt,     D(MEM) | D(AUDIO) },
+    [ST_RECORD]  = { "record",   stage_record,   D(AUDIO) | D(DISPLAY) | D(WIFI) },
+    [ST_PLAYER]  = { "player",   stage_player,   D(MEM) | D(AUDIO) },
+    [ST_POWER]   = { "power",    stage_power,    D(DISPLAY) },
+};
+
+// Ready to talk: the doll is known, commands arrive, replies can stream
+static const boot_milestone_t k_milestones[] = {
+    { "wifiIp",    EVT_WIFI_GOT_IP },
+    { "dollReady", EVT_DOLL_READY },
+    { "mqttUp",    EVT_MQTT_CONNECTED },
+    { "playerUp",  EVT_STREAM_CONNECTED },
+};
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "=== CipherDolls Watcher ===");
+
+    // Core init
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    g_events = xEventGroupCreate();
+
+    // Load saved config
+    config_store_load();
+
+    // Wall clock for TLS from RTC / NVS, before any network
+    time_sync_restore();
+
+    boot_milestones_watch(k_milestones, sizeof(k_milestones) / sizeof(k_milestones[0]));
+    boot_graph_run(k_stages, ST_COUNT);
 
     // Main loop — keep task alive
     while (1) {
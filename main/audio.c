@@ -1,12 +1,18 @@
 #include "audio.h"
+#include "audio_src.h"
+#include "audio_cache.h"
+#include "aec.h"
+#include "dsp_pcm.h"
+#include "mp3_decoder.h"
+#include "opus_dec.h"
 #include "board.h"
 #include "config.h"
 #include "events.h"
 #include "display.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
-#include "esp_http_client.h"
-#include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "http_pool.h"
 #include "driver/i2s_std.h"
 #include "driver/i2c.h"
 #include "es8311.h"
@@ -14,59 +20,161 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
-#include "freertos/stream_buffer.h"
 #include "record.h"
+#include "spsc_ring.h"
+#include "i2c_bus.h"
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
 
 #define ES8311_ADDR         0x18  // ADDR pin low on SenseCAP Watcher
 #define I2S_MCLK_MULTIPLE   256   // matches I2S_STD_CLK_DEFAULT_CONFIG
 
-#define MINIMP3_IMPLEMENTATION
-#define MINIMP3_ONLY_MP3
-#include "minimp3.h"
+// TX DMA ring (IDF defaults, spelled out because the first-sample metric
+// counts descriptors)
+#define TX_DMA_DESC_NUM     6
+#define TX_DMA_FRAME_NUM    240
 
 static const char *TAG = "audio";
 
 static void update_play_rms(const int16_t *pcm, int samples)
 {
-    if (samples <= 0) { g_audio_rms = 0; return; }
-    uint64_t sum_sq = 0;
-    for (int i = 0; i < samples; i++) {
-        int32_t v = pcm[i];
-        sum_sq += (uint64_t)(v * v);
-    }
-    g_audio_rms = (uint16_t)sqrtf((float)sum_sq / samples);
+    g_audio_rms = samples > 0 ? dsp_rms_s16(pcm, (size_t)samples) : 0;
 }
 
 static i2s_chan_handle_t   s_tx_chan    = NULL;
 static QueueHandle_t      s_queue     = NULL;
 static SemaphoreHandle_t  s_play_mutex = NULL;
 static volatile bool      s_stop      = false;
+static audio_play_cb_t    s_play_cb;      // EVT_AUDIO_PLAYING edges (record.c)
 
-// PSRAM-allocated decode buffers — keeps internal SRAM free for TLS/WiFi/LVGL heap
-static mp3dec_t  *s_dec    = NULL;
+// PSRAM-allocated decode buffer — keeps internal SRAM free for TLS/WiFi/LVGL heap
+// (decoder state and scratch are owned by mp3_decoder.c)
 static int16_t   *s_pcm    = NULL;  // MINIMP3_MAX_SAMPLES_PER_FRAME*2 shorts
-static int16_t   *s_stereo = NULL;  // mono→stereo expansion buffer (same size)
 
-// Static task descriptor must be in DRAM; stack goes in PSRAM
+// Static task descriptors must be in DRAM; stacks go in PSRAM
 static StaticTask_t s_audio_tcb;
+static StaticTask_t s_writer_tcb;
 
 #define AUDIO_MSG_ID_MAX  80
-#define STREAM_BUF_SIZE   8192   // MP3 accumulation buffer (enough for several frames)
+
+// Compressed input window shared by all sources (allocated once, never per message)
+#define INPUT_WINDOW_BYTES  (16 * 1024)
+#define INPUT_MIRROR_BYTES  4096   // > 2 max-size MP3 frames + header, see play_source()
+#define INPUT_LOW_WATER     4096   // refill from the source below this many buffered bytes
+
+static uint8_t *s_win = NULL;      // INPUT_WINDOW_BYTES + INPUT_MIRROR_BYTES
+
+// Full-duplex output: one frame resampled to AUDIO_DUPLEX_HZ (room for 2×
+// upsampling of the largest mono MP3 frame and for any Opus packet)
+#define RESAMPLE_OUT_MAX    MINIMP3_MAX_SAMPLES_PER_FRAME
+static int16_t *s_resample = NULL;
+
+// ── PCM ring: decoder stage (producer) → I2S writer stage (consumer) ─────────
+// The decoder never touches I2S; it only pushes PCM into this ring.  The writer
+// task holds back output until the ring has PREBUF worth of audio, so network
+// stalls shorter than the prebuffer are absorbed instead of heard.
+//
+// An spsc_ring: the decoder copies in, and the writer hands spans of the ring
+// straight to i2s_channel_write, without the stream buffer's copy out into a
+// chunk buffer or its critical section per call.  Two binary semaphores
+// stand in for the stream buffer's blocking: data committed, space freed.
+
+#define PCM_RING_BYTES      (128 * 1024) // ~1.3 s of 24 kHz stereo 16-bit (power of two)
+#define PCM_WRITE_CHUNK     2048         // max bytes per i2s_channel_write from the writer
+#define WRITER_STACK_SIZE   4096
+
+#define PREBUF_MIN_MS       60     // floor for the adaptive prebuffer target
+#define PREBUF_MAX_MS       600    // ceiling (must stay well below ring capacity)
+#define PREBUF_JITTER_MULT  4      // target = MIN + MULT × smoothed jitter + bias
+#define PREBUF_BIAS_STEP_MS 40     // added after every underrun, decays on clean utterances
+
+static spsc_ring_t          s_pcm_ring;
+static uint8_t             *s_pcm_ring_storage;
+static SemaphoreHandle_t    s_pcm_data;    // given by the decoder after a commit
+static SemaphoreHandle_t    s_pcm_space;   // given by the writer after a consume
+
+static TaskHandle_t       s_writer_task  = NULL;
+static SemaphoreHandle_t  s_writer_done  = NULL;  // given when a session is drained
+static volatile bool      s_writer_eos   = false; // decoder has pushed its last frame
+static volatile uint32_t  s_out_bytes_per_s = 0;  // PCM byte rate of current session
+
+// Arrival jitter (RFC 3550-style smoothing of how late each decoded frame is
+// relative to the media time of the frame before it)
+static int64_t  s_last_push_us;
+static int64_t  s_last_push_media_us;
+static int32_t  s_jitter_us;
+static uint32_t s_prebuf_bias_ms;
+
+static audio_stats_t s_stats;
 
 typedef struct {
-    char message_id[AUDIO_MSG_ID_MAX];
+    char    message_id[AUDIO_MSG_ID_MAX];
+    int64_t requested_us;   // esp_timer time the play request arrived
 } play_req_t;
 
-// ── I2S ──────────────────────────────────────────────────────────────────────
+// ── I2S TX ───────────────────────────────────────────────────────────────────
+// The TX channel and the codec outlive a single message: the first utterance
+// creates them, later ones only re-clock when the sample rate (or slot mode)
+// actually changes.  Between utterances the codec sits muted with clocks
+// running for AUDIO_TX_WARM_MS, then everything is released.  The mic RX
+// channel shares MCLK/BCLK/WS with TX, so audio_speaker_mute() releases an
+// idle channel immediately.
+
+static es8311_handle_t    s_codec = NULL;
+
+// The ES8311 component runs its own transactions on AUDIO_I2C_PORT, so every
+// call holds the arbitrated bus (i2c_bus.c), where the codec goes first
+static void codec_bus_take(void) { i2c_bus_acquire(I2C_CLIENT_CODEC, I2C_BUS_WAIT_FOREVER); }
+static void codec_bus_give(void) { i2c_bus_release(I2C_CLIENT_CODEC); }
+
+static void codec_silence(void)
+{
+    codec_bus_take();
+    es8311_voice_volume_set(s_codec, 0, NULL);
+    es8311_voice_mute(s_codec, true);
+    codec_bus_give();
+}
+
+static void codec_unmute(int volume)
+{
+    codec_bus_take();
+    es8311_voice_mute(s_codec, false);
+    es8311_voice_volume_set(s_codec, volume, NULL);
+    codec_bus_give();
+}
+
+static void codec_set_rate(int sample_rate)
+{
+    codec_bus_take();
+    ESP_ERROR_CHECK(es8311_sample_frequency_config(s_codec, I2S_MCLK_MULTIPLE * sample_rate, sample_rate));
+    codec_bus_give();
+}
 
-static es8311_handle_t s_codec = NULL;
+static SemaphoreHandle_t  s_tx_lock;          // guards every s_tx_* field below
+static esp_timer_handle_t s_tx_idle_timer;
+static int                s_tx_rate     = 0;
+static int                s_tx_channels = 0;
+static bool               s_tx_enabled  = false;
+static bool               s_tx_in_use   = false;  // between tx_acquire() and tx_park()
+static int                s_volume;     // g_config.speaker_volume at init; applied whenever the codec unmutes
+
+// Full duplex (conversation mode): RX is created alongside TX on the same
+// port and both run until audio_duplex_end().  TX stays at AUDIO_DUPLEX_HZ
+// mono, clocked and never released, and every buffer it sends is the echo
+// canceller's reference.
+static i2s_chan_handle_t  s_duplex_rx   = NULL;
+static size_t             s_duplex_rx_bytes_per_sample = 1;
+
+// Request → first DMA sample: the writer arms the countdown right before its
+// first write of a session; the descriptor receiving that write starts playing
+// once the TX_DMA_DESC_NUM descriptors ahead of it (including the one whose
+// completion freed it) have been sent.
+static int64_t            s_session_t0_us;
+static volatile int32_t   s_first_countdown = 0;
 
 static void codec_init(int sample_rate)
 {
-    // I2C is already initialized by display.c (lcd_power_on uses AUDIO_I2C_PORT)
+    // I2C is already initialized (boot stage "i2c", i2c_bus_init)
     s_codec = es8311_create(AUDIO_I2C_PORT, ES8311_ADDR);
     if (!s_codec) {
         ESP_LOGE(TAG, "ES8311 create failed");
@@ -79,194 +187,603 @@ static void codec_init(int sample_rate)
         .mclk_from_mclk_pin = true,
         .sample_frequency   = sample_rate,
     };
+    codec_bus_take();
     ESP_ERROR_CHECK(es8311_init(s_codec, &clk, ES8311_RESOLUTION_16, ES8311_RESOLUTION_16));
     ESP_ERROR_CHECK(es8311_sample_frequency_config(s_codec, I2S_MCLK_MULTIPLE * sample_rate, sample_rate));
-    ESP_ERROR_CHECK(es8311_voice_volume_set(s_codec, 70, NULL));
+    ESP_ERROR_CHECK(es8311_voice_volume_set(s_codec, s_volume, NULL));
     ESP_ERROR_CHECK(es8311_microphone_config(s_codec, false));
-    ESP_LOGI(TAG, "ES8311 initialized at %d Hz, volume 70", sample_rate);
+    codec_bus_give();
+    ESP_LOGI(TAG, "ES8311 initialized at %d Hz, volume %d", sample_rate, s_volume);
 }
 
-static void i2s_start(int sample_rate)
+static bool IRAM_ATTR tx_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event,
+                                 void *user_ctx)
 {
-    if (s_tx_chan) {
-        i2s_channel_disable(s_tx_chan);
-        i2s_del_channel(s_tx_chan);
-        s_tx_chan = NULL;
+    if (s_first_countdown > 0 && --s_first_countdown == 0) {
+        s_stats.first_sample_ms =
+            (uint32_t)((esp_timer_get_time() - s_session_t0_us) / 1000);
+    }
+    if (s_duplex_rx) {
+        // IDF 5.2: data points at the descriptor's buffer pointer; auto_clear
+        // zeroes the buffer only after this callback
+        return aec_ref_push(*(const int16_t **)event->data, event->size / sizeof(int16_t));
     }
+    return false;
+}
+
+static bool IRAM_ATTR rx_on_recv(i2s_chan_handle_t handle, i2s_event_data_t *event,
+                                 void *user_ctx)
+{
+    aec_rx_mark(event->size / s_duplex_rx_bytes_per_sample);
+    return false;
+}
 
+static bool IRAM_ATTR rx_on_recv_q_ovf(i2s_chan_handle_t handle, i2s_event_data_t *event,
+                                       void *user_ctx)
+{
+    aec_rx_lost(event->size / s_duplex_rx_bytes_per_sample);
+    return false;
+}
+
+// Mono streams use the native mono slot mode: the same sample is clocked out
+// on both slots, so the decoder never expands to stereo.
+static i2s_std_slot_config_t tx_slot_cfg(int channels)
+{
+    i2s_std_slot_config_t slot = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(
+        I2S_DATA_BIT_WIDTH_16BIT,
+        channels == 1 ? I2S_SLOT_MODE_MONO : I2S_SLOT_MODE_STEREO);
+    slot.slot_mask = I2S_STD_SLOT_BOTH;
+    return slot;
+}
+
+// rx_slot != NULL creates the full-duplex pair (RX into s_duplex_rx)
+static void tx_create_locked(int sample_rate, int channels,
+                             const i2s_std_slot_config_t *rx_slot)
+{
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_PORT, I2S_ROLE_MASTER);
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &s_tx_chan, NULL));
+    chan_cfg.dma_desc_num  = TX_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = TX_DMA_FRAME_NUM;
+    chan_cfg.auto_clear    = true;  // DMA sends silence (not stale audio) when idle
+    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &s_tx_chan,
+                                    rx_slot ? &s_duplex_rx : NULL));
 
     i2s_std_config_t std_cfg = {
         .clk_cfg  = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate),
-        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO),
+        .slot_cfg = tx_slot_cfg(channels),
         .gpio_cfg = {
             .mclk         = I2S_MCLK,
             .bclk         = I2S_BCLK,
             .ws           = I2S_WS,
             .dout         = I2S_DOUT,
-            .din          = I2S_GPIO_UNUSED,
+            .din          = rx_slot ? I2S_DIN : I2S_GPIO_UNUSED,
             .invert_flags = { .mclk_inv = false, .bclk_inv = false, .ws_inv = false },
         },
     };
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(s_tx_chan, &std_cfg));
+
+    i2s_event_callbacks_t cbs = { .on_sent = tx_on_sent };
+    ESP_ERROR_CHECK(i2s_channel_register_event_callback(s_tx_chan, &cbs, NULL));
+
+    if (rx_slot) {
+        // Same clock and pins, the mic's own slot layout
+        i2s_std_config_t rx_cfg = std_cfg;
+        rx_cfg.slot_cfg = *rx_slot;
+        ESP_ERROR_CHECK(i2s_channel_init_std_mode(s_duplex_rx, &rx_cfg));
+        i2s_event_callbacks_t rx_cbs = {
+            .on_recv       = rx_on_recv,
+            .on_recv_q_ovf = rx_on_recv_q_ovf,
+        };
+        ESP_ERROR_CHECK(i2s_channel_register_event_callback(s_duplex_rx, &rx_cbs, NULL));
+    }
+
     ESP_ERROR_CHECK(i2s_channel_enable(s_tx_chan));
+    s_tx_enabled = true;
+    if (rx_slot) ESP_ERROR_CHECK(i2s_channel_enable(s_duplex_rx));
 
     // Configure codec sample rate now that MCLK is running from I2S
     if (s_codec) {
-        ESP_ERROR_CHECK(es8311_sample_frequency_config(s_codec, I2S_MCLK_MULTIPLE * sample_rate, sample_rate));
-        es8311_voice_mute(s_codec, false);
-        ESP_ERROR_CHECK(es8311_voice_volume_set(s_codec, 70, NULL));
+        codec_set_rate(sample_rate);
     } else {
         codec_init(sample_rate);
     }
-
-    ESP_LOGI(TAG, "I2S started: %d Hz stereo (Philips)", sample_rate);
+    ESP_LOGI(TAG, "I2S TX%s created: %d Hz %s", rx_slot ? "+RX" : "", sample_rate,
+             channels == 1 ? "mono" : "stereo");
 }
 
-static void i2s_stop_ch(void)
+static void tx_release_locked(void)
 {
+    esp_timer_stop(s_tx_idle_timer);
+    if (s_codec) {
+        codec_silence();
+    }
+    if (s_duplex_rx) {
+        i2s_channel_disable(s_duplex_rx);
+        i2s_del_channel(s_duplex_rx);
+        s_duplex_rx = NULL;
+    }
     if (s_tx_chan) {
-        i2s_channel_disable(s_tx_chan);
+        if (s_tx_enabled) i2s_channel_disable(s_tx_chan);
         i2s_del_channel(s_tx_chan);
         s_tx_chan = NULL;
+        ESP_LOGI(TAG, "I2S TX released");
     }
+    s_tx_enabled  = false;
+    s_tx_rate     = 0;
+    s_tx_channels = 0;
 }
 
-// ── Stream-decode: download MP3 + decode + play simultaneously ────────────────
-// Opens HTTP GET, reads chunks into a small buffer, decodes MP3 frames as they
-// arrive, and plays them via I2S immediately.  No waiting for the full download.
-
-static void stream_play_mp3(const char *message_id)
+// Bring the output path up for a stream.  A warm channel at the same format is
+// reused as-is — the only I2C traffic is the unmute.  In full duplex the
+// format is pinned (play_out() converts to it).
+static void tx_acquire(int sample_rate, int channels)
 {
-    if (xSemaphoreTake(s_play_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        ESP_LOGW(TAG, "Audio busy, skipping HTTP play for %s", message_id);
-        return;
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    esp_timer_stop(s_tx_idle_timer);
+    s_tx_in_use = true;
+
+    if (s_duplex_rx) {
+        sample_rate = AUDIO_DUPLEX_HZ;
+        channels    = 1;
     }
 
-    uint8_t *sbuf = heap_caps_malloc(STREAM_BUF_SIZE,
-                                      MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!sbuf) {
-        ESP_LOGE(TAG, "No memory for stream buffer");
-        xSemaphoreGive(s_play_mutex);
-        return;
+    if (!s_tx_chan) {
+        tx_create_locked(sample_rate, channels, NULL);
+    } else if (sample_rate != s_tx_rate || channels != s_tx_channels) {
+        if (s_tx_enabled) i2s_channel_disable(s_tx_chan);
+        if (sample_rate != s_tx_rate) {
+            i2s_std_clk_config_t clk = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
+            ESP_ERROR_CHECK(i2s_channel_reconfig_std_clock(s_tx_chan, &clk));
+        }
+        if (channels != s_tx_channels) {
+            i2s_std_slot_config_t slot = tx_slot_cfg(channels);
+            ESP_ERROR_CHECK(i2s_channel_reconfig_std_slot(s_tx_chan, &slot));
+        }
+        ESP_ERROR_CHECK(i2s_channel_enable(s_tx_chan));
+        s_tx_enabled = true;
+        if (sample_rate != s_tx_rate && s_codec) {
+            codec_set_rate(sample_rate);
+        }
+        ESP_LOGI(TAG, "I2S TX re-clocked: %d Hz %s", sample_rate,
+                 channels == 1 ? "mono" : "stereo");
+    } else if (!s_tx_enabled) {
+        ESP_ERROR_CHECK(i2s_channel_enable(s_tx_chan));
+        s_tx_enabled = true;
     }
+    s_tx_rate     = sample_rate;
+    s_tx_channels = channels;
 
-    char url[256], auth[128];
-    snprintf(url,  sizeof(url),  "%s/messages/%s/audio",
-             g_config.server_url, message_id);
-    snprintf(auth, sizeof(auth), "Bearer %s", g_config.apikey);
+    if (s_codec) {
+        codec_unmute(s_volume);
+    }
+    xSemaphoreGive(s_tx_lock);
+}
 
-    esp_http_client_config_t cfg = {
-        .url               = url,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .buffer_size       = 4096,
-        .timeout_ms        = 20000,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    esp_http_client_set_header(client, "Authorization", auth);
+// End of an utterance: mute but keep clocks running so the next one starts
+// without channel allocation or codec setup.
+static void tx_park(void)
+{
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    s_tx_in_use = false;
+    if (s_codec) {
+        codec_bus_take();
+        es8311_voice_mute(s_codec, true);
+        codec_bus_give();
+    }
+    if (s_tx_chan && !s_duplex_rx) {
+        esp_timer_stop(s_tx_idle_timer);
+        esp_timer_start_once(s_tx_idle_timer, (uint64_t)AUDIO_TX_WARM_MS * 1000);
+    }
+    xSemaphoreGive(s_tx_lock);
+}
 
-    bool i2s_started = false;
+static void tx_idle_timer_cb(void *arg)
+{
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (!s_tx_in_use && !s_duplex_rx) tx_release_locked();
+    xSemaphoreGive(s_tx_lock);
+}
 
-    if (esp_http_client_open(client, 0) != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP open failed for %s", message_id);
-        goto cleanup;
+// Time for everything already queued in the DMA ring to reach the codec
+static uint32_t tx_dma_drain_ms(void)
+{
+    if (s_tx_rate <= 0) return 0;
+    return (uint32_t)(TX_DMA_DESC_NUM * TX_DMA_FRAME_NUM * 1000 / s_tx_rate) + 1;
+}
+
+// ── PCM output stage ─────────────────────────────────────────────────────────
+
+static uint32_t prebuf_target_ms(void)
+{
+    uint32_t ms = PREBUF_MIN_MS
+                + PREBUF_JITTER_MULT * (uint32_t)(s_jitter_us / 1000)
+                + s_prebuf_bias_ms;
+    if (ms > PREBUF_MAX_MS) ms = PREBUF_MAX_MS;
+    return ms;
+}
+
+static void i2s_writer_task(void *arg)
+{
+    while (1) {
+        // Wait for the decoder to open a session (pcm_out_begin)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        bool     prebuffering = true;
+        bool     underran     = false;
+        bool     first_write  = true;
+        size_t   target       = 0;
+
+        while (1) {
+            if (s_stop) {
+                // Drop whatever is queued — playback was cancelled
+                spsc_ring_trim(&s_pcm_ring, 0);
+                xSemaphoreGive(s_pcm_space);
+                break;
+            }
+
+            if (prebuffering) {
+                if (target == 0) {
+                    s_stats.prebuffer_ms = prebuf_target_ms();
+                    s_stats.prebuffers++;
+                    target = (size_t)((uint64_t)s_out_bytes_per_s *
+                                      s_stats.prebuffer_ms / 1000);
+                }
+                if (spsc_ring_used(&s_pcm_ring) < target && !s_writer_eos) {
+                    xSemaphoreTake(s_pcm_data, pdMS_TO_TICKS(10));
+                    continue;
+                }
+                prebuffering = false;
+                target = 0;
+            }
+
+            const uint8_t *span;
+            size_t got = spsc_ring_peek(&s_pcm_ring, &span);
+            if (got == 0) {
+                xSemaphoreTake(s_pcm_data, pdMS_TO_TICKS(10));
+                got = spsc_ring_peek(&s_pcm_ring, &span);
+            }
+            if (got == 0) {
+                if (s_writer_eos && spsc_ring_used(&s_pcm_ring) == 0)
+                    break;   // session fully played
+                // Ring ran dry mid-utterance — refill before resuming
+                s_stats.underruns++;
+                underran = true;
+                s_prebuf_bias_ms += PREBUF_BIAS_STEP_MS;
+                if (s_prebuf_bias_ms > PREBUF_MAX_MS) s_prebuf_bias_ms = PREBUF_MAX_MS;
+                prebuffering = true;
+                ESP_LOGW(TAG, "PCM underrun #%lu, rebuffering %lu ms",
+                         (unsigned long)s_stats.underruns,
+                         (unsigned long)prebuf_target_ms());
+                continue;
+            }
+
+            if (got > PCM_WRITE_CHUNK) got = PCM_WRITE_CHUNK;
+            update_play_rms((const int16_t *)span, got / sizeof(int16_t));
+
+            if (first_write) {
+                s_first_countdown = TX_DMA_DESC_NUM;
+                first_write = false;
+            }
+            size_t written = 0;
+            i2s_channel_write(s_tx_chan, span, got, &written, pdMS_TO_TICKS(2000));
+            spsc_ring_consume(&s_pcm_ring, got);
+            xSemaphoreGive(s_pcm_space);
+        }
+
+        // Clean utterance → let the bias relax back toward the jitter estimate
+        if (!underran && s_prebuf_bias_ms > 0) {
+            s_prebuf_bias_ms -= s_prebuf_bias_ms < PREBUF_BIAS_STEP_MS / 2
+                              ? s_prebuf_bias_ms : PREBUF_BIAS_STEP_MS / 2;
+        }
+        g_audio_rms = 0;
+        xSemaphoreGive(s_writer_done);
     }
+}
 
-    esp_http_client_fetch_headers(client);
-    int status = esp_http_client_get_status_code(client);
-    if (status != 200) {
-        ESP_LOGE(TAG, "HTTP %d for %s", status, message_id);
-        goto cleanup;
+// Called by the decoder once I2S is running at the session's format.
+static void pcm_out_begin(int sample_rate, int channels)
+{
+    s_out_bytes_per_s = (uint32_t)sample_rate * channels * sizeof(int16_t);
+    s_writer_eos      = false;
+    s_last_push_us    = 0;
+    xSemaphoreTake(s_writer_done, 0);  // clear any stale completion
+    xTaskNotifyGive(s_writer_task);
+}
+
+// Push decoded PCM into the ring; blocks while the ring is full.
+static void pcm_out_write(const void *pcm, size_t bytes)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_last_push_us) {
+        int64_t late = (now - s_last_push_us) - s_last_push_media_us;
+        if (late < 0) late = 0;
+        s_jitter_us += (int32_t)((late - s_jitter_us) / 16);
+    }
+    s_last_push_us       = now;
+    s_last_push_media_us = (int64_t)bytes * 1000000 / s_out_bytes_per_s;
+    s_stats.jitter_ms    = (uint32_t)(s_jitter_us / 1000);
+
+    const uint8_t *p = pcm;
+    while (bytes > 0 && !s_stop) {
+        size_t sent = spsc_ring_write(&s_pcm_ring, p, bytes);
+        if (sent) xSemaphoreGive(s_pcm_data);
+        p     += sent;
+        bytes -= sent;
+        if (bytes) xSemaphoreTake(s_pcm_space, pdMS_TO_TICKS(100));
     }
+}
 
-    ESP_LOGI(TAG, "Streaming MP3 for msg %s", message_id);
+// Mark end of stream and block until the writer has played everything out.
+static void pcm_out_finish(void)
+{
+    s_writer_eos = true;
+    xSemaphoreTake(s_writer_done, portMAX_DELAY);
+}
 
-    mp3dec_init(s_dec);
-    s_stop = false;
-    xEventGroupSetBits(g_events, EVT_AUDIO_PLAYING);
-    display_set_state(DISPLAY_STATE_PLAYING, "Playing...");
+// ── Playback engine: one decode loop for every audio_src_t ───────────────────
+// Streaming sources land in a wrap-around input window.  Bytes that wrap past
+// the end are also mirrored into INPUT_MIRROR_BYTES of slack after it, so any
+// frame is always contiguous and minimp3 decodes straight out of the window —
+// no per-frame memmove, and the only extra copy is the mirrored head once per
+// lap.  Memory-resident sources skip the window and decode in place.
+
+static void window_mirror(size_t idx, size_t len)
+{
+    if (idx < INPUT_MIRROR_BYTES) {
+        size_t n = INPUT_MIRROR_BYTES - idx;
+        if (n > len) n = len;
+        memcpy(s_win + INPUT_WINDOW_BYTES + idx, s_win + idx, n);
+    }
+}
+
+// Output format follows the decoded stream: I2S is brought up on the first
+// frame and re-clocked when a later item of a gapless sequence changes format.
+// In full duplex the port stays at AUDIO_DUPLEX_HZ mono for the mic, so the
+// stream is folded onto it instead: L+R downmix, then low-pass and linear
+// resample.  RX and TX share the port's clocks, and with keyword spotting the
+// mic runs between conversations too, so TX cannot follow the stream's rate.
+typedef struct {
+    bool            started;
+    int             hz, ch;
+    int             rs_hz;    // input rate the resampler is set up for
+    dsp_resampler_t rs;
+} play_out_t;
+
+static void play_out(play_out_t *o, int16_t *pcm, int samples, int hz, int ch)
+{
+    if (s_duplex_rx && (hz != AUDIO_DUPLEX_HZ || ch != 1)) {
+        if (ch == 2) dsp_downmix_s16(pcm, pcm, (size_t)samples);
+        if (hz != AUDIO_DUPLEX_HZ) {
+            if (o->rs_hz != hz) {
+                dsp_resampler_init(&o->rs, hz, AUDIO_DUPLEX_HZ);
+                o->rs_hz = hz;
+            }
+            samples = (int)dsp_resample_s16(&o->rs, pcm, (size_t)samples,
+                                            s_resample, RESAMPLE_OUT_MAX);
+            pcm = s_resample;
+        }
+        hz = AUDIO_DUPLEX_HZ;
+        ch = 1;
+    }
+    if (!o->started || hz != o->hz || ch != o->ch) {
+        if (o->started) pcm_out_finish();
+        tx_acquire(hz, ch);
+        pcm_out_begin(hz, ch);
+        o->started = true;
+        o->hz      = hz;
+        o->ch      = ch;
+    }
+    pcm_out_write(pcm, (size_t)samples * ch * sizeof(int16_t));
+}
+
+// One MP3 item.  Returns the source's terminal read() code (AUDIO_SRC_EOF for
+// memory sources) or 0 when stopped.
+static int play_mp3_item(audio_src_t *src, play_out_t *o)
+{
+    bool   src_done  = (src->mem != NULL);
+    bool   need_more = false;
+    int    src_end   = src->mem ? AUDIO_SRC_EOF : 0;
+    size_t rd = 0, wr = 0;   // monotonic window positions (bytes)
 
-    size_t buf_fill = 0;
-    bool   http_done = false;
+    mp3_decoder_reset();
 
     while (!s_stop) {
-        // ── Fill buffer from HTTP ────────────────────────────────────────────
-        if (!http_done && buf_fill < STREAM_BUF_SIZE) {
-            int rd = esp_http_client_read(client,
-                        (char *)(sbuf + buf_fill),
-                        STREAM_BUF_SIZE - buf_fill);
-            if (rd > 0) {
-                buf_fill += rd;
-            } else {
-                http_done = true;
+        const uint8_t *data;
+        size_t         avail;
+
+        if (src->mem) {
+            data  = src->mem + rd;
+            avail = src->mem_len - rd;
+        } else {
+            // ── Top up the window when it runs low (or a frame is split) ────
+            if (!src_done && (need_more || wr - rd < INPUT_LOW_WATER)) {
+                size_t idx    = wr % INPUT_WINDOW_BYTES;
+                size_t space  = INPUT_WINDOW_BYTES - (wr - rd);
+                size_t contig = INPUT_WINDOW_BYTES - idx;
+                size_t want   = space < contig ? space : contig;
+                if (want > 0) {
+                    int n = src->read(src, s_win + idx, want);
+                    if (n > 0) {
+                        window_mirror(idx, (size_t)n);
+                        audio_cache_capture(s_win + idx, (size_t)n);
+                        wr += (size_t)n;
+                    } else if (n < 0) {
+                        src_end  = n;
+                        src_done = true;
+                    } else if (need_more || wr == rd) {
+                        // Nothing arrived and nothing to decode: never spin,
+                        // even on a source whose read() does not block
+                        vTaskDelay(1);
+                    }
+                }
+                need_more = false;
             }
+
+            size_t idx = rd % INPUT_WINDOW_BYTES;
+            avail = wr - rd;
+            if (avail > INPUT_WINDOW_BYTES + INPUT_MIRROR_BYTES - idx)
+                avail = INPUT_WINDOW_BYTES + INPUT_MIRROR_BYTES - idx;
+            data = s_win + idx;
         }
 
-        if (buf_fill == 0) break;
+        if (avail == 0) {
+            if (src_done) break;   // item ended, no more data
+            continue;              // else wait for more data
+        }
 
         // ── Decode one MP3 frame ─────────────────────────────────────────────
         mp3dec_frame_info_t info = {};
-        int samples = mp3dec_decode_frame(s_dec, sbuf, (int)buf_fill,
-                                           s_pcm, &info);
+        int samples = mp3_decoder_decode(data, (int)avail, s_pcm, &info);
 
         if (info.frame_bytes == 0) {
-            if (http_done) break;   // no more data, no more frames
-            continue;               // need more data from network
+            if (src_done) break;   // no more data, no more frames
+            need_more = true;      // else frame straddles the fill level
+            continue;
         }
-
-        // Consume decoded bytes
-        buf_fill -= info.frame_bytes;
-        if (buf_fill > 0)
-            memmove(sbuf, sbuf + info.frame_bytes, buf_fill);
+        rd += info.frame_bytes;
 
         if (samples <= 0) continue;  // ID3 / padding frame
 
-        // Init I2S once we know the sample rate from the first decoded frame
-        if (!i2s_started) {
-            i2s_start(info.hz);
-            i2s_started = true;
-        }
+        // ── Hand decoded PCM (mono or interleaved stereo) to the writer ──────
+        play_out(o, s_pcm, samples, info.hz, info.channels);
+    }
+    return s_stop ? 0 : src_end;
+}
 
-        // ── Play decoded PCM ─────────────────────────────────────────────────
-        int16_t *out   = s_pcm;
-        size_t   bytes = (size_t)samples * info.channels * sizeof(int16_t);
+// One Opus item: one packet per read(), packets the source lost (or that
+// fail to decode) concealed in their place so the media clock keeps running.
+// The packet is staged in the MP3 input window, which is idle meanwhile.
+static int play_opus_item(audio_src_t *src, play_out_t *o)
+{
+    unsigned corrupt = 0;   // undecodable packets, concealed with the next gap
 
-        update_play_rms(s_pcm, samples);
+    opus_dec_reset();
 
-        if (info.channels == 1) {
-            for (int i = 0; i < samples; i++) {
-                s_stereo[i * 2]     = s_pcm[i];
-                s_stereo[i * 2 + 1] = s_pcm[i];
-            }
-            out   = s_stereo;
-            bytes = (size_t)samples * 2 * sizeof(int16_t);
+    while (!s_stop) {
+        src->lost = 0;
+        int n = src->read(src, s_win, AUDIO_SRC_PACKET_MAX);
+        if (n < 0) return n;
+        if (n == 0) {           // nothing yet; the writer rides out the gap
+            vTaskDelay(1);      // (and a read() that does not block can't spin)
+            continue;
+        }
+
+        unsigned lost = src->lost + corrupt;
+        if (lost > OPUS_DEC_MAX_CONCEAL) lost = OPUS_DEC_MAX_CONCEAL;
+        for (unsigned i = 0; i < lost; i++) {
+            bool last    = (i == lost - 1);
+            int  samples = opus_dec_conceal(last ? s_win : NULL, n, s_pcm);
+            if (samples > 0) play_out(o, s_pcm, samples, OPUS_DEC_HZ, OPUS_DEC_CHANNELS);
         }
 
-        size_t written = 0;
-        i2s_channel_write(s_tx_chan, out, bytes, &written, pdMS_TO_TICKS(2000));
+        int samples = opus_dec_decode(s_win, n, s_pcm);
+        corrupt = (samples < 0);
+        if (samples > 0) play_out(o, s_pcm, samples, OPUS_DEC_HZ, OPUS_DEC_CHANNELS);
     }
+    return 0;
+}
+
+static void play_source(audio_src_t *src)
+{
+    play_out_t out = {};
 
-    if (i2s_started) {
-        // Flush DMA with silence to prevent echo/artifact at end
-        memset(s_pcm, 0, MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t));
-        size_t zw = 0;
-        i2s_channel_write(s_tx_chan, s_pcm, MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t), &zw, pdMS_TO_TICKS(500));
-        vTaskDelay(pdMS_TO_TICKS(50));
-        i2s_stop_ch();
+    s_stop = false;
+    xEventGroupSetBits(g_events, EVT_AUDIO_PLAYING);
+    if (s_play_cb) s_play_cb(true);
+    display_set_state(DISPLAY_STATE_PLAYING, "Playing...");
+
+    // Items of a gapless sequence share the writer session; only the decoder
+    // (bit reservoir / overlap state) and the input window start over
+    int end;
+    do {
+        if (src->codec == AUDIO_CODEC_OPUS && !src->mem) {
+            end = play_opus_item(src, &out);
+        } else {
+            end = play_mp3_item(src, &out);
+        }
+    } while (end == AUDIO_SRC_NEXT && !s_stop);
+
+    if (end == AUDIO_SRC_ERR) ESP_LOGW(TAG, "Source error, finishing playback");
+
+    if (out.started) {
+        // Let the writer play out the ring, then the DMA tail (auto_clear
+        // follows it with silence), before muting
+        pcm_out_finish();
+        if (s_stop) {
+            // The writer trimmed the ring and left, but a frame this task
+            // committed after that would open the next message.  Both sides
+            // are idle now, so start the ring (and its wake-ups) over
+            spsc_ring_reset(&s_pcm_ring);
+            xSemaphoreTake(s_pcm_data, 0);
+            xSemaphoreTake(s_pcm_space, 0);
+        }
+        vTaskDelay(pdMS_TO_TICKS(tx_dma_drain_ms()));
+        tx_park();
     }
 
+    // Only a stream played to its end is worth caching
+    audio_cache_capture_end(!s_stop && end != AUDIO_SRC_ERR);
+
     g_audio_rms = 0;
     xEventGroupClearBits(g_events, EVT_AUDIO_PLAYING);
+    if (s_play_cb) s_play_cb(false);
 
     // Restore display
-    const char *msg = strlen(g_config.chat_id) > 0 ? "" : "No chat linked";
+    const char *msg = config_has_chat() ? "" : "No chat linked";
     display_set_state(DISPLAY_STATE_WIFI_OK, msg);
+}
+
+// ── HTTP playback: download MP3 + decode + play simultaneously ───────────────
+
+static void stream_play_mp3(const play_req_t *req)
+{
+    const char *message_id = req->message_id;
+    if (xSemaphoreTake(s_play_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGW(TAG, "Audio busy, skipping HTTP play for %s", message_id);
+        return;
+    }
+
+    // Replays and repeats are served from flash: no network, no TLS
+    audio_src_t src;
+    if (audio_cache_open(message_id, &src)) {
+        ESP_LOGI(TAG, "Playing cached MP3 for msg %s", message_id);
+        s_session_t0_us = req->requested_us;
+        play_source(&src);
+        audio_src_close(&src);
+        xSemaphoreGive(s_play_mutex);
+        return;
+    }
+
+    char url[256];
+    snprintf(url, sizeof(url), "%s/messages/%s/audio", g_config.server_url, message_id);
+
+    esp_http_client_handle_t client = http_pool_acquire(url, NULL, NULL);
+    bool keep = false;
+    if (!client) goto cleanup;
+
+    if (http_pool_open(client) != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP open failed for %s", message_id);
+        goto cleanup;
+    }
+
+    int status = esp_http_client_get_status_code(client);
+    if (status != 200) {
+        ESP_LOGE(TAG, "HTTP %d for %s", status, message_id);
+        goto cleanup;
+    }
+
+    ESP_LOGI(TAG, "Streaming MP3 for msg %s", message_id);
+    s_session_t0_us = req->requested_us;
+
+    audio_src_http(&src, client);
+    audio_cache_capture_begin(message_id);
+    play_source(&src);
+
+    // A skipped or failed stream leaves the body half-read: the connection
+    // can only go back to the pool when the response ended cleanly
+    keep = esp_http_client_is_complete_data_received(client);
 
 cleanup:
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
-    free(sbuf);
+    http_pool_release(client, keep);
     xSemaphoreGive(s_play_mutex);
 }
 
@@ -277,7 +794,7 @@ static void audio_play_task(void *arg)
     play_req_t req;
     while (1) {
         if (xQueueReceive(s_queue, &req, portMAX_DELAY) != pdTRUE) continue;
-        stream_play_mp3(req.message_id);
+        stream_play_mp3(&req);
     }
 }
 
@@ -285,25 +802,60 @@ static void audio_play_task(void *arg)
 
 void audio_init(void)
 {
+    if (!dsp_pcm_selftest()) {
+        ESP_LOGE(TAG, "dsp_pcm self-test failed, PCM kernels on the scalar path");
+    }
+
     // Allocate decode buffers from PSRAM so internal SRAM stays free for TLS/WiFi heap
-    s_dec    = heap_caps_malloc(sizeof(mp3dec_t),
-                                MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    s_pcm    = heap_caps_malloc(MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t),
+    // PCM buffer 16-byte aligned so dsp_pcm stays on the PIE vector path
+    s_pcm    = heap_caps_aligned_alloc(DSP_PCM_ALIGN,
+                                       MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t),
+                                       MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_win    = heap_caps_malloc(INPUT_WINDOW_BYTES + INPUT_MIRROR_BYTES,
                                 MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    s_stereo = heap_caps_malloc(MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t),
-                                MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    assert(s_dec && s_pcm && s_stereo);
+    s_resample = heap_caps_aligned_alloc(DSP_PCM_ALIGN,
+                                         RESAMPLE_OUT_MAX * sizeof(int16_t),
+                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    bool dec_ok = mp3_decoder_init() && opus_dec_init();
+    assert(s_pcm && s_win && s_resample && dec_ok);
+
+    audio_cache_init();
 
-    // Allocate task stack from PSRAM — minimp3 decode uses ~10 KB of stack
-    // (float grbuf[2][576] + call chain), keeping DRAM free for LVGL/TLS
+    // Allocate task stack from PSRAM, keeping DRAM free for LVGL/TLS (the
+    // minimp3 frame scratch is no longer on the stack, see mp3_decoder.c)
     StackType_t *audio_stack = heap_caps_malloc(
         32768, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     assert(audio_stack);
 
+    // PCM ring between decoder and I2S writer, also in PSRAM
+    // (aligned, so the writer's spans stay on the PIE path for RMS metering)
+    s_pcm_ring_storage = heap_caps_aligned_alloc(DSP_PCM_ALIGN, PCM_RING_BYTES,
+                                                 MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    StackType_t *writer_stack = heap_caps_malloc(
+        WRITER_STACK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    assert(s_pcm_ring_storage && writer_stack);
+    spsc_ring_init(&s_pcm_ring, s_pcm_ring_storage, PCM_RING_BYTES);
+    s_pcm_data    = xSemaphoreCreateBinary();
+    s_pcm_space   = xSemaphoreCreateBinary();
+    s_writer_done = xSemaphoreCreateBinary();
+
     s_play_mutex = xSemaphoreCreateMutex();
+    s_tx_lock    = xSemaphoreCreateMutex();
+    s_volume     = g_config.speaker_volume <= 100 ? g_config.speaker_volume : 100;
+    const esp_timer_create_args_t idle_args = {
+        .callback = tx_idle_timer_cb,
+        .name     = "audio_tx_idle",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&idle_args, &s_tx_idle_timer));
     s_queue = xQueueCreate(4, sizeof(play_req_t));
     xTaskCreateStaticPinnedToCore(audio_play_task, "audio_play",
-        32768 / sizeof(StackType_t), NULL, 5, audio_stack, &s_audio_tcb, 0);
+        32768 / sizeof(StackType_t), NULL, 5, audio_stack, &s_audio_tcb,
+        AUDIO_DECODE_CORE);
+
+    // Writer runs above the decoder so a busy decode never starves the DMA
+    s_writer_task = xTaskCreateStaticPinnedToCore(i2s_writer_task, "audio_i2s_wr",
+        WRITER_STACK_SIZE / sizeof(StackType_t), NULL, 6, writer_stack,
+        &s_writer_tcb, AUDIO_WRITER_CORE);
 
     // Early-init ES8311 codec so speaker mute works before first playback.
     // Without this, s_codec is NULL and mute calls during recording are no-ops,
@@ -318,19 +870,22 @@ void audio_init(void)
             .mclk_from_mclk_pin = true,
             .sample_frequency   = 44100,
         };
+        codec_bus_take();
         es8311_init(s_codec, &clk, ES8311_RESOLUTION_16, ES8311_RESOLUTION_16);
         es8311_voice_volume_set(s_codec, 0, NULL);
         es8311_voice_mute(s_codec, true);
         es8311_microphone_config(s_codec, false);
+        codec_bus_give();
         ESP_LOGI(TAG, "ES8311 early init — muted, awaiting I2S for sample rate config");
     }
 
-    ESP_LOGI(TAG, "Audio subsystem ready (PSRAM stack + decode buffers)");
+    ESP_LOGI(TAG, "Audio subsystem ready (decode core %d, I2S writer core %d)",
+             AUDIO_DECODE_CORE, AUDIO_WRITER_CORE);
 }
 
 void audio_play_message(const char *message_id)
 {
-    play_req_t req = {};
+    play_req_t req = { .requested_us = esp_timer_get_time() };
     strlcpy(req.message_id, message_id, sizeof(req.message_id));
     if (xQueueSend(s_queue, &req, 0) != pdTRUE) {
         ESP_LOGW(TAG, "Play queue full, dropping %s", message_id);
@@ -342,142 +897,153 @@ void audio_stop(void)
     s_stop = true;
 }
 
+void audio_play_attach(audio_play_cb_t cb)
+{
+    s_play_cb = cb;
+}
+
+void audio_get_stats(audio_stats_t *out)
+{
+    mp3_decoder_stats_t ds;
+    mp3_decoder_get_stats(&ds);
+    s_stats.mp3_frame_us_avg = ds.frame_us_avg;
+    s_stats.mp3_frame_us_max = ds.frame_us_max;
+    opus_dec_stats_t os;
+    opus_dec_get_stats(&os);
+    s_stats.opus_frame_us_avg = os.frame_us_avg;
+    s_stats.opus_frame_us_max = os.frame_us_max;
+    s_stats.opus_concealed    = os.concealed;
+    *out = s_stats;
+}
+
 void audio_speaker_mute(void)
 {
-    if (s_codec) {
-        es8311_voice_volume_set(s_codec, 0, NULL);
-        es8311_voice_mute(s_codec, true);
-    }
-    // Disable I2S TX to stop bus noise from reaching the speaker amp
-    if (s_tx_chan) {
-        i2s_channel_disable(s_tx_chan);
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (s_duplex_rx) {
+        // TX clocks the mic too: silence the codec only
+        if (s_codec) {
+            codec_silence();
+        }
+    } else if (!s_tx_in_use) {
+        // Idle (possibly warm) channel: release it so RX can own the I2S pins
+        tx_release_locked();
+    } else {
+        if (s_codec) {
+            codec_silence();
+        }
+        // Disable I2S TX to stop bus noise from reaching the speaker amp
+        if (s_tx_enabled) {
+            i2s_channel_disable(s_tx_chan);
+            s_tx_enabled = false;
+        }
     }
+    xSemaphoreGive(s_tx_lock);
 }
 
 void audio_speaker_unmute(void)
 {
-    // Re-enable I2S TX before unmuting codec
-    if (s_tx_chan) {
-        i2s_channel_enable(s_tx_chan);
-    }
-    if (s_codec) {
-        es8311_voice_mute(s_codec, false);
-        es8311_voice_volume_set(s_codec, 70, NULL);
+    // Only a playback that was gated mid-utterance needs restoring; an idle
+    // codec stays muted until the next tx_acquire()
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (s_tx_in_use) {
+        if (s_tx_chan && !s_tx_enabled) {
+            i2s_channel_enable(s_tx_chan);
+            s_tx_enabled = true;
+        }
+        if (s_codec) {
+            codec_unmute(s_volume);
+        }
     }
+    xSemaphoreGive(s_tx_lock);
 }
 
-// ── Stream-fed playback (from stream_player WebSocket) ──────────────────────
-
-void audio_stream_play(StreamBufferHandle_t stream,
-                       volatile bool *stream_active,
-                       volatile bool *stream_error,
-                       uint8_t first_byte)
+// Caller holds s_tx_lock
+static int volume_set_locked(int vol)
 {
-    if (xSemaphoreTake(s_play_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        ESP_LOGW(TAG, "Audio busy, skipping stream play");
-        return;
+    if (vol < 0)   vol = 0;
+    if (vol > 100) vol = 100;
+    s_volume = vol;
+    // A playing codec takes it now (one register write, ahead of the next
+    // DMA buffer); a muted or idle one on the next unmute
+    if (s_codec && s_tx_in_use && s_tx_enabled) {
+        codec_bus_take();
+        es8311_voice_volume_set(s_codec, vol, NULL);
+        codec_bus_give();
     }
+    return vol;
+}
 
-    uint8_t *sbuf = heap_caps_malloc(STREAM_BUF_SIZE,
-                                      MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!sbuf) {
-        ESP_LOGE(TAG, "No memory for stream buffer");
-        xSemaphoreGive(s_play_mutex);
-        return;
+int audio_volume_set(int vol)
+{
+    if (!s_tx_lock) {                 // before audio_init(), which picks it up
+        g_config.speaker_volume = vol < 0 ? 0 : vol > 100 ? 100 : vol;
+        return g_config.speaker_volume;
     }
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    vol = volume_set_locked(vol);
+    xSemaphoreGive(s_tx_lock);
+    ESP_LOGI(TAG, "Volume %d", vol);
+    return vol;
+}
 
-    bool i2s_started = false;
-    mp3dec_init(s_dec);
-    s_stop = false;
-    xEventGroupSetBits(g_events, EVT_AUDIO_PLAYING);
-    display_set_state(DISPLAY_STATE_PLAYING, "Playing...");
-
-    // Seed buffer with the first peeked byte
-    sbuf[0] = first_byte;
-    size_t buf_fill = 1;
-
-    while (!s_stop) {
-        // Fill buffer from StreamBuffer
-        // Don't block when stream has ended — avoids I2S DMA replaying stale audio
-        if (buf_fill < STREAM_BUF_SIZE) {
-            TickType_t wait = *stream_active ? pdMS_TO_TICKS(200) : 0;
-            size_t rd = xStreamBufferReceive(stream,
-                            sbuf + buf_fill,
-                            STREAM_BUF_SIZE - buf_fill,
-                            wait);
-            buf_fill += rd;
-        }
-
-        // Check for error with empty buffer
-        if (*stream_error && buf_fill == 0) {
-            ESP_LOGW(TAG, "Stream error, aborting playback");
-            break;
-        }
-
-        if (buf_fill == 0) {
-            if (!(*stream_active) && xStreamBufferBytesAvailable(stream) == 0)
-                break;  // stream ended, no more data
-            continue;    // wait for more data
-        }
-
-        // Decode one MP3 frame
-        mp3dec_frame_info_t info = {};
-        int samples = mp3dec_decode_frame(s_dec, sbuf, (int)buf_fill,
-                                           s_pcm, &info);
-
-        if (info.frame_bytes == 0) {
-            // Need more data
-            if (!(*stream_active) && xStreamBufferBytesAvailable(stream) == 0)
-                break;
-            continue;
-        }
+int audio_volume_step(int delta)
+{
+    if (!s_tx_lock) return audio_volume_set(g_config.speaker_volume + delta);
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    int vol = volume_set_locked(s_volume + delta);
+    xSemaphoreGive(s_tx_lock);
+    ESP_LOGI(TAG, "Volume %d", vol);
+    return vol;
+}
 
-        buf_fill -= info.frame_bytes;
-        if (buf_fill > 0)
-            memmove(sbuf, sbuf + info.frame_bytes, buf_fill);
+int audio_volume_get(void)
+{
+    return s_tx_lock ? s_volume : g_config.speaker_volume;
+}
 
-        if (samples <= 0) continue;  // ID3 / padding frame
+// ── Full duplex ──────────────────────────────────────────────────────────────
 
-        // Init I2S once we know the sample rate
-        if (!i2s_started) {
-            i2s_start(info.hz);
-            i2s_started = true;
+i2s_chan_handle_t audio_duplex_begin(const i2s_std_slot_config_t *rx_slot,
+                                     size_t rx_bytes_per_sample)
+{
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (!s_duplex_rx) {
+        // A warm half-duplex channel is torn down; callers start duplex only
+        // with no playback running
+        tx_release_locked();
+        s_duplex_rx_bytes_per_sample = rx_bytes_per_sample;
+        aec_reset(AUDIO_DUPLEX_HZ);
+        tx_create_locked(AUDIO_DUPLEX_HZ, 1, rx_slot);
+        s_tx_rate     = AUDIO_DUPLEX_HZ;
+        s_tx_channels = 1;
+        if (s_codec) {
+            codec_silence();
         }
+    }
+    i2s_chan_handle_t rx = s_duplex_rx;
+    xSemaphoreGive(s_tx_lock);
+    return rx;
+}
 
-        // Play decoded PCM
-        int16_t *out   = s_pcm;
-        size_t   bytes = (size_t)samples * info.channels * sizeof(int16_t);
-
-        update_play_rms(s_pcm, samples);
-
-        if (info.channels == 1) {
-            for (int i = 0; i < samples; i++) {
-                s_stereo[i * 2]     = s_pcm[i];
-                s_stereo[i * 2 + 1] = s_pcm[i];
-            }
-            out   = s_stereo;
-            bytes = (size_t)samples * 2 * sizeof(int16_t);
-        }
+void audio_duplex_end(void)
+{
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (s_duplex_rx) tx_release_locked();
+    xSemaphoreGive(s_tx_lock);
+}
 
-        size_t written = 0;
-        i2s_channel_write(s_tx_chan, out, bytes, &written, pdMS_TO_TICKS(2000));
-    }
+// ── Stream-fed playback (from stream_player WebSocket) ──────────────────────
 
-    if (i2s_started) {
-        // Flush DMA with silence to prevent echo/artifact at end
-        memset(s_pcm, 0, MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t));
-        size_t zw = 0;
-        i2s_channel_write(s_tx_chan, s_pcm, MINIMP3_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t), &zw, pdMS_TO_TICKS(500));
-        vTaskDelay(pdMS_TO_TICKS(50));
-        i2s_stop_ch();
+bool audio_stream_play(audio_src_t *src, int64_t requested_us)
+{
+    if (xSemaphoreTake(s_play_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGW(TAG, "Audio busy, skipping stream play");
+        return false;
     }
 
-    g_audio_rms = 0;
-    xEventGroupClearBits(g_events, EVT_AUDIO_PLAYING);
-
-    const char *msg = strlen(g_config.chat_id) > 0 ? "" : "No chat linked";
-    display_set_state(DISPLAY_STATE_WIFI_OK, msg);
+    s_session_t0_us = requested_us;
+    play_source(src);
 
-    free(sbuf);
     xSemaphoreGive(s_play_mutex);
+    return true;
 }
@@ -1,18 +1,70 @@
 #pragma once
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/stream_buffer.h"
+#include "audio_src.h"
+#include "driver/i2s_std.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+// Core affinity of the playback stages.  Decoders (audio_play, sp_decode) feed
+// a PCM ring; a separate writer task drains it into I2S.  Override at build time.
+#ifndef AUDIO_DECODE_CORE
+#define AUDIO_DECODE_CORE   0
+#endif
+#ifndef AUDIO_WRITER_CORE
+#define AUDIO_WRITER_CORE   1
+#endif
+
+// How long the I2S TX channel and codec stay clocked (muted) after an
+// utterance, so back-to-back messages skip channel and codec setup
+#ifndef AUDIO_TX_WARM_MS
+#define AUDIO_TX_WARM_MS    10000
+#endif
+
+// Conversation mode runs speaker and mic full duplex on one I2S port at this
+// rate; playback of any other format is converted on the fly
+#define AUDIO_DUPLEX_HZ     16000
+
+typedef struct {
+    uint32_t underruns;     // PCM ring ran dry mid-utterance
+    uint32_t prebuffers;    // prebuffer fills (utterance starts + post-underrun refills)
+    uint32_t prebuffer_ms;  // current adaptive prebuffer target
+    uint32_t jitter_ms;     // smoothed lateness of decoded frames vs. media time
+    uint32_t mp3_frame_us_avg;  // smoothed MP3 decode time per frame
+    uint32_t mp3_frame_us_max;  // worst MP3 frame of the current/last utterance
+    uint32_t first_sample_ms;   // play request → first DMA sample, last utterance
+    uint32_t opus_frame_us_avg; // smoothed Opus decode time per packet
+    uint32_t opus_frame_us_max; // worst Opus packet of the current/last utterance
+    uint32_t opus_concealed;    // Opus packets lost/corrupt and concealed (PLC/FEC)
+} audio_stats_t;
 
 void audio_init(void);
 void audio_play_message(const char *message_id);
 void audio_stop(void);
 void audio_speaker_mute(void);
 void audio_speaker_unmute(void);
+void audio_get_stats(audio_stats_t *out);
+
+// Called on the playing task as EVT_AUDIO_PLAYING is set (true) and cleared
+typedef void (*audio_play_cb_t)(bool playing);
+void audio_play_attach(audio_play_cb_t cb);
+
+// Speaker volume 0–100, clamped; returns the value applied.  Starts at
+// g_config.speaker_volume; persisting it is the caller's business (knob.c).
+int  audio_volume_set(int vol);
+int  audio_volume_step(int delta);
+int  audio_volume_get(void);
+
+// Full duplex: create RX next to TX (same clock and pins, the caller's slot
+// layout) and keep both running until audio_duplex_end().  The RX handle is
+// the caller's to read; rx_bytes_per_sample is how many RX DMA bytes make one
+// of the mono samples later passed to aec_process().  Every TX buffer played
+// becomes the echo canceller's reference.  Start with no playback running.
+i2s_chan_handle_t audio_duplex_begin(const i2s_std_slot_config_t *rx_slot,
+                                     size_t rx_bytes_per_sample);
+void audio_duplex_end(void);
 
-// Play MP3 stream from a StreamBuffer (fed by stream_player module).
-// Blocks until stream is fully played or audio_stop() is called.
-void audio_stream_play(StreamBufferHandle_t stream,
-                       volatile bool *stream_active,
-                       volatile bool *stream_error,
-                       uint8_t first_byte);
+// Play an MP3 or Opus source fed by another module (stream_player's utterance queue).
+// Blocks until the source is exhausted or audio_stop() is called; returns
+// false without reading anything if another playback holds the output.
+// requested_us: esp_timer time of the play request, for firstSampleMs.
+bool audio_stream_play(audio_src_t *src, int64_t requested_us);
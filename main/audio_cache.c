@@ -0,0 +1,403 @@
+#include "audio_cache.h"
+#include "events.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "audio_cache";
+
+// ── Layout ───────────────────────────────────────────────────────────────────
+// [dir A][dir B][slot 0][slot 1]...  Fixed-size slots, one message each.  The
+// directory is written alternately to A and B with a rising generation, so a
+// power cut mid-write leaves the previous copy intact; each entry also carries
+// the CRC of its data, so a slot overwritten but not yet re-indexed is caught
+// at lookup.
+
+#define CACHE_PART_LABEL    "storage"
+#define CACHE_SECTOR        4096
+#define CACHE_DIR_BYTES     CACHE_SECTOR
+#define CACHE_SLOT_BYTES    (256 * 1024)   // ~40 s at 48 kbps
+#define CACHE_MAX_SLOTS     32
+#define CACHE_ID_MAX        48
+#define CACHE_MAGIC         0x43414D50     // "PMAC"
+
+#define CACHE_TASK_STACK    4096
+#define CACHE_IDLE_POLL_MS  200
+
+// Audio activity that must not see a flash erase/write
+#define CACHE_BUSY_BITS     (EVT_AUDIO_PLAYING | EVT_AUDIO_RECORDING | EVT_STREAM_PLAYING)
+
+typedef struct {
+    char     id[CACHE_ID_MAX];   // message ID, "" = free slot
+    uint32_t len;
+    uint32_t crc;                // of the MP3 bytes
+    uint32_t stamp;              // LRU clock at insert / last hit
+} cache_entry_t;
+
+typedef struct {
+    uint32_t      magic;
+    uint32_t      generation;
+    uint32_t      clock;
+    uint32_t      n_slots;
+    cache_entry_t e[CACHE_MAX_SLOTS];
+    uint32_t      crc;           // over everything above
+} cache_dir_t;
+
+_Static_assert(sizeof(cache_dir_t) <= CACHE_DIR_BYTES, "cache directory exceeds a sector");
+
+static const esp_partition_t *s_part;
+static cache_dir_t            s_dir;       // authoritative copy, guarded by s_lock
+static SemaphoreHandle_t      s_lock;
+static bool                   s_dir_dirty;
+static TaskHandle_t           s_task;
+static audio_cache_stats_t    s_stats;
+
+// Capture (producer: whichever playback path is active)
+static uint8_t      *s_cap_buf;            // CACHE_SLOT_BYTES, PSRAM
+static char          s_cap_id[CACHE_ID_MAX];
+static size_t        s_cap_len;
+static bool          s_cap_active;
+static volatile bool s_commit_pending;     // capture complete, waiting for audio idle
+static bool          s_commit_claimed;     // s_cap_buf owned by the cache task (s_lock)
+static char          s_last_id[CACHE_ID_MAX];   // last capture committed this boot
+static char          s_drop_id[CACHE_ID_MAX];   // drop once written: it is truncated (s_lock)
+
+static inline size_t slot_offset(int slot)
+{
+    return 2 * CACHE_DIR_BYTES + (size_t)slot * CACHE_SLOT_BYTES;
+}
+
+static uint32_t dir_crc(const cache_dir_t *d)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)d, offsetof(cache_dir_t, crc));
+}
+
+static int find_entry_locked(const char *msg_id)
+{
+    for (int i = 0; i < (int)s_dir.n_slots; i++) {
+        if (s_dir.e[i].id[0] && strcmp(s_dir.e[i].id, msg_id) == 0) return i;
+    }
+    return -1;
+}
+
+// ── Flash side (cache task only — internal-RAM stack, see config_store.c) ───
+
+static void wait_audio_idle(void)
+{
+    while (xEventGroupGetBits(g_events) & CACHE_BUSY_BITS) {
+        vTaskDelay(pdMS_TO_TICKS(CACHE_IDLE_POLL_MS));
+    }
+}
+
+static esp_err_t write_dir(void)
+{
+    static cache_dir_t snap;   // too big for the task stack
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_dir.generation++;
+    s_dir.crc   = dir_crc(&s_dir);
+    snap        = s_dir;
+    s_dir_dirty = false;
+    xSemaphoreGive(s_lock);
+
+    size_t off = (snap.generation & 1) ? CACHE_DIR_BYTES : 0;
+    wait_audio_idle();
+    esp_err_t err = esp_partition_erase_range(s_part, off, CACHE_DIR_BYTES);
+    if (err == ESP_OK) err = esp_partition_write(s_part, off, &snap, sizeof(snap));
+    if (err != ESP_OK) ESP_LOGE(TAG, "dir write failed: %s", esp_err_to_name(err));
+    return err;
+}
+
+static void commit_capture(void)
+{
+    // Pick a free slot, else the least recently used one
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int slot = find_entry_locked(s_cap_id);
+    if (slot < 0) {
+        for (int i = 0; i < (int)s_dir.n_slots; i++) {
+            if (!s_dir.e[i].id[0]) { slot = i; break; }
+            if (slot < 0 || s_dir.e[i].stamp < s_dir.e[slot].stamp) slot = i;
+        }
+        if (s_dir.e[slot].id[0]) {
+            ESP_LOGI(TAG, "Evicting %.36s", s_dir.e[slot].id);
+            s_stats.evictions++;
+        }
+    }
+    // The slot is unindexed while its data is rewritten
+    s_dir.e[slot].id[0] = '\0';
+    xSemaphoreGive(s_lock);
+
+    size_t    base = slot_offset(slot);
+    esp_err_t err  = ESP_OK;
+    for (size_t pos = 0; pos < s_cap_len && err == ESP_OK; pos += CACHE_SECTOR) {
+        size_t n = s_cap_len - pos < CACHE_SECTOR ? s_cap_len - pos : CACHE_SECTOR;
+        wait_audio_idle();   // per sector, so a new playback waits ≤ one erase
+        err = esp_partition_erase_range(s_part, base + pos, CACHE_SECTOR);
+        if (err == ESP_OK) err = esp_partition_write(s_part, base + pos, s_cap_buf + pos, n);
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (err == ESP_OK) {
+        cache_entry_t *e = &s_dir.e[slot];
+        e->len   = (uint32_t)s_cap_len;
+        e->crc   = esp_rom_crc32_le(0, s_cap_buf, s_cap_len);
+        e->stamp = ++s_dir.clock;
+        if (strcmp(s_drop_id, s_cap_id) == 0) {
+            // More of the message played meanwhile and could not be captured
+            ESP_LOGI(TAG, "%.36s continued during its commit, not cached", s_cap_id);
+            s_stats.skipped++;
+        } else {
+            strlcpy(e->id, s_cap_id, sizeof(e->id));
+            strlcpy(s_last_id, s_cap_id, sizeof(s_last_id));
+            s_stats.inserts++;
+            ESP_LOGI(TAG, "Cached %.36s (%u B) in slot %d", e->id, (unsigned)e->len, slot);
+        }
+    } else {
+        ESP_LOGE(TAG, "Slot %d write failed: %s", slot, esp_err_to_name(err));
+    }
+    s_drop_id[0] = '\0';
+    s_dir_dirty = true;
+    xSemaphoreGive(s_lock);
+}
+
+static void cache_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (s_commit_pending) {
+            // Until it is claimed, a next utterance of the same message can
+            // take the capture back and extend it (audio_cache_capture_begin)
+            wait_audio_idle();
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            s_commit_claimed = s_commit_pending;
+            xSemaphoreGive(s_lock);
+            if (s_commit_claimed) {
+                commit_capture();
+                xSemaphoreTake(s_lock, portMAX_DELAY);
+                s_commit_claimed = false;
+                s_commit_pending = false;
+                xSemaphoreGive(s_lock);
+            }
+        }
+        if (s_dir_dirty) write_dir();
+    }
+}
+
+// ── Directory load ───────────────────────────────────────────────────────────
+
+static void load_dir(uint32_t n_slots)
+{
+    // Read through an mmap: no flash operation, so safe from any task
+    const cache_dir_t          *copies;
+    esp_partition_mmap_handle_t h;
+    const cache_dir_t          *best = NULL;
+    if (esp_partition_mmap(s_part, 0, 2 * CACHE_DIR_BYTES, ESP_PARTITION_MMAP_DATA,
+                           (const void **)&copies, &h) == ESP_OK) {
+        for (int i = 0; i < 2; i++) {
+            const cache_dir_t *d = (const cache_dir_t *)((const uint8_t *)copies + i * CACHE_DIR_BYTES);
+            if (d->magic != CACHE_MAGIC || d->n_slots != n_slots || d->crc != dir_crc(d)) continue;
+            if (!best || d->generation > best->generation) best = d;
+        }
+        if (best) s_dir = *best;
+        esp_partition_munmap(h);
+    }
+
+    if (!best) {
+        memset(&s_dir, 0, sizeof(s_dir));
+        s_dir.magic   = CACHE_MAGIC;
+        s_dir.n_slots = n_slots;
+        ESP_LOGI(TAG, "No valid directory, starting empty");
+        return;
+    }
+    int used = 0;
+    for (int i = 0; i < (int)n_slots; i++) used += s_dir.e[i].id[0] != '\0';
+    ESP_LOGI(TAG, "Directory gen %lu: %d/%lu slots used", (unsigned long)s_dir.generation,
+             used, (unsigned long)n_slots);
+}
+
+// ── Public API ───────────────────────────────────────────────────────────────
+
+void audio_cache_init(void)
+{
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                      CACHE_PART_LABEL);
+    if (!s_part) {
+        ESP_LOGW(TAG, "No '%s' partition — cache disabled", CACHE_PART_LABEL);
+        return;
+    }
+    uint32_t n_slots = (s_part->size - 2 * CACHE_DIR_BYTES) / CACHE_SLOT_BYTES;
+    if (n_slots > CACHE_MAX_SLOTS) n_slots = CACHE_MAX_SLOTS;
+
+    s_cap_buf = heap_caps_malloc(CACHE_SLOT_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_lock    = xSemaphoreCreateMutex();
+    if (!s_cap_buf || !s_lock || n_slots == 0) {
+        ESP_LOGE(TAG, "Init failed — cache disabled");
+        s_part = NULL;
+        return;
+    }
+    load_dir(n_slots);
+
+    // Flash writes need an internal-RAM stack (plain xTaskCreate, not PSRAM)
+    xTaskCreate(cache_task, "audio_cache", CACHE_TASK_STACK, NULL, 2, &s_task);
+}
+
+bool audio_cache_open(const char *msg_id, audio_src_t *src)
+{
+    if (!s_part) return false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int slot = find_entry_locked(msg_id);
+    cache_entry_t e = {};
+    if (slot >= 0) e = s_dir.e[slot];
+    xSemaphoreGive(s_lock);
+
+    if (slot < 0) {
+        s_stats.misses++;
+        return false;
+    }
+    if (audio_src_mmap(src, s_part, slot_offset(slot), e.len) != ESP_OK) {
+        s_stats.misses++;
+        return false;
+    }
+    if (esp_rom_crc32_le(0, src->mem, e.len) != e.crc) {
+        ESP_LOGW(TAG, "CRC mismatch for %.36s, dropping entry", msg_id);
+        audio_src_close(src);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_dir.e[slot].id[0] = '\0';
+        s_dir_dirty = true;
+        xSemaphoreGive(s_lock);
+        xTaskNotifyGive(s_task);
+        s_stats.misses++;
+        return false;
+    }
+
+    // Touch for LRU; persisted by the cache task once audio is idle
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_dir.e[slot].stamp = ++s_dir.clock;
+    s_dir_dirty = true;
+    xSemaphoreGive(s_lock);
+    xTaskNotifyGive(s_task);
+
+    s_stats.hits++;
+    ESP_LOGI(TAG, "Hit %.36s (%u B, slot %d)", msg_id, (unsigned)e.len, slot);
+    return true;
+}
+
+// Give up on the capture; an entry it was extending holds only part of it
+static void capture_abandon(void)
+{
+    s_cap_active = false;
+    s_stats.skipped++;
+    if (strcmp(s_last_id, s_cap_id) != 0) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int slot = find_entry_locked(s_cap_id);
+    if (slot >= 0) {
+        s_dir.e[slot].id[0] = '\0';
+        s_dir_dirty = true;
+    }
+    s_last_id[0] = '\0';
+    xSemaphoreGive(s_lock);
+    if (slot >= 0) xTaskNotifyGive(s_task);
+}
+
+// Reload a cached entry into the capture buffer, to append to it
+static bool capture_reload(int slot, const cache_entry_t *e)
+{
+    const uint8_t              *data;
+    esp_partition_mmap_handle_t h;
+    if (esp_partition_mmap(s_part, slot_offset(slot), e->len, ESP_PARTITION_MMAP_DATA,
+                           (const void **)&data, &h) != ESP_OK) {
+        return false;
+    }
+    bool ok = esp_rom_crc32_le(0, data, e->len) == e->crc;
+    if (ok) memcpy(s_cap_buf, data, e->len);
+    esp_partition_munmap(h);
+    s_cap_len = ok ? e->len : 0;
+    return ok;
+}
+
+// A streamed message can span several playback sessions, one per burst of
+// utterances, and each session ends its capture.  A later session with the
+// same ID extends what the earlier ones captured: from the buffer while the
+// commit still waits for audio idle, else from the entry it wrote.  An entry
+// that cannot be extended is dropped, so a replay never plays it truncated.
+void audio_cache_capture_begin(const char *msg_id)
+{
+    if (!s_part) return;
+    if (s_cap_active && strcmp(s_cap_id, msg_id) == 0) return;   // continuation
+    if (s_cap_active) audio_cache_capture_end(true);
+
+    if (strlen(msg_id) >= CACHE_ID_MAX) {
+        s_stats.skipped++;
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool same = strcmp(s_cap_id, msg_id) == 0;
+    if (s_commit_pending && same && !s_commit_claimed) {
+        s_commit_pending = false;   // not on flash yet: carry on in the buffer
+        s_cap_active     = true;
+        xSemaphoreGive(s_lock);
+        return;
+    }
+    int slot = find_entry_locked(msg_id);
+    cache_entry_t e = {};
+    if (slot >= 0) e = s_dir.e[slot];
+    if (s_commit_pending) {
+        // The buffer is the cache task's; this part of the message is lost
+        if (same) strlcpy(s_drop_id, msg_id, sizeof(s_drop_id));
+        if (slot >= 0) {
+            s_dir.e[slot].id[0] = '\0';
+            s_dir_dirty = true;
+        }
+        xSemaphoreGive(s_lock);
+        if (slot >= 0) xTaskNotifyGive(s_task);
+        s_stats.skipped++;
+        return;
+    }
+    xSemaphoreGive(s_lock);
+
+    // An entry committed earlier this boot is this message's first part;
+    // anything older is a replay streamed again, and is replaced
+    strlcpy(s_cap_id, msg_id, sizeof(s_cap_id));
+    s_cap_len    = 0;
+    s_cap_active = true;
+    if (slot >= 0 && strcmp(s_last_id, msg_id) == 0 && !capture_reload(slot, &e)) {
+        capture_abandon();
+    }
+}
+
+void audio_cache_capture(const uint8_t *data, size_t len)
+{
+    if (!s_cap_active) return;
+    if (s_cap_len + len > CACHE_SLOT_BYTES) {
+        ESP_LOGI(TAG, "%.36s exceeds a cache slot, not caching", s_cap_id);
+        capture_abandon();
+        return;
+    }
+    memcpy(s_cap_buf + s_cap_len, data, len);
+    s_cap_len += len;
+}
+
+void audio_cache_capture_end(bool complete)
+{
+    if (!s_cap_active) return;
+    if (!complete || s_cap_len == 0) {
+        capture_abandon();
+        return;
+    }
+    s_cap_active     = false;
+    s_commit_pending = true;
+    xTaskNotifyGive(s_task);
+}
+
+void audio_cache_get_stats(audio_cache_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "audio_src.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Write-through MP3 cache on the `storage` data partition, keyed by message ID
+// with LRU eviction.
+//
+// Playback paths capture the compressed bytes they play; a complete capture is
+// committed to flash in the background once audio is idle (flash erase stalls
+// the PSRAM cache, so it never runs under playback or recording).  Hits are
+// mmapped and decoded in place — no network, no TLS.
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t inserts;
+    uint32_t evictions;
+    uint32_t skipped;   // captures not cached (too large, writer busy, aborted)
+} audio_cache_stats_t;
+
+void audio_cache_init(void);
+
+// Hit → src is an mmapped in-place source (release with audio_src_close()).
+bool audio_cache_open(const char *msg_id, audio_src_t *src);
+
+// Capture the bytes of msg_id as they are played.  Beginning the ID that is
+// already being captured continues it (TTS split into several utterances), and
+// so does a later session with the ID whose capture ended earlier this boot:
+// it extends the pending capture or the entry written from it.
+// end(complete=false) discards the capture, and an entry it was extending.
+void audio_cache_capture_begin(const char *msg_id);
+void audio_cache_capture(const uint8_t *data, size_t len);
+void audio_cache_capture_end(bool complete);
+
+void audio_cache_get_stats(audio_cache_stats_t *out);
@@ -0,0 +1,57 @@
+#include "audio_src.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "audio_src";
+
+// ── HTTP body ────────────────────────────────────────────────────────────────
+
+static int http_read(audio_src_t *src, uint8_t *dst, size_t max)
+{
+    int rd = esp_http_client_read(src->u.http.client, (char *)dst, (int)max);
+    if (rd > 0) return rd;
+    return rd == 0 ? AUDIO_SRC_EOF : AUDIO_SRC_ERR;
+}
+
+void audio_src_http(audio_src_t *src, esp_http_client_handle_t client)
+{
+    memset(src, 0, sizeof(*src));
+    src->read          = http_read;
+    src->u.http.client = client;
+}
+
+// ── Memory-resident / mmapped ────────────────────────────────────────────────
+
+void audio_src_mem(audio_src_t *src, const uint8_t *data, size_t len)
+{
+    memset(src, 0, sizeof(*src));
+    src->mem     = data;
+    src->mem_len = len;
+}
+
+esp_err_t audio_src_mmap(audio_src_t *src, const esp_partition_t *part,
+                         size_t offset, size_t len)
+{
+    memset(src, 0, sizeof(*src));
+    const void *ptr = NULL;
+    esp_err_t err = esp_partition_mmap(part, offset, len, ESP_PARTITION_MMAP_DATA,
+                                       &ptr, &src->u.mmap.handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap %s+0x%x (%u B) failed: %s", part->label,
+                 (unsigned)offset, (unsigned)len, esp_err_to_name(err));
+        return err;
+    }
+    src->u.mmap.mapped = true;
+    src->mem           = ptr;
+    src->mem_len       = len;
+    return ESP_OK;
+}
+
+void audio_src_close(audio_src_t *src)
+{
+    if (src->read == NULL && src->u.mmap.mapped) {
+        esp_partition_munmap(src->u.mmap.handle);
+        src->u.mmap.mapped = false;
+    }
+    src->mem = NULL;
+}
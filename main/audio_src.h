@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "esp_partition.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed-audio source for the playback engine in audio.c.
+//
+// Streaming sources (HTTP body, stream_player's utterance queue) implement
+// read(); the engine copies their bytes once into its wrap-around input
+// window.  Memory-resident
+// sources (flash-resident data, mmapped partition ranges) set mem/mem_len and
+// are decoded in place with no copy at all.
+//
+// Sources live on the caller's stack — nothing here allocates.
+//
+// MP3 is a byte stream: read() may return any split.  Opus has no in-band
+// framing, so an Opus source returns exactly one packet per read() and
+// reports packets it lost in `lost`; the engine conceals them.
+
+#define AUDIO_SRC_EOF   (-1)   // read(): no more data will arrive
+#define AUDIO_SRC_ERR   (-2)   // read(): transport failed, treat as end of stream
+#define AUDIO_SRC_NEXT  (-3)   // read(): current item ended and another follows —
+                               // play it gaplessly on a fresh decoder
+
+#define AUDIO_SRC_PACKET_MAX  1500   // max Opus packet a source may return (≥ 1275)
+
+typedef enum {
+    AUDIO_CODEC_MP3 = 0,
+    AUDIO_CODEC_OPUS,
+} audio_codec_t;
+
+typedef struct audio_src audio_src_t;
+
+struct audio_src {
+    // Copy up to max bytes into dst.  Returns bytes copied, 0 when nothing
+    // arrived within the source's poll interval, or AUDIO_SRC_EOF / _ERR /
+    // _NEXT.  read() must block while it waits: return 0 only after the poll
+    // interval (at least one tick) has passed without data.  The engine
+    // yields a tick after an empty read that leaves it nothing to decode, so
+    // a source that breaks this wastes ticks but does not starve other tasks.
+    int (*read)(audio_src_t *src, uint8_t *dst, size_t max);
+
+    // Codec of the current item; a source may change it before returning
+    // AUDIO_SRC_NEXT.  Packet codecs (Opus) set `lost` alongside each packet
+    // to the number of packets dropped immediately before it.
+    audio_codec_t codec;
+    uint16_t      lost;
+
+    const uint8_t *mem;       // non-NULL → decode directly from here
+    size_t         mem_len;
+
+    union {
+        struct {
+            esp_http_client_handle_t client;
+        } http;
+        struct {
+            void *ctx;                     // sources implemented by other modules
+        } custom;
+        struct {
+            esp_partition_mmap_handle_t handle;
+            bool                        mapped;
+        } mmap;
+    } u;
+};
+
+// HTTP response body; caller has already opened the request and fetched headers.
+void audio_src_http(audio_src_t *src, esp_http_client_handle_t client);
+
+// Flash-resident (e.g. EMBED_FILES) or otherwise memory-resident data.
+void audio_src_mem(audio_src_t *src, const uint8_t *data, size_t len);
+
+// Map [offset, offset+len) of a data partition and decode it in place.
+esp_err_t audio_src_mmap(audio_src_t *src, const esp_partition_t *part,
+                         size_t offset, size_t len);
+
+// Release anything the source holds (currently only mmap mappings).
+void audio_src_close(audio_src_t *src);
@@ -1,10 +1,8 @@
 #include "avatar_img.h"
-#include "scenario_img.h"
 #include "board.h"
 #include "config.h"
 #include "display.h"
-#include "esp_http_client.h"
-#include "esp_crt_bundle.h"
+#include "http_pool.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -85,9 +83,11 @@ static UINT tjpgd_output(JDEC *jd, void *bitmap, JRECT *rect)
 
 // ── Download + decode task ───────────────────────────────────────────────────
 
-static void avatar_task(void *arg)
+static void avatar_fetch(void)
 {
-    if (strlen(g_config.avatar_id) == 0) {
+    char avatar_id[CONFIG_AVATAR_ID_MAX];
+    config_get_id(CONFIG_ID_AVATAR, avatar_id, sizeof(avatar_id));
+    if (strlen(avatar_id) == 0) {
         ESP_LOGW(TAG, "No avatar_id — skipping download");
         goto done;
     }
@@ -97,10 +97,7 @@ static void avatar_task(void *arg)
     // Request small avatar (20% of display) — scenario image is the full-screen background
     #define AVATAR_SIZE 82
     snprintf(url, sizeof(url), "%s/avatars/%s/picture.jpg?x=%d&y=%d",
-             g_config.server_url, g_config.avatar_id, AVATAR_SIZE, AVATAR_SIZE);
-
-    char auth[128];
-    snprintf(auth, sizeof(auth), "Bearer %s", g_config.apikey);
+             g_config.server_url, avatar_id, AVATAR_SIZE, AVATAR_SIZE);
 
     ESP_LOGI(TAG, "Downloading avatar: %s", url);
 
@@ -116,21 +113,13 @@ static void avatar_task(void *arg)
     }
 
     // Download JPEG
-    esp_http_client_config_t cfg = {
-        .url               = url,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .event_handler     = on_data,
-        .user_data         = &dl,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    esp_http_client_set_header(client, "Authorization", auth);
-
-    esp_err_t err = esp_http_client_perform(client);
+    esp_http_client_handle_t client = http_pool_acquire(url, on_data, &dl);
+    esp_err_t err = client ? http_pool_perform(client) : ESP_FAIL;
     int status = -1;
     if (err == ESP_OK) {
         status = esp_http_client_get_status_code(client);
     }
-    esp_http_client_cleanup(client);
+    http_pool_release(client, err == ESP_OK);
 
     if (status != 200 || dl.len == 0) {
         ESP_LOGE(TAG, "Download failed: status=%d len=%d", status, dl.len);
@@ -195,19 +184,30 @@ static void avatar_task(void *arg)
     display_set_avatar(fb, jdec.width, jdec.height);
 
 done:
-    // Start scenario download after avatar is done — only one TLS connection at a time
-    scenario_img_start();
-    vTaskDelete(NULL);
+    return;
+}
+
+// Once per start; a start during a download (the doll profile changed)
+// runs one more when it is done
+static void avatar_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        avatar_fetch();
+    }
 }
 
 // Use PSRAM stack to keep internal SRAM free for TLS operations
-static StaticTask_t s_avatar_tcb;
+static StaticTask_t  s_avatar_tcb;
+static TaskHandle_t  s_avatar_task;
 
 void avatar_img_start(void)
 {
-    StackType_t *stack = heap_caps_malloc(8192, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (stack) {
-        xTaskCreateStaticPinnedToCore(avatar_task, "avatar_dl",
+    if (!s_avatar_task) {
+        StackType_t *stack = heap_caps_malloc(8192, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!stack) return;
+        s_avatar_task = xTaskCreateStaticPinnedToCore(avatar_task, "avatar_dl",
             8192 / sizeof(StackType_t), NULL, 3, stack, &s_avatar_tcb, 1);
     }
+    xTaskNotifyGive(s_avatar_task);
 }
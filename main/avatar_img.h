@@ -1,5 +1,6 @@
 #pragma once
 
 // Download and display the avatar image on the LCD.
-// Call after g_config.avatar_id and g_config.server_url are populated.
+// Call after g_config.avatar_id and g_config.server_url are populated, and
+// again when avatar_id changes (a download in progress is followed by one more).
 void avatar_img_start(void);
@@ -1,18 +1,19 @@
 #include "battery.h"
 #include "board.h"
 #include "display.h"
+#include "io_expander.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
-#include "driver/i2c.h"
 
 static const char *TAG = "battery";
 
 static adc_oneshot_unit_handle_t s_adc = NULL;
 static adc_cali_handle_t         s_cali = NULL;
 static esp_timer_handle_t        s_timer = NULL;
+static esp_timer_handle_t        s_refresh = NULL;   // one-shot, on charger edges
 
 // Read battery voltage in mV (after voltage divider compensation)
 static int battery_read_mv(void)
@@ -36,27 +37,22 @@ static int voltage_to_percent(int mv)
     return pct;
 }
 
-// Read charging status from IO expander port 0 (active-low pins)
-static bool is_charging(void)
-{
-    uint8_t reg = PCA9535_INPUT0;
-    uint8_t val = 0xFF;
-    i2c_master_write_read_device(AUDIO_I2C_PORT, IO_EXP_ADDR,
-                                  &reg, 1, &val, 1, pdMS_TO_TICKS(50));
-    // Bit 0 (CHRG_DET) low = charging, Bit 1 (STDBY_DET) low = full
-    bool charging = !(val & (1 << PWR_CHRG_DET_BIT));
-    return charging;
-}
-
 static void battery_timer_cb(void *arg)
 {
     int mv  = battery_read_mv();
     int pct = voltage_to_percent(mv);
-    bool chrg = is_charging();
+    bool chrg = io_exp_active(IO_EXP_CHRG);   // cached, no I2C
     ESP_LOGI(TAG, "%d mV → %d%%%s", mv, pct, chrg ? " (charging)" : "");
     display_set_battery(pct, chrg);
 }
 
+// Expander service edge: rerun the reading on the esp_timer task, like the
+// periodic one, rather than touching the ADC from here
+static void charger_edge(io_exp_pin_t pin, bool active)
+{
+    if (pin == IO_EXP_CHRG || pin == IO_EXP_VBUS) esp_timer_start_once(s_refresh, 0);
+}
+
 void battery_init(void)
 {
     // ADC1 oneshot
@@ -80,11 +76,6 @@ void battery_init(void)
     };
     ESP_ERROR_CHECK(adc_cali_create_scheme_curve_fitting(&cali_cfg, &s_cali));
 
-    // Configure IO expander port 0 as all inputs (power status bits 0-2, knob btn bit 3)
-    uint8_t cmd[] = { PCA9535_CONFIG0, 0xFF };
-    i2c_master_write_to_device(AUDIO_I2C_PORT, IO_EXP_ADDR,
-                                cmd, sizeof(cmd), pdMS_TO_TICKS(100));
-
     // First reading immediately
     battery_timer_cb(NULL);
 
@@ -96,5 +87,10 @@ void battery_init(void)
     ESP_ERROR_CHECK(esp_timer_create(&ta, &s_timer));
     ESP_ERROR_CHECK(esp_timer_start_periodic(s_timer, 30 * 1000 * 1000));
 
+    // Plug/unplug updates the label at once instead of on the next tick
+    ta.name = "battery_edge";
+    ESP_ERROR_CHECK(esp_timer_create(&ta, &s_refresh));
+    io_exp_attach(charger_edge);
+
     ESP_LOGI(TAG, "Battery monitor started (GPIO%d, 30s interval)", BAT_ADC_GPIO);
 }
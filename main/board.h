@@ -31,6 +31,12 @@
 // Port 1: outputs (power control, camera, etc.)
 #define IO_EXP_ADDR         0x21
 
+// Expander INT (open drain, low while port 0 differs from its last read).
+// A plain number for #if; -1 builds the service without it (polling only).
+#ifndef IO_EXP_INT_GPIO
+#define IO_EXP_INT_GPIO     2
+#endif
+
 // PCA9535 registers
 #define PCA9535_INPUT0      0x00
 #define PCA9535_OUTPUT0     0x02
@@ -0,0 +1,218 @@
+#include "boot_graph.h"
+#include "events.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <string.h>
+
+static const char *TAG = "boot";
+
+#define BOOT_WORKERS            4
+#define BOOT_WORKER_STACK       4096    // internal RAM: stages may touch NVS
+#define BOOT_RAM_FLOOR          (16 * 1024)
+#define BOOT_READY_TIMEOUT_MS   60000
+#define BOOT_MAX_MILESTONES     8
+#define BOOT_CHART_COLS         40
+
+static const boot_stage_t *s_stages;
+static int                 s_n;
+static boot_timing_t       s_timing[BOOT_MAX_STAGES];
+static EventGroupHandle_t  s_finished;          // bit per stage, done or failed
+static QueueHandle_t       s_work;              // stage index (-1: exit)
+static QueueHandle_t       s_done;              // stage index, result in s_timing
+
+static boot_milestone_t    s_ms[BOOT_MAX_MILESTONES];
+static int                 s_n_ms;
+static volatile uint32_t   s_ready_ms;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// ── Workers ──────────────────────────────────────────────────────────────────
+
+static void worker_task(void *arg)
+{
+    int i;
+    while (xQueueReceive(s_work, &i, portMAX_DELAY) == pdTRUE && i >= 0) {
+        s_timing[i].start_ms = now_ms();
+        bool ok = s_stages[i].run();
+        s_timing[i].end_ms = now_ms();
+        s_timing[i].result = ok ? BOOT_DONE : BOOT_FAILED;
+        xQueueSend(s_done, &i, portMAX_DELAY);
+    }
+    vTaskDelete(NULL);
+}
+
+// ── Scheduler ────────────────────────────────────────────────────────────────
+
+// Pending stage i: can start (1), must be skipped (-1), or not yet (0)
+static int deps_state(int i)
+{
+    for (int d = 0; d < s_n; d++) {
+        if (!(s_stages[i].deps & BOOT_DEP(d))) continue;
+        boot_result_t r = s_timing[d].result;
+        if (r == BOOT_FAILED || r == BOOT_SKIPPED) return -1;
+        if (r != BOOT_DONE) return 0;
+    }
+    return 1;
+}
+
+static void finish(int i)
+{
+    xEventGroupSetBits(s_finished, BOOT_DEP(i));
+}
+
+void boot_graph_run(const boot_stage_t *stages, int n)
+{
+    assert(n <= BOOT_MAX_STAGES);
+    s_stages   = stages;
+    s_n        = n;
+    s_finished = xEventGroupCreate();
+    s_work     = xQueueCreate(n + BOOT_WORKERS, sizeof(int));
+    s_done     = xQueueCreate(n, sizeof(int));
+    for (int i = 0; i < n; i++) {
+        s_timing[i] = (boot_timing_t){ .name = stages[i].name, .result = BOOT_PENDING };
+    }
+    for (int w = 0; w < BOOT_WORKERS; w++) {
+        xTaskCreatePinnedToCore(worker_task, "boot_wk", BOOT_WORKER_STACK, NULL, 4, NULL, w & 1);
+    }
+
+    int running = 0, left = n;
+    while (left > 0) {
+        // Start everything that can go: dependencies met, a worker free,
+        // its internal RAM available (or nothing else running to free any)
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (int i = 0; i < n && running < BOOT_WORKERS; i++) {
+                if (s_timing[i].result != BOOT_PENDING) continue;
+                int st = deps_state(i);
+                if (st < 0) {
+                    s_timing[i].result = BOOT_SKIPPED;
+                    s_timing[i].ready_ms = s_timing[i].start_ms = s_timing[i].end_ms = now_ms();
+                    ESP_LOGW(TAG, "%s skipped (a dependency failed)", stages[i].name);
+                    finish(i);
+                    left--;
+                    progress = true;
+                    continue;
+                }
+                if (st == 0) continue;
+                if (!s_timing[i].ready_ms) s_timing[i].ready_ms = now_ms();
+
+                size_t free_now = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+                if (running > 0 && free_now < stages[i].ram + BOOT_RAM_FLOOR) continue;
+                s_timing[i].result = BOOT_RUNNING;
+                xQueueSend(s_work, &i, 0);
+                running++;
+            }
+        }
+        if (left == 0) break;
+
+        int i;
+        xQueueReceive(s_done, &i, portMAX_DELAY);
+        running--;
+        left--;
+        finish(i);
+        if (s_timing[i].result == BOOT_FAILED) {
+            ESP_LOGW(TAG, "%s failed after %lu ms", stages[i].name,
+                     (unsigned long)(s_timing[i].end_ms - s_timing[i].start_ms));
+        }
+    }
+
+    int stop = -1;
+    for (int w = 0; w < BOOT_WORKERS; w++) xQueueSend(s_work, &stop, portMAX_DELAY);
+    ESP_LOGI(TAG, "Boot graph finished at %lu ms", (unsigned long)now_ms());
+}
+
+bool boot_graph_wait(int stage, uint32_t timeout_ms)
+{
+    xEventGroupWaitBits(s_finished, BOOT_DEP(stage), pdFALSE, pdTRUE,
+                        pdMS_TO_TICKS(timeout_ms));
+    return s_timing[stage].result == BOOT_DONE;
+}
+
+// ── Profiler ─────────────────────────────────────────────────────────────────
+
+static void log_timeline(void)
+{
+    uint32_t span = s_ready_ms ? s_ready_ms : now_ms();
+    ESP_LOGI(TAG, "Boot timeline (ms since power-on), ready to talk at %lu ms:",
+             (unsigned long)s_ready_ms);
+    for (int i = 0; i < s_n; i++) {
+        const boot_timing_t *t = &s_timing[i];
+        char bar[BOOT_CHART_COLS + 1];
+        int a = (int)((uint64_t)t->start_ms * BOOT_CHART_COLS / span);
+        int b = (int)((uint64_t)t->end_ms * BOOT_CHART_COLS / span);
+        if (a > BOOT_CHART_COLS) a = BOOT_CHART_COLS;
+        if (b > BOOT_CHART_COLS) b = BOOT_CHART_COLS;
+        for (int c = 0; c < BOOT_CHART_COLS; c++) bar[c] = c >= a && c <= b ? '#' : '.';
+        bar[BOOT_CHART_COLS] = '\0';
+        ESP_LOGI(TAG, "  %-12s %s %6lu → %6lu  (+%lu ms queued)%s", t->name, bar,
+                 (unsigned long)t->start_ms, (unsigned long)t->end_ms,
+                 (unsigned long)(t->start_ms - t->ready_ms),
+                 t->result == BOOT_FAILED ? " FAILED" : t->result == BOOT_SKIPPED ? " skipped" : "");
+    }
+    for (int m = 0; m < s_n_ms; m++) {
+        if (s_ms[m].at_ms) {
+            ESP_LOGI(TAG, "  %-12s at %lu ms", s_ms[m].name, (unsigned long)s_ms[m].at_ms);
+        } else {
+            ESP_LOGW(TAG, "  %-12s not reached", s_ms[m].name);
+        }
+    }
+}
+
+// Stamps each milestone bit as it is set, then logs the timeline
+static void milestone_task(void *arg)
+{
+    EventBits_t want = 0;
+    for (int m = 0; m < s_n_ms; m++) want |= s_ms[m].bit;
+
+    EventBits_t seen = 0;
+    while (seen != want) {
+        int32_t left = (int32_t)(BOOT_READY_TIMEOUT_MS - now_ms());
+        if (left <= 0) break;
+        EventBits_t bits = xEventGroupWaitBits(g_events, want & ~seen, pdFALSE, pdFALSE,
+                                               pdMS_TO_TICKS(left));
+        uint32_t t = now_ms();
+        for (int m = 0; m < s_n_ms; m++) {
+            if ((bits & s_ms[m].bit) && !(seen & s_ms[m].bit)) s_ms[m].at_ms = t;
+        }
+        seen |= bits & want;
+    }
+    uint32_t ready = 0;
+    for (int m = 0; m < s_n_ms; m++) {
+        if (s_ms[m].at_ms > ready) ready = s_ms[m].at_ms;
+    }
+    s_ready_ms = seen == want ? ready : BOOT_READY_TIMEOUT_MS;
+    if (seen != want) ESP_LOGW(TAG, "Not ready to talk after %d ms", BOOT_READY_TIMEOUT_MS);
+    log_timeline();
+    vTaskDelete(NULL);
+}
+
+void boot_milestones_watch(const boot_milestone_t *m, int n)
+{
+    s_n_ms = n < BOOT_MAX_MILESTONES ? n : BOOT_MAX_MILESTONES;
+    memcpy(s_ms, m, s_n_ms * sizeof(*m));
+    xTaskCreatePinnedToCore(milestone_task, "boot_ms", 3072, NULL, 2, NULL, 1);
+}
+
+int boot_stage_timings(const boot_timing_t **out)
+{
+    *out = s_timing;
+    return s_n;
+}
+
+int boot_milestone_times(const boot_milestone_t **out)
+{
+    *out = s_ms;
+    return s_n_ms;
+}
+
+uint32_t boot_ready_ms(void)
+{
+    return s_ready_ms;
+}
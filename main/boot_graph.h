@@ -0,0 +1,71 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Boot as a dependency graph, with a profiler.
+//
+// Each stage names the stages it needs.  boot_graph_run() starts every stage
+// whose dependencies have finished, up to BOOT_WORKERS at once.  A stage
+// also waits until the internal RAM it declares is free (above
+// BOOT_RAM_FLOOR); if nothing else is running, it starts anyway.  When a
+// stage fails, the stages that depend on it are skipped.  Stages run on
+// short-lived workers with internal-RAM stacks, so NVS and flash access are
+// safe there.
+//
+// The profiler records when each stage's dependencies were met, when it
+// started and when it ended, in ms since power-on.  It also records
+// milestones: g_events bits that other modules set later, such as MQTT or
+// the player socket connecting.  Once every milestone is in (or
+// BOOT_READY_TIMEOUT_MS has passed), the timeline is logged as a chart;
+// boot_ready_ms() is then the "ready to talk" time.
+
+#define BOOT_MAX_STAGES     24
+#define BOOT_DEP(i)         (1u << (i))
+
+typedef struct {
+    const char *name;          // camelCase, also the MQTT key
+    bool      (*run)(void);    // false: failed, dependents are skipped
+    uint32_t    deps;          // BOOT_DEP() of earlier stages
+    uint32_t    ram;           // internal RAM (bytes) to leave free to start
+} boot_stage_t;
+
+typedef enum {
+    BOOT_PENDING,
+    BOOT_RUNNING,
+    BOOT_DONE,
+    BOOT_FAILED,
+    BOOT_SKIPPED,
+} boot_result_t;
+
+typedef struct {
+    const char   *name;
+    uint32_t      ready_ms;    // dependencies met
+    uint32_t      start_ms;
+    uint32_t      end_ms;
+    boot_result_t result;
+} boot_timing_t;
+
+typedef struct {
+    const char  *name;
+    EventBits_t  bit;          // in g_events
+    uint32_t     at_ms;        // 0 until seen
+} boot_milestone_t;
+
+// Watch these g_events bits; ready to talk is when all of them are set.
+// Call before boot_graph_run().
+void boot_milestones_watch(const boot_milestone_t *m, int n);
+
+// Run the graph; returns once every stage has finished or been skipped
+void boot_graph_run(const boot_stage_t *stages, int n);
+
+// For a stage that needs another one only partway through: wait for it to
+// finish, true if it succeeded
+bool boot_graph_wait(int stage, uint32_t timeout_ms);
+
+// Profile, valid once boot_ready_ms() is non-zero
+int  boot_stage_timings(const boot_timing_t **out);
+int  boot_milestone_times(const boot_milestone_t **out);
+uint32_t boot_ready_ms(void);      // 0 until every milestone is in or timed out
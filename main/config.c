@@ -1,6 +1,9 @@
 #include "config.h"
+#include "freertos/FreeRTOS.h"
 #include <string.h>
 
+static portMUX_TYPE s_ids_lock = portMUX_INITIALIZER_UNLOCKED;
+
 doll_config_t g_config = {
     .ssid        = "",
     .password    = "",
@@ -12,3 +15,30 @@ doll_config_t g_config = {
     .stream_player_url   = "https://stream-player.cipherdolls.com",
     .provisioned = false,
 };
+
+void config_get_id(config_id_t id, char *out, size_t size)
+{
+    const char *src = id == CONFIG_ID_CHAT   ? g_config.chat_id
+                    : id == CONFIG_ID_AVATAR ? g_config.avatar_id
+                    :                          g_config.scenario_id;
+    taskENTER_CRITICAL(&s_ids_lock);
+    strlcpy(out, src, size);
+    taskEXIT_CRITICAL(&s_ids_lock);
+}
+
+bool config_has_chat(void)
+{
+    taskENTER_CRITICAL(&s_ids_lock);
+    bool has = g_config.chat_id[0] != '\0';
+    taskEXIT_CRITICAL(&s_ids_lock);
+    return has;
+}
+
+void config_set_profile_ids(const char *chat, const char *avatar, const char *scenario)
+{
+    taskENTER_CRITICAL(&s_ids_lock);
+    strlcpy(g_config.chat_id,     chat,     sizeof(g_config.chat_id));
+    strlcpy(g_config.avatar_id,   avatar,   sizeof(g_config.avatar_id));
+    strlcpy(g_config.scenario_id, scenario, sizeof(g_config.scenario_id));
+    taskEXIT_CRITICAL(&s_ids_lock);
+}
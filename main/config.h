@@ -1,4 +1,5 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -14,6 +15,7 @@
 #define CONFIG_STREAM_PLAYER_MAX 128
 #define CONFIG_AVATAR_ID_MAX     64
 #define CONFIG_SCENARIO_ID_MAX   64
+#define CONFIG_ETAG_MAX          72
 
 typedef struct {
     char ssid[CONFIG_SSID_MAX];
@@ -23,9 +25,13 @@ typedef struct {
     char doll_id[CONFIG_DOLL_ID_MAX];            // obtained from backend after POST /dolls
     char server_url[CONFIG_SERVER_MAX];
     char mqtt_url[CONFIG_MQTT_URL_MAX];
-    char chat_id[CONFIG_CHAT_ID_MAX];   // populated at runtime from GET /dolls/:id
-    char avatar_id[CONFIG_AVATAR_ID_MAX]; // populated at runtime from GET /dolls/:id?include=chat
-    char scenario_id[CONFIG_SCENARIO_ID_MAX]; // populated at runtime from GET /dolls/:id?include=chat
+    // Doll profile from GET /dolls/:id?include=chat, cached in NVS and
+    // revalidated in the background on each boot (http.c)
+    char chat_id[CONFIG_CHAT_ID_MAX];
+    char avatar_id[CONFIG_AVATAR_ID_MAX];
+    char scenario_id[CONFIG_SCENARIO_ID_MAX];
+    char doll_etag[CONFIG_ETAG_MAX];    // of the cached profile, "" if the server sent none
+    bool profile_cached;                // the four above came from NVS / were saved there
     char stream_recorder_url[CONFIG_STREAM_REC_MAX];
     char stream_player_url[CONFIG_STREAM_PLAYER_MAX];
     bool provisioned;
@@ -33,3 +39,18 @@ typedef struct {
 } doll_config_t;
 
 extern doll_config_t g_config;
+
+// chat_id, avatar_id and scenario_id change at runtime, when the background
+// profile revalidation (http.c) finds an edit.  That task writes them through
+// config_set_profile_ids(); other tasks copy one out with config_get_id()
+// before formatting it into a URL or topic, never mid-update, and ask
+// config_has_chat() rather than reading chat_id directly.
+typedef enum {
+    CONFIG_ID_CHAT,
+    CONFIG_ID_AVATAR,
+    CONFIG_ID_SCENARIO,
+} config_id_t;
+
+void config_get_id(config_id_t id, char *out, size_t size);
+bool config_has_chat(void);
+void config_set_profile_ids(const char *chat, const char *avatar, const char *scenario);
@@ -59,6 +59,21 @@ esp_err_t config_store_load(void)
         g_config.speaker_volume = vol;
     }
 
+    // Cached doll profile: lets MQTT and the player start before the
+    // backend has answered
+    uint8_t cached = 0;
+    if (strlen(g_config.doll_id) > 0 && nvs_get_u8(h, "profile", &cached) == ESP_OK && cached) {
+        len = sizeof(g_config.chat_id);
+        nvs_get_str(h, "chat_id", g_config.chat_id, &len);
+        len = sizeof(g_config.avatar_id);
+        nvs_get_str(h, "avatar_id", g_config.avatar_id, &len);
+        len = sizeof(g_config.scenario_id);
+        nvs_get_str(h, "scenario_id", g_config.scenario_id, &len);
+        len = sizeof(g_config.doll_etag);
+        nvs_get_str(h, "doll_etag", g_config.doll_etag, &len);
+        g_config.profile_cached = true;
+    }
+
     nvs_close(h);
 
     g_config.provisioned = (strlen(g_config.ssid) > 0);
@@ -81,20 +96,52 @@ esp_err_t config_store_save(void)
     return err;
 }
 
+// Just the volume key: the knob saves often enough that rewriting the
+// credentials each time would be wasted flash wear
+esp_err_t config_store_save_volume(void)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    nvs_set_u8(h, "volume", g_config.speaker_volume);
+    err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+// The doll profile only, with profile_cached: written when the backend's
+// copy differs from the cached one
+esp_err_t config_store_save_profile(void)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    nvs_set_str(h, "chat_id",     g_config.chat_id);
+    nvs_set_str(h, "avatar_id",   g_config.avatar_id);
+    nvs_set_str(h, "scenario_id", g_config.scenario_id);
+    nvs_set_str(h, "doll_etag",   g_config.doll_etag);
+    nvs_set_u8(h, "profile",      g_config.profile_cached);
+    err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
 // NVS writes touch SPI flash which disables cache, making PSRAM inaccessible.
 // This wrapper spawns a short-lived task on internal RAM to do the save safely.
 static SemaphoreHandle_t s_save_sem;
 static esp_err_t s_save_result;
+static esp_err_t (*s_save_fn)(void);
 
 static void save_task(void *arg)
 {
-    s_save_result = config_store_save();
+    s_save_result = s_save_fn();
     xSemaphoreGive(s_save_sem);
     vTaskDelete(NULL);
 }
 
-esp_err_t config_store_save_from_psram(void)
+static esp_err_t save_on_internal_stack(esp_err_t (*fn)(void))
 {
+    s_save_fn  = fn;
     s_save_sem = xSemaphoreCreateBinary();
     xTaskCreate(save_task, "nvs_save", 4096, NULL, 5, NULL);
     xSemaphoreTake(s_save_sem, portMAX_DELAY);
@@ -102,6 +149,16 @@ esp_err_t config_store_save_from_psram(void)
     return s_save_result;
 }
 
+esp_err_t config_store_save_from_psram(void)
+{
+    return save_on_internal_stack(config_store_save);
+}
+
+esp_err_t config_store_save_profile_from_psram(void)
+{
+    return save_on_internal_stack(config_store_save_profile);
+}
+
 esp_err_t config_store_clear(void)
 {
     nvs_handle_t h;
@@ -110,6 +167,7 @@ esp_err_t config_store_clear(void)
     nvs_commit(h);
     nvs_close(h);
     g_config.doll_id[0] = '\0';
+    g_config.profile_cached = false;
     ESP_LOGI(TAG, "Config cleared");
     return ESP_OK;
 }
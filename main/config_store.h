@@ -3,5 +3,8 @@
 
 esp_err_t config_store_load(void);
 esp_err_t config_store_save(void);
+esp_err_t config_store_save_volume(void);     // internal-RAM stack only, like config_store_save()
 esp_err_t config_store_save_from_psram(void);  // safe to call from PSRAM-stacked tasks
+esp_err_t config_store_save_profile(void);     // chat / avatar / scenario ids + ETag
+esp_err_t config_store_save_profile_from_psram(void);
 esp_err_t config_store_clear(void);
@@ -0,0 +1,195 @@
+#include "conv_fsm.h"
+#include <string.h>
+
+#define LISTEN_TIMEOUT_MS   60000
+#define REPLY_TIMEOUT_MS    30000
+
+void conv_fsm_config_default(conv_fsm_config_t *cfg)
+{
+    *cfg = (conv_fsm_config_t){
+        .listen_timeout_ms = LISTEN_TIMEOUT_MS,
+        .reply_timeout_ms  = REPLY_TIMEOUT_MS,
+        .barge_in          = true,
+    };
+}
+
+void conv_fsm_init(conv_fsm_t *f, const conv_fsm_config_t *cfg, conv_clock_t clock)
+{
+    memset(f, 0, sizeof(*f));
+    f->cfg        = *cfg;
+    f->clock      = clock;
+    f->state      = CONV_OFF;
+    f->entered_ms = clock();
+}
+
+conv_input_t conv_fsm_input(const conv_fsm_t *f, conv_event_t ev)
+{
+    return (conv_input_t){ .ev = ev, .at_ms = f->clock() };
+}
+
+int32_t conv_fsm_wait_ms(const conv_fsm_t *f)
+{
+    if (!f->deadline) return -1;
+    int32_t left = (int32_t)(f->deadline_ms - f->clock());
+    return left > 0 ? left : 0;
+}
+
+conv_input_t conv_fsm_timeout_input(const conv_fsm_t *f)
+{
+    return (conv_input_t){ .ev = CONV_EV_TIMEOUT, .at_ms = f->deadline_ms };
+}
+
+// ── Transitions ──────────────────────────────────────────────────────────────
+
+// Next state and actions for ev in state s; false when ev does not apply
+static bool transition(const conv_fsm_t *f, conv_state_t s, conv_event_t ev,
+                       conv_state_t *to, uint32_t *act)
+{
+    switch (s) {
+    case CONV_OFF:
+        if (ev == CONV_EV_KNOB || ev == CONV_EV_WAKE) {
+            *to  = CONV_LISTENING;
+            *act = CONV_ACT_LISTEN | CONV_ACT_PRECONNECT;
+            return true;
+        }
+        return false;
+
+    case CONV_LISTENING:
+        switch (ev) {
+        case CONV_EV_SPEECH:
+            *to  = CONV_RECORDING;
+            *act = CONV_ACT_RECORD;
+            return true;
+        case CONV_EV_PLAY_START:
+            // More of the reply after a gap: back to barge-in listening
+            if (!f->cfg.barge_in) return false;
+            *to  = CONV_PLAYING;
+            *act = CONV_ACT_PLAYING;
+            return true;
+        case CONV_EV_KNOB:
+        case CONV_EV_TIMEOUT:
+            *to  = CONV_OFF;
+            *act = CONV_ACT_EXIT;
+            return true;
+        default:
+            return false;
+        }
+
+    case CONV_RECORDING:
+        switch (ev) {
+        case CONV_EV_SILENCE:
+        case CONV_EV_TURN_STOP:
+            *to  = CONV_WAITING;
+            *act = CONV_ACT_END_TURN | CONV_ACT_PRECONNECT;
+            return true;
+        case CONV_EV_KNOB:
+            *to  = CONV_OFF;
+            *act = CONV_ACT_CANCEL_TURN | CONV_ACT_EXIT;
+            return true;
+        default:
+            return false;
+        }
+
+    case CONV_WAITING:
+        switch (ev) {
+        case CONV_EV_PLAY_START:
+            *to  = CONV_PLAYING;
+            *act = CONV_ACT_PLAYING;
+            return true;
+        case CONV_EV_TURN_DROPPED:
+        case CONV_EV_TIMEOUT:
+            *to  = CONV_LISTENING;
+            *act = CONV_ACT_LISTEN;
+            return true;
+        case CONV_EV_KNOB:
+            *to  = CONV_OFF;
+            *act = CONV_ACT_EXIT;
+            return true;
+        default:
+            return false;
+        }
+
+    case CONV_PLAYING:
+        switch (ev) {
+        case CONV_EV_PLAY_END:
+            *to  = CONV_LISTENING;
+            *act = CONV_ACT_LISTEN | CONV_ACT_PRECONNECT;
+            return true;
+        case CONV_EV_SPEECH:
+            if (!f->cfg.barge_in) return false;
+            *to  = CONV_RECORDING;
+            *act = CONV_ACT_STOP_PLAY | CONV_ACT_RECORD;
+            return true;
+        case CONV_EV_KNOB:
+            *to  = CONV_OFF;
+            *act = CONV_ACT_STOP_PLAY | CONV_ACT_EXIT;
+            return true;
+        default:
+            return false;
+        }
+
+    default:
+        return false;
+    }
+}
+
+bool conv_fsm_handle(conv_fsm_t *f, const conv_input_t *in, conv_step_t *step)
+{
+    // A deadline is only good for the state that set it
+    if (in->ev == CONV_EV_TIMEOUT && (!f->deadline || conv_fsm_wait_ms(f) > 0)) return false;
+
+    conv_state_t to;
+    uint32_t     act;
+    if (!transition(f, f->state, in->ev, &to, &act)) return false;
+
+    uint32_t now = f->clock();
+    int32_t  lat = (int32_t)(now - in->at_ms);
+    if (lat < 0) lat = 0;
+
+    conv_latency_t *l = &f->latency[in->ev];
+    l->last_ms = (uint32_t)lat;
+    l->avg_ms  = l->count ? (l->avg_ms * 7 + (uint32_t)lat) / 8 : (uint32_t)lat;
+    if ((uint32_t)lat > l->max_ms) l->max_ms = (uint32_t)lat;
+    l->count++;
+
+    if (step) {
+        *step = (conv_step_t){
+            .from = f->state, .to = to, .ev = in->ev, .actions = act,
+            .at_ms = now, .latency_ms = (uint32_t)lat,
+        };
+    }
+
+    f->state      = to;
+    f->entered_ms = now;
+    f->transitions++;
+
+    // Deadlines run from entering the state
+    f->deadline = false;
+    if (to == CONV_LISTENING) {
+        f->deadline    = true;
+        f->deadline_ms = now + f->cfg.listen_timeout_ms;
+    } else if (to == CONV_WAITING) {
+        f->deadline    = true;
+        f->deadline_ms = now + f->cfg.reply_timeout_ms;
+    }
+    return true;
+}
+
+// ── Names ────────────────────────────────────────────────────────────────────
+
+const char *conv_state_name(conv_state_t s)
+{
+    static const char *const k_names[CONV_STATE_COUNT] = {
+        "OFF", "LISTENING", "RECORDING", "WAITING", "PLAYING",
+    };
+    return (unsigned)s < CONV_STATE_COUNT ? k_names[s] : "?";
+}
+
+const char *conv_event_name(conv_event_t ev)
+{
+    static const char *const k_names[CONV_EV_COUNT] = {
+        "knob", "wake", "speech", "silence", "turnStop", "turnDropped",
+        "playStart", "playEnd", "timeout",
+    };
+    return (unsigned)ev < CONV_EV_COUNT ? k_names[ev] : "?";
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Conversation state machine: the phases of a conversation and what the
+// record task has to do on each input.
+//
+// Plain C with no FreeRTOS or IDF dependency, and time comes from an injected
+// clock: record.c runs it on esp_timer, tools/conv_sim.c on a scripted fake
+// clock for deterministic latency checks.  Inputs are events stamped when
+// they were posted; each transition records how long its event waited.
+//
+//   OFF        knob, wake         → LISTENING
+//   LISTENING  speech             → RECORDING
+//              play start         → PLAYING     (barge_in: a reply resumed)
+//              knob, timeout      → OFF
+//   RECORDING  silence, turn stop → WAITING
+//              knob               → OFF
+//   WAITING    play start         → PLAYING
+//              dropped, timeout   → LISTENING
+//              knob               → OFF
+//   PLAYING    play end           → LISTENING
+//              speech             → RECORDING   (barge_in)
+//              knob               → OFF
+
+typedef enum {
+    CONV_OFF,
+    CONV_LISTENING,
+    CONV_RECORDING,
+    CONV_WAITING,
+    CONV_PLAYING,
+    CONV_STATE_COUNT,
+} conv_state_t;
+
+typedef enum {
+    CONV_EV_KNOB,          // knob press (starts a conversation when off)
+    CONV_EV_WAKE,          // wake word (starts a conversation; ignored in one)
+    CONV_EV_SPEECH,        // VAD onset, listening or over playback
+    CONV_EV_SILENCE,       // VAD end of speech while recording
+    CONV_EV_TURN_STOP,     // uplink stopped: turn at its maximum length, or link lost
+    CONV_EV_TURN_DROPPED,  // finished turn not kept (too short, never connected)
+    CONV_EV_PLAY_START,
+    CONV_EV_PLAY_END,
+    CONV_EV_TIMEOUT,       // the state's deadline passed (conv_fsm_timeout_input)
+    CONV_EV_COUNT,
+} conv_event_t;
+
+// Actions for the caller, to be run in bit order
+enum {
+    CONV_ACT_STOP_PLAY   = 1 << 0,  // stop playback and the queued rest of a reply
+    CONV_ACT_CANCEL_TURN = 1 << 1,  // abandon the turn being recorded
+    CONV_ACT_END_TURN    = 1 << 2,  // finish uploading the turn
+    CONV_ACT_EXIT        = 1 << 3,  // leave the conversation
+    CONV_ACT_LISTEN      = 1 << 4,  // listen for speech
+    CONV_ACT_RECORD      = 1 << 5,  // start a turn; its onset is in the ring
+    CONV_ACT_PLAYING     = 1 << 6,  // a reply plays: listen for barge-in
+    CONV_ACT_PRECONNECT  = 1 << 7,  // open the next turn's link ahead of speech
+};
+
+typedef struct {
+    uint32_t listen_timeout_ms;   // LISTENING without speech ends the conversation
+    uint32_t reply_timeout_ms;    // WAITING without playback goes back to listening
+    bool     barge_in;            // mic runs over playback (full duplex)
+} conv_fsm_config_t;
+
+typedef uint32_t (*conv_clock_t)(void);   // monotonic ms (may wrap)
+
+typedef struct {
+    conv_event_t ev;
+    uint32_t     at_ms;   // posted
+} conv_input_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t last_ms;
+    uint32_t avg_ms;      // EMA, 1/8
+    uint32_t max_ms;
+} conv_latency_t;
+
+typedef struct {
+    conv_state_t from, to;
+    conv_event_t ev;
+    uint32_t     actions;
+    uint32_t     at_ms;        // handled
+    uint32_t     latency_ms;   // posted → handled
+} conv_step_t;
+
+typedef struct {
+    conv_fsm_config_t cfg;
+    conv_clock_t      clock;
+    conv_state_t      state;
+    uint32_t          entered_ms;
+    uint32_t          deadline_ms;
+    bool              deadline;
+    uint32_t          transitions;
+    conv_latency_t    latency[CONV_EV_COUNT];   // per event, transitions only
+} conv_fsm_t;
+
+void conv_fsm_config_default(conv_fsm_config_t *cfg);
+void conv_fsm_init(conv_fsm_t *f, const conv_fsm_config_t *cfg, conv_clock_t clock);
+
+// An input stamped now
+conv_input_t conv_fsm_input(const conv_fsm_t *f, conv_event_t ev);
+
+// ms until the state's deadline (0: due), -1 when it has none
+int32_t conv_fsm_wait_ms(const conv_fsm_t *f);
+
+// The due deadline as an input, stamped when it fell due
+conv_input_t conv_fsm_timeout_input(const conv_fsm_t *f);
+
+// Apply one input.  True on a transition, described in *step (optional);
+// inputs that do not apply in the current state are ignored.
+bool conv_fsm_handle(conv_fsm_t *f, const conv_input_t *in, conv_step_t *step);
+
+static inline conv_state_t conv_fsm_state(const conv_fsm_t *f) { return f->state; }
+
+const char *conv_state_name(conv_state_t s);
+const char *conv_event_name(conv_event_t ev);   // camelCase, also the metrics key stem
@@ -5,7 +5,7 @@
 #include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 #include "driver/ledc.h"
 #include "driver/spi_master.h"
 #include "esp_lcd_panel_io.h"
@@ -93,26 +93,14 @@ static void dim_rx_cb(void *arg)
 // ─────────────────────────────────────────────────────────────────────────────
 static void lcd_power_on(void)
 {
-    i2c_config_t cfg = {
-        .mode             = I2C_MODE_MASTER,
-        .sda_io_num       = AUDIO_I2C_SDA,
-        .scl_io_num       = AUDIO_I2C_SCL,
-        .sda_pullup_en    = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en    = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = AUDIO_I2C_FREQ,
-    };
-    i2c_param_config(AUDIO_I2C_PORT, &cfg);
-    i2c_driver_install(AUDIO_I2C_PORT, I2C_MODE_MASTER, 0, 0, 0);
-
+    // Bus driver installed by i2c_bus_init() (boot stage "i2c")
     // Configure port 1 (pins 8-15) as outputs
     uint8_t config_cmd[] = { PCA9535_CONFIG1, 0x00 };
-    i2c_master_write_to_device(AUDIO_I2C_PORT, IO_EXP_ADDR,
-        config_cmd, sizeof(config_cmd), pdMS_TO_TICKS(100));
+    i2c_bus_write(I2C_CLIENT_DISPLAY, IO_EXP_ADDR, config_cmd, sizeof(config_cmd));
 
     // Set all port-1 outputs HIGH (pin 9 = BSP_PWR_LCD)
     uint8_t output_cmd[] = { PCA9535_OUTPUT1, 0xFF };
-    i2c_master_write_to_device(AUDIO_I2C_PORT, IO_EXP_ADDR,
-        output_cmd, sizeof(output_cmd), pdMS_TO_TICKS(100));
+    i2c_bus_write(I2C_CLIENT_DISPLAY, IO_EXP_ADDR, output_cmd, sizeof(output_cmd));
 
     ESP_LOGI(TAG, "LCD power ON (IO expander 0x21 pin 9)");
     vTaskDelay(pdMS_TO_TICKS(200));
@@ -275,6 +263,9 @@ esp_err_t display_init(void)
 
 bool display_lvgl_lock(int timeout_ms)
 {
+    // Boot runs in parallel (app_main.c): callers may get here before
+    // display_init(), and then simply draw nothing
+    if (!s_lvgl_mux) return false;
     TickType_t ticks = (timeout_ms < 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
     return xSemaphoreTake(s_lvgl_mux, ticks) == pdTRUE;
 }
@@ -494,7 +485,14 @@ static void enforce_z_order(void)
 void display_set_scenario(uint16_t *rgb565, int w, int h)
 {
     if (!rgb565 || w <= 0 || h <= 0) return;
-    if (!display_lvgl_lock(1000)) return;
+    if (!display_lvgl_lock(1000)) {
+        heap_caps_free(rgb565);
+        return;
+    }
+
+    // A new image for a changed doll profile replaces the old framebuffer
+    void *old = (void *)s_scenario_dsc.data;
+    if (old) lv_img_cache_invalidate_src(&s_scenario_dsc);
 
     // Set up image descriptor pointing to the PSRAM framebuffer
     s_scenario_dsc.header.always_zero = 0;
@@ -521,6 +519,8 @@ void display_set_scenario(uint16_t *rgb565, int w, int h)
     // Make the screen background transparent so the image shows through
     lv_obj_set_style_bg_opa(scr, LV_OPA_TRANSP, 0);
 
+    if (old && old != rgb565) heap_caps_free(old);
+
     ESP_LOGI(TAG, "Scenario image set (%dx%d)", w, h);
     display_lvgl_unlock();
 }
@@ -540,7 +540,14 @@ void display_wake(void)
 void display_set_avatar(uint16_t *rgb565, int w, int h)
 {
     if (!rgb565 || w <= 0 || h <= 0) return;
-    if (!display_lvgl_lock(1000)) return;
+    if (!display_lvgl_lock(1000)) {
+        heap_caps_free(rgb565);
+        return;
+    }
+
+    // A new image for a changed doll profile replaces the old framebuffer
+    void *old = (void *)s_avatar_dsc.data;
+    if (old) lv_img_cache_invalidate_src(&s_avatar_dsc);
 
     // Set up image descriptor pointing to the PSRAM framebuffer
     s_avatar_dsc.header.always_zero = 0;
@@ -583,6 +590,8 @@ void display_set_avatar(uint16_t *rgb565, int w, int h)
     // Make the screen background transparent so the image shows through
     lv_obj_set_style_bg_opa(scr, LV_OPA_TRANSP, 0);
 
+    if (old && old != rgb565) heap_caps_free(old);
+
     ESP_LOGI(TAG, "Avatar image set (%dx%d)", w, h);
     display_lvgl_unlock();
 }
@@ -0,0 +1,369 @@
+#include "dsp_pcm.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#define TEST_ALLOC(bytes)  heap_caps_aligned_alloc(DSP_PCM_ALIGN, (bytes), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define TEST_FREE(p)       heap_caps_free(p)
+#else
+#define TEST_ALLOC(bytes)  aligned_alloc(DSP_PCM_ALIGN, (bytes))
+#define TEST_FREE(p)       free(p)
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(DSP_PCM_SCALAR_ONLY)
+#define DSP_PCM_HAVE_PIE 1
+#else
+#define DSP_PCM_HAVE_PIE 0
+#endif
+
+#define GAIN_SHIFT  12
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v >  32767) return  32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+// ── Scalar reference ─────────────────────────────────────────────────────────
+
+uint64_t dsp_sumsq_s16_scalar(const int16_t *x, size_t n)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t v = x[i];
+        sum += (uint64_t)(v * v);
+    }
+    return sum;
+}
+
+void dsp_interleave_s16_scalar(int16_t *dst, const int16_t *l, const int16_t *r, size_t frames)
+{
+    // Walk backwards so dst may alias l (in-place mono → stereo)
+    for (size_t i = frames; i-- > 0; ) {
+        int16_t a = l[i], b = r[i];
+        dst[i * 2]     = a;
+        dst[i * 2 + 1] = b;
+    }
+}
+
+void dsp_deinterleave_s16_scalar(int16_t *l, int16_t *r, const int16_t *src, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++) {
+        int16_t a = src[i * 2], b = src[i * 2 + 1];
+        if (l) l[i] = a;
+        if (r) r[i] = b;
+    }
+}
+
+void dsp_gain_s16_scalar(int16_t *dst, const int16_t *src, size_t n, uint16_t gain_q12)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = sat16(((int32_t)src[i] * gain_q12) >> GAIN_SHIFT);
+    }
+}
+
+void dsp_mix_s16_scalar(int16_t *dst, const int16_t *a, const int16_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = sat16((int32_t)a[i] + b[i]);
+    }
+}
+
+// ── PIE dispatch (ESP32-S3) ──────────────────────────────────────────────────
+// The assembly kernels process whole 8-sample (128-bit) blocks and require
+// 16-byte aligned pointers; the wrappers below hand them the aligned bulk and
+// finish the tail with the scalar code.
+
+#if DSP_PCM_HAVE_PIE
+
+// ACCX is 40 bits: 32 blocks × 8 × 2^30 = 2^38 can never overflow
+#define SUMSQ_MAX_BLOCKS  32
+
+uint64_t dsp_pie_sumsq_s16(const int16_t *x, size_t blocks);
+void dsp_pie_interleave_s16(int16_t *dst, const int16_t *l, const int16_t *r, size_t blocks);
+void dsp_pie_deinterleave_s16(int16_t *l, int16_t *r, const int16_t *src, size_t blocks);
+void dsp_pie_gain_s16(int16_t *dst, const int16_t *src, size_t blocks, int16_t gain, int shift);
+void dsp_pie_mix_s16(int16_t *dst, const int16_t *a, const int16_t *b, size_t blocks);
+
+// Cleared by dsp_pcm_selftest() if a kernel disagrees with the scalar code
+static bool s_pie_ok = true;
+
+static inline int aligned(const void *p)
+{
+    return s_pie_ok && (p == NULL || ((uintptr_t)p & (DSP_PCM_ALIGN - 1)) == 0);
+}
+
+uint64_t dsp_sumsq_s16(const int16_t *x, size_t n)
+{
+    uint64_t sum = 0;
+    size_t   i   = 0;
+    if (aligned(x)) {
+        while (n - i >= 8) {
+            size_t blocks = (n - i) / 8;
+            if (blocks > SUMSQ_MAX_BLOCKS) blocks = SUMSQ_MAX_BLOCKS;
+            sum += dsp_pie_sumsq_s16(x + i, blocks) & 0xFFFFFFFFFFULL;
+            i   += blocks * 8;
+        }
+    }
+    return sum + dsp_sumsq_s16_scalar(x + i, n - i);
+}
+
+void dsp_interleave_s16(int16_t *dst, const int16_t *l, const int16_t *r, size_t frames)
+{
+    // Vector path writes dst front to back, so it cannot run in place
+    if (!aligned(dst) || !aligned(l) || !aligned(r) || dst == l || dst == r) {
+        dsp_interleave_s16_scalar(dst, l, r, frames);
+        return;
+    }
+    size_t blocks = frames / 8;
+    dsp_pie_interleave_s16(dst, l, r, blocks);
+    size_t done = blocks * 8;
+    dsp_interleave_s16_scalar(dst + done * 2, l + done, r + done, frames - done);
+}
+
+void dsp_deinterleave_s16(int16_t *l, int16_t *r, const int16_t *src, size_t frames)
+{
+    if (!aligned(l) || !aligned(r) || !aligned(src) || (!l && !r)) {
+        dsp_deinterleave_s16_scalar(l, r, src, frames);
+        return;
+    }
+    size_t blocks = frames / 8;
+    dsp_pie_deinterleave_s16(l, r, src, blocks);
+    size_t done = blocks * 8;
+    dsp_deinterleave_s16_scalar(l ? l + done : NULL, r ? r + done : NULL,
+                                src + done * 2, frames - done);
+}
+
+void dsp_gain_s16(int16_t *dst, const int16_t *src, size_t n, uint16_t gain_q12)
+{
+    // EE.VMUL.S16 keeps the low 16 bits without saturating, so only gains that
+    // cannot overflow (≤ unity) take the vector path.
+    size_t done = 0;
+    if (gain_q12 <= DSP_GAIN_UNITY && s_pie_ok && aligned(dst) && aligned(src)) {
+        size_t blocks = n / 8;
+        dsp_pie_gain_s16(dst, src, blocks, (int16_t)gain_q12, GAIN_SHIFT);
+        done = blocks * 8;
+    }
+    dsp_gain_s16_scalar(dst + done, src + done, n - done, gain_q12);
+}
+
+void dsp_mix_s16(int16_t *dst, const int16_t *a, const int16_t *b, size_t n)
+{
+    size_t done = 0;
+    if (aligned(dst) && aligned(a) && aligned(b)) {
+        size_t blocks = n / 8;
+        dsp_pie_mix_s16(dst, a, b, blocks);
+        done = blocks * 8;
+    }
+    dsp_mix_s16_scalar(dst + done, a + done, b + done, n - done);
+}
+
+#else  // !DSP_PCM_HAVE_PIE
+
+uint64_t dsp_sumsq_s16(const int16_t *x, size_t n)
+{
+    return dsp_sumsq_s16_scalar(x, n);
+}
+
+void dsp_interleave_s16(int16_t *dst, const int16_t *l, const int16_t *r, size_t frames)
+{
+    dsp_interleave_s16_scalar(dst, l, r, frames);
+}
+
+void dsp_deinterleave_s16(int16_t *l, int16_t *r, const int16_t *src, size_t frames)
+{
+    dsp_deinterleave_s16_scalar(l, r, src, frames);
+}
+
+void dsp_gain_s16(int16_t *dst, const int16_t *src, size_t n, uint16_t gain_q12)
+{
+    dsp_gain_s16_scalar(dst, src, n, gain_q12);
+}
+
+void dsp_mix_s16(int16_t *dst, const int16_t *a, const int16_t *b, size_t n)
+{
+    dsp_mix_s16_scalar(dst, a, b, n);
+}
+
+#endif // DSP_PCM_HAVE_PIE
+
+// ── Self-test ────────────────────────────────────────────────────────────────
+// Every dispatching kernel against its scalar reference on aligned buffers:
+// whole blocks, odd tails, saturation, in-place use.  On the S3 this is the
+// PIE path; elsewhere dispatch is the scalar code and it passes trivially.
+
+#define SELFTEST_BLOCKS  40                              // > SUMSQ_MAX_BLOCKS
+#define SELFTEST_MAX     (8 * SELFTEST_BLOCKS + 7)       // longest frame count
+#define TEST_MAX         (2 * SELFTEST_MAX + 10)         // samples, 16-byte multiple
+
+static uint32_t s_lcg = 12345;
+
+static int16_t test_sample(void)
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    // A quarter full scale, to hit the saturation paths
+    if ((s_lcg >> 30) == 0) return (s_lcg & 0x100) ? 32767 : -32768;
+    return (int16_t)(s_lcg >> 16);
+}
+
+static void test_fill(int16_t *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = test_sample();
+}
+
+static bool selftest_run(int16_t *a, int16_t *b, int16_t *x, int16_t *y, int16_t *src)
+{
+    static const size_t k_lens[] = { 0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 257,
+                                     SELFTEST_MAX };
+    static const uint16_t k_gains[] = { 0, 1, 2048, 4095, DSP_GAIN_UNITY,
+                                        DSP_GAIN_UNITY + 1, 65535 };
+    const size_t bytes = TEST_MAX * sizeof(int16_t);
+
+    for (size_t t = 0; t < sizeof(k_lens) / sizeof(k_lens[0]); t++) {
+        size_t n = k_lens[t];
+        test_fill(a, 2 * n + 8);
+        test_fill(b, 2 * n + 8);
+
+        if (dsp_sumsq_s16(a, 2 * n) != dsp_sumsq_s16_scalar(a, 2 * n)) return false;
+
+        dsp_interleave_s16(x, a, b, n);
+        dsp_interleave_s16_scalar(y, a, b, n);
+        if (memcmp(x, y, 2 * n * sizeof(int16_t))) return false;
+
+        // Both halves, one half, and in place over the source
+        memset(x, 0, bytes);
+        memset(y, 0, bytes);
+        dsp_deinterleave_s16(x, y, a, n);
+        dsp_deinterleave_s16_scalar(src, src + n, a, n);
+        if (memcmp(x, src, n * sizeof(int16_t)) || memcmp(y, src + n, n * sizeof(int16_t))) {
+            return false;
+        }
+        memcpy(x, a, 2 * n * sizeof(int16_t));
+        memcpy(y, a, 2 * n * sizeof(int16_t));
+        dsp_deinterleave_s16(x, NULL, x, n);
+        dsp_deinterleave_s16_scalar(y, NULL, y, n);
+        if (memcmp(x, y, 2 * n * sizeof(int16_t))) return false;
+        memcpy(x, a, 2 * n * sizeof(int16_t));
+        memcpy(y, a, 2 * n * sizeof(int16_t));
+        dsp_deinterleave_s16(NULL, x, x, n);
+        dsp_deinterleave_s16_scalar(NULL, y, y, n);
+        if (memcmp(x, y, 2 * n * sizeof(int16_t))) return false;
+
+        for (size_t g = 0; g < sizeof(k_gains) / sizeof(k_gains[0]); g++) {
+            dsp_gain_s16(x, a, n, k_gains[g]);
+            dsp_gain_s16_scalar(y, a, n, k_gains[g]);
+            if (memcmp(x, y, n * sizeof(int16_t))) return false;
+        }
+        memcpy(x, a, n * sizeof(int16_t));
+        dsp_gain_s16(x, x, n, 2048);
+        dsp_gain_s16_scalar(y, a, n, 2048);
+        if (memcmp(x, y, n * sizeof(int16_t))) return false;
+
+        dsp_mix_s16(x, a, b, n);
+        dsp_mix_s16_scalar(y, a, b, n);
+        if (memcmp(x, y, n * sizeof(int16_t))) return false;
+        memcpy(x, a, n * sizeof(int16_t));
+        dsp_mix_s16(x, x, b, n);
+        if (memcmp(x, y, n * sizeof(int16_t))) return false;
+    }
+    return true;
+}
+
+bool dsp_pcm_selftest(void)
+{
+    const size_t bytes = TEST_MAX * sizeof(int16_t);
+    int16_t *buf[5];
+    bool ok = true;
+    for (int i = 0; i < 5; i++) buf[i] = TEST_ALLOC(bytes);
+    for (int i = 0; i < 5; i++) ok = ok && buf[i];
+    if (ok) ok = selftest_run(buf[0], buf[1], buf[2], buf[3], buf[4]);
+    for (int i = 0; i < 5; i++) if (buf[i]) TEST_FREE(buf[i]);
+#if DSP_PCM_HAVE_PIE
+    s_pie_ok = ok;
+#endif
+    return ok;
+}
+
+uint16_t dsp_rms_s16(const int16_t *x, size_t n)
+{
+    if (n == 0) return 0;
+    return (uint16_t)sqrtf((float)dsp_sumsq_s16(x, n) / n);
+}
+
+void dsp_downmix_s16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++) {
+        dst[i] = (int16_t)(((int32_t)src[2 * i] + src[2 * i + 1]) >> 1);
+    }
+}
+
+// ── Resampler ────────────────────────────────────────────────────────────────
+// x(-1) = prev, x(k) = in[k] (low-passed when downsampling); phase walks that
+// sequence in Q16 steps.
+
+void dsp_resampler_init(dsp_resampler_t *rs, int in_hz, int out_hz)
+{
+    memset(rs, 0, sizeof(*rs));
+    rs->step  = (uint32_t)(((uint64_t)in_hz << 16) / (uint32_t)out_hz);
+    rs->phase = 1u << 16;   // first output lands on in[0]
+    if (in_hz <= out_hz) return;
+
+    // Hamming-windowed sinc, cutoff 0.45 × out_hz; normalised to unity DC gain
+    const int   n  = DSP_RESAMPLE_TAPS;
+    const float fc = 0.45f * (float)out_hz / (float)in_hz;
+    float       h[DSP_RESAMPLE_TAPS], sum = 0;
+    for (int i = 0; i < n; i++) {
+        float m = (float)(i - (n - 1) / 2);
+        float s = m == 0 ? 2 * fc : sinf(2 * (float)M_PI * fc * m) / ((float)M_PI * m);
+        h[i] = s * (0.54f - 0.46f * cosf(2 * (float)M_PI * i / (n - 1)));
+        sum += h[i];
+    }
+    for (int i = 0; i < n; i++) rs->coef[i] = (int16_t)lrintf(h[i] / sum * 32767.0f);
+    rs->taps = (uint8_t)n;
+}
+
+static int16_t resample_fir(dsp_resampler_t *rs, int16_t x)
+{
+    const int n = rs->taps;
+    rs->hist[rs->pos]     = x;
+    rs->hist[rs->pos + n] = x;
+    rs->pos = (uint8_t)(rs->pos + 1 == n ? 0 : rs->pos + 1);
+
+    // hist[pos .. pos+n-1] is the window, oldest first
+    const int16_t *w   = &rs->hist[rs->pos];
+    int32_t        acc = 1 << 14;
+    for (int i = 0; i < n; i++) acc += (int32_t)w[i] * rs->coef[i];
+    acc >>= 15;
+    return (int16_t)(acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : acc);
+}
+
+size_t dsp_resample_s16(dsp_resampler_t *rs, const int16_t *in, size_t n,
+                        int16_t *out, size_t out_max)
+{
+    if (n == 0) return 0;
+
+    size_t   produced = 0;
+    uint32_t phase    = rs->phase;
+    int32_t  s0       = rs->prev;
+    for (size_t i = 0; i < n; i++) {
+        // Every input sample goes through the filter, to keep its history
+        int32_t s1 = rs->taps ? resample_fir(rs, in[i]) : in[i];
+        while ((phase >> 16) == i && produced < out_max) {
+            int32_t frac = (int32_t)(phase & 0xFFFF);
+            out[produced++] = (int16_t)(s0 + (int32_t)(((int64_t)(s1 - s0) * frac) >> 16));
+            phase += rs->step;
+        }
+        s0 = s1;
+    }
+    // Out of room: skip the rest of this chunk rather than drift
+    if ((phase >> 16) < n) phase = (uint32_t)n << 16;
+
+    rs->phase = phase - ((uint32_t)n << 16);
+    rs->prev  = (int16_t)s0;
+    return produced;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 16-bit PCM kernels used on every audio chunk (playback and microphone).
+//
+// On the ESP32-S3 the bulk of each call runs on the PIE 128-bit vector unit
+// (dsp_pcm_s3.S) when all pointers are 16-byte aligned; tails and unaligned
+// buffers fall back to the scalar code.  The scalar versions (*_scalar) are
+// plain C, build on any host, and define the exact output the PIE path must
+// reproduce bit for bit.
+//
+// Allocate buffers with heap_caps_aligned_alloc(DSP_PCM_ALIGN, ...) to stay
+// on the vector path.
+
+#define DSP_PCM_ALIGN   16
+
+#define DSP_GAIN_UNITY  4096   // gain is Q12: 4096 = 0 dB, max 65535 ≈ +24 dB
+
+// Σ x[i]² over n samples
+uint64_t dsp_sumsq_s16(const int16_t *x, size_t n);
+
+// sqrt(Σ x[i]² / n), 0 for n == 0
+uint16_t dsp_rms_s16(const int16_t *x, size_t n);
+
+// dst[2i] = l[i], dst[2i+1] = r[i]  (l == r gives mono → stereo)
+void dsp_interleave_s16(int16_t *dst, const int16_t *l, const int16_t *r, size_t frames);
+
+// l[i] = src[2i], r[i] = src[2i+1].  Either output may be NULL, and an output
+// may alias src (in-place downmix to one channel).
+void dsp_deinterleave_s16(int16_t *l, int16_t *r, const int16_t *src, size_t frames);
+
+// dst[i] = sat16((src[i] × gain_q12) >> 12); dst may alias src
+void dsp_gain_s16(int16_t *dst, const int16_t *src, size_t n, uint16_t gain_q12);
+
+// dst[i] = sat16(a[i] + b[i]); dst may alias a or b
+void dsp_mix_s16(int16_t *dst, const int16_t *a, const int16_t *b, size_t n);
+
+// dst[i] = (src[2i] + src[2i+1]) / 2, stereo → mono; dst may alias src
+// (scalar only)
+void dsp_downmix_s16(int16_t *dst, const int16_t *src, size_t frames);
+
+// Streaming linear-interpolation resampler (scalar only; used to fold
+// playback onto a fixed I2S rate).  State carries the fractional phase, the
+// last input sample and the filter history across calls, so a stream can be
+// fed in any chunking.  Downsampling first runs the input through a
+// DSP_RESAMPLE_TAPS-tap windowed-sinc low-pass at 0.45 × out_hz, so content
+// above the new Nyquist rate is removed instead of aliased.
+#define DSP_RESAMPLE_TAPS  41
+
+typedef struct {
+    uint32_t step;    // input samples per output sample, Q16
+    uint32_t phase;   // position relative to `prev`, Q16
+    int16_t  prev;    // last (filtered) sample of the previous chunk
+    uint8_t  taps;    // 0: no anti-alias filter (upsampling, same rate)
+    uint8_t  pos;     // next write in hist
+    int16_t  coef[DSP_RESAMPLE_TAPS];       // Q15, symmetric
+    int16_t  hist[2 * DSP_RESAMPLE_TAPS];   // input history, written twice
+} dsp_resampler_t;
+
+void dsp_resampler_init(dsp_resampler_t *rs, int in_hz, int out_hz);
+
+// Mono in → mono out; returns output samples (at most out_max, excess input
+// is dropped).  out must not alias in.
+size_t dsp_resample_s16(dsp_resampler_t *rs, const int16_t *in, size_t n,
+                        int16_t *out, size_t out_max);
+
+// Compares each dispatching kernel with its scalar reference on aligned
+// buffers: odd tails, saturation, in-place use.  On a mismatch the vector
+// path is switched off (the scalar code keeps running) and false returned.
+// Allocation failure also returns false.
+bool dsp_pcm_selftest(void);
+
+// Portable reference implementations
+uint64_t dsp_sumsq_s16_scalar(const int16_t *x, size_t n);
+void dsp_interleave_s16_scalar(int16_t *dst, const int16_t *l, const int16_t *r, size_t frames);
+void dsp_deinterleave_s16_scalar(int16_t *l, int16_t *r, const int16_t *src, size_t frames);
+void dsp_gain_s16_scalar(int16_t *dst, const int16_t *src, size_t n, uint16_t gain_q12);
+void dsp_mix_s16_scalar(int16_t *dst, const int16_t *a, const int16_t *b, size_t n);
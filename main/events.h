@@ -15,8 +15,8 @@
 #define EVT_DOLL_READY          (1 << 9)   // doll_id confirmed with backend
 #define EVT_CONV_MODE           (1 << 10)  // conversation mode active
 #define EVT_CONV_LISTENING      (1 << 11)  // listening for speech (green LED)
-#define EVT_IMAGES_DONE         (1 << 12)  // avatar+scenario download finished
 #define EVT_STREAM_PLAYING      (1 << 13)  // stream-player delivering TTS audio
 #define EVT_STREAM_CONNECTED    (1 << 14)  // stream-player WebSocket connected
+#define EVT_TIME_SYNCED         (1 << 15)  // wall clock trusted (time_sync.c)
 
 extern EventGroupHandle_t g_events;
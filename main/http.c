@@ -3,35 +3,45 @@
 #include "config_store.h"
 #include "display.h"
 #include "avatar_img.h"
+#include "scenario_img.h"
 #include "events.h"
-#include "esp_http_client.h"
-#include "esp_crt_bundle.h"
+#include "http_pool.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "esp_mac.h"
-#include "esp_sntp.h"
+#include "esp_system.h"
+#include "time_sync.h"
+#include "mqtt.h"
+#include "stream_player.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
 #include <stdio.h>
+#include <strings.h>
 
 static const char *TAG = "http";
 
 #define MAX_RETRIES    5
 #define RETRY_DELAY_MS 5000
 #define RESP_BUF_SIZE  2048
+#define TIME_SYNC_WAIT_MS 10000   // the old up-front SNTP wait, now only after a failure
 
 // ── HTTP response accumulator ─────────────────────────────────────────────────
 
 typedef struct {
     char buf[RESP_BUF_SIZE];
     int  len;
+    char etag[CONFIG_ETAG_MAX];
 } resp_t;
 
 static esp_err_t on_data(esp_http_client_event_t *evt)
 {
     resp_t *r = (resp_t *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && r &&
+        strcasecmp(evt->header_key, "ETag") == 0) {
+        strlcpy(r->etag, evt->header_value, sizeof(r->etag));
+    }
     if (evt->event_id == HTTP_EVENT_ON_DATA && r) {
         int space = RESP_BUF_SIZE - r->len - 1;
         int copy  = evt->data_len < space ? evt->data_len : space;
@@ -44,22 +54,18 @@ static esp_err_t on_data(esp_http_client_event_t *evt)
 
 // ── Simple GET — returns HTTP status code, -1 on transport error ──────────────
 
-static int http_get(const char *url, const char *auth, resp_t *resp)
+// etag: conditional GET, 304 when the resource still matches (NULL: none)
+static int http_get(const char *url, resp_t *resp, const char *etag)
 {
-    esp_http_client_config_t cfg = {
-        .url                = url,
-        .crt_bundle_attach  = esp_crt_bundle_attach,
-        .event_handler      = on_data,
-        .user_data          = resp,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    esp_http_client_set_header(client, "Authorization", auth);
+    esp_http_client_handle_t client = http_pool_acquire(url, on_data, resp);
+    if (!client) return -1;
+    if (etag && etag[0]) esp_http_client_set_header(client, "If-None-Match", etag);
 
     int status = -1;
-    if (esp_http_client_perform(client) == ESP_OK) {
+    if (http_pool_perform(client) == ESP_OK) {
         status = esp_http_client_get_status_code(client);
     }
-    esp_http_client_cleanup(client);
+    http_pool_release(client, status > 0);
     return status;
 }
 
@@ -73,99 +79,161 @@ static void get_mac_str(char *out, size_t out_sz)
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
-// ── Main sync task ────────────────────────────────────────────────────────────
+// ── Doll profile ──────────────────────────────────────────────────────────────
 
-static void show_chat_status(const char *resp_json)
+typedef struct {
+    char chat_id[CONFIG_CHAT_ID_MAX];
+    char avatar_id[CONFIG_AVATAR_ID_MAX];
+    char scenario_id[CONFIG_SCENARIO_ID_MAX];
+} profile_t;
+
+// From the doll JSON; avatarId and scenarioId come from the nested chat
+// object (requires ?include=chat).  No chat: all empty.
+static void parse_profile(const char *resp_json, profile_t *p)
 {
-    char msg[128];
+    memset(p, 0, sizeof(*p));
     cJSON *j = cJSON_Parse(resp_json);
     const char *cid = j ? cJSON_GetStringValue(cJSON_GetObjectItem(j, "chatId")) : NULL;
     if (cid && strlen(cid) > 0) {
-        strlcpy(g_config.chat_id, cid, sizeof(g_config.chat_id));
-        msg[0] = '\0';
-
-        // Extract avatarId and scenarioId from nested chat object (requires ?include=chat)
-        cJSON *chat = j ? cJSON_GetObjectItem(j, "chat") : NULL;
+        strlcpy(p->chat_id, cid, sizeof(p->chat_id));
+        cJSON *chat = cJSON_GetObjectItem(j, "chat");
         const char *aid = chat ? cJSON_GetStringValue(cJSON_GetObjectItem(chat, "avatarId")) : NULL;
-        if (aid && strlen(aid) > 0) {
-            strlcpy(g_config.avatar_id, aid, sizeof(g_config.avatar_id));
-            ESP_LOGI(TAG, "Avatar ID: %s", g_config.avatar_id);
-        } else {
-            memset(g_config.avatar_id, 0, sizeof(g_config.avatar_id));
-        }
+        if (aid) strlcpy(p->avatar_id, aid, sizeof(p->avatar_id));
         const char *sid = chat ? cJSON_GetStringValue(cJSON_GetObjectItem(chat, "scenarioId")) : NULL;
-        if (sid && strlen(sid) > 0) {
-            strlcpy(g_config.scenario_id, sid, sizeof(g_config.scenario_id));
-            ESP_LOGI(TAG, "Scenario ID: %s", g_config.scenario_id);
-        } else {
-            memset(g_config.scenario_id, 0, sizeof(g_config.scenario_id));
-        }
-    } else {
-        memset(g_config.chat_id, 0, sizeof(g_config.chat_id));
-        memset(g_config.avatar_id, 0, sizeof(g_config.avatar_id));
-        memset(g_config.scenario_id, 0, sizeof(g_config.scenario_id));
-        snprintf(msg, sizeof(msg), "No chat linked");
+        if (sid) strlcpy(p->scenario_id, sid, sizeof(p->scenario_id));
     }
     if (j) cJSON_Delete(j);
-    display_set_state(DISPLAY_STATE_WIFI_OK, msg);
 }
 
-static void sync_task(void *arg)
+static void show_chat_status(void)
 {
-    // Sync system clock via NTP — required for TLS certificate date validation
-    display_set_state(DISPLAY_STATE_PROCESSING, "Syncing time...");
-    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    esp_sntp_setservername(0, "pool.ntp.org");
-    esp_sntp_init();
-    int sntp_retries = 0;
-    while (sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED && sntp_retries++ < 10) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
+    display_set_state(DISPLAY_STATE_WIFI_OK, strlen(g_config.chat_id) > 0 ? "" : "No chat linked");
+}
+
+// Into g_config.  live: MQTT, the player and the images already run on the
+// cached profile, so each change goes to the module it concerns.  True if
+// anything changed.
+static bool apply_profile(const profile_t *p, bool live)
+{
+    bool chat     = strcmp(p->chat_id,     g_config.chat_id)     != 0;
+    bool avatar   = strcmp(p->avatar_id,   g_config.avatar_id)   != 0;
+    bool scenario = strcmp(p->scenario_id, g_config.scenario_id) != 0;
+    if (!chat && !avatar && !scenario) return false;
+
+    // This task is the only writer, so it reads g_config directly; the
+    // subscribers get their own copies of the chat IDs
+    char old_chat[CONFIG_CHAT_ID_MAX];
+    strlcpy(old_chat, g_config.chat_id, sizeof(old_chat));
+    config_set_profile_ids(p->chat_id, p->avatar_id, p->scenario_id);
+    ESP_LOGI(TAG, "Chat: %s  Avatar ID: %s  Scenario ID: %s",
+             p->chat_id, p->avatar_id, p->scenario_id);
+    if (!live) return true;
+
+    if (chat) {
+        mqtt_chat_changed(old_chat, p->chat_id);
+        stream_player_chat_changed(p->chat_id);
+        show_chat_status();
     }
-    if (sntp_retries >= 10) {
-        ESP_LOGW(TAG, "SNTP sync timed out");
-    } else {
-        ESP_LOGI(TAG, "SNTP synced OK");
+    if (avatar && strlen(p->avatar_id) > 0) avatar_img_start();
+    if (scenario && strlen(p->scenario_id) > 0) scenario_img_start();
+    return true;
+}
+
+static void save_profile(const char *etag)
+{
+    strlcpy(g_config.doll_etag, etag, sizeof(g_config.doll_etag));
+    g_config.profile_cached = true;
+    if (config_store_save_profile_from_psram() != ESP_OK) {
+        ESP_LOGW(TAG, "Profile not cached");
     }
+}
+
+static void doll_ready(void)
+{
+    show_chat_status();
+    xEventGroupSetBits(g_events, EVT_DOLL_READY);
+    // Both downloads at once: the pool and the RAM budget
+    // (mem_budget.c) decide how much actually overlaps
+    avatar_img_start();
+    scenario_img_start();
+}
+
+// ── Main sync task ────────────────────────────────────────────────────────────
+
+// No connection on an untrusted clock: perhaps a certificate newer than the
+// restored time.  True once SNTP (or another response) has set it: retry.
+static bool wait_for_clock(int status)
+{
+    if (status > 0 || time_sync_trusted()) return false;
+    display_set_state(DISPLAY_STATE_PROCESSING, "Syncing time...");
+    return time_sync_wait(TIME_SYNC_WAIT_MS);
+}
 
+static void sync_task(void *arg)
+{
+    // No wait for SNTP: the clock was restored at boot (time_sync.c), and
+    // the first response's Date header corrects it
     char url[256];
-    char auth[128];
     char mac[18];
     get_mac_str(mac, sizeof(mac));
-    snprintf(auth, sizeof(auth), "Bearer %s", g_config.apikey);
     ESP_LOGI(TAG, "API key: '%.8s...' (len=%d)", g_config.apikey, (int)strlen(g_config.apikey));
 
-    // GET /dolls and POST /dolls both accept Bearer auth.
-    // 401 on either means the API key is wrong — surface that immediately.
-    display_set_state(DISPLAY_STATE_PROCESSING, "Connecting...");
+    // A cached profile goes live at once: MQTT, the player and the images
+    // start now, and the GET below only revalidates it
+    bool live = g_config.profile_cached && strlen(g_config.doll_id) > 0;
+    if (live) {
+        ESP_LOGI(TAG, "Doll %s from cache (etag %s), revalidating",
+                 g_config.doll_id, g_config.doll_etag[0] ? g_config.doll_etag : "none");
+        doll_ready();
+    } else {
+        // GET /dolls and POST /dolls both accept Bearer auth.
+        // 401 on either means the API key is wrong — surface that immediately.
+        display_set_state(DISPLAY_STATE_PROCESSING, "Connecting...");
+    }
 
     resp_t resp = {.len = 0};
     int status  = 0;
 
     // ── Register / verify doll ────────────────────────────────────────────────
     for (int attempt = 0; attempt < MAX_RETRIES; attempt++) {
-        resp.len = 0;
-        status   = 0;
+        resp.len     = 0;
+        resp.etag[0] = '\0';
+        status       = 0;
 
         // If we already have a doll_id, verify it still exists on the backend
         if (strlen(g_config.doll_id) > 0) {
-            display_set_state(DISPLAY_STATE_PROCESSING, "Checking API key...");
+            if (!live) display_set_state(DISPLAY_STATE_PROCESSING, "Checking API key...");
             snprintf(url, sizeof(url), "%s/dolls/%s?include=chat", g_config.server_url, g_config.doll_id);
             ESP_LOGI(TAG, "GET %s", url);
 
-            status = http_get(url, auth, &resp);
+            status = http_get(url, &resp, live ? g_config.doll_etag : NULL);
+            if (wait_for_clock(status)) continue;
 
             if (status == 401) {
                 ESP_LOGE(TAG, "API key invalid");
                 display_set_state(DISPLAY_STATE_ERROR, "Invalid API key\nCheck .env");
                 goto done;
             }
+            if (status == 304) {
+                ESP_LOGI(TAG, "Doll profile unchanged");
+                goto done;
+            }
             if (status == 200) {
                 ESP_LOGI(TAG, "Doll verified: %s", g_config.doll_id);
-                show_chat_status(resp.buf);
-                xEventGroupSetBits(g_events, EVT_DOLL_READY);
-                avatar_img_start();
+                profile_t p;
+                parse_profile(resp.buf, &p);
+                bool changed = apply_profile(&p, live);
+                if (changed || !live || strcmp(resp.etag, g_config.doll_etag) != 0) {
+                    save_profile(resp.etag);
+                }
+                if (!live) doll_ready();
                 goto done;
             }
+            if (status != 404) {
+                ESP_LOGW(TAG, "GET /dolls/:id returned %d, retrying", status);
+                vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
+                continue;
+            }
 
             // 404 → doll deleted on backend, fall through to POST
             ESP_LOGW(TAG, "GET /dolls/:id returned %d — re-registering", status);
@@ -184,23 +252,18 @@ static void sync_task(void *arg)
         char *body_str = cJSON_PrintUnformatted(body);
         cJSON_Delete(body);
 
-        esp_http_client_config_t cfg = {
-            .url               = url,
-            .method            = HTTP_METHOD_POST,
-            .crt_bundle_attach = esp_crt_bundle_attach,
-            .event_handler     = on_data,
-            .user_data         = &resp,
-        };
-        esp_http_client_handle_t client = esp_http_client_init(&cfg);
-        esp_http_client_set_header(client, "Authorization", auth);
-        esp_http_client_set_header(client, "Content-Type",  "application/json");
-        esp_http_client_set_post_field(client, body_str, strlen(body_str));
-
-        esp_err_t err = esp_http_client_perform(client);
-        if (err == ESP_OK) {
-            status = esp_http_client_get_status_code(client);
+        esp_http_client_handle_t client = http_pool_acquire(url, on_data, &resp);
+        if (client) {
+            esp_http_client_set_method(client, HTTP_METHOD_POST);
+            esp_http_client_set_header(client, "Content-Type", "application/json");
+            esp_http_client_set_post_field(client, body_str, strlen(body_str));
+
+            esp_err_t err = http_pool_perform(client);
+            if (err == ESP_OK) {
+                status = esp_http_client_get_status_code(client);
+            }
+            http_pool_release(client, err == ESP_OK);
         }
-        esp_http_client_cleanup(client);
         free(body_str);
 
         ESP_LOGI(TAG, "POST status=%d  body=%s", status, resp.buf);
@@ -221,9 +284,17 @@ static void sync_task(void *arg)
                     strlcpy(g_config.doll_id, id, sizeof(g_config.doll_id));
                     config_store_save_from_psram();
                     ESP_LOGI(TAG, "Registered — doll_id=%s", g_config.doll_id);
-                    show_chat_status(resp.buf);
-                    xEventGroupSetBits(g_events, EVT_DOLL_READY);
-                    avatar_img_start();
+                    profile_t p;
+                    parse_profile(resp.buf, &p);
+                    apply_profile(&p, false);
+                    save_profile("");    // POST's ETag is not the GET's
+                    if (live) {
+                        // MQTT client id and topics, and the player, are
+                        // all keyed on the old doll_id
+                        ESP_LOGW(TAG, "Cached doll was deleted, restarting as the new one");
+                        esp_restart();
+                    }
+                    doll_ready();
                 }
                 cJSON_Delete(json);
             }
@@ -239,9 +310,16 @@ static void sync_task(void *arg)
         ESP_LOGW(TAG, "Attempt %d failed (status=%d): %s",
                  attempt + 1, status, err_msg ? err_msg : resp.buf);
         if (err_json) cJSON_Delete(err_json);
+
+        if (wait_for_clock(status)) continue;
         vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
     }
 
+    if (live) {
+        // The doll keeps running on the cached profile
+        ESP_LOGW(TAG, "Max retries reached — profile not revalidated");
+        goto done;
+    }
     ESP_LOGE(TAG, "Max retries reached — registration failed");
     display_set_state(DISPLAY_STATE_ERROR, "Registration failed\nCheck doll body ID");
 
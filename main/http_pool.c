@@ -0,0 +1,225 @@
+#include "http_pool.h"
+#include "net_stats.h"
+#include "mem_budget.h"
+#include "time_sync.h"
+#include "config.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <assert.h>
+#include <stdio.h>
+#include <strings.h>
+
+static const char *TAG = "http_pool";
+
+#define HTTP_POOL_SLOTS    2       // sync/images and message audio can run at the same time
+#define HTTP_POOL_IDLE_MS  4500    // under the server's keep-alive timeout (Node.js: 5 s)
+#define HTTP_POOL_BUF      4096    // MP3 streaming reads through the same clients
+#define HTTP_POOL_TIMEOUT  20000
+#define HTTP_POOL_MEM_WAIT 15000   // queue this long for internal RAM, then fail the request
+
+typedef struct {
+    esp_http_client_handle_t client;
+    bool                     busy;
+    http_event_handle_cb     handler;    // caller's handler and user_data
+    void                    *user_data;
+    int64_t                  t0_us;      // request start (connect timing)
+    int64_t                  idle_us;    // released at
+    bool                     connected;  // fresh connection made for this request
+    bool                     responded;  // any response bytes seen
+    size_t                   mem;        // internal RAM reserved (mem_budget.c)
+} pool_slot_t;
+
+static pool_slot_t       s_slots[HTTP_POOL_SLOTS];
+static SemaphoreHandle_t s_free;         // counts idle slots
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ── Event trampoline ─────────────────────────────────────────────────────────
+
+static esp_err_t pool_event(esp_http_client_event_t *evt)
+{
+    pool_slot_t *slot = (pool_slot_t *)evt->user_data;
+
+    switch (evt->event_id) {
+    case HTTP_EVENT_ON_CONNECTED:
+        slot->connected = true;
+        net_stats_connect(NET_LINK_HTTP, (uint32_t)((esp_timer_get_time() - slot->t0_us) / 1000));
+        break;
+    case HTTP_EVENT_ON_HEADER:
+        // Only a certificate-checked server's clock is worth taking
+        if (strcasecmp(evt->header_key, "Date") == 0 &&
+            esp_http_client_get_transport_type(evt->client) == HTTP_TRANSPORT_OVER_SSL) {
+            time_sync_http_date(evt->header_value);
+        }
+        slot->responded = true;
+        break;
+    case HTTP_EVENT_ON_DATA:
+        slot->responded = true;
+        break;
+    default:
+        break;
+    }
+
+    if (!slot->handler) return ESP_OK;
+    evt->user_data = slot->user_data;
+    return slot->handler(evt);
+}
+
+static pool_slot_t *slot_of(esp_http_client_handle_t client)
+{
+    for (int i = 0; i < HTTP_POOL_SLOTS; i++) {
+        if (s_slots[i].client == client) return &s_slots[i];
+    }
+    return NULL;
+}
+
+// ── Acquire / release ────────────────────────────────────────────────────────
+
+void http_pool_init(void)
+{
+    s_free = xSemaphoreCreateCounting(HTTP_POOL_SLOTS, HTTP_POOL_SLOTS);
+    assert(s_free);
+}
+
+esp_http_client_handle_t http_pool_acquire(const char *url, http_event_handle_cb handler,
+                                           void *user_data)
+{
+    xSemaphoreTake(s_free, portMAX_DELAY);
+
+    pool_slot_t *slot = NULL;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < HTTP_POOL_SLOTS && !slot; i++) {
+        if (!s_slots[i].busy) slot = &s_slots[i];
+    }
+    slot->busy = true;
+    taskEXIT_CRITICAL(&s_lock);
+
+    // Room for a handshake, in case this request needs one
+    if (!mem_budget_take(MEM_USER_HTTP, MEM_TLS_HANDSHAKE, HTTP_POOL_MEM_WAIT)) {
+        slot->busy = false;
+        xSemaphoreGive(s_free);
+        return NULL;
+    }
+    slot->mem = MEM_TLS_HANDSHAKE;
+
+    int64_t now = esp_timer_get_time();
+
+    if (!slot->client) {
+        esp_http_client_config_t cfg = {
+            .url               = url,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+            .event_handler     = pool_event,
+            .user_data         = slot,
+            .buffer_size       = HTTP_POOL_BUF,
+            .timeout_ms        = HTTP_POOL_TIMEOUT,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            // Reconnects (idle close, server restart) resume the TLS session
+            // instead of a full handshake
+            .save_client_session = true,
+#endif
+        };
+        slot->client = esp_http_client_init(&cfg);
+        if (!slot->client) {
+            ESP_LOGE(TAG, "Client init failed");
+            mem_budget_give(MEM_USER_HTTP, slot->mem);
+            slot->mem  = 0;
+            slot->busy = false;
+            xSemaphoreGive(s_free);
+            return NULL;
+        }
+    } else {
+        // The server has probably dropped a connection idle this long; close
+        // it here rather than find out from a failed request
+        if (now - slot->idle_us > (int64_t)HTTP_POOL_IDLE_MS * 1000) {
+            esp_http_client_close(slot->client);
+        }
+        esp_http_client_set_url(slot->client, url);
+        esp_http_client_set_method(slot->client, HTTP_METHOD_GET);
+    }
+
+    char auth[128];
+    snprintf(auth, sizeof(auth), "Bearer %s", g_config.apikey);
+    esp_http_client_set_header(slot->client, "Authorization", auth);
+
+    slot->handler   = handler;
+    slot->user_data = user_data;
+    slot->t0_us     = now;
+    slot->connected = false;
+    slot->responded = false;
+    return slot->client;
+}
+
+void http_pool_release(esp_http_client_handle_t client, bool keep)
+{
+    pool_slot_t *slot = client ? slot_of(client) : NULL;
+    if (!slot) return;
+
+    if (keep && !slot->connected && slot->responded) net_stats_reuse(NET_LINK_HTTP);
+    // An idle keep-alive connection is optional memory: drop it when someone
+    // is queued for internal RAM
+    if (!keep || mem_budget_contended()) esp_http_client_close(client);
+    mem_budget_give(MEM_USER_HTTP, slot->mem);
+    slot->mem = 0;
+
+    esp_http_client_delete_header(client, "Content-Type");
+    esp_http_client_delete_header(client, "If-None-Match");
+    esp_http_client_set_post_field(client, NULL, 0);
+    slot->handler   = NULL;
+    slot->user_data = NULL;
+    slot->idle_us   = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    slot->busy = false;
+    taskEXIT_CRITICAL(&s_lock);
+    xSemaphoreGive(s_free);
+}
+
+// ── Requests ─────────────────────────────────────────────────────────────────
+
+// A reused connection the server closed fails before any response arrives;
+// anything else is a real error
+static bool retry_fresh(esp_http_client_handle_t client)
+{
+    pool_slot_t *slot = slot_of(client);
+    if (!slot || slot->connected || slot->responded) return false;
+    ESP_LOGD(TAG, "Stale connection, reconnecting");
+    esp_http_client_close(client);
+    slot->t0_us = esp_timer_get_time();
+    return true;
+}
+
+// Handshake over (or not needed): keep only the connection's share
+static void settle_mem(esp_http_client_handle_t client)
+{
+    pool_slot_t *slot = slot_of(client);
+    if (!slot || slot->mem <= MEM_TLS_CONN) return;
+    mem_budget_give(MEM_USER_HTTP, slot->mem - MEM_TLS_CONN);
+    slot->mem = MEM_TLS_CONN;
+}
+
+esp_err_t http_pool_perform(esp_http_client_handle_t client)
+{
+    esp_err_t err = esp_http_client_perform(client);
+    if (err != ESP_OK && retry_fresh(client)) err = esp_http_client_perform(client);
+    settle_mem(client);
+    return err;
+}
+
+esp_err_t http_pool_open(esp_http_client_handle_t client)
+{
+    for (int attempt = 0; attempt < 2; attempt++) {
+        esp_err_t err = esp_http_client_open(client, 0);
+        if (err == ESP_OK && esp_http_client_fetch_headers(client) >= 0) {
+            settle_mem(client);
+            return ESP_OK;
+        }
+        if (err == ESP_OK) err = ESP_FAIL;
+        if (attempt || !retry_fresh(client)) {
+            settle_mem(client);
+            return err;
+        }
+    }
+    return ESP_FAIL;
+}
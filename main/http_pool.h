@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include "esp_http_client.h"
+
+// Keep-alive HTTPS clients for API requests to g_config.server_url.
+//
+// Every request used to build its own client: a TCP connect plus a full TLS
+// handshake (certificate chain verify, ECDHE) per doll check, image and
+// message download.  Pooled clients keep the connection open between
+// requests, so back-to-back requests (sync → avatar → scenario, or the
+// audio of consecutive messages) pay the handshake once.
+//
+//   esp_http_client_handle_t c = http_pool_acquire(url, on_data, &buf);
+//   if (http_pool_perform(c) == ESP_OK) status = esp_http_client_get_status_code(c);
+//   http_pool_release(c, true);
+//
+// Acquire sets the URL, GET and the API key header; callers add anything
+// else (method, headers, post field) and release undoes it.  A request that
+// fails on a reused connection is retried once on a fresh one.  Acquire
+// blocks while every client is in use, and queues for internal RAM
+// (mem_budget.c): NULL if none came free within 15 s.
+
+void http_pool_init(void);
+
+esp_http_client_handle_t http_pool_acquire(const char *url, http_event_handle_cb handler,
+                                           void *user_data);
+
+// esp_http_client_perform with the stale-connection retry
+esp_err_t http_pool_perform(esp_http_client_handle_t client);
+
+// esp_http_client_open + fetch_headers with the same retry, for streaming
+// reads (esp_http_client_read).  ESP_OK once the status line is in.
+esp_err_t http_pool_open(esp_http_client_handle_t client);
+
+// keep = false drops the connection (response not fully read, or an error)
+void http_pool_release(esp_http_client_handle_t client, bool keep);
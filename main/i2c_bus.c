@@ -0,0 +1,245 @@
+#include "i2c_bus.h"
+#include "board.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "i2c_bus";
+
+#define I2C_BUS_XFER_MS         50
+#define I2C_BUS_BATCH_MAX       8      // ~2.5 ms at 100 kHz: the longest a codec waits
+#define I2C_BUS_RECOVER_AFTER   3
+
+// Higher goes first
+static const uint8_t k_prio[I2C_CLIENT_COUNT] = {
+    [I2C_CLIENT_CODEC]   = 3,
+    [I2C_CLIENT_MIC]     = 2,
+    [I2C_CLIENT_IOEXP]   = 1,
+    [I2C_CLIENT_DISPLAY] = 1,
+};
+
+// A queued acquire, on the waiting task's stack
+typedef struct waiter {
+    struct waiter     *next;
+    i2c_client_t       client;
+    bool               granted;
+    SemaphoreHandle_t  sem;
+    StaticSemaphore_t  sem_buf;
+} waiter_t;
+
+static portMUX_TYPE    s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool            s_busy;
+static i2c_client_t    s_owner;
+static int64_t         s_owned_us;       // when s_owner got the bus
+static waiter_t       *s_waiters;        // by priority, FIFO within one
+static int             s_fail_run;       // consecutive failed transactions (owner only)
+static i2c_bus_stats_t s_stats[I2C_CLIENT_COUNT];
+
+esp_err_t i2c_bus_init(void)
+{
+    i2c_config_t cfg = {
+        .mode             = I2C_MODE_MASTER,
+        .sda_io_num       = AUDIO_I2C_SDA,
+        .scl_io_num       = AUDIO_I2C_SCL,
+        .sda_pullup_en    = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en    = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = AUDIO_I2C_FREQ,
+    };
+    esp_err_t err = i2c_param_config(AUDIO_I2C_PORT, &cfg);
+    if (err == ESP_OK) err = i2c_driver_install(AUDIO_I2C_PORT, I2C_MODE_MASTER, 0, 0, 0);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Driver install failed: %s", esp_err_to_name(err));
+    return err;
+}
+
+// ── Arbitration ──────────────────────────────────────────────────────────────
+
+// Caller holds s_lock
+static void enqueue(waiter_t *w)
+{
+    waiter_t **p = &s_waiters;
+    while (*p && k_prio[(*p)->client] >= k_prio[w->client]) p = &(*p)->next;
+    w->next = *p;
+    *p = w;
+}
+
+static void unlink_waiter(waiter_t *w)
+{
+    for (waiter_t **p = &s_waiters; *p; p = &(*p)->next) {
+        if (*p == w) {
+            *p = w->next;
+            return;
+        }
+    }
+}
+
+static void granted(i2c_client_t c, int64_t asked_us, bool queued)
+{
+    int64_t now = esp_timer_get_time();
+    i2c_bus_stats_t *st = &s_stats[c];
+    st->grants++;
+    if (queued) {
+        uint32_t wait = (uint32_t)(now - asked_us);
+        st->waits++;
+        if (wait > st->wait_us_max) st->wait_us_max = wait;
+    }
+    s_owned_us = now;
+}
+
+bool i2c_bus_acquire(i2c_client_t c, uint32_t wait_ms)
+{
+    int64_t asked = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    if (!s_busy) {
+        s_busy  = true;
+        s_owner = c;
+        taskEXIT_CRITICAL(&s_lock);
+        granted(c, asked, false);
+        return true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    waiter_t w = { .client = c };
+    w.sem = xSemaphoreCreateBinaryStatic(&w.sem_buf);
+
+    taskENTER_CRITICAL(&s_lock);
+    bool now_free = !s_busy;     // released while the semaphore was made
+    if (now_free) {
+        s_busy  = true;
+        s_owner = c;
+    } else {
+        enqueue(&w);
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    bool ok = true;
+    if (!now_free) {
+        TickType_t ticks = wait_ms == I2C_BUS_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms);
+        if (xSemaphoreTake(w.sem, ticks) != pdTRUE) {
+            taskENTER_CRITICAL(&s_lock);
+            ok = w.granted;
+            if (!ok) unlink_waiter(&w);
+            taskEXIT_CRITICAL(&s_lock);
+            // Handed over just as the wait ran out: the give is on its way,
+            // and w must outlive it
+            if (ok) xSemaphoreTake(w.sem, portMAX_DELAY);
+        }
+    }
+    vSemaphoreDelete(w.sem);
+    if (ok) granted(c, asked, !now_free);
+    return ok;
+}
+
+void i2c_bus_release(i2c_client_t c)
+{
+    i2c_bus_stats_t *st = &s_stats[c];
+    uint32_t held = (uint32_t)(esp_timer_get_time() - s_owned_us);
+    st->bus_us += held;
+    if (held > st->hold_us_max) st->hold_us_max = held;
+
+    taskENTER_CRITICAL(&s_lock);
+    waiter_t *w = s_waiters;
+    if (w) {
+        s_waiters  = w->next;
+        w->granted = true;
+        s_owner    = w->client;
+    } else {
+        s_busy = false;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (w) xSemaphoreGive(w->sem);
+}
+
+// ── Transactions ─────────────────────────────────────────────────────────────
+
+// Bus held by c
+static esp_err_t account(i2c_client_t c, esp_err_t err)
+{
+    if (err == ESP_OK) {
+        s_fail_run = 0;
+        return err;
+    }
+    s_stats[c].errors++;
+    if (++s_fail_run >= I2C_BUS_RECOVER_AFTER) {
+        // A stuck transfer leaves bytes behind in the FIFOs
+        i2c_reset_tx_fifo(AUDIO_I2C_PORT);
+        i2c_reset_rx_fifo(AUDIO_I2C_PORT);
+        s_stats[c].recoveries++;
+        s_fail_run = 0;
+        ESP_LOGW(TAG, "%s: %d failures in a row (%s), FIFOs reset",
+                 i2c_client_name(c), I2C_BUS_RECOVER_AFTER, esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t i2c_bus_write(i2c_client_t c, uint8_t addr, const uint8_t *data, size_t len)
+{
+    i2c_bus_acquire(c, I2C_BUS_WAIT_FOREVER);
+    esp_err_t err = i2c_master_write_to_device(AUDIO_I2C_PORT, addr, data, len,
+                                               pdMS_TO_TICKS(I2C_BUS_XFER_MS));
+    account(c, err);
+    i2c_bus_release(c);
+    return err;
+}
+
+esp_err_t i2c_bus_read_reg(i2c_client_t c, uint8_t addr, uint8_t reg, uint8_t *val)
+{
+    i2c_bus_acquire(c, I2C_BUS_WAIT_FOREVER);
+    esp_err_t err = i2c_master_write_read_device(AUDIO_I2C_PORT, addr, &reg, 1, val, 1,
+                                                 pdMS_TO_TICKS(I2C_BUS_XFER_MS));
+    account(c, err);
+    i2c_bus_release(c);
+    return err;
+}
+
+esp_err_t i2c_bus_write_regs(i2c_client_t c, uint8_t addr, const i2c_reg_t *regs, size_t n)
+{
+    esp_err_t first_err = ESP_OK;
+    while (n > 0) {
+        size_t batch = n < I2C_BUS_BATCH_MAX ? n : I2C_BUS_BATCH_MAX;
+
+        // One command link: START addr reg val, repeated, then STOP
+        uint8_t buf[I2C_LINK_RECOMMENDED_SIZE(I2C_BUS_BATCH_MAX)];
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buf, sizeof(buf));
+        for (size_t i = 0; i < batch; i++) {
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
+            i2c_master_write_byte(cmd, regs[i].reg, true);
+            i2c_master_write_byte(cmd, regs[i].val, true);
+        }
+        i2c_master_stop(cmd);
+
+        i2c_bus_acquire(c, I2C_BUS_WAIT_FOREVER);
+        esp_err_t err = i2c_master_cmd_begin(AUDIO_I2C_PORT, cmd,
+                                             pdMS_TO_TICKS(I2C_BUS_XFER_MS * batch));
+        account(c, err);
+        i2c_bus_release(c);
+        i2c_cmd_link_delete_static(cmd);
+
+        if (err != ESP_OK && first_err == ESP_OK) {
+            ESP_LOGW(TAG, "%s: batch at reg 0x%02X failed: %s", i2c_client_name(c),
+                     regs[0].reg, esp_err_to_name(err));
+            first_err = err;
+        }
+        regs += batch;
+        n    -= batch;
+    }
+    return first_err;
+}
+
+// ── Stats ────────────────────────────────────────────────────────────────────
+
+const char *i2c_client_name(i2c_client_t c)
+{
+    static const char *const k_names[I2C_CLIENT_COUNT] = {
+        "codec", "mic", "ioExp", "display",
+    };
+    return (unsigned)c < I2C_CLIENT_COUNT ? k_names[c] : "?";
+}
+
+void i2c_bus_get_stats(i2c_client_t c, i2c_bus_stats_t *out)
+{
+    *out = s_stats[c];
+}
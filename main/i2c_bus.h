@@ -0,0 +1,63 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Arbitrated access to AUDIO_I2C_PORT (codecs and the IO expander).
+//
+// One client holds the bus at a time.  When it lets go, the waiting client
+// with the highest priority goes next: the codecs ahead of the IO
+// expander, so a play-path codec write waits for at most the one expander
+// transaction already on the wire.  Register sequences are batched into
+// one transaction of up to I2C_BUS_BATCH_MAX writes, and the bus is
+// released between batches.  Bus time, waits and errors are counted per
+// client.  After I2C_BUS_RECOVER_AFTER failures in a row the controller's
+// FIFOs are reset, which is counted as a recovery.
+//
+// The ES8311 component does its own transactions on the port, so audio.c
+// wraps its calls in i2c_bus_acquire() / i2c_bus_release().
+
+typedef enum {
+    I2C_CLIENT_CODEC,      // ES8311 (audio.c): play path, highest
+    I2C_CLIENT_MIC,        // ES7243E (record.c)
+    I2C_CLIENT_IOEXP,      // PCA9535 port 0 service (io_expander.c)
+    I2C_CLIENT_DISPLAY,    // PCA9535 port 1, LCD power at boot
+    I2C_CLIENT_COUNT,
+} i2c_client_t;
+
+typedef struct {
+    uint8_t reg;
+    uint8_t val;
+} i2c_reg_t;
+
+typedef struct {
+    uint32_t grants;          // times the client got the bus
+    uint32_t bus_us;          // time holding it, total
+    uint32_t hold_us_max;
+    uint32_t waits;           // grants that had to queue
+    uint32_t wait_us_max;
+    uint32_t errors;          // failed transactions
+    uint32_t recoveries;      // FIFO resets after repeated failures
+} i2c_bus_stats_t;
+
+#define I2C_BUS_WAIT_FOREVER  UINT32_MAX
+
+// Installs the driver on AUDIO_I2C_PORT; first thing to touch the bus
+esp_err_t i2c_bus_init(void);
+
+// Hold the bus across several transactions of a driver that runs its own
+// (I2C_BUS_WAIT_FOREVER to wait without limit).  Not recursive.
+bool i2c_bus_acquire(i2c_client_t c, uint32_t wait_ms);
+void i2c_bus_release(i2c_client_t c);
+
+// One transaction each, arbitrated
+esp_err_t i2c_bus_write(i2c_client_t c, uint8_t addr, const uint8_t *data, size_t len);
+esp_err_t i2c_bus_read_reg(i2c_client_t c, uint8_t addr, uint8_t reg, uint8_t *val);
+
+// Register writes in order, I2C_BUS_BATCH_MAX per transaction
+esp_err_t i2c_bus_write_regs(i2c_client_t c, uint8_t addr, const i2c_reg_t *regs, size_t n);
+
+const char *i2c_client_name(i2c_client_t c);    // camelCase (metrics: i2c<Name>BusMs, ...)
+void i2c_bus_get_stats(i2c_client_t c, i2c_bus_stats_t *out);
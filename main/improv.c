@@ -4,6 +4,7 @@
 #include "wifi_mgr.h"
 #include "events.h"
 #include "led.h"
+#include "audio.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -273,6 +274,7 @@ static void handle_serial_line(const char *line)
     } else if (strncmp(line, "VOLUME:", 7) == 0) {
         int vol = atoi(line + 7);
         if (vol >= 0 && vol <= 100) {
+            audio_volume_set(vol);
             g_config.speaker_volume = (uint8_t)vol;
             config_store_save();
             ESP_LOGI(TAG, "Volume set to %d via serial", vol);
@@ -0,0 +1,187 @@
+#include "io_expander.h"
+#include "board.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "i2c_bus.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "io_exp";
+
+#define IO_EXP_STACK        3072
+#define IO_EXP_MAX_CBS      4
+#define IO_EXP_KNOB_DEB_MS  30      // contact bounce
+#define IO_EXP_PWR_DEB_MS   300     // charger status pins flicker on plug/unplug
+
+// Without INT the poll is all there is; with it, only a safety net for a
+// lost edge (INT stays low until the port is read)
+#ifndef IO_EXP_POLL_MS
+#if IO_EXP_INT_GPIO >= 0
+#define IO_EXP_POLL_MS      2000
+#else
+#define IO_EXP_POLL_MS      100
+#endif
+#endif
+
+static const uint8_t k_bits[IO_EXP_PIN_COUNT] = {
+    [IO_EXP_CHRG]  = PWR_CHRG_DET_BIT,
+    [IO_EXP_STDBY] = PWR_STDBY_DET_BIT,
+    [IO_EXP_VBUS]  = PWR_VBUS_DET_BIT,
+    [IO_EXP_KNOB]  = KNOB_BTN_BIT,
+};
+
+static const uint16_t k_debounce_ms[IO_EXP_PIN_COUNT] = {
+    [IO_EXP_CHRG]  = IO_EXP_PWR_DEB_MS,
+    [IO_EXP_STDBY] = IO_EXP_PWR_DEB_MS,
+    [IO_EXP_VBUS]  = IO_EXP_PWR_DEB_MS,
+    [IO_EXP_KNOB]  = IO_EXP_KNOB_DEB_MS,
+};
+
+static TaskHandle_t      s_task;
+static io_exp_cb_t       s_cbs[IO_EXP_MAX_CBS];
+static int               s_n_cbs;
+static volatile uint8_t  s_port0 = 0xFF;     // debounced, all inactive until read
+static io_exp_stats_t    s_stats;
+
+// Raw samples, service task only
+static uint8_t           s_raw = 0xFF;
+static uint32_t          s_raw_since_ms[IO_EXP_PIN_COUNT];
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static bool read_port0(uint8_t *val)
+{
+    esp_err_t err = i2c_bus_read_reg(I2C_CLIENT_IOEXP, IO_EXP_ADDR, PCA9535_INPUT0, val);
+    s_stats.reads++;
+    if (err != ESP_OK) {
+        if (s_stats.errors++ == 0) ESP_LOGW(TAG, "Port 0 read failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+#if IO_EXP_INT_GPIO >= 0
+static void IRAM_ATTR int_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    s_stats.irqs++;
+    vTaskNotifyGiveFromISR(s_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+// ── Debounce ─────────────────────────────────────────────────────────────────
+
+// Fold one sample in and deliver the pins that settled.  Returns ms until the
+// next pin settles, or -1 when none is pending.
+static int32_t debounce(uint8_t raw, uint32_t t)
+{
+    int32_t next = -1;
+    for (int p = 0; p < IO_EXP_PIN_COUNT; p++) {
+        uint8_t bit = 1u << k_bits[p];
+        if ((raw ^ s_raw) & bit) s_raw_since_ms[p] = t;
+        if (!((raw ^ s_port0) & bit)) continue;
+
+        uint32_t held = t - s_raw_since_ms[p];
+        if (held < k_debounce_ms[p]) {
+            int32_t left = (int32_t)(k_debounce_ms[p] - held);
+            if (next < 0 || left < next) next = left;
+            continue;
+        }
+        s_port0 = (s_port0 & ~bit) | (raw & bit);
+        bool active = !(raw & bit);
+        s_stats.edges++;
+        ESP_LOGD(TAG, "pin %d %s", k_bits[p], active ? "active" : "inactive");
+        for (int i = 0; i < s_n_cbs; i++) s_cbs[i]((io_exp_pin_t)p, active);
+    }
+    s_raw = raw;
+    return next;
+}
+
+// ── Service task ─────────────────────────────────────────────────────────────
+
+static void io_exp_task(void *arg)
+{
+    int32_t pending = -1;
+    while (1) {
+        uint32_t wait = pending >= 0 && pending < IO_EXP_POLL_MS ? (uint32_t)pending : IO_EXP_POLL_MS;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+
+        uint8_t raw;
+        if (!read_port0(&raw)) continue;
+#if IO_EXP_INT_GPIO >= 0
+        // A change between the edge and the read leaves INT low without a
+        // new edge: read again until it lets go
+        for (int i = 0; i < 3 && gpio_get_level((gpio_num_t)IO_EXP_INT_GPIO) == 0; i++) {
+            if (!read_port0(&raw)) break;
+        }
+#endif
+        pending = debounce(raw, now_ms());
+    }
+}
+
+// ── Public API ───────────────────────────────────────────────────────────────
+
+bool io_exp_init(void)
+{
+    // Port 0 all inputs: power status bits 0-2, knob button bit 3
+    uint8_t cmd[] = { PCA9535_CONFIG0, 0xFF };
+    esp_err_t err = i2c_bus_write(I2C_CLIENT_IOEXP, IO_EXP_ADDR, cmd, sizeof(cmd));
+    uint8_t raw;
+    if (err != ESP_OK || !read_port0(&raw)) {
+        ESP_LOGW(TAG, "IO expander 0x%02X not found — knob button and charge status disabled",
+                 IO_EXP_ADDR);
+        return false;
+    }
+    // Boot state counts as settled: no edges for what was already true
+    s_raw = s_port0 = raw;
+
+    StackType_t *stack = heap_caps_malloc(IO_EXP_STACK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!stack) {
+        ESP_LOGE(TAG, "Failed to allocate task stack");
+        return false;
+    }
+    static StaticTask_t s_tcb;
+    s_task = xTaskCreateStaticPinnedToCore(io_exp_task, "io_exp", IO_EXP_STACK / sizeof(StackType_t),
+                                           NULL, 5, stack, &s_tcb, 1);
+
+#if IO_EXP_INT_GPIO >= 0
+    gpio_config_t io = {
+        .pin_bit_mask = 1ULL << IO_EXP_INT_GPIO,
+        .mode         = GPIO_MODE_INPUT,
+        .pull_up_en   = GPIO_PULLUP_ENABLE,     // INT is open drain
+        .intr_type    = GPIO_INTR_NEGEDGE,
+    };
+    gpio_config(&io);
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "ISR service: %s — polling only", esp_err_to_name(err));
+    } else {
+        gpio_isr_handler_add((gpio_num_t)IO_EXP_INT_GPIO, int_isr, NULL);
+    }
+#endif
+
+    ESP_LOGI(TAG, "IO expander 0x%02X port0=0x%02X (INT GPIO%d, poll %d ms)",
+             IO_EXP_ADDR, raw, IO_EXP_INT_GPIO, IO_EXP_POLL_MS);
+    return true;
+}
+
+void io_exp_attach(io_exp_cb_t cb)
+{
+    if (s_n_cbs < IO_EXP_MAX_CBS) s_cbs[s_n_cbs++] = cb;
+}
+
+bool io_exp_active(io_exp_pin_t pin)
+{
+    return (unsigned)pin < IO_EXP_PIN_COUNT && !(s_port0 & (1u << k_bits[pin]));
+}
+
+void io_exp_get_stats(io_exp_stats_t *out)
+{
+    *out = s_stats;
+}
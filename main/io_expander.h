@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// PCA9535 port 0 inputs (power status, knob button) as a cached snapshot.
+//
+// Port 0 shares AUDIO_I2C_PORT with the codecs, so only this service reads
+// it: once per falling edge of the expander's INT line (IO_EXP_INT_GPIO),
+// plus a slow fallback poll that also covers boards without the line.
+// Readers use the cache; pins that change and stay changed for their
+// debounce time are delivered to the attached callbacks as edges.
+
+typedef enum {
+    IO_EXP_CHRG,      // charging
+    IO_EXP_STDBY,     // fully charged
+    IO_EXP_VBUS,      // USB power present
+    IO_EXP_KNOB,      // knob button pressed
+    IO_EXP_PIN_COUNT,
+} io_exp_pin_t;
+
+// A debounced edge; active is the pin's meaning (all of them are active low).
+// Runs on the service task: keep it short.
+typedef void (*io_exp_cb_t)(io_exp_pin_t pin, bool active);
+
+typedef struct {
+    uint32_t reads;        // port 0 transactions
+    uint32_t irqs;         // INT falling edges
+    uint32_t errors;       // failed reads
+    uint32_t edges;        // debounced edges delivered
+} io_exp_stats_t;
+
+// After display_init() has installed the I2C driver.  False when the
+// expander does not answer; the accessors then report everything inactive.
+bool io_exp_init(void);
+
+// Up to IO_EXP_MAX_CBS callbacks, attached once
+void io_exp_attach(io_exp_cb_t cb);
+
+// Debounced state from the cache, no I2C
+bool io_exp_active(io_exp_pin_t pin);
+
+void io_exp_get_stats(io_exp_stats_t *out);
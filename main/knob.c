@@ -0,0 +1,130 @@
+#include "knob.h"
+#include "audio.h"
+#include "board.h"
+#include "config.h"
+#include "config_store.h"
+#include "esp_log.h"
+#include "driver/pulse_cnt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "knob";
+
+// Quadrature edges per mechanical detent (both channels, both edges)
+#ifndef KNOB_COUNTS_PER_DETENT
+#define KNOB_COUNTS_PER_DETENT  4
+#endif
+#ifndef KNOB_VOLUME_STEP
+#define KNOB_VOLUME_STEP        5       // negative: turn the other way for louder
+#endif
+#define KNOB_SAVE_DELAY_MS      3000    // a spin ends in one NVS write
+#define KNOB_GLITCH_NS          1000    // contact chatter shorter than this is ignored
+#define KNOB_STACK              3072    // internal RAM: the task writes NVS
+
+static pcnt_unit_handle_t s_unit;
+static TaskHandle_t       s_task;
+static volatile int32_t   s_pending;    // detents from the ISR, not yet applied
+static knob_stats_t       s_stats;
+static portMUX_TYPE       s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// One detent: the count hit a limit and was cleared
+static bool IRAM_ATTR on_detent(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t *ev,
+                                void *ctx)
+{
+    taskENTER_CRITICAL_ISR(&s_lock);
+    s_pending += ev->watch_point_value > 0 ? 1 : -1;
+    taskEXIT_CRITICAL_ISR(&s_lock);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_task, &woken);
+    return woken == pdTRUE;
+}
+
+// ── Volume task ──────────────────────────────────────────────────────────────
+
+static void knob_task(void *arg)
+{
+    bool dirty = false;
+    while (1) {
+        // Idle until a detent; with an unsaved change, until the knob rests
+        uint32_t got = ulTaskNotifyTake(pdTRUE, dirty ? pdMS_TO_TICKS(KNOB_SAVE_DELAY_MS)
+                                                       : portMAX_DELAY);
+        if (!got) {
+            esp_err_t err = config_store_save_volume();
+            if (err == ESP_OK) {
+                s_stats.saves++;
+                ESP_LOGI(TAG, "Volume %d saved", g_config.speaker_volume);
+            } else {
+                ESP_LOGW(TAG, "Volume save failed: %s", esp_err_to_name(err));
+            }
+            dirty = false;
+            continue;
+        }
+
+        taskENTER_CRITICAL(&s_lock);
+        int32_t detents = s_pending;
+        s_pending = 0;
+        taskEXIT_CRITICAL(&s_lock);
+        if (!detents) continue;
+
+        s_stats.detents += detents > 0 ? detents : -detents;
+        int vol = audio_volume_step(detents * KNOB_VOLUME_STEP);
+        if (vol != g_config.speaker_volume) {
+            g_config.speaker_volume = (uint8_t)vol;
+            dirty = true;
+        }
+    }
+}
+
+// ── Public API ───────────────────────────────────────────────────────────────
+
+bool knob_init(void)
+{
+    pcnt_unit_config_t unit_cfg = {
+        .low_limit  = -KNOB_COUNTS_PER_DETENT,
+        .high_limit =  KNOB_COUNTS_PER_DETENT,
+    };
+    esp_err_t err = pcnt_new_unit(&unit_cfg, &s_unit);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "PCNT unit: %s — knob disabled", esp_err_to_name(err));
+        return false;
+    }
+    pcnt_glitch_filter_config_t filter = { .max_glitch_ns = KNOB_GLITCH_NS };
+    ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(s_unit, &filter));
+
+    // Full quadrature: each channel counts its own edges, direction from
+    // the other channel's level
+    pcnt_chan_config_t a_cfg = { .edge_gpio_num = KNOB_A, .level_gpio_num = KNOB_B };
+    pcnt_chan_config_t b_cfg = { .edge_gpio_num = KNOB_B, .level_gpio_num = KNOB_A };
+    pcnt_channel_handle_t a, b;
+    ESP_ERROR_CHECK(pcnt_new_channel(s_unit, &a_cfg, &a));
+    ESP_ERROR_CHECK(pcnt_new_channel(s_unit, &b_cfg, &b));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(a, PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+                                                 PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+    ESP_ERROR_CHECK(pcnt_channel_set_level_action(a, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                                  PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(b, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                                 PCNT_CHANNEL_EDGE_ACTION_DECREASE));
+    ESP_ERROR_CHECK(pcnt_channel_set_level_action(b, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                                  PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(s_unit, -KNOB_COUNTS_PER_DETENT));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(s_unit,  KNOB_COUNTS_PER_DETENT));
+
+    // Task first: the callback notifies it
+    xTaskCreatePinnedToCore(knob_task, "knob", KNOB_STACK, NULL, 4, &s_task, 1);
+
+    pcnt_event_callbacks_t cbs = { .on_reach = on_detent };
+    ESP_ERROR_CHECK(pcnt_unit_register_event_callbacks(s_unit, &cbs, NULL));
+    ESP_ERROR_CHECK(pcnt_unit_enable(s_unit));
+    ESP_ERROR_CHECK(pcnt_unit_clear_count(s_unit));
+    ESP_ERROR_CHECK(pcnt_unit_start(s_unit));
+
+    ESP_LOGI(TAG, "Knob on GPIO%d/%d, volume %d (step %d per detent)",
+             KNOB_A, KNOB_B, audio_volume_get(), KNOB_VOLUME_STEP);
+    return true;
+}
+
+void knob_get_stats(knob_stats_t *out)
+{
+    *out = s_stats;
+}
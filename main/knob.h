@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Rotary knob (KNOB_A/KNOB_B quadrature) as the speaker volume control.
+//
+// The PCNT peripheral decodes the encoder and counts edges in hardware.  Its
+// limits sit one detent either side of zero: reaching one raises an
+// interrupt and clears the count, so the CPU only runs per detent.  Each
+// detent moves the volume by KNOB_VOLUME_STEP at once; the new value is
+// written to NVS once the knob has been still for KNOB_SAVE_DELAY_MS.
+// The knob button is the IO expander's (io_expander.c).
+
+typedef struct {
+    uint32_t detents;     // detents turned, either way
+    uint32_t saves;       // volume writes to NVS
+} knob_stats_t;
+
+// After audio_init(); false when the PCNT unit could not be set up
+bool knob_init(void);
+
+void knob_get_stats(knob_stats_t *out);
@@ -0,0 +1,257 @@
+#include "kws.h"
+#include "spsc_ring.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wn_iface.h"
+#include "esp_wn_models.h"
+#include "esp_mn_iface.h"
+#include "esp_mn_models.h"
+#include "esp_mn_speech_commands.h"
+#include "model_path.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "kws";
+
+#define KWS_MODEL_PART      "model"
+#define KWS_RATE            16000
+#define KWS_RING_BYTES      (32 * 1024)     // ~1 s of mic audio in PSRAM
+#define KWS_PREROLL_BYTES   (10 * 1024)     // ~320 ms before the VAD onset (start of the word)
+#define KWS_TAIL_SAMPLES    (KWS_RATE / 2)  // models keep running 500 ms after speech (command end)
+#define KWS_IDLE_POLL_MS    200             // gate closed: trim the pre-roll this often
+#define KWS_CHUNK_MAX       1024            // samples per model call (esp-sr uses 480–512)
+#define KWS_MN_TIMEOUT_MS   6000
+#define KWS_STATS_WINDOW_US (10 * 1000000LL)
+#define KWS_STACK           8192
+#define KWS_CORE            1               // away from the mic reader and the decoders
+#define KWS_PRIO            2               // below the I2S writer on the same core
+
+// MultiNet command ids index this table; several phrases may map to one word
+static const struct {
+    kws_word_t  word;
+    const char *phrase;
+} k_commands[] = {
+    { KWS_STOP,    "stop" },
+    { KWS_LOUDER,  "louder" },
+    { KWS_LOUDER,  "volume up" },
+    { KWS_QUIETER, "quieter" },
+    { KWS_QUIETER, "volume down" },
+};
+
+static kws_cb_t              s_cb;
+static TaskHandle_t          s_task;
+static spsc_ring_t           s_ring;
+static int16_t              *s_frame;      // internal RAM, one model chunk
+static size_t                s_chunk_bytes;
+
+static esp_wn_iface_t       *s_wakenet;
+static model_iface_data_t   *s_wn_data;
+static esp_mn_iface_t       *s_multinet;   // NULL: wake word only
+static model_iface_data_t   *s_mn_data;
+
+// Reader side
+static volatile bool         s_gate;       // speech (or its tail) in the newest audio
+static int                   s_tail;
+static volatile uint32_t     s_fed_bytes;  // bytes offered to the ring
+static volatile int64_t      s_fed_us;     // when the newest of them was captured
+static volatile uint32_t     s_dropped;
+
+// Task side
+static uint32_t              s_read_bytes; // bytes taken from the ring (run or trimmed)
+static kws_stats_t           s_stats;
+
+const char *kws_word_name(kws_word_t word)
+{
+    switch (word) {
+    case KWS_WAKE:    return "wake";
+    case KWS_STOP:    return "stop";
+    case KWS_LOUDER:  return "louder";
+    case KWS_QUIETER: return "quieter";
+    default:          return "none";
+    }
+}
+
+// ── Reader side ──────────────────────────────────────────────────────────────
+
+void kws_feed(const int16_t *pcm, size_t n, bool speech)
+{
+    if (!s_task) return;
+
+    size_t bytes = n * sizeof(int16_t);
+    if (spsc_ring_write(&s_ring, pcm, bytes) < bytes) s_dropped++;
+    s_fed_us    = esp_timer_get_time();
+    s_fed_bytes += bytes;
+
+    if (speech)                 s_tail = KWS_TAIL_SAMPLES;
+    else if (s_tail > (int)n)   s_tail -= (int)n;
+    else                        s_tail = 0;
+    s_gate = speech || s_tail > 0;
+
+    if (s_gate) xTaskNotifyGive(s_task);
+}
+
+// ── Detection task ───────────────────────────────────────────────────────────
+
+static kws_word_t kws_run_chunk(void)
+{
+    kws_word_t word = KWS_NONE;
+
+    if (s_wakenet->detect(s_wn_data, s_frame) > 0) word = KWS_WAKE;
+
+    if (s_multinet) {
+        esp_mn_state_t st = s_multinet->detect(s_mn_data, s_frame);
+        if (st == ESP_MN_STATE_DETECTED) {
+            esp_mn_results_t *res = s_multinet->get_results(s_mn_data);
+            int id = res->num > 0 ? res->command_id[0] : -1;
+            if (word == KWS_NONE && id >= 0 && id < (int)(sizeof(k_commands) / sizeof(k_commands[0]))) {
+                word = k_commands[id].word;
+            }
+            s_multinet->clean(s_mn_data);
+        } else if (st == ESP_MN_STATE_TIMEOUT) {
+            s_multinet->clean(s_mn_data);
+        }
+    }
+    return word;
+}
+
+static void kws_task(void *arg)
+{
+    bool     active    = false;
+    int64_t  win_t0    = esp_timer_get_time();
+    int64_t  win_busy  = 0;
+    uint32_t win_fed0  = s_fed_bytes;
+    uint32_t win_run   = 0;   // bytes through the models this window
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(KWS_IDLE_POLL_MS));
+
+        if (!s_gate) {
+            if (active && s_multinet) s_multinet->clean(s_mn_data);
+            active = false;
+            s_read_bytes += spsc_ring_trim(&s_ring, KWS_PREROLL_BYTES);
+        } else {
+            // Gate just opened: start from the pre-roll, so the models hear
+            // the word from its first syllable
+            if (!active) s_read_bytes += spsc_ring_trim(&s_ring, KWS_PREROLL_BYTES);
+            active = true;
+
+            while (spsc_ring_used(&s_ring) >= s_chunk_bytes) {
+                spsc_ring_read(&s_ring, s_frame, s_chunk_bytes);
+                s_read_bytes += s_chunk_bytes;
+                win_run      += s_chunk_bytes;
+
+                int64_t    t0   = esp_timer_get_time();
+                kws_word_t word = kws_run_chunk();
+                int64_t    t1   = esp_timer_get_time();
+                win_busy += t1 - t0;
+                if (word == KWS_NONE) continue;
+
+                // The chunk just run ends (fed - read) bytes before the newest
+                // captured sample
+                uint32_t behind = s_fed_bytes - s_read_bytes;
+                int64_t  at_us  = s_fed_us - (int64_t)behind * 1000000 / (KWS_RATE * 2);
+                s_stats.latency_ms = (uint32_t)((t1 - at_us) / 1000);
+                if (word == KWS_WAKE) s_stats.wakes++;
+                else                  s_stats.commands++;
+                ESP_LOGI(TAG, "\"%s\" (%lu ms)", kws_word_name(word),
+                         (unsigned long)s_stats.latency_ms);
+                s_cb(word);
+            }
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (now - win_t0 >= KWS_STATS_WINDOW_US) {
+            uint32_t fed = s_fed_bytes - win_fed0;
+            s_stats.cpu_permille = (uint32_t)(win_busy * 1000 / (now - win_t0));
+            s_stats.duty_pct     = fed ? (uint32_t)((uint64_t)win_run * 100 / fed) : 0;
+            win_t0   = now;
+            win_busy = 0;
+            win_fed0 = s_fed_bytes;
+            win_run  = 0;
+        }
+    }
+}
+
+// ── Init ─────────────────────────────────────────────────────────────────────
+
+static bool kws_load_commands(srmodel_list_t *models)
+{
+    char *mn_name = esp_srmodel_filter(models, ESP_MN_PREFIX, ESP_MN_ENGLISH);
+    if (!mn_name) {
+        ESP_LOGW(TAG, "No English MultiNet model, wake word only");
+        return false;
+    }
+    s_multinet = esp_mn_handle_from_name(mn_name);
+    s_mn_data  = s_multinet->create(mn_name, KWS_MN_TIMEOUT_MS);
+
+    size_t chunk = (size_t)s_multinet->get_samp_chunksize(s_mn_data) * sizeof(int16_t);
+    if (chunk != s_chunk_bytes) {
+        ESP_LOGW(TAG, "%s chunk %u B != wake word chunk %u B, commands disabled",
+                 mn_name, (unsigned)chunk, (unsigned)s_chunk_bytes);
+        s_multinet->destroy(s_mn_data);
+        s_multinet = NULL;
+        return false;
+    }
+
+    esp_mn_commands_alloc(s_multinet, s_mn_data);
+    esp_mn_commands_clear();
+    for (int i = 0; i < (int)(sizeof(k_commands) / sizeof(k_commands[0])); i++) {
+        esp_mn_commands_add(i, (char *)k_commands[i].phrase);
+    }
+    esp_mn_error_t *err = esp_mn_commands_update();
+    if (err) {
+        for (int i = 0; i < err->num; i++) {
+            ESP_LOGW(TAG, "Command rejected: \"%s\"", err->phrases[i]->string);
+        }
+    }
+    ESP_LOGI(TAG, "Commands: %s", mn_name);
+    return true;
+}
+
+bool kws_init(kws_cb_t cb)
+{
+    srmodel_list_t *models = esp_srmodel_init(KWS_MODEL_PART);
+    char *wn_name = models ? esp_srmodel_filter(models, ESP_WN_PREFIX, NULL) : NULL;
+    if (!wn_name) {
+        ESP_LOGW(TAG, "No wake word model in \"%s\", keyword spotting off", KWS_MODEL_PART);
+        return false;
+    }
+
+    s_wakenet     = (esp_wn_iface_t *)esp_wn_handle_from_name(wn_name);
+    s_wn_data     = s_wakenet->create(wn_name, DET_MODE_90);
+    s_chunk_bytes = (size_t)s_wakenet->get_samp_chunksize(s_wn_data) * sizeof(int16_t);
+    if (s_chunk_bytes > KWS_CHUNK_MAX * sizeof(int16_t)) {
+        ESP_LOGE(TAG, "%s chunk %u B too large", wn_name, (unsigned)s_chunk_bytes);
+        s_wakenet->destroy(s_wn_data);
+        return false;
+    }
+    kws_load_commands(models);
+
+    uint8_t     *ring  = heap_caps_malloc(KWS_RING_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    StackType_t *stack = heap_caps_malloc(KWS_STACK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_frame = heap_caps_malloc(s_chunk_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!ring || !stack || !s_frame) {
+        ESP_LOGE(TAG, "Buffer allocation failed");
+        heap_caps_free(ring);
+        heap_caps_free(stack);
+        heap_caps_free(s_frame);
+        return false;
+    }
+    spsc_ring_init(&s_ring, ring, KWS_RING_BYTES);
+    s_cb = cb;
+
+    static StaticTask_t s_tcb;
+    s_task = xTaskCreateStaticPinnedToCore(kws_task, "kws", KWS_STACK / sizeof(StackType_t),
+                                           NULL, KWS_PRIO, stack, &s_tcb, KWS_CORE);
+    ESP_LOGI(TAG, "Wake word: %s, %u-sample chunks", wn_name,
+             (unsigned)(s_chunk_bytes / sizeof(int16_t)));
+    return true;
+}
+
+void kws_get_stats(kws_stats_t *out)
+{
+    *out = s_stats;
+    out->dropped = s_dropped;
+}
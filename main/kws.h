@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// On-device keyword spotting (esp-sr WakeNet + MultiNet) on the mic path.
+//
+// record.c's reader task feeds every echo-cancelled 16 kHz mono chunk while
+// the device is idle (not in a conversation) and says whether its VAD hears
+// speech.  The models only run while it does, plus a short pre-roll and tail,
+// so silence costs a memcpy per chunk.  Detection runs on its own task.
+//
+//   KWS_WAKE                       wake word ("Hi ESP", WakeNet9)
+//   KWS_STOP / LOUDER / QUIETER    local commands (MultiNet, English)
+//
+// Models come from the `model` flash partition (esp-sr builds and flashes it
+// from the CONFIG_SR_* choices in sdkconfig.defaults).
+
+typedef enum {
+    KWS_NONE,
+    KWS_WAKE,
+    KWS_STOP,
+    KWS_LOUDER,
+    KWS_QUIETER,
+} kws_word_t;
+
+// Called on the KWS task; keep it short
+typedef void (*kws_cb_t)(kws_word_t word);
+
+typedef struct {
+    uint32_t cpu_permille;   // one core's time spent in the models, last window
+    uint32_t duty_pct;       // share of mic audio that went through them
+    uint32_t wakes;
+    uint32_t commands;
+    uint32_t latency_ms;     // capture of the deciding audio → callback, last detection
+    uint32_t dropped;        // chunks lost because the KWS task fell behind
+} kws_stats_t;
+
+// Load the models and start the task.  False (and every other call a no-op)
+// when the model partition or a model is missing.
+bool kws_init(kws_cb_t cb);
+
+// Reader task: n mic samples, and whether they are speech
+void kws_feed(const int16_t *pcm, size_t n, bool speech);
+
+const char *kws_word_name(kws_word_t word);
+void kws_get_stats(kws_stats_t *out);
@@ -0,0 +1,141 @@
+#include "mem_budget.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "mem_budget";
+
+#define MEM_BUDGET_FLOOR        (24 * 1024)          // never reserved: ISRs, WiFi bursts, LVGL
+#define MEM_BUDGET_FG_HEADROOM  MEM_TLS_HANDSHAKE    // background users leave this free
+#define MEM_BUDGET_POLL_MS      20
+
+static portMUX_TYPE       s_lock = portMUX_INITIALIZER_UNLOCKED;
+static mem_budget_stats_t s_stats;
+static uint32_t           s_conn[MEM_USER_COUNT];   // held through the conn_* helpers
+static int                s_waiting;
+
+const char *mem_user_name(mem_user_t user)
+{
+    switch (user) {
+    case MEM_USER_HTTP:     return "http";
+    case MEM_USER_PLAYER:   return "player";
+    case MEM_USER_RECORDER: return "recorder";
+    case MEM_USER_MQTT:     return "mqtt";
+    default:                return "?";
+    }
+}
+
+void mem_budget_init(void)
+{
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    s_stats.budget  = free_now > MEM_BUDGET_FLOOR ? (uint32_t)(free_now - MEM_BUDGET_FLOOR) : 0;
+    ESP_LOGI(TAG, "Internal RAM budget %lu B (%u B free, %u B floor)",
+             (unsigned long)s_stats.budget, (unsigned)free_now, (unsigned)MEM_BUDGET_FLOOR);
+}
+
+// Caller holds s_lock; free_now is read before taking it
+static bool admit(mem_user_t user, size_t bytes, size_t free_now)
+{
+    size_t extra = user == MEM_USER_HTTP ? MEM_BUDGET_FG_HEADROOM : 0;
+    if (s_stats.reserved + bytes + extra > s_stats.budget) return false;
+    return free_now >= MEM_BUDGET_FLOOR + bytes + extra;
+}
+
+static void hold(mem_user_t user, size_t bytes)
+{
+    s_stats.reserved    += bytes;
+    s_stats.held[user]  += bytes;
+    if (s_stats.reserved > s_stats.reserved_max) s_stats.reserved_max = s_stats.reserved;
+}
+
+static bool try_take(mem_user_t user, size_t bytes)
+{
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    taskENTER_CRITICAL(&s_lock);
+    bool ok = admit(user, bytes, free_now);
+    if (ok) hold(user, bytes);
+    taskEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+bool mem_budget_take(mem_user_t user, size_t bytes, uint32_t wait_ms)
+{
+    if (bytes == 0 || try_take(user, bytes)) return true;
+
+    ESP_LOGI(TAG, "%s waits for %u B (%lu of %lu B reserved, %u B free)",
+             mem_user_name(user), (unsigned)bytes, (unsigned long)s_stats.reserved,
+             (unsigned long)s_stats.budget,
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    taskENTER_CRITICAL(&s_lock);
+    s_waiting++;
+    s_stats.waits++;
+    taskEXIT_CRITICAL(&s_lock);
+
+    // Queue: poll until the heap allows it or the caller gives up
+    int64_t  t0     = esp_timer_get_time();
+    uint32_t waited = 0;
+    bool     ok     = false;
+    while (!ok && waited < wait_ms) {
+        vTaskDelay(pdMS_TO_TICKS(MEM_BUDGET_POLL_MS));
+        waited = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+        ok     = try_take(user, bytes);
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_waiting--;
+    if (waited > s_stats.wait_ms_max) s_stats.wait_ms_max = waited;
+    if (!ok) s_stats.denied++;
+    taskEXIT_CRITICAL(&s_lock);
+    if (!ok) {
+        ESP_LOGW(TAG, "%s denied %u B after %lu ms", mem_user_name(user), (unsigned)bytes,
+                 (unsigned long)waited);
+    }
+    return ok;
+}
+
+void mem_budget_give(mem_user_t user, size_t bytes)
+{
+    taskENTER_CRITICAL(&s_lock);
+    if (bytes > s_stats.held[user]) bytes = s_stats.held[user];
+    s_stats.held[user] -= bytes;
+    s_stats.reserved   -= bytes;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+bool mem_budget_contended(void)
+{
+    return s_waiting > 0;
+}
+
+// ── Connection helpers ───────────────────────────────────────────────────────
+
+bool mem_budget_conn_begin(mem_user_t user, uint32_t wait_ms)
+{
+    if (s_conn[user] >= MEM_TLS_HANDSHAKE) return true;
+    if (!mem_budget_take(user, MEM_TLS_HANDSHAKE - s_conn[user], wait_ms)) return false;
+    s_conn[user] = MEM_TLS_HANDSHAKE;
+    return true;
+}
+
+void mem_budget_conn_up(mem_user_t user)
+{
+    if (s_conn[user] <= MEM_TLS_CONN) return;
+    mem_budget_give(user, s_conn[user] - MEM_TLS_CONN);
+    s_conn[user] = MEM_TLS_CONN;
+}
+
+void mem_budget_conn_end(mem_user_t user)
+{
+    mem_budget_give(user, s_conn[user]);
+    s_conn[user] = 0;
+}
+
+void mem_budget_get_stats(mem_budget_stats_t *out)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+    out->free_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+}
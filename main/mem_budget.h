@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Internal-RAM admission control for TLS connections.
+//
+// Internal SRAM is the scarce heap: WiFi, LVGL and the DMA buffers hold most
+// of it, and two TLS handshakes at once have failed PK verification.  Before
+// connecting, a subsystem reserves the handshake's peak here; once connected
+// it shrinks to the connection's steady cost, and gives that back when the
+// connection goes.  A reservation is granted when
+//   - all outstanding reservations plus this one fit the budget measured at
+//     mem_budget_init(), and
+//   - the heap has that much free above MEM_BUDGET_FLOOR right now
+// and otherwise waits, up to the caller's timeout.  Background users
+// (MEM_USER_HTTP) also leave a handshake's worth for the conversation, so
+// image downloads can never starve a turn.
+//
+// Costs are estimates; memFreeMin in the metrics shows how much margin the
+// floor really leaves.
+
+typedef enum {
+    MEM_USER_HTTP,        // API requests (http_pool.c), background
+    MEM_USER_PLAYER,      // /ws-player socket
+    MEM_USER_RECORDER,    // /ws-stream socket, per turn
+    MEM_USER_MQTT,
+    MEM_USER_COUNT,
+} mem_user_t;
+
+#define MEM_TLS_HANDSHAKE   (32 * 1024)   // peak while connecting
+#define MEM_TLS_CONN        (12 * 1024)   // an open connection (socket, client buffers)
+
+typedef struct {
+    uint32_t budget;                  // bytes reservable (measured at init)
+    uint32_t reserved;                // held now, all users
+    uint32_t reserved_max;            // high-water mark
+    uint32_t held[MEM_USER_COUNT];
+    uint32_t free_min;                // lowest internal free heap since boot
+    uint32_t waits;                   // reservations that had to queue
+    uint32_t denied;                  // ... and timed out
+    uint32_t wait_ms_max;
+} mem_budget_stats_t;
+
+// After WiFi and the display are up: what is free then is the budget
+void mem_budget_init(void);
+
+// Reserve bytes for user; false after wait_ms without room (nothing held)
+bool mem_budget_take(mem_user_t user, size_t bytes, uint32_t wait_ms);
+void mem_budget_give(mem_user_t user, size_t bytes);
+
+// Someone is queued: holders of optional memory (idle keep-alive
+// connections) should let it go
+bool mem_budget_contended(void);
+
+// One connection per user: reserve the handshake, shrink to MEM_TLS_CONN
+// once connected, release on disconnect.  Safe to call out of order.
+bool mem_budget_conn_begin(mem_user_t user, uint32_t wait_ms);
+void mem_budget_conn_up(mem_user_t user);
+void mem_budget_conn_end(mem_user_t user);
+
+const char *mem_user_name(mem_user_t user);
+void mem_budget_get_stats(mem_budget_stats_t *out);
@@ -91,7 +91,45 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 #define MINIMP3_ONLY_SIMD
 #endif /* SIMD checks... */
 
-#if (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || ((defined(__i386__) || defined(__x86_64__)) && defined(__SSE2__))
+#if defined(MINIMP3_GENERIC_VEC) && defined(__GNUC__)
+/* FPU-only targets (ESP32-S3): 4-lane GCC vector types lowered to scalar FPU
+   ops. Same float32 arithmetic as the SSE/NEON paths; the four independent
+   accumulation chains keep an in-order FPU pipeline (madd.s) busy. */
+#define HAVE_SSE 0
+#define HAVE_GVEC 1
+#define HAVE_SIMD 1
+typedef float f4 __attribute__((vector_size(16), aligned(4)));
+typedef int32_t mp3d_i4 __attribute__((vector_size(16)));
+static __inline__ __attribute__((always_inline)) f4 mp3d_vld(const float *p)
+{
+    f4 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+static __inline__ __attribute__((always_inline)) void mp3d_vst(float *p, f4 v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+static __inline__ __attribute__((always_inline)) f4 mp3d_vset(float s)
+{
+    f4 v = { s, s, s, s };
+    return v;
+}
+#define VSTORE mp3d_vst
+#define VLD mp3d_vld
+#define VSET mp3d_vset
+#define VADD(a, b) ((a) + (b))
+#define VSUB(a, b) ((a) - (b))
+#define VMUL(a, b) ((a)*(b))
+#define VMAC(a, x, y) ((a) + (x)*(y))
+#define VMSB(a, x, y) ((a) - (x)*(y))
+#define VMUL_S(x, s)  ((x)*mp3d_vset(s))
+#define VREV(x) __builtin_shuffle(x, (mp3d_i4){ 3, 2, 1, 0 })
+static int have_simd(void)
+{
+    return 1;
+}
+#elif (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || ((defined(__i386__) || defined(__x86_64__)) && defined(__SSE2__))
 #if defined(_MSC_VER)
 #include <intrin.h>
 #endif /* defined(_MSC_VER) */
@@ -190,6 +228,9 @@ static int have_simd()
 #else /* !defined(MINIMP3_NO_SIMD) */
 #define HAVE_SIMD 0
 #endif /* !defined(MINIMP3_NO_SIMD) */
+#ifndef HAVE_GVEC
+#define HAVE_GVEC 0
+#endif /* HAVE_GVEC */
 
 #if defined(__ARM_ARCH) && (__ARM_ARCH >= 6) && !defined(__aarch64__) && !defined(_M_ARM64)
 #define HAVE_ARMV6 1
@@ -1329,6 +1370,8 @@ static void mp3d_DCT_II(float *grbuf, int n)
         {
 #if HAVE_SSE
 #define VSAVE2(i, v) _mm_storel_pi((__m64 *)(void*)&y[i*18], v)
+#elif HAVE_GVEC
+#define VSAVE2(i, v) do { f4 v2_ = (v); y[i*18] = v2_[0]; y[i*18 + 1] = v2_[1]; } while (0)
 #else /* HAVE_SSE */
 #define VSAVE2(i, v) vst1_f32((float32_t *)&y[i*18],  vget_low_f32(v))
 #endif /* HAVE_SSE */
@@ -1548,6 +1591,15 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
             dstr[(49 + i)*nch] = _mm_extract_epi16(pcm8, 7);
             dstl[(47 - i)*nch] = _mm_extract_epi16(pcm8, 2);
             dstl[(49 + i)*nch] = _mm_extract_epi16(pcm8, 6);
+#elif HAVE_GVEC
+            dstr[(15 - i)*nch] = mp3d_scale_pcm(a[1]);
+            dstr[(17 + i)*nch] = mp3d_scale_pcm(b[1]);
+            dstl[(15 - i)*nch] = mp3d_scale_pcm(a[0]);
+            dstl[(17 + i)*nch] = mp3d_scale_pcm(b[0]);
+            dstr[(47 - i)*nch] = mp3d_scale_pcm(a[3]);
+            dstr[(49 + i)*nch] = mp3d_scale_pcm(b[3]);
+            dstl[(47 - i)*nch] = mp3d_scale_pcm(a[2]);
+            dstl[(49 + i)*nch] = mp3d_scale_pcm(b[2]);
 #else /* HAVE_SSE */
             int16x4_t pcma, pcmb;
             a = VADD(a, VSET(0.5f));
@@ -1578,6 +1630,15 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
             _mm_store_ss(dstr + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)));
             _mm_store_ss(dstl + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)));
             _mm_store_ss(dstl + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)));
+#elif HAVE_GVEC
+            dstr[(15 - i)*nch] = a[1];
+            dstr[(17 + i)*nch] = b[1];
+            dstl[(15 - i)*nch] = a[0];
+            dstl[(17 + i)*nch] = b[0];
+            dstr[(47 - i)*nch] = a[3];
+            dstr[(49 + i)*nch] = b[3];
+            dstl[(47 - i)*nch] = a[2];
+            dstl[(49 + i)*nch] = b[2];
 #else /* HAVE_SSE */
             vst1q_lane_f32(dstr + (15 - i)*nch, a, 1);
             vst1q_lane_f32(dstr + (17 + i)*nch, b, 1);
@@ -1715,7 +1776,12 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
     int i = 0, igr, frame_size = 0, success = 1;
     const uint8_t *hdr;
     bs_t bs_frame[1];
+#ifndef MINIMP3_SCRATCH
     mp3dec_scratch_t scratch;
+#else /* MINIMP3_SCRATCH */
+    /* caller-provided scratch (placed in fast RAM instead of on the stack) */
+#define scratch (*(mp3dec_scratch_t *)(MINIMP3_SCRATCH))
+#endif /* MINIMP3_SCRATCH */
 
     if (mp3_bytes > 4 && dec->header[0] == 0xff && hdr_compare(dec->header, mp3))
     {
@@ -1803,13 +1869,16 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 #endif /* MINIMP3_ONLY_MP3 */
     }
     return success*hdr_frame_samples(dec->header);
+#ifdef MINIMP3_SCRATCH
+#undef scratch
+#endif /* MINIMP3_SCRATCH */
 }
 
 #ifdef MINIMP3_FLOAT_OUTPUT
 void mp3dec_f32_to_s16(const float *in, int16_t *out, int num_samples)
 {
     int i = 0;
-#if HAVE_SIMD
+#if HAVE_SIMD && !HAVE_GVEC
     int aligned_count = num_samples & ~7;
     for(; i < aligned_count; i += 8)
     {
@@ -1845,7 +1914,7 @@ void mp3dec_f32_to_s16(const float *in, int16_t *out, int num_samples)
         vst1_lane_s16(out+i+7, pcmb, 3);
 #endif /* HAVE_SSE */
     }
-#endif /* HAVE_SIMD */
+#endif /* HAVE_SIMD && !HAVE_GVEC */
     for(; i < num_samples; i++)
     {
         float sample = in[i] * 32768.0f;
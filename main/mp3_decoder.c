@@ -0,0 +1,92 @@
+#include "mp3_decoder.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+// minimp3's 4-lane float path on GCC vector types (see minimp3.h).  The S3
+// has no float SIMD, so it lowers to scalar FPU code: opt-in, for frame-time
+// comparisons only.
+#ifndef MP3_GENERIC_VEC
+#define MP3_GENERIC_VEC         0
+#endif
+#if MP3_GENERIC_VEC
+#define MINIMP3_GENERIC_VEC
+#endif
+
+// Per-frame scratch handed to mp3dec_decode_frame() instead of a stack local
+static void *s_scratch = NULL;
+#define MINIMP3_SCRATCH     s_scratch
+#define MINIMP3_IMPLEMENTATION
+#define MINIMP3_ONLY_MP3
+#include "minimp3.h"
+
+static const char *TAG = "mp3";
+
+// State (~6.7 KB) + scratch (~15 KB) stay in PSRAM like the rest of the
+// decode path: internal RAM is what TLS, Wi-Fi and LVGL run short of
+// (mem_budget.c).  -DMP3_STATE_INTERNAL=1 moves them to internal RAM, for
+// comparing mp3FrameUs on hardware; there is no measurement yet that
+// justifies the 22 KB.
+#ifndef MP3_STATE_INTERNAL
+#define MP3_STATE_INTERNAL  0
+#endif
+#define MP3_PSRAM_CAPS      (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+
+#define FRAME_US_SMOOTH     16      // EWMA divisor for frame_us_avg
+
+static mp3dec_t           *s_dec = NULL;
+static mp3_decoder_stats_t s_stats;
+
+static void *alloc_state(size_t size, const char *what)
+{
+#if MP3_STATE_INTERNAL
+    void *p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (p) return p;
+    ESP_LOGW(TAG, "%s: no internal RAM for %u bytes, using PSRAM", what, (unsigned)size);
+#endif
+    return heap_caps_malloc(size, MP3_PSRAM_CAPS);
+}
+
+bool mp3_decoder_init(void)
+{
+    s_dec     = alloc_state(sizeof(mp3dec_t), "state");
+    s_scratch = alloc_state(sizeof(mp3dec_scratch_t), "scratch");
+    if (!s_dec || !s_scratch) {
+        ESP_LOGE(TAG, "decoder alloc failed");
+        return false;
+    }
+    mp3dec_init(s_dec);
+    ESP_LOGI(TAG, "decoder ready (state %u B, scratch %u B)",
+             (unsigned)sizeof(mp3dec_t), (unsigned)sizeof(mp3dec_scratch_t));
+    return true;
+}
+
+void mp3_decoder_reset(void)
+{
+    mp3dec_init(s_dec);
+    s_stats.frame_us_max = 0;
+}
+
+int mp3_decoder_decode(const uint8_t *mp3, int mp3_bytes, int16_t *pcm,
+                       mp3dec_frame_info_t *info)
+{
+    int64_t t0 = esp_timer_get_time();
+    int samples = mp3dec_decode_frame(s_dec, mp3, mp3_bytes, pcm, info);
+    if (samples > 0) {
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        if (s_stats.frame_us_avg == 0) {
+            s_stats.frame_us_avg = us;
+        } else {
+            s_stats.frame_us_avg += ((int32_t)us - (int32_t)s_stats.frame_us_avg)
+                                    / FRAME_US_SMOOTH;
+        }
+        if (us > s_stats.frame_us_max) s_stats.frame_us_max = us;
+    }
+    return samples;
+}
+
+void mp3_decoder_get_stats(mp3_decoder_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "minimp3.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single MP3 decoder instance shared by every playback path (audio.c
+// serialises playback with its play mutex, so there is only ever one frame
+// in flight).
+//
+// minimp3 lives in its own translation unit so it can be built at -O2,
+// independent of the project-wide -Og.  The decoder state and its ~15 KB
+// per-frame scratch are PSRAM heap blocks instead of a PSRAM task-stack
+// local; MP3_STATE_INTERNAL / MP3_GENERIC_VEC (mp3_decoder.c) are opt-in
+// experiments, off by default.
+
+typedef struct {
+    uint32_t frame_us_avg;  // smoothed decode time per frame (µs)
+    uint32_t frame_us_max;  // worst frame since the last mp3_decoder_reset()
+} mp3_decoder_stats_t;
+
+bool mp3_decoder_init(void);
+void mp3_decoder_reset(void);   // start of a new stream
+int  mp3_decoder_decode(const uint8_t *mp3, int mp3_bytes, int16_t *pcm,
+                        mp3dec_frame_info_t *info);
+void mp3_decoder_get_stats(mp3_decoder_stats_t *out);
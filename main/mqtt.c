@@ -1,22 +1,50 @@
 #include "mqtt.h"
 #include "audio.h"
+#include "audio_cache.h"
+#include "aec.h"
+#include "kws.h"
+#include "record.h"
+#include "stream_player.h"
+#include "net_stats.h"
+#include "mem_budget.h"
+#include "io_expander.h"
+#include "knob.h"
+#include "i2c_bus.h"
+#include "boot_graph.h"
+#include "time_sync.h"
 #include "config.h"
 #include "events.h"
 #include "display.h"
 #include "esp_log.h"
 #include "mqtt_client.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 
 static const char *TAG = "mqtt";
 
+#define MQTT_MEM_WAIT_MS 10000 // queue this long for handshake memory, then connect anyway
+
+// How long a play waits for the stream player's tts_start of the same
+// messageId before fetching the message over HTTP instead
+#ifndef MQTT_STREAM_WAIT_MS
+#define MQTT_STREAM_WAIT_MS 500
+#endif
+
+#define ACTION_QUEUE_LEN 8
+#define ACTION_RECENT    8      // delivered messageIds remembered for dedup
+#define ACTION_MID_LEN   40
+
 static esp_mqtt_client_handle_t s_client = NULL;
 static char s_client_id[80]; // "doll_{doll_id}"
+static int64_t s_connect_us; // BEFORE_CONNECT → CONNECTED (net_stats)
 
 // ── Publish helpers ───────────────────────────────────────────────────────────
 
@@ -34,6 +62,189 @@ static void publish_connection_event(const char *status)
     free(payload);
 }
 
+// ── Action dispatcher ─────────────────────────────────────────────────────────
+// Actions are parsed on the MQTT task and run on their own worker, so nothing
+// waits inside the event handler and a stop is never stuck behind a play.
+// A message can reach the device twice, as an MQTT play and as a stream-player
+// utterance, in either order; s_recent records which path took each
+// messageId so it plays once.
+
+typedef enum {
+    ACT_PLAY,
+    ACT_REPLAY,
+    ACT_STOP,           // cancels a play still waiting for the stream player
+    ACT_STREAM_START,   // stream player opened an utterance (tts_start)
+} action_kind_t;
+
+typedef struct {
+    action_kind_t kind;
+    int64_t       at_us;   // esp_timer time the MQTT message arrived
+    char          mid[ACTION_MID_LEN];
+} action_t;
+
+typedef enum { VIA_NONE, VIA_STREAM, VIA_HTTP } action_via_t;
+
+static QueueHandle_t s_actions;
+static struct {
+    char         mid[ACTION_MID_LEN];
+    action_via_t via;
+} s_recent[ACTION_RECENT];
+static uint32_t      s_recent_next;
+static struct {                       // the play waiting for tts_start
+    char    mid[ACTION_MID_LEN];
+    int64_t at_us;
+} s_waiting;
+static portMUX_TYPE  s_recent_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Published with the metrics
+static struct {
+    uint32_t stream;     // plays delivered by the stream player
+    uint32_t http;       // plays fetched over HTTP (fallback included)
+    uint32_t fallback;   // of those, after waiting out MQTT_STREAM_WAIT_MS
+    uint32_t deduped;    // second deliveries of a messageId dropped
+} s_play_stats;
+
+// Path that already took mid, or VIA_NONE after recording it for via
+static action_via_t recent_claim(const char *mid, action_via_t via)
+{
+    action_via_t prev = VIA_NONE;
+    taskENTER_CRITICAL(&s_recent_lock);
+    for (int i = 0; i < ACTION_RECENT; i++) {
+        if (s_recent[i].via != VIA_NONE && strcmp(s_recent[i].mid, mid) == 0) {
+            prev = s_recent[i].via;
+            break;
+        }
+    }
+    if (prev == VIA_NONE) {
+        uint32_t n = s_recent_next++ % ACTION_RECENT;
+        strlcpy(s_recent[n].mid, mid, sizeof(s_recent[n].mid));
+        s_recent[n].via = via;
+    }
+    taskEXIT_CRITICAL(&s_recent_lock);
+    return prev;
+}
+
+// Publish the play waiting for the stream player ("" when none), so the
+// stream's first-sample latency can start from it
+static void waiting_set(const char *mid, int64_t at_us)
+{
+    taskENTER_CRITICAL(&s_recent_lock);
+    strlcpy(s_waiting.mid, mid, sizeof(s_waiting.mid));
+    s_waiting.at_us = at_us;
+    taskEXIT_CRITICAL(&s_recent_lock);
+}
+
+static void play_http(const char *mid, bool fallback)
+{
+    if (recent_claim(mid, VIA_HTTP) != VIA_NONE) {
+        s_play_stats.deduped++;
+        ESP_LOGI(TAG, "Already delivered, skipping %.36s", mid);
+        return;
+    }
+    s_play_stats.http++;
+    if (fallback) s_play_stats.fallback++;
+    ESP_LOGI(TAG, "Audio play (HTTP%s): %.36s", fallback ? " fallback" : "", mid);
+    audio_play_message(mid);
+}
+
+// Stream player's WS task, at every tts_start
+static bool on_stream_start(const char *mid, int64_t *requested_us)
+{
+    if (recent_claim(mid, VIA_STREAM) == VIA_HTTP) {
+        s_play_stats.deduped++;
+        return false;           // already playing over HTTP
+    }
+    taskENTER_CRITICAL(&s_recent_lock);
+    if (strcmp(s_waiting.mid, mid) == 0) *requested_us = s_waiting.at_us;
+    taskEXIT_CRITICAL(&s_recent_lock);
+    s_play_stats.stream++;
+    action_t a = { .kind = ACT_STREAM_START };
+    strlcpy(a.mid, mid, sizeof(a.mid));
+    xQueueSendToFront(s_actions, &a, 0);
+    return true;
+}
+
+static void action_task(void *arg)
+{
+    char       pending[ACTION_MID_LEN] = "";   // play waiting for tts_start
+    TickType_t deadline = 0;
+    action_t   a;
+
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        if (pending[0]) {
+            int32_t left = (int32_t)(deadline - xTaskGetTickCount());
+            wait = left > 0 ? (TickType_t)left : 0;
+        }
+        if (xQueueReceive(s_actions, &a, wait) != pdTRUE) {
+            play_http(pending, true);
+            pending[0] = '\0';
+            waiting_set("", 0);
+            continue;
+        }
+
+        switch (a.kind) {
+        case ACT_STREAM_START:
+            if (pending[0] && strcmp(pending, a.mid) == 0) {
+                ESP_LOGI(TAG, "Stream-player delivering %.36s", a.mid);
+                pending[0] = '\0';
+                waiting_set("", 0);
+            }
+            break;
+
+        case ACT_STOP:
+            pending[0] = '\0';
+            waiting_set("", 0);
+            break;
+
+        case ACT_PLAY: {
+            // Only one play waits at a time; an earlier one goes to HTTP now
+            // (a late tts_start for it is then refused)
+            if (pending[0]) {
+                play_http(pending, true);
+                pending[0] = '\0';
+                waiting_set("", 0);
+            }
+            EventBits_t bits = xEventGroupGetBits(g_events);
+            if (bits & EVT_AUDIO_RECORDING) {
+                ESP_LOGW(TAG, "Recording in progress, skipping play %.36s", a.mid);
+            } else if (bits & (EVT_STREAM_PLAYING | EVT_AUDIO_PLAYING)) {
+                // Includes this very message, if its tts_start came first
+                ESP_LOGI(TAG, "Already playing, skipping %.36s", a.mid);
+            } else if (bits & EVT_STREAM_CONNECTED) {
+                ESP_LOGI(TAG, "Waiting for stream-player %.36s", a.mid);
+                strlcpy(pending, a.mid, sizeof(pending));
+                waiting_set(a.mid, a.at_us);
+                deadline = xTaskGetTickCount() + pdMS_TO_TICKS(MQTT_STREAM_WAIT_MS);
+            } else {
+                play_http(a.mid, false);
+            }
+            break;
+        }
+
+        case ACT_REPLAY: {
+            EventBits_t bits = xEventGroupGetBits(g_events);
+            if (bits & (EVT_AUDIO_RECORDING | EVT_AUDIO_PLAYING)) {
+                ESP_LOGW(TAG, "Busy, skipping replay %.36s", a.mid);
+            } else {
+                ESP_LOGI(TAG, "Audio replay (cache/HTTP): %.36s", a.mid);
+                audio_play_message(a.mid);
+            }
+            break;
+        }
+        }
+    }
+}
+
+static void action_post(action_kind_t kind, const char *mid)
+{
+    action_t a = { .kind = kind, .at_us = esp_timer_get_time() };
+    if (mid) strlcpy(a.mid, mid, sizeof(a.mid));
+    BaseType_t ok = kind == ACT_STOP ? xQueueSendToFront(s_actions, &a, 0)
+                                     : xQueueSend(s_actions, &a, 0);
+    if (ok != pdTRUE) ESP_LOGW(TAG, "Action queue full, dropping %.36s", mid ? mid : "stop");
+}
+
 // ── Incoming message handler ──────────────────────────────────────────────────
 
 static void handle_action_event(const char *data, int data_len)
@@ -43,46 +254,17 @@ static void handle_action_event(const char *data, int data_len)
 
     const char *type   = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
     const char *action = cJSON_GetStringValue(cJSON_GetObjectItem(json, "action"));
+    const char *mid    = cJSON_GetStringValue(cJSON_GetObjectItem(json, "messageId"));
 
     if (type && action) {
         if (strcmp(type, "audio") == 0) {
             if (strcmp(action, "play") == 0) {
-                const char *mid = cJSON_GetStringValue(cJSON_GetObjectItem(json, "messageId"));
-                if (mid) {
-                    EventBits_t bits = xEventGroupGetBits(g_events);
-                    if (bits & EVT_AUDIO_RECORDING) {
-                        ESP_LOGW(TAG, "Recording in progress, skipping play %.36s", mid);
-                    } else if (bits & (EVT_STREAM_PLAYING | EVT_AUDIO_PLAYING)) {
-                        ESP_LOGI(TAG, "Already playing, skipping %.36s", mid);
-                    } else if (bits & EVT_STREAM_CONNECTED) {
-                        // Give stream-player 2 s to receive tts_start
-                        ESP_LOGI(TAG, "Waiting for stream-player %.36s", mid);
-                        vTaskDelay(pdMS_TO_TICKS(2000));
-                        bits = xEventGroupGetBits(g_events);
-                        if (bits & (EVT_STREAM_PLAYING | EVT_AUDIO_PLAYING)) {
-                            ESP_LOGI(TAG, "Stream-player delivering %.36s", mid);
-                        } else {
-                            ESP_LOGI(TAG, "Stream-player idle, HTTP fallback: %.36s", mid);
-                            audio_play_message(mid);
-                        }
-                    } else {
-                        ESP_LOGI(TAG, "Audio play (HTTP): %.36s", mid);
-                        audio_play_message(mid);
-                    }
-                }
+                if (mid) action_post(ACT_PLAY, mid);
             } else if (strcmp(action, "replay") == 0) {
-                const char *mid = cJSON_GetStringValue(cJSON_GetObjectItem(json, "messageId"));
-                if (mid) {
-                    EventBits_t bits = xEventGroupGetBits(g_events);
-                    if (bits & (EVT_AUDIO_RECORDING | EVT_AUDIO_PLAYING)) {
-                        ESP_LOGW(TAG, "Busy, skipping replay %.36s", mid);
-                    } else {
-                        ESP_LOGI(TAG, "Audio replay (HTTP): %.36s", mid);
-                        audio_play_message(mid);
-                    }
-                }
+                if (mid) action_post(ACT_REPLAY, mid);
             } else if (strcmp(action, "stop") == 0) {
                 audio_stop();
+                action_post(ACT_STOP, NULL);
             }
         } else if (strcmp(type, "system") == 0) {
             ESP_LOGI(TAG, "system action: %s", action);
@@ -106,8 +288,18 @@ static void mqtt_event_handler(void *arg, esp_event_base_t base,
 
     switch ((esp_mqtt_event_id_t)event_id) {
 
+    case MQTT_EVENT_BEFORE_CONNECT:
+        // (Re)connects queue here, on the MQTT task, for room to handshake
+        if (!mem_budget_conn_begin(MEM_USER_MQTT, MQTT_MEM_WAIT_MS)) {
+            ESP_LOGW(TAG, "Connecting without a memory reservation");
+        }
+        s_connect_us = esp_timer_get_time();
+        break;
+
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "Connected to %s", g_config.mqtt_url);
+        mem_budget_conn_up(MEM_USER_MQTT);
+        net_stats_connect(NET_LINK_MQTT, (uint32_t)((esp_timer_get_time() - s_connect_us) / 1000));
         xEventGroupClearBits(g_events, EVT_MQTT_DISCONNECTED);
         xEventGroupSetBits(g_events, EVT_MQTT_CONNECTED);
         display_set_mqtt_connected(true);
@@ -122,10 +314,12 @@ static void mqtt_event_handler(void *arg, esp_event_base_t base,
         ESP_LOGI(TAG, "Subscribed to %s", action_topic);
 
         // Subscribe to chat-level action events (audio play arrives here)
-        if (strlen(g_config.chat_id) > 0) {
+        char chat_id[CONFIG_CHAT_ID_MAX];
+        config_get_id(CONFIG_ID_CHAT, chat_id, sizeof(chat_id));
+        if (strlen(chat_id) > 0) {
             char chat_topic[128];
             snprintf(chat_topic, sizeof(chat_topic),
-                     "chats/%s/actionEvents", g_config.chat_id);
+                     "chats/%s/actionEvents", chat_id);
             esp_mqtt_client_subscribe(s_client, chat_topic, 0);
             ESP_LOGI(TAG, "Subscribed to %s", chat_topic);
         }
@@ -133,6 +327,7 @@ static void mqtt_event_handler(void *arg, esp_event_base_t base,
 
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG, "Disconnected");
+        mem_budget_conn_end(MEM_USER_MQTT);
         xEventGroupClearBits(g_events, EVT_MQTT_CONNECTED);
         xEventGroupSetBits(g_events, EVT_MQTT_DISCONNECTED);
         display_set_mqtt_connected(false);
@@ -145,14 +340,15 @@ static void mqtt_event_handler(void *arg, esp_event_base_t base,
                  ? evt->topic_len : (int)sizeof(topic) - 1;
         memcpy(topic, evt->topic, tlen);
 
-        char doll_topic[128], chat_topic[128];
+        char doll_topic[128], chat_topic[128], chat_id[CONFIG_CHAT_ID_MAX];
+        config_get_id(CONFIG_ID_CHAT, chat_id, sizeof(chat_id));
         snprintf(doll_topic, sizeof(doll_topic),
                  "dolls/%s/actionEvents", g_config.doll_id);
         snprintf(chat_topic, sizeof(chat_topic),
-                 "chats/%s/actionEvents", g_config.chat_id);
+                 "chats/%s/actionEvents", chat_id);
 
         if (strcmp(topic, doll_topic) == 0 ||
-            (strlen(g_config.chat_id) > 0 && strcmp(topic, chat_topic) == 0)) {
+            (strlen(chat_id) > 0 && strcmp(topic, chat_topic) == 0)) {
             display_mqtt_rx_pulse();
             handle_action_event(evt->data, evt->data_len);
         }
@@ -168,6 +364,43 @@ static void mqtt_event_handler(void *arg, esp_event_base_t base,
     }
 }
 
+// ── Boot profile — published once, when ready to talk ───────────────────────
+
+static void publish_boot_profile(void)
+{
+    char topic[128];
+    snprintf(topic, sizeof(topic), "dolls/%s/boot", g_config.doll_id);
+
+    static const char *const k_results[] = { "pending", "running", "done", "failed", "skipped" };
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddNumberToObject(body, "readyMs", boot_ready_ms());
+
+    const boot_timing_t *t;
+    int n = boot_stage_timings(&t);
+    cJSON *stages = cJSON_AddArrayToObject(body, "stages");
+    for (int i = 0; i < n; i++) {
+        cJSON *st = cJSON_CreateObject();
+        cJSON_AddStringToObject(st, "name",    t[i].name);
+        cJSON_AddNumberToObject(st, "readyMs", t[i].ready_ms);
+        cJSON_AddNumberToObject(st, "startMs", t[i].start_ms);
+        cJSON_AddNumberToObject(st, "endMs",   t[i].end_ms);
+        cJSON_AddStringToObject(st, "result",  k_results[t[i].result]);
+        cJSON_AddItemToArray(stages, st);
+    }
+
+    // { "wifiIp": 2140, "dollReady": 3310, ... }, 0 if never reached
+    const boot_milestone_t *m;
+    int nm = boot_milestone_times(&m);
+    cJSON *ms = cJSON_AddObjectToObject(body, "milestones");
+    for (int i = 0; i < nm; i++) cJSON_AddNumberToObject(ms, m[i].name, m[i].at_ms);
+
+    char *payload = cJSON_PrintUnformatted(body);
+    cJSON_Delete(body);
+    esp_mqtt_client_publish(s_client, topic, payload, 0, 1, 1);
+    ESP_LOGI(TAG, "boot profile → %s", payload);
+    free(payload);
+}
+
 // ── Metrics task — publishes every 30 s while connected ──────────────────────
 
 static void metrics_task(void *arg)
@@ -184,6 +417,21 @@ static void metrics_task(void *arg)
 
         EventBits_t bits = xEventGroupGetBits(g_events);
 
+        static bool s_boot_sent;
+        if (!s_boot_sent && boot_ready_ms()) {
+            publish_boot_profile();
+            s_boot_sent = true;
+        }
+
+        audio_stats_t as;
+        audio_get_stats(&as);
+        audio_cache_stats_t cs;
+        audio_cache_get_stats(&cs);
+        aec_stats_t es;
+        aec_get_stats(&es);
+        kws_stats_t ks;
+        kws_get_stats(&ks);
+
         cJSON *body = cJSON_CreateObject();
         cJSON_AddNumberToObject(body, "recording",          (bits & EVT_AUDIO_RECORDING) ? 1 : 0);
         cJSON_AddBoolToObject  (body, "t1",                 false);
@@ -192,6 +440,118 @@ static void metrics_task(void *arg)
         cJSON_AddNumberToObject(body, "freePSRAM",          (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
         cJSON_AddNumberToObject(body, "wifiRSSI",           ap.rssi);
         cJSON_AddNumberToObject(body, "deepSleepCountdown", 0);
+        cJSON_AddNumberToObject(body, "audioUnderruns",     as.underruns);
+        cJSON_AddNumberToObject(body, "audioPrebuffers",    as.prebuffers);
+        cJSON_AddNumberToObject(body, "audioPrebufferMs",   as.prebuffer_ms);
+        cJSON_AddNumberToObject(body, "audioJitterMs",      as.jitter_ms);
+        cJSON_AddNumberToObject(body, "mp3FrameUs",         as.mp3_frame_us_avg);
+        cJSON_AddNumberToObject(body, "mp3FrameUsMax",      as.mp3_frame_us_max);
+        cJSON_AddNumberToObject(body, "audioFirstSampleMs", as.first_sample_ms);
+        cJSON_AddNumberToObject(body, "opusFrameUs",        as.opus_frame_us_avg);
+        cJSON_AddNumberToObject(body, "opusFrameUsMax",     as.opus_frame_us_max);
+        cJSON_AddNumberToObject(body, "opusConcealed",      as.opus_concealed);
+        cJSON_AddNumberToObject(body, "audioCacheHits",     cs.hits);
+        cJSON_AddNumberToObject(body, "audioCacheMisses",   cs.misses);
+        cJSON_AddNumberToObject(body, "audioCacheInserts",  cs.inserts);
+        cJSON_AddNumberToObject(body, "audioCacheEvicts",   cs.evictions);
+        cJSON_AddNumberToObject(body, "aecErleDb",          es.erle_db);
+        cJSON_AddNumberToObject(body, "aecDoubleTalkMs",    es.doubletalk_ms);
+        cJSON_AddNumberToObject(body, "kwsCpuPermille",     ks.cpu_permille);
+        cJSON_AddNumberToObject(body, "kwsDutyPct",         ks.duty_pct);
+        cJSON_AddNumberToObject(body, "kwsWakes",           ks.wakes);
+        cJSON_AddNumberToObject(body, "kwsCommands",        ks.commands);
+        cJSON_AddNumberToObject(body, "kwsLatencyMs",       ks.latency_ms);
+        cJSON_AddNumberToObject(body, "kwsDropped",         ks.dropped);
+        cJSON_AddNumberToObject(body, "playStream",         s_play_stats.stream);
+        cJSON_AddNumberToObject(body, "playHttp",           s_play_stats.http);
+        cJSON_AddNumberToObject(body, "playFallback",       s_play_stats.fallback);
+        cJSON_AddNumberToObject(body, "playDeduped",        s_play_stats.deduped);
+
+        // Connection setup per link: httpConnects, httpConnectMs, httpConnectMsMax, httpReused, rec…
+        static const char *const k_links[NET_LINK_COUNT] = { "http", "rec", "player", "mqtt" };
+        for (int i = 0; i < NET_LINK_COUNT; i++) {
+            net_link_stats_t ns;
+            net_stats_get((net_link_t)i, &ns);
+            char key[32];
+            snprintf(key, sizeof(key), "%sConnects", k_links[i]);
+            cJSON_AddNumberToObject(body, key, ns.connects);
+            snprintf(key, sizeof(key), "%sConnectMs", k_links[i]);
+            cJSON_AddNumberToObject(body, key, ns.connect_ms_avg);
+            snprintf(key, sizeof(key), "%sConnectMsMax", k_links[i]);
+            cJSON_AddNumberToObject(body, key, ns.connect_ms_max);
+            if (i == NET_LINK_HTTP) cJSON_AddNumberToObject(body, "httpReused", ns.reused);
+        }
+
+        // Conversation event → record task latency: knobLatencyMs, knobLatencyMsMax, speech…
+        conv_latency_t cl[CONV_EV_COUNT];
+        record_get_conv_latency(cl);
+        for (int i = 0; i < CONV_EV_COUNT; i++) {
+            if (!cl[i].count) continue;
+            char key[40];
+            snprintf(key, sizeof(key), "%sLatencyMs", conv_event_name((conv_event_t)i));
+            cJSON_AddNumberToObject(body, key, cl[i].avg_ms);
+            snprintf(key, sizeof(key), "%sLatencyMsMax", conv_event_name((conv_event_t)i));
+            cJSON_AddNumberToObject(body, key, cl[i].max_ms);
+        }
+
+        // Internal-RAM admission (mem_budget.c)
+        mem_budget_stats_t mb;
+        mem_budget_get_stats(&mb);
+        cJSON_AddNumberToObject(body, "memBudget",      mb.budget);
+        cJSON_AddNumberToObject(body, "memReserved",    mb.reserved);
+        cJSON_AddNumberToObject(body, "memReservedMax", mb.reserved_max);
+        cJSON_AddNumberToObject(body, "memFreeMin",     mb.free_min);
+        cJSON_AddNumberToObject(body, "memWaits",       mb.waits);
+        cJSON_AddNumberToObject(body, "memDenied",      mb.denied);
+        cJSON_AddNumberToObject(body, "memWaitMsMax",   mb.wait_ms_max);
+
+        // IO expander port 0 (io_expander.c)
+        io_exp_stats_t xs;
+        io_exp_get_stats(&xs);
+        cJSON_AddNumberToObject(body, "ioExpReads",  xs.reads);
+        cJSON_AddNumberToObject(body, "ioExpIrqs",   xs.irqs);
+        cJSON_AddNumberToObject(body, "ioExpErrors", xs.errors);
+        cJSON_AddNumberToObject(body, "ioExpEdges",  xs.edges);
+
+        // Knob volume (knob.c)
+        knob_stats_t kn;
+        knob_get_stats(&kn);
+        cJSON_AddNumberToObject(body, "volume",      audio_volume_get());
+        cJSON_AddNumberToObject(body, "knobDetents", kn.detents);
+        cJSON_AddNumberToObject(body, "volumeSaves", kn.saves);
+
+        // Shared codec / IO expander bus (i2c_bus.c), per client
+        for (int i = 0; i < I2C_CLIENT_COUNT; i++) {
+            i2c_bus_stats_t bs;
+            i2c_bus_get_stats((i2c_client_t)i, &bs);
+            if (!bs.grants) continue;
+            // i2cCodecBusMs, i2cIoExpErrors, ...
+            char name[16];
+            strlcpy(name, i2c_client_name((i2c_client_t)i), sizeof(name));
+            name[0] = (char)toupper((unsigned char)name[0]);
+            char key[40];
+            snprintf(key, sizeof(key), "i2c%sBusMs", name);
+            cJSON_AddNumberToObject(body, key, bs.bus_us / 1000);
+            snprintf(key, sizeof(key), "i2c%sHoldUsMax", name);
+            cJSON_AddNumberToObject(body, key, bs.hold_us_max);
+            snprintf(key, sizeof(key), "i2c%sWaitUsMax", name);
+            cJSON_AddNumberToObject(body, key, bs.wait_us_max);
+            snprintf(key, sizeof(key), "i2c%sErrors", name);
+            cJSON_AddNumberToObject(body, key, bs.errors);
+            snprintf(key, sizeof(key), "i2c%sRecoveries", name);
+            cJSON_AddNumberToObject(body, key, bs.recoveries);
+        }
+        cJSON_AddNumberToObject(body, "bootReadyMs", boot_ready_ms());
+
+        // Wall clock (time_sync.c)
+        time_sync_stats_t ts;
+        time_sync_get_stats(&ts);
+        cJSON_AddStringToObject(body, "timeSource",    time_src_name(ts.source));
+        cJSON_AddStringToObject(body, "timeRestored",  time_src_name(ts.restored));
+        cJSON_AddNumberToObject(body, "timeStepMs",    ts.step_ms);
+        cJSON_AddNumberToObject(body, "timeTrustedMs", ts.trusted_ms);
+        cJSON_AddNumberToObject(body, "timeSntpMs",    ts.sntp_ms);
+
         char *payload = cJSON_PrintUnformatted(body);
         cJSON_Delete(body);
 
@@ -208,11 +568,10 @@ static void metrics_task(void *arg)
 
 static void mqtt_connect_task(void *arg)
 {
-    // Wait for doll registration AND image downloads to finish before connecting.
-    // Image downloads use TLS which needs most of internal SRAM for RSA operations;
-    // MQTT socket allocation during that window causes PK verify failures.
-    xEventGroupWaitBits(g_events, EVT_DOLL_READY | EVT_IMAGES_DONE,
-                        pdFALSE, pdTRUE, portMAX_DELAY);
+    // Wait for doll registration.  The handshake itself queues for internal
+    // RAM (BEFORE_CONNECT), so it no longer has to wait out the image
+    // downloads: two handshakes at once caused PK verify failures.
+    xEventGroupWaitBits(g_events, EVT_DOLL_READY, pdFALSE, pdTRUE, portMAX_DELAY);
 
     snprintf(s_client_id, sizeof(s_client_id), "doll_%s", g_config.doll_id);
 
@@ -241,10 +600,37 @@ static void mqtt_connect_task(void *arg)
 
 // ── Public API ────────────────────────────────────────────────────────────────
 
+// Not connected: the next MQTT_EVENT_CONNECTED subscribes to the new chat
+void mqtt_chat_changed(const char *old_chat, const char *new_chat)
+{
+    if (!s_client || !(xEventGroupGetBits(g_events) & EVT_MQTT_CONNECTED)) return;
+
+    char topic[128];
+    if (strlen(old_chat) > 0) {
+        snprintf(topic, sizeof(topic), "chats/%s/actionEvents", old_chat);
+        esp_mqtt_client_unsubscribe(s_client, topic);
+        ESP_LOGI(TAG, "Unsubscribed from %s", topic);
+    }
+    if (strlen(new_chat) > 0) {
+        snprintf(topic, sizeof(topic), "chats/%s/actionEvents", new_chat);
+        esp_mqtt_client_subscribe(s_client, topic, 0);
+        ESP_LOGI(TAG, "Subscribed to %s", topic);
+    }
+}
+
 static StaticTask_t s_mqtt_tcb;
+static StaticTask_t s_action_tcb;
 
 void mqtt_start(void)
 {
+    s_actions = xQueueCreate(ACTION_QUEUE_LEN, sizeof(action_t));
+    assert(s_actions);
+    StackType_t *astack = heap_caps_malloc(4096, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    assert(astack);
+    xTaskCreateStaticPinnedToCore(action_task, "mqtt_action",
+        4096 / sizeof(StackType_t), NULL, 4, astack, &s_action_tcb, 1);
+    stream_player_start_attach(on_stream_start);
+
     StackType_t *stack = heap_caps_malloc(4096, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     assert(stack);
     xTaskCreateStaticPinnedToCore(mqtt_connect_task, "mqtt_connect",
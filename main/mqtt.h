@@ -4,3 +4,6 @@
 // Internally waits for EVT_DOLL_READY before connecting, so it is safe
 // to call this immediately after http_sync_doll().
 void mqtt_start(void);
+
+// The chat ID changed from old_chat to new_chat: move the chat subscription
+void mqtt_chat_changed(const char *old_chat, const char *new_chat);
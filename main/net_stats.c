@@ -0,0 +1,31 @@
+#include "net_stats.h"
+#include "freertos/FreeRTOS.h"
+
+static net_link_stats_t s_stats[NET_LINK_COUNT];
+static portMUX_TYPE     s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void net_stats_connect(net_link_t link, uint32_t ms)
+{
+    net_link_stats_t *s = &s_stats[link];
+    taskENTER_CRITICAL(&s_lock);
+    s->connect_ms_avg  = s->connects ? s->connect_ms_avg + ((int32_t)ms - (int32_t)s->connect_ms_avg) / 8
+                                     : ms;
+    s->connect_ms_last = ms;
+    if (ms > s->connect_ms_max) s->connect_ms_max = ms;
+    s->connects++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void net_stats_reuse(net_link_t link)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_stats[link].reused++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void net_stats_get(net_link_t link, net_link_stats_t *out)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats[link];
+    taskEXIT_CRITICAL(&s_lock);
+}
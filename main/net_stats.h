@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+// Connection setup cost per link, for the metrics.  "Connect" is TCP + TLS
+// handshake (+ WebSocket upgrade / MQTT CONNACK): everything a reused
+// connection saves.
+
+typedef enum {
+    NET_LINK_HTTP,       // API requests (http_pool.c)
+    NET_LINK_RECORDER,   // /ws-stream, one connection per turn
+    NET_LINK_PLAYER,     // /ws-player, long-lived
+    NET_LINK_MQTT,
+    NET_LINK_COUNT,
+} net_link_t;
+
+typedef struct {
+    uint32_t connects;         // fresh connections
+    uint32_t reused;           // requests served on an open connection
+    uint32_t connect_ms_last;
+    uint32_t connect_ms_avg;   // smoothed
+    uint32_t connect_ms_max;
+} net_link_stats_t;
+
+void net_stats_connect(net_link_t link, uint32_t ms);
+void net_stats_reuse(net_link_t link);
+void net_stats_get(net_link_t link, net_link_stats_t *out);
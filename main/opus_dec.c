@@ -0,0 +1,99 @@
+#include "opus_dec.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "opus.h"
+
+static const char *TAG = "opus";
+
+// Same placement policy as mp3_decoder.c: the decoder state is touched on
+// every sample, so keep it out of PSRAM when internal RAM allows
+#define OPUS_STATE_CAPS     (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define OPUS_FALLBACK_CAPS  (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+
+#define FRAME_US_SMOOTH     16      // EWMA divisor for frame_us_avg
+#define DEFAULT_FRAME       (OPUS_DEC_HZ / 50)   // 20 ms, until a packet says otherwise
+
+static OpusDecoder     *s_dec = NULL;
+static int              s_last_frame = DEFAULT_FRAME;   // samples in the last packet
+static opus_dec_stats_t s_stats;
+
+bool opus_dec_init(void)
+{
+    int size = opus_decoder_get_size(OPUS_DEC_CHANNELS);
+    s_dec = heap_caps_malloc(size, OPUS_STATE_CAPS);
+    if (!s_dec) {
+        ESP_LOGW(TAG, "no internal RAM for %d bytes, using PSRAM", size);
+        s_dec = heap_caps_malloc(size, OPUS_FALLBACK_CAPS);
+    }
+    if (!s_dec) {
+        ESP_LOGE(TAG, "decoder alloc failed");
+        return false;
+    }
+    int err = opus_decoder_init(s_dec, OPUS_DEC_HZ, OPUS_DEC_CHANNELS);
+    if (err != OPUS_OK) {
+        ESP_LOGE(TAG, "decoder init failed: %s", opus_strerror(err));
+        return false;
+    }
+    ESP_LOGI(TAG, "decoder ready (%d Hz, state %d B)", OPUS_DEC_HZ, size);
+    return true;
+}
+
+void opus_dec_reset(void)
+{
+    opus_decoder_ctl(s_dec, OPUS_RESET_STATE);
+    s_last_frame         = DEFAULT_FRAME;
+    s_stats.frame_us_max = 0;
+}
+
+static void account(int64_t t0)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+    if (s_stats.frame_us_avg == 0) {
+        s_stats.frame_us_avg = us;
+    } else {
+        s_stats.frame_us_avg += ((int32_t)us - (int32_t)s_stats.frame_us_avg)
+                                / FRAME_US_SMOOTH;
+    }
+    if (us > s_stats.frame_us_max) s_stats.frame_us_max = us;
+}
+
+int opus_dec_decode(const uint8_t *pkt, int len, int16_t *pcm)
+{
+    int64_t t0 = esp_timer_get_time();
+    int samples = opus_decode(s_dec, pkt, len, pcm, OPUS_DEC_MAX_SAMPLES, 0);
+    if (samples < 0) {
+        ESP_LOGW(TAG, "corrupt packet (%d B): %s", len, opus_strerror(samples));
+        return samples;
+    }
+    s_last_frame = samples;
+    account(t0);
+    return samples;
+}
+
+int opus_dec_conceal(const uint8_t *next, int next_len, int16_t *pcm)
+{
+    int64_t t0 = esp_timer_get_time();
+    int samples = -1;
+    s_stats.concealed++;
+
+    // FEC: the next packet may carry a low-bitrate copy of this one (libopus
+    // falls back to PLC itself when it does not).  Must ask for exactly the
+    // lost duration, which the next packet's TOC gives.
+    if (next) {
+        int n = opus_packet_get_nb_samples(next, next_len, OPUS_DEC_HZ);
+        if (n > 0 && n <= OPUS_DEC_MAX_SAMPLES) {
+            samples = opus_decode(s_dec, next, next_len, pcm, n, 1);
+        }
+    }
+    // PLC: extrapolate from the decoder state, one frame of the last size
+    if (samples <= 0) samples = opus_decode(s_dec, NULL, 0, pcm, s_last_frame, 0);
+
+    if (samples > 0) account(t0);
+    return samples;
+}
+
+void opus_dec_get_stats(opus_dec_stats_t *out)
+{
+    *out = s_stats;
+}
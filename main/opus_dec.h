@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single Opus decoder instance for the stream-player path (audio.c serialises
+// playback, so like the MP3 decoder there is only ever one packet in flight).
+//
+// Output is fixed at OPUS_DEC_HZ mono whatever the encoder ran at — libopus
+// resamples internally — so consecutive Opus utterances never re-clock I2S.
+// Lost packets are concealed: in-band FEC from the next packet when the
+// encoder sent it, libopus PLC otherwise.  (Named opus_dec_* because libopus
+// already owns the opus_decoder_* namespace.)
+
+#define OPUS_DEC_HZ             24000
+#define OPUS_DEC_CHANNELS       1
+#define OPUS_DEC_MAX_SAMPLES    (OPUS_DEC_HZ * 120 / 1000)   // longest packet (120 ms)
+#define OPUS_DEC_MAX_CONCEAL    5    // lost packets concealed per gap; PLC has
+                                     // decayed to silence by then anyway
+
+typedef struct {
+    uint32_t frame_us_avg;  // smoothed decode time per packet (µs)
+    uint32_t frame_us_max;  // worst packet since the last opus_dec_reset()
+    uint32_t concealed;     // lost/corrupt packets synthesised (all time)
+} opus_dec_stats_t;
+
+bool opus_dec_init(void);
+void opus_dec_reset(void);   // start of a new stream
+
+// Decode one packet into pcm (OPUS_DEC_MAX_SAMPLES capacity).  Returns samples,
+// <0 for a corrupt packet (conceal it like a lost one).
+int  opus_dec_decode(const uint8_t *pkt, int len, int16_t *pcm);
+
+// Synthesise one lost packet's worth of audio.  next/next_len is the packet
+// that arrived after the gap: its FEC data reconstructs the packet right
+// before it, so pass it only for the last lost packet (NULL otherwise).
+int  opus_dec_conceal(const uint8_t *next, int next_len, int16_t *pcm);
+
+void opus_dec_get_stats(opus_dec_stats_t *out);
@@ -1,239 +1,244 @@
 #include "record.h"
 #include "audio.h"
+#include "aec.h"
+#include "stream_player.h"
 #include "board.h"
 #include "config.h"
 #include "events.h"
 #include "display.h"
 #include "touch.h"
+#include "dsp_pcm.h"
+#include "uplink_enc.h"
+#include "spsc_ring.h"
+#include "vad.h"
+#include "conv_fsm.h"
+#include "kws.h"
+#include "net_stats.h"
+#include "mem_budget.h"
+#include "io_expander.h"
 #include "esp_log.h"
 #include "esp_websocket_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "driver/i2s_std.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 #include "driver/gpio.h"
+#include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
-#include "freertos/stream_buffer.h"
+#include "freertos/queue.h"
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
 
 static const char *TAG = "record";
 
 volatile uint16_t g_audio_rms = 0;
 
-#define SAMPLE_RATE      16000
+#define SAMPLE_RATE      UPLINK_SAMPLE_RATE
 #define RECORD_MAX_S     20
 #define I2S_READ_BYTES   2048           // stereo read buffer per iteration
+#define RX_BYTES_PER_SAMPLE 4           // reader keeps one 16-bit slot per stereo frame
 #define RING_BUF_BYTES   (128 * 1024)   // 128 KB ring buffer in PSRAM (~4 s audio)
 #define SEND_CHUNK       4096           // 4 KB per WS send
+#define CODEC_WAIT_MS    300            // wait for the server's codec answer after connect
+#define REC_MEM_WAIT_MS  1500           // queue this long for handshake memory before pausing the player
+#define RECORD_STACK     32768          // Opus encoder runs on the record task
 
 #define ES7243_ADDR  0x14   // Confirmed by I2C scan on SenseCAP Watcher
 
+// Full duplex: the mic keeps running, echo-cancelled, while a reply plays, so
+// the user can talk over it.  0 restores the mute-speaker-to-listen flow.
+#ifndef CONV_FULL_DUPLEX
+#define CONV_FULL_DUPLEX  1
+#endif
+
+_Static_assert(SEND_CHUNK <= STREAM_MUX_MSG_MAX, "uplink messages fit the shared socket");
+
+#if CONV_FULL_DUPLEX
+_Static_assert(SAMPLE_RATE == AUDIO_DUPLEX_HZ, "duplex port runs at the uplink rate");
+#endif
+
+// Keyword spotting (kws.c): the mic stays on between conversations for the
+// wake word and the local stop / louder / quieter commands.  Needs the
+// always-clocked duplex port; off anyway when the model partition is empty.
+#ifndef CONV_KWS
+#define CONV_KWS          CONV_FULL_DUPLEX
+#endif
+#if CONV_KWS && !CONV_FULL_DUPLEX
+#error "CONV_KWS needs CONV_FULL_DUPLEX"
+#endif
+#define KWS_VOLUME_STEP   10
+
 // ── VAD configuration ────────────────────────────────────────────────────────
 
-#define VAD_RMS_THRESHOLD       200     // RMS level above which speech is detected
-#define VAD_SILENCE_TIMEOUT_MS  1500    // 1.5 s of silence ends recording
-#define VAD_CONFIRM_CHUNKS      3       // ~96 ms of consecutive speech to confirm onset
+// Onset and end of speech come from vad.c (thresholds and hangover live in
+// vad_config_default; tools/vad_eval.c measures them on recorded audio).
+// VAD_ENGINE_RMS is the original fixed-threshold detector.
+#ifndef CONV_VAD_ENGINE
+#define CONV_VAD_ENGINE         VAD_ENGINE_ADAPTIVE
+#endif
 #define LISTEN_TIMEOUT_S        60      // Max time in LISTENING before auto-exit
 #define WAIT_RESPONSE_TIMEOUT_S 30      // Max time waiting for server response
+#define CONV_TRIM_MS            500     // idle listening trims the ring to the look-back this often
+#define CONV_QUEUE_LEN          16
 
-// Pre-speech circular buffer — captures ~300 ms before VAD triggers
+// Pre-speech look-back kept in the ring while listening — ~300 ms before VAD triggers
 #define PRE_SPEECH_BYTES  (10 * 1024)   // ~312 ms at 16 kHz mono 16-bit
 
-typedef enum {
-    CONV_OFF,
-    CONV_LISTENING,
-    CONV_RECORDING,
-    CONV_WAITING,
-    CONV_PLAYING,
-} conv_state_t;
-
+// What the reader task acts on; follows the state machine (conv_fsm.c) as
+// the record task carries out each transition
 static volatile conv_state_t s_conv_state = CONV_OFF;
 
+// Every input of the conversation (VAD, knob, wake word, playback, the turn's
+// link) is posted here, stamped, and handled by the record task in order
+static QueueHandle_t s_conv_q;
+static conv_fsm_t    s_fsm;
+
 // ── Shared state ─────────────────────────────────────────────────────────────
 
 static i2s_chan_handle_t s_rx_chan  = NULL;
 static bool             s_mic_init = false;
 
-// Ring buffer for Core 0 → Core 1 audio transfer
-static StreamBufferHandle_t s_ring_buf;
-static StaticStreamBuffer_t s_ring_struct;
+// Mono PCM ring, I2S reader (core 0) → record task (core 1).  The reader
+// DMA-reads into ring memory and the uplink encodes/sends straight out of it.
+// While listening the record task trims it to the pre-speech window, so on
+// speech onset the look-back audio is simply the oldest data in the ring.
+static spsc_ring_t          s_ring;
 static uint8_t             *s_ring_storage;
 static volatile bool        s_reader_running;
+static TaskHandle_t         s_record_task;   // woken per commit while recording
+static uint32_t             s_ring_overflows;
 
 // Reader task stack in PSRAM (keeps internal heap free for TLS)
 #define READER_STACK_WORDS 4096   // 4096 words = 16 KB stack
 static StackType_t         *s_reader_stack;
 static StaticTask_t         s_reader_tcb;
 
-// Pre-speech circular buffer
-static uint8_t  *s_pre_buf;
-static size_t    s_pre_write;
-static size_t    s_pre_fill;
-
-// VAD event group (reader → main task signaling)
-static EventGroupHandle_t s_vad_events;
-#define VAD_EVT_SPEECH   (1 << 0)
-#define VAD_EVT_SILENCE  (1 << 1)
-
-static volatile uint32_t s_speech_chunks;  // consecutive loud chunks counter
-static TimerHandle_t     s_silence_timer;
-static TickType_t        s_wait_start;
-
-// Send buffer (allocated once, reused)
+// Every VAD event of a turn, at the byte of the ring stream where its
+// evidence starts (reader → record task, sent on as recorder control frames)
+typedef struct {
+    vad_event_t ev;
+    size_t      pos;
+    int         hangover_ms;   // VAD_PAUSE: hangover left after the pause
+} vad_mark_t;
+#define VAD_MARKS        16
+static QueueHandle_t     s_vad_marks;
+
+static vad_t             s_vad;            // reader task only (rearmed there on state changes)
+static bool              s_kws_on;         // models loaded: mic runs between conversations
+
+// Send buffers (allocated once, reused): frames straddling the ring wrap,
+// encoded output
 static uint8_t *s_send_buf;
-
-// ── WAV header ────────────────────────────────────────────────────────────────
-
-typedef struct __attribute__((packed)) {
-    char     riff[4];           // "RIFF"
-    uint32_t file_size;         // total file size - 8
-    char     wave[4];           // "WAVE"
-    char     fmt_id[4];         // "fmt "
-    uint32_t fmt_size;          // 16
-    uint16_t audio_format;      // 1 = PCM
-    uint16_t channels;          // 1
-    uint32_t sample_rate;       // 16000
-    uint32_t byte_rate;         // sample_rate * channels * bits/8
-    uint16_t block_align;       // channels * bits/8
-    uint16_t bits_per_sample;   // 16
-    char     data_id[4];        // "data"
-    uint32_t data_size;         // PCM byte count
-} wav_hdr_t;
-
-static void build_wav_header(wav_hdr_t *h, uint32_t pcm_bytes)
-{
-    memcpy(h->riff,    "RIFF", 4);
-    h->file_size       = pcm_bytes + sizeof(wav_hdr_t) - 8;
-    memcpy(h->wave,    "WAVE", 4);
-    memcpy(h->fmt_id,  "fmt ", 4);
-    h->fmt_size        = 16;
-    h->audio_format    = 1;
-    h->channels        = 1;
-    h->sample_rate     = SAMPLE_RATE;
-    h->byte_rate       = SAMPLE_RATE * 2;   // 1 ch × 2 bytes
-    h->block_align     = 2;
-    h->bits_per_sample = 16;
-    memcpy(h->data_id, "data", 4);
-    h->data_size       = pcm_bytes;
-}
+static uint8_t *s_enc_buf;
 
 // ── ES7243E ADC init ──────────────────────────────────────────────────────────
 
-static void es7243_write(uint8_t reg, uint8_t val)
-{
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (ES7243_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write_byte(cmd, val, true);
-    i2c_master_stop(cmd);
-    esp_err_t err = i2c_master_cmd_begin(AUDIO_I2C_PORT, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "ES7243E write reg 0x%02X failed: %s", reg, esp_err_to_name(err));
-    }
-}
+// Sequence from ESP-ADF es7243e driver — paged register map.  Two batches
+// on the bus (i2c_bus.c) instead of one transaction per register.
+static const i2c_reg_t k_es7243e_reset[] = {
+    { 0x01, 0x3A },
+    { 0x00, 0x80 },  // Reset all registers
+};
+
+static const i2c_reg_t k_es7243e_init[] = {
+    { 0xF9, 0x00 },  // Select page 0
+    { 0x04, 0x02 },
+    { 0x04, 0x01 },
+    { 0xF9, 0x01 },  // Select page 1
+    { 0x00, 0x1E },
+    { 0x01, 0x00 },
+    { 0x02, 0x00 },
+    { 0x03, 0x20 },
+    { 0x04, 0x01 },
+    { 0x0D, 0x00 },
+    { 0x05, 0x00 },
+    { 0x06, 0x03 },  // SCLK = MCLK / 4
+    { 0x07, 0x00 },  // LRCK = MCLK / 256 (high byte)
+    { 0x08, 0xFF },  // LRCK = MCLK / 256 (low byte)
+    { 0x09, 0xCA },
+    { 0x0A, 0x85 },
+    { 0x0B, 0x00 },
+    { 0x0E, 0xBF },
+    { 0x0F, 0x80 },
+    { 0x14, 0x0C },
+    { 0x15, 0x0C },
+    { 0x17, 0x02 },
+    { 0x18, 0x26 },
+    { 0x19, 0x77 },
+    { 0x1A, 0xF4 },
+    { 0x1B, 0x66 },
+    { 0x1C, 0x44 },
+    { 0x1E, 0x00 },
+    { 0x1F, 0x0C },
+    { 0x20, 0x1A },  // MIC PGA gain +30 dB
+    { 0x21, 0x1A },  // MIC PGA gain +30 dB
+    { 0x00, 0x80 },  // Slave mode, enable
+    { 0x01, 0x3A },
+    { 0x16, 0x3F },
+    { 0x16, 0x00 },
+};
 
 static void es7243e_init(void)
 {
     // Chip at 0x14 is ES7243E (ID 0x7A43), NOT plain ES7243.
-    // Sequence from ESP-ADF es7243e driver — paged register map.
-    es7243_write(0x01, 0x3A);
-    es7243_write(0x00, 0x80);   // Reset all registers
+    i2c_bus_write_regs(I2C_CLIENT_MIC, ES7243_ADDR, k_es7243e_reset,
+                       sizeof(k_es7243e_reset) / sizeof(k_es7243e_reset[0]));
     vTaskDelay(pdMS_TO_TICKS(10));
-    es7243_write(0xF9, 0x00);   // Select page 0
-    es7243_write(0x04, 0x02);
-    es7243_write(0x04, 0x01);
-    es7243_write(0xF9, 0x01);   // Select page 1
-    es7243_write(0x00, 0x1E);
-    es7243_write(0x01, 0x00);
-    es7243_write(0x02, 0x00);
-    es7243_write(0x03, 0x20);
-    es7243_write(0x04, 0x01);
-    es7243_write(0x0D, 0x00);
-    es7243_write(0x05, 0x00);
-    es7243_write(0x06, 0x03);   // SCLK = MCLK / 4
-    es7243_write(0x07, 0x00);   // LRCK = MCLK / 256 (high byte)
-    es7243_write(0x08, 0xFF);   // LRCK = MCLK / 256 (low byte)
-    es7243_write(0x09, 0xCA);
-    es7243_write(0x0A, 0x85);
-    es7243_write(0x0B, 0x00);
-    es7243_write(0x0E, 0xBF);
-    es7243_write(0x0F, 0x80);
-    es7243_write(0x14, 0x0C);
-    es7243_write(0x15, 0x0C);
-    es7243_write(0x17, 0x02);
-    es7243_write(0x18, 0x26);
-    es7243_write(0x19, 0x77);
-    es7243_write(0x1A, 0xF4);
-    es7243_write(0x1B, 0x66);
-    es7243_write(0x1C, 0x44);
-    es7243_write(0x1E, 0x00);
-    es7243_write(0x1F, 0x0C);
-    es7243_write(0x20, 0x1A);  // MIC PGA gain +30 dB
-    es7243_write(0x21, 0x1A);  // MIC PGA gain +30 dB
-    es7243_write(0x00, 0x80);  // Slave mode, enable
-    es7243_write(0x01, 0x3A);
-    es7243_write(0x16, 0x3F);
-    es7243_write(0x16, 0x00);
+    esp_err_t err = i2c_bus_write_regs(I2C_CLIENT_MIC, ES7243_ADDR, k_es7243e_init,
+                                       sizeof(k_es7243e_init) / sizeof(k_es7243e_init[0]));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "ES7243E init failed: %s", esp_err_to_name(err));
+        return;
+    }
     ESP_LOGI(TAG, "ES7243E init done (addr=0x%02X, chip ID 0x7A43)", ES7243_ADDR);
 }
 
-// ── Knob button ──────────────────────────────────────────────────────────────
+// ── Conversation events ──────────────────────────────────────────────────────
 
-static bool s_knob_btn_ok = false;
+static uint32_t conv_clock(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
 
-static bool knob_btn_pressed(void)
+// Any task.  Also wakes a recording's uplink wait, so the record task sees
+// the event at once.
+static void conv_post(conv_event_t ev)
 {
-    uint8_t reg = PCA9535_INPUT0;
-    uint8_t val = 0xFF;
-    esp_err_t err = i2c_master_write_read_device(
-        AUDIO_I2C_PORT, IO_EXP_ADDR,
-        &reg, 1, &val, 1, pdMS_TO_TICKS(50));
-    if (err != ESP_OK) {
-        if (s_knob_btn_ok) {
-            ESP_LOGW(TAG, "Knob I2C read failed: %s", esp_err_to_name(err));
-        }
-        return false;
-    }
-    if (!s_knob_btn_ok) {
-        s_knob_btn_ok = true;
-        ESP_LOGI(TAG, "Knob IO expander 0x%02X responding, port0=0x%02X",
-                 IO_EXP_ADDR, val);
+    conv_input_t in = conv_fsm_input(&s_fsm, ev);
+    if (xQueueSend(s_conv_q, &in, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Conversation queue full, dropping %s", conv_event_name(ev));
     }
-    return !(val & (1 << KNOB_BTN_BIT));
+    xTaskNotifyGive(s_record_task);
 }
 
-static void knob_init(void)
+// ── Knob button ──────────────────────────────────────────────────────────────
+
+// Debounced by the expander service (io_expander.c): presses become
+// CONV_EV_KNOB on the way down
+static void knob_edge(io_exp_pin_t pin, bool active)
 {
-    uint8_t cmd[] = { PCA9535_CONFIG0, (1 << KNOB_BTN_BIT) };
-    esp_err_t err = i2c_master_write_to_device(
-        AUDIO_I2C_PORT, IO_EXP_ADDR,
-        cmd, sizeof(cmd), pdMS_TO_TICKS(100));
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Knob IO expander 0x%02X not found (%s) — button disabled",
-                 IO_EXP_ADDR, esp_err_to_name(err));
-    } else {
-        ESP_LOGI(TAG, "Knob button configured (IO exp 0x%02X, port0 pin %d)",
-                 IO_EXP_ADDR, KNOB_BTN_BIT);
-    }
+    if (pin == IO_EXP_KNOB && active) conv_post(CONV_EV_KNOB);
 }
 
 // ── I2S RX ────────────────────────────────────────────────────────────────────
 
 static void i2s_rx_start(void)
 {
+    i2s_std_slot_config_t slot = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT,
+                                                                     I2S_SLOT_MODE_MONO);
+#if CONV_FULL_DUPLEX
+    // RX joins the speaker's TX on the shared port (audio.c owns both)
+    s_rx_chan = audio_duplex_begin(&slot, RX_BYTES_PER_SAMPLE);
+    ESP_LOGI(TAG, "I2S RX started at %d Hz mono, full duplex", SAMPLE_RATE);
+#else
     i2s_chan_config_t cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_PORT, I2S_ROLE_MASTER);
     ESP_ERROR_CHECK(i2s_new_channel(&cfg, NULL, &s_rx_chan));
 
     i2s_std_config_t std = {
         .clk_cfg  = I2S_STD_CLK_DEFAULT_CONFIG(SAMPLE_RATE),
-        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT,
-                                                        I2S_SLOT_MODE_MONO),
+        .slot_cfg = slot,
         .gpio_cfg = {
             .mclk = I2S_MCLK,
             .bclk = I2S_BCLK,
@@ -246,13 +251,18 @@ static void i2s_rx_start(void)
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(s_rx_chan, &std));
     ESP_ERROR_CHECK(i2s_channel_enable(s_rx_chan));
     ESP_LOGI(TAG, "I2S RX started at %d Hz mono", SAMPLE_RATE);
+#endif
 }
 
 static void i2s_rx_stop(void)
 {
     if (s_rx_chan) {
+#if CONV_FULL_DUPLEX
+        audio_duplex_end();
+#else
         i2s_channel_disable(s_rx_chan);
         i2s_del_channel(s_rx_chan);
+#endif
         s_rx_chan = NULL;
         ESP_LOGI(TAG, "I2S RX stopped");
     }
@@ -260,20 +270,64 @@ static void i2s_rx_stop(void)
 
 // ── WebSocket event helpers ──────────────────────────────────────────────────
 
+// One turn's link to the recorder endpoint: its own /ws-stream socket, or the
+// recorder channel of the stream player's socket when the server multiplexes
+// (stream_player.h).  Opened ahead of speech (pre-connect), closed after the
+// upload; events from either kind land in s_ws_events.
 static EventGroupHandle_t              s_ws_events       = NULL;
-static esp_websocket_client_handle_t   s_preconnect_client = NULL;
+static esp_websocket_client_handle_t   s_ws_client       = NULL;   // own socket
+static bool                            s_ws_open;
+static bool                            s_ws_mux;                   // shared socket
+static int64_t                         s_ws_connect_us;     // BEFORE_CONNECT → CONNECTED
+static bool                            s_player_paused;     // to make room for this socket
 
 #define WS_EVT_CONNECTED   (1 << 0)
 #define WS_EVT_CLOSED      (1 << 1)
 #define WS_EVT_ERROR       (1 << 2)
+#define WS_EVT_CODEC       (1 << 3)   // server answered the codec= offer
+#define WS_EVT_ALL         (WS_EVT_CONNECTED | WS_EVT_CLOSED | WS_EVT_ERROR | WS_EVT_CODEC)
+
+// Uplink codec for the current connection.  The URL offers what this build
+// can encode; a server that understands it answers {"type":"codec","codec":…}
+// right after the handshake.  No answer means a legacy server: raw PCM.
+static volatile uplink_codec_t s_ws_codec = UPLINK_CODEC_PCM;
+
+// The URL also offers ctrl=1; a server that adds "control":true to its codec
+// answer gets the turn's VAD events as text frames (see ctrl_pump)
+static volatile bool s_ws_ctrl;
+
+static void ws_handle_text(const char *text, int len)
+{
+    cJSON *json = cJSON_ParseWithLength(text, len);
+    const char *type  = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
+    const char *codec = cJSON_GetStringValue(cJSON_GetObjectItem(json, "codec"));
+    uplink_codec_t c;
+    if (type && strcmp(type, "codec") == 0 && codec && uplink_codec_parse(codec, &c)) {
+        s_ws_codec = c;
+        s_ws_ctrl  = cJSON_IsTrue(cJSON_GetObjectItem(json, "control"));
+        xEventGroupSetBits(s_ws_events, WS_EVT_CODEC);
+        ESP_LOGI(TAG, "Server accepted uplink codec: %s%s", codec,
+                 s_ws_ctrl ? ", control frames" : "");
+    }
+    cJSON_Delete(json);
+}
 
 static void ws_event_handler(void *arg, esp_event_base_t base,
                              int32_t event_id, void *event_data)
 {
+    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+
     switch (event_id) {
+    case WEBSOCKET_EVENT_BEFORE_CONNECT:
+        s_ws_connect_us = esp_timer_get_time();
+        break;
     case WEBSOCKET_EVENT_CONNECTED:
         ESP_LOGI(TAG, "WS connected");
+        mem_budget_conn_up(MEM_USER_RECORDER);
+        net_stats_connect(NET_LINK_RECORDER,
+                          (uint32_t)((esp_timer_get_time() - s_ws_connect_us) / 1000));
         xEventGroupSetBits(s_ws_events, WS_EVT_CONNECTED);
+        xTaskNotifyGive(s_record_task);   // a recording may be waiting for it
         break;
     case WEBSOCKET_EVENT_DISCONNECTED:
         ESP_LOGI(TAG, "WS disconnected");
@@ -282,6 +336,14 @@ static void ws_event_handler(void *arg, esp_event_base_t base,
     case WEBSOCKET_EVENT_ERROR:
         ESP_LOGE(TAG, "WS error");
         xEventGroupSetBits(s_ws_events, WS_EVT_ERROR);
+        xTaskNotifyGive(s_record_task);
+        break;
+    case WEBSOCKET_EVENT_DATA:
+        // Control messages are tiny; only unfragmented text frames are parsed
+        if (data->op_code == 0x01 && data->payload_offset == 0 &&
+            data->data_len == data->payload_len) {
+            ws_handle_text(data->data_ptr, data->data_len);
+        }
         break;
     default:
         break;
@@ -292,7 +354,7 @@ static void ws_event_handler(void *arg, esp_event_base_t base,
 
 static void restore_idle_display(void)
 {
-    const char *msg = strlen(g_config.chat_id) > 0 ? "" : "No chat linked";
+    const char *msg = config_has_chat() ? "" : "No chat linked";
     display_set_state(DISPLAY_STATE_WIFI_OK, msg);
 }
 
@@ -300,110 +362,121 @@ static void restore_idle_display(void)
 
 static uint16_t compute_rms(const int16_t *samples, size_t count)
 {
-    if (count == 0) return 0;
-    uint64_t sum_sq = 0;
-    for (size_t i = 0; i < count; i++) {
-        int32_t s = samples[i];
-        sum_sq += (uint64_t)(s * s);
-    }
-    return (uint16_t)sqrtf((float)sum_sq / count);
-}
-
-static void pre_buf_write(const uint8_t *data, size_t len)
-{
-    for (size_t i = 0; i < len; i++) {
-        s_pre_buf[s_pre_write] = data[i];
-        s_pre_write = (s_pre_write + 1) % PRE_SPEECH_BYTES;
-    }
-    s_pre_fill += len;
-    if (s_pre_fill > PRE_SPEECH_BYTES) s_pre_fill = PRE_SPEECH_BYTES;
-}
-
-static size_t pre_buf_drain_to_ring(void)
-{
-    if (s_pre_fill == 0) return 0;
-    size_t start = (s_pre_write + PRE_SPEECH_BYTES - s_pre_fill) % PRE_SPEECH_BYTES;
-    size_t to_read = s_pre_fill;
-
-    // Send in two parts if wrapping
-    if (start + to_read <= PRE_SPEECH_BYTES) {
-        xStreamBufferSend(s_ring_buf, s_pre_buf + start, to_read, pdMS_TO_TICKS(100));
-    } else {
-        size_t first = PRE_SPEECH_BYTES - start;
-        xStreamBufferSend(s_ring_buf, s_pre_buf + start, first, pdMS_TO_TICKS(50));
-        xStreamBufferSend(s_ring_buf, s_pre_buf, to_read - first, pdMS_TO_TICKS(50));
-    }
-
-    size_t drained = s_pre_fill;
-    s_pre_fill = 0;
-    s_pre_write = 0;
-    return drained;
-}
-
-static void silence_timer_cb(TimerHandle_t timer)
-{
-    // Keep lightweight — timer service task has a small stack (2 KB)
-    xEventGroupSetBits(s_vad_events, VAD_EVT_SILENCE);
+    return dsp_rms_s16(samples, count);
 }
 
 // ── I2S reader task — runs on Core 0, feeds ring buffer / pre-buf ───────────
 
 static void i2s_reader_task(void *arg)
 {
-    uint8_t *buf = heap_caps_malloc(I2S_READ_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!buf) {
+    // Bounce buffer, only for reads that would not fit contiguously in the ring
+    uint8_t *bounce = heap_caps_aligned_alloc(DSP_PCM_ALIGN, I2S_READ_BYTES,
+                                              MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!bounce) {
         ESP_LOGE(TAG, "i2s_reader: malloc failed");
         s_reader_running = false;
         vTaskDelete(NULL);
         return;
     }
 
+    conv_state_t prev = CONV_OFF;
+    bool         silence_posted = false;
+
     while (s_reader_running) {
+        // Stereo lands directly in the ring; the mono result (first half)
+        // is what gets committed
+        uint8_t *span;
+        uint8_t *buf = spsc_ring_reserve(&s_ring, &span) >= I2S_READ_BYTES ? span : bounce;
+
         size_t got = 0;
         i2s_channel_read(s_rx_chan, buf, I2S_READ_BYTES, &got, pdMS_TO_TICKS(200));
         if (got == 0) continue;
 
         // Downsample stereo→mono in-place (keep right channel)
         int16_t *s = (int16_t *)buf;
-        size_t n_mono = got / 4;
-        for (size_t i = 0; i < n_mono; i++) {
-            s[i] = s[i * 2 + 1];
-        }
+        size_t n_mono = got / RX_BYTES_PER_SAMPLE;
+        dsp_deinterleave_s16(NULL, s, s, n_mono);
         size_t mono_bytes = n_mono * 2;
 
-        // Compute RMS for VAD and LED level metering
+#if CONV_FULL_DUPLEX
+        // Every chunk, in every state: the canceller counts mic samples to
+        // stay aligned with the speaker reference
+        aec_process(s, n_mono);
+#endif
+
+        // RMS for LED level metering only (the writer meters playback
+        // while a reply plays)
         uint16_t rms = compute_rms(s, n_mono);
-        g_audio_rms = rms;
-        bool loud = (rms > VAD_RMS_THRESHOLD);
 
+        // A new listening phase (or a reply starting) forgets any speech in
+        // progress; over playback the onset is stricter
         conv_state_t state = s_conv_state;
+        if (state != prev &&
+            (state == CONV_OFF || state == CONV_LISTENING || state == CONV_PLAYING)) {
+            vad_rearm(&s_vad, state == CONV_PLAYING);
+        }
+        if (state != prev) silence_posted = false;
+        prev = state;
+
+        // Every chunk, so the noise floor keeps tracking between turns.  A
+        // queued chunk lands at the ring's write position, which places each
+        // event of the turn in the uplink stream.
+        bool   queued = state == CONV_LISTENING || state == CONV_RECORDING ||
+                        state == CONV_PLAYING;
+        size_t base   = spsc_ring_write_pos(&s_ring);
+        bool   onset  = false;
+        for (size_t off = 0; off < n_mono; ) {
+            size_t      used;
+            vad_event_t ev = vad_step(&s_vad, s + off, n_mono - off, &used);
+            off += used;
+            if (ev == VAD_NONE) continue;
+            if (ev == VAD_ONSET) onset = true;
+            if (queued) {
+                vad_mark_t m = {
+                    .ev  = ev,
+                    .pos = base + (off - vad_event_lag(&s_vad)) * sizeof(int16_t),
+                    .hangover_ms = ev == VAD_PAUSE
+                                 ? vad_hangover_ms(&s_vad) - s_vad.cfg.pause_ms : 0,
+                };
+                xQueueSend(s_vad_marks, &m, 0);
+            }
+        }
+
+        // Between conversations the keyword models hear what the VAD calls
+        // speech; in one, speech belongs to the server
+        if (s_kws_on) kws_feed(s, n_mono, state == CONV_OFF && vad_in_speech(&s_vad));
 
-        if (state == CONV_LISTENING) {
-            // Write to pre-speech circular buffer (overwrites oldest)
-            pre_buf_write(buf, mono_bytes);
-
-            // Track consecutive loud chunks for speech onset
-            if (loud) {
-                s_speech_chunks++;
-                if (s_speech_chunks >= VAD_CONFIRM_CHUNKS) {
-                    xEventGroupSetBits(s_vad_events, VAD_EVT_SPEECH);
-                }
-            } else {
-                s_speech_chunks = 0;
+        if (state == CONV_LISTENING || state == CONV_RECORDING) {
+            g_audio_rms = rms;
+        } else if (state == CONV_WAITING) {
+            g_audio_rms = 0;
+        }
+
+        // While a reply plays the ring holds the barge-in look-back, as it
+        // does the pre-speech window when listening
+        if (queued) {
+            if (buf == span) {
+                spsc_ring_commit(&s_ring, mono_bytes);
+            } else if (spsc_ring_write(&s_ring, buf, mono_bytes) < mono_bytes) {
+                s_ring_overflows++;   // uplink fell ~4 s behind; newest audio lost
             }
-        } else if (state == CONV_RECORDING) {
-            // Write to ring buffer for WS streaming
-            xStreamBufferSend(s_ring_buf, buf, mono_bytes, pdMS_TO_TICKS(50));
+        }
 
-            // Reset silence timer on loud chunks
-            if (loud) {
-                xTimerReset(s_silence_timer, 0);
+        if (state == CONV_LISTENING || state == CONV_PLAYING) {
+            if (onset) conv_post(CONV_EV_SPEECH);
+        } else if (state == CONV_RECORDING) {
+            // The onset that started the recording left the VAD in speech;
+            // its hangover running out ends the turn
+            if (!vad_in_speech(&s_vad) && !silence_posted) {
+                conv_post(CONV_EV_SILENCE);
+                silence_posted = true;
             }
+            xTaskNotifyGive(s_record_task);
         }
     }
 
     g_audio_rms = 0;
-    heap_caps_free(buf);
+    heap_caps_free(bounce);
     ESP_LOGI(TAG, "I2S reader task exiting");
     vTaskDelete(NULL);
 }
@@ -412,28 +485,69 @@ static void i2s_reader_task(void *arg)
 
 static void build_ws_url(char *url, size_t url_size)
 {
+    char chat_id[CONFIG_CHAT_ID_MAX];
+    config_get_id(CONFIG_ID_CHAT, chat_id, sizeof(chat_id));
     if (strncmp(g_config.stream_recorder_url, "https://", 8) == 0) {
-        snprintf(url, url_size, "wss://%s/ws-stream?chatId=%s&auth=%s",
-                 g_config.stream_recorder_url + 8, g_config.chat_id, g_config.apikey);
+        snprintf(url, url_size, "wss://%s/ws-stream?chatId=%s&auth=%s&codec=%s&ctrl=1",
+                 g_config.stream_recorder_url + 8, chat_id, g_config.apikey,
+                 uplink_enc_offer());
     } else if (strncmp(g_config.stream_recorder_url, "http://", 7) == 0) {
-        snprintf(url, url_size, "ws://%s/ws-stream?chatId=%s&auth=%s",
-                 g_config.stream_recorder_url + 7, g_config.chat_id, g_config.apikey);
+        snprintf(url, url_size, "ws://%s/ws-stream?chatId=%s&auth=%s&codec=%s&ctrl=1",
+                 g_config.stream_recorder_url + 7, chat_id, g_config.apikey,
+                 uplink_enc_offer());
     } else {
-        snprintf(url, url_size, "ws://%s/ws-stream?chatId=%s&auth=%s",
-                 g_config.stream_recorder_url, g_config.chat_id, g_config.apikey);
+        snprintf(url, url_size, "ws://%s/ws-stream?chatId=%s&auth=%s&codec=%s&ctrl=1",
+                 g_config.stream_recorder_url, chat_id, g_config.apikey,
+                 uplink_enc_offer());
     }
 }
 
-// ── WebSocket pre-connect helpers ────────────────────────────────────────────
+// ── Turn link ────────────────────────────────────────────────────────────────
 
-static void ws_preconnect_start(void)
+// Recorder-channel messages on the shared socket (stream player's WS task)
+static void ws_mux_rec(const char *json, int len)
 {
-    if (s_preconnect_client) return;  // already connecting
+    if (!s_ws_mux) return;
+    if (!json) {
+        xEventGroupSetBits(s_ws_events, WS_EVT_ERROR);
+        xTaskNotifyGive(s_record_task);
+        return;
+    }
+    ws_handle_text(json, len);
+}
 
-    if (s_ws_events) {
-        vEventGroupDelete(s_ws_events);
+static void ws_open(void)
+{
+    if (s_ws_open) return;
+    xEventGroupClearBits(s_ws_events, WS_EVT_ALL);
+    s_ws_codec = UPLINK_CODEC_PCM;
+    s_ws_ctrl  = false;
+    s_ws_open  = true;
+
+    // Shared socket: already connected, the offer goes in an open message
+    if (stream_player_mux_ready()) {
+        s_ws_mux = true;
+        char json[96];
+        int  len = snprintf(json, sizeof(json),
+                            "{\"type\":\"open\",\"codec\":\"%s\",\"ctrl\":1}",
+                            uplink_enc_offer());
+        bool ok  = stream_player_mux_send_text(STREAM_CH_REC, json, len, 1000) >= 0;
+        xEventGroupSetBits(s_ws_events, ok ? WS_EVT_CONNECTED : WS_EVT_ERROR);
+        ESP_LOGI(TAG, "Turn opened on the shared stream-player socket");
+        return;
+    }
+    s_ws_mux = false;
+
+    // Own socket: a second handshake.  The user is talking, so if the budget
+    // stays short, drop the idle player connection rather than wait longer.
+    if (!mem_budget_conn_begin(MEM_USER_RECORDER, REC_MEM_WAIT_MS)) {
+        ESP_LOGW(TAG, "Short of internal RAM, pausing the stream player");
+        stream_player_pause();
+        s_player_paused = true;
+        if (!mem_budget_conn_begin(MEM_USER_RECORDER, REC_MEM_WAIT_MS)) {
+            ESP_LOGW(TAG, "Connecting without a memory reservation");
+        }
     }
-    s_ws_events = xEventGroupCreate();
 
     char url[384];
     build_ws_url(url, sizeof(url));
@@ -446,48 +560,71 @@ static void ws_preconnect_start(void)
         ws_cfg.crt_bundle_attach = esp_crt_bundle_attach;
     }
 
-    s_preconnect_client = esp_websocket_client_init(&ws_cfg);
-    esp_websocket_register_events(s_preconnect_client, WEBSOCKET_EVENT_ANY,
+    s_ws_client = esp_websocket_client_init(&ws_cfg);
+    esp_websocket_register_events(s_ws_client, WEBSOCKET_EVENT_ANY,
                                    ws_event_handler, NULL);
-    esp_websocket_client_start(s_preconnect_client);
-    ESP_LOGI(TAG, "WebSocket pre-connecting...");
+    esp_websocket_client_start(s_ws_client);
 }
 
-static void ws_preconnect_cancel(void)
+// End of the turn (or of a pre-connect nobody used)
+static void ws_close(void)
 {
-    if (!s_preconnect_client) return;
-    esp_websocket_client_stop(s_preconnect_client);
-    esp_websocket_client_destroy(s_preconnect_client);
-    s_preconnect_client = NULL;
-    if (s_ws_events) {
-        vEventGroupDelete(s_ws_events);
-        s_ws_events = NULL;
+    if (!s_ws_open) return;
+    if (s_ws_mux) {
+        static const char k_close[] = "{\"type\":\"close\"}";
+        stream_player_mux_send_text(STREAM_CH_REC, k_close, sizeof(k_close) - 1, 1000);
+        s_ws_mux = false;
+    } else {
+        esp_websocket_client_stop(s_ws_client);
+        esp_websocket_client_destroy(s_ws_client);
+        s_ws_client = NULL;
+        mem_budget_conn_end(MEM_USER_RECORDER);
+        if (s_player_paused) {
+            s_player_paused = false;
+            stream_player_resume();
+        }
     }
+    s_ws_open = false;
+}
+
+static void ws_preconnect_start(void)
+{
+    if (s_ws_open) return;  // already connecting
+    ws_open();
+    if (!s_ws_mux) ESP_LOGI(TAG, "WebSocket pre-connecting...");
 }
 
 // ── Start listening (I2S RX + reader task) ───────────────────────────────────
+// In full duplex the mic is started once per conversation (or once at boot
+// with keyword spotting); later calls only switch the reader's state.
 
-static void start_listening(void)
+static void mic_start(conv_state_t state)
 {
-    audio_speaker_mute();
+    if (s_reader_running) {
+        s_conv_state = state;
+        return;
+    }
+
+    if (!CONV_FULL_DUPLEX) audio_speaker_mute();
     i2s_rx_start();
     if (!s_mic_init) {
         vTaskDelay(pdMS_TO_TICKS(50));
         es7243e_init();
         s_mic_init = true;
     }
+    spsc_ring_reset(&s_ring);   // reader not running yet
 
-    xStreamBufferReset(s_ring_buf);
-    s_pre_fill = 0;
-    s_pre_write = 0;
-    s_speech_chunks = 0;
-    xEventGroupClearBits(s_vad_events, VAD_EVT_SPEECH | VAD_EVT_SILENCE);
-
-    s_conv_state = CONV_LISTENING;
+    s_conv_state = state;
     s_reader_running = true;
     xTaskCreateStaticPinnedToCore(i2s_reader_task, "i2s_rd",
         READER_STACK_WORDS, NULL, 5,
         s_reader_stack, &s_reader_tcb, 0);
+}
+
+static void start_listening(void)
+{
+    xQueueReset(s_vad_marks);
+    mic_start(CONV_LISTENING);
 
     xEventGroupSetBits(g_events, EVT_CONV_LISTENING);
     display_set_state(DISPLAY_STATE_WIFI_OK, "Listening...");
@@ -504,364 +641,543 @@ static void stop_listening(void)
     xEventGroupClearBits(g_events, EVT_CONV_LISTENING);
 }
 
-// ── Record and send via WebSocket ────────────────────────────────────────────
-// Returns true if a meaningful recording was sent, false if too short / error.
+// ── Uplink: PCM ring → encoder → WebSocket ──────────────────────────────────
+// Everything is sent from ring memory in place: PCM spans go out as they are,
+// encoder frames are encoded straight from the ring unless one straddles the
+// wrap, which is the only case copied (into s_send_buf).  Opus packets go out
+// one per message (the server needs the packet boundaries); ADPCM blocks are
+// batched up to SEND_CHUNK while the ring has more.
+
+typedef struct {
+    esp_websocket_client_handle_t client;   // NULL: shared socket
+    uplink_codec_t codec;
+    size_t frame_bytes;   // PCM bytes per encoder frame
+    size_t out_len;       // encoded bytes staged in s_enc_buf
+    size_t pcm_total;     // PCM bytes taken from the ring
+    size_t tx_total;      // bytes handed to the WebSocket
+    bool   ok;
+} uplink_t;
+
+static void uplink_send(uplink_t *u, const uint8_t *data, size_t len)
+{
+    if (len == 0 || !u->ok) return;
+    int ret = u->client ? esp_websocket_client_send_bin(u->client, (const char *)data, len,
+                                                        pdMS_TO_TICKS(5000))
+                        : stream_player_mux_send(STREAM_CH_REC, data, len, 5000);
+    if (ret < 0) u->ok = false;
+    else         u->tx_total += len;
+}
+
+static void uplink_flush(uplink_t *u)
+{
+    uplink_send(u, s_enc_buf, u->out_len);
+    u->out_len = 0;
+}
 
-static bool conv_record_and_send(void)
+// Connected: settle the codec and send the stream header
+static void uplink_begin(uplink_t *u)
 {
-    // Flush pre-speech buffer into ring buffer
-    size_t pre_len = pre_buf_drain_to_ring();
-    ESP_LOGI(TAG, "Speech detected! %zu pre-speech bytes flushed", pre_len);
+    if (!(xEventGroupGetBits(s_ws_events) & WS_EVT_CODEC)) {
+        xEventGroupWaitBits(s_ws_events, WS_EVT_CODEC, pdFALSE, pdFALSE,
+                            pdMS_TO_TICKS(CODEC_WAIT_MS));
+    }
+    uplink_enc_begin(s_ws_codec);
+    *u = (uplink_t){
+        .client      = s_ws_mux ? NULL : s_ws_client,
+        .codec       = s_ws_codec,
+        .frame_bytes = uplink_enc_frame_samples() * sizeof(int16_t),
+        .ok          = true,
+    };
+
+    uint8_t hdr[64];
+    uplink_send(u, hdr, uplink_enc_header(hdr, sizeof(hdr)));
+    ESP_LOGI(TAG, "Uplink codec: %s", uplink_codec_name(u->codec));
+}
+
+static void uplink_encode(uplink_t *u, const uint8_t *pcm)
+{
+    int n = uplink_enc_encode((const int16_t *)pcm, s_enc_buf + u->out_len,
+                              SEND_CHUNK - u->out_len);
+    if (n > 0) u->out_len += (size_t)n;
+    if (u->codec == UPLINK_CODEC_OPUS || u->out_len + UPLINK_ADPCM_BLOCK > SEND_CHUNK) {
+        uplink_flush(u);
+    }
+}
+
+// Send what the ring holds (one chunk / frame).  Waits up to `wait` for the
+// reader when there is not enough yet.  Returns PCM bytes consumed.
+static size_t uplink_pump(uplink_t *u, TickType_t wait)
+{
+    size_t need = u->codec == UPLINK_CODEC_PCM ? 1 : u->frame_bytes;
+    if (spsc_ring_used(&s_ring) < need) {
+        uplink_flush(u);   // ring idle: don't sit on batched blocks
+        if (wait) ulTaskNotifyTake(pdTRUE, wait);
+        if (spsc_ring_used(&s_ring) < need) return 0;
+    }
+
+    const uint8_t *span;
+    size_t avail = spsc_ring_peek(&s_ring, &span);
+    size_t n;
+    if (u->codec == UPLINK_CODEC_PCM) {
+        n = avail < SEND_CHUNK ? avail : SEND_CHUNK;
+        uplink_send(u, span, n);
+        spsc_ring_consume(&s_ring, n);
+    } else if (avail >= u->frame_bytes) {
+        n = u->frame_bytes;
+        uplink_encode(u, span);
+        spsc_ring_consume(&s_ring, n);
+    } else {
+        n = spsc_ring_read(&s_ring, s_send_buf, u->frame_bytes);   // wrap
+        uplink_encode(u, s_send_buf);
+    }
+    u->pcm_total += n;
+    return n;
+}
+
+// End of recording: drain the ring, zero-pad the last frame, flush
+static void uplink_finish(uplink_t *u)
+{
+    while (u->ok && uplink_pump(u, 0) > 0) {}
+    size_t rest = spsc_ring_used(&s_ring);
+    if (u->ok && rest > 0) {
+        spsc_ring_read(&s_ring, s_send_buf, rest);
+        memset(s_send_buf + rest, 0, u->frame_bytes - rest);
+        u->pcm_total += rest;
+        uplink_encode(u, s_send_buf);
+    }
+    uplink_flush(u);
+}
+
+// ── Control frames: the turn's VAD events, in band ──────────────────────────
+// Text frames next to the audio, for servers that accepted ctrl=1.  "sample"
+// counts 16 kHz samples from the first one of this recording (pre-speech
+// included), whatever the uplink codec, so the server can line each event up
+// with the audio it has decoded:
+//   {"type":"speech_start","sample":N}
+//   {"type":"probable_end","sample":N,"hangover_ms":H}  speech stopped at N;
+//       the end is confirmed after H ms more silence — start finalising now
+//   {"type":"cancel","reason":"resumed","sample":N}     the probable end was not
+//   {"type":"confirmed_end","sample":N}                 the turn ends at N
+//   {"type":"cancel","reason":"exit"|"too_short"}       drop the whole turn
+
+static void ctrl_send(uplink_t *u, const char *json, int len)
+{
+    if (!u->ok || !s_ws_ctrl) return;
+    int ret = u->client ? esp_websocket_client_send_text(u->client, json, len, pdMS_TO_TICKS(1000))
+                        : stream_player_mux_send_text(STREAM_CH_REC, json, len, 1000);
+    if (ret < 0) {
+        u->ok = false;
+    }
+}
+
+static void ctrl_cancel(uplink_t *u, const char *reason)
+{
+    char json[64];
+    ctrl_send(u, json, snprintf(json, sizeof(json),
+              "{\"type\":\"cancel\",\"reason\":\"%s\"}", reason));
+}
+
+// Send the queued marks (connected).  Returns true once the end was sent.
+static bool ctrl_pump(uplink_t *u, size_t rec_base)
+{
+    bool       ended = false;
+    vad_mark_t m;
+    while (xQueueReceive(s_vad_marks, &m, 0) == pdTRUE) {
+        long sample = (long)(ptrdiff_t)(m.pos - rec_base) / (long)sizeof(int16_t);
+        if (sample < 0) sample = 0;
+
+        char json[96];
+        int  len;
+        switch (m.ev) {
+        case VAD_ONSET:
+            len = snprintf(json, sizeof(json),
+                           "{\"type\":\"speech_start\",\"sample\":%ld}", sample);
+            break;
+        case VAD_PAUSE:
+            len = snprintf(json, sizeof(json),
+                           "{\"type\":\"probable_end\",\"sample\":%ld,\"hangover_ms\":%d}",
+                           sample, m.hangover_ms);
+            break;
+        case VAD_RESUME:
+            len = snprintf(json, sizeof(json),
+                           "{\"type\":\"cancel\",\"reason\":\"resumed\",\"sample\":%ld}", sample);
+            break;
+        case VAD_END:
+            len = snprintf(json, sizeof(json),
+                           "{\"type\":\"confirmed_end\",\"sample\":%ld}", sample);
+            ended = true;
+            break;
+        default:
+            continue;
+        }
+        ctrl_send(u, json, len);
+    }
+    return ended;
+}
+
+// ── Turn: record and send via WebSocket ──────────────────────────────────────
+// A turn runs while the state machine is in RECORDING: the record task pumps
+// the uplink between conversation events, and the event that ends RECORDING
+// (end of speech, turn stop, knob) finishes or cancels it.
+
+#define RECORD_MAX_BYTES  (RECORD_MAX_S * SAMPLE_RATE * 2)
+
+typedef struct {
+    uplink_t up;
+    size_t   rec_base;    // ring position of the turn's first byte
+    bool     connected;
+    bool     ended;       // confirmed_end sent
+    bool     stopped;     // CONV_EV_TURN_STOP posted
+} turn_t;
+
+static turn_t s_turn;
+
+static void turn_begin(void)
+{
+    // The pre-speech window is at the head of the ring; control frames count
+    // samples from its first byte
+    spsc_ring_trim(&s_ring, PRE_SPEECH_BYTES);
+    s_turn = (turn_t){ .rec_base = spsc_ring_read_pos(&s_ring) };
+    ESP_LOGI(TAG, "Speech detected! %zu pre-speech bytes buffered", spsc_ring_used(&s_ring));
 
     s_conv_state = CONV_RECORDING;
     xEventGroupClearBits(g_events, EVT_CONV_LISTENING);
     xEventGroupSetBits(g_events, EVT_AUDIO_RECORDING);
 
-    // Start silence timer
-    xEventGroupClearBits(s_vad_events, VAD_EVT_SILENCE);
-    xTimerReset(s_silence_timer, 0);
-    xTimerStart(s_silence_timer, 0);
-
     ESP_LOGI(TAG, "Free internal heap: %lu B",
              (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
 
-    // Use pre-connected WebSocket if available, otherwise connect now
-    esp_websocket_client_handle_t client;
-    if (s_preconnect_client) {
-        client = s_preconnect_client;
-        s_preconnect_client = NULL;
-        ESP_LOGI(TAG, "Using pre-connected WebSocket");
+    // Use the pre-connected link if available, otherwise connect now
+    if (s_ws_open) {
+        ESP_LOGI(TAG, "Using pre-connected %s", s_ws_mux ? "shared socket" : "WebSocket");
     } else {
-        char url[384];
-        build_ws_url(url, sizeof(url));
-        if (s_ws_events) vEventGroupDelete(s_ws_events);
-        s_ws_events = xEventGroupCreate();
-        esp_websocket_client_config_t ws_cfg = {
-            .uri        = url,
-            .task_stack = 8192,
-        };
-        if (strncmp(url, "wss://", 6) == 0) {
-            ws_cfg.crt_bundle_attach = esp_crt_bundle_attach;
-        }
-        client = esp_websocket_client_init(&ws_cfg);
-        esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY,
-                                       ws_event_handler, NULL);
-        esp_websocket_client_start(client);
+        ws_open();
         ESP_LOGI(TAG, "WebSocket connecting now (no pre-connect available)");
     }
+}
 
-    bool ws_connected = false;
-    bool header_sent  = false;
-    bool ws_ok        = true;
-    bool knob_exit    = false;
-    size_t total_mono = 0;
-    size_t max_mono   = RECORD_MAX_S * SAMPLE_RATE * 2;
-
-    // Stream loop: runs until silence timeout, knob press, or max duration
-    while (ws_ok && total_mono < max_mono) {
-        // Check silence timer
-        EventBits_t vad = xEventGroupGetBits(s_vad_events);
-        if (vad & VAD_EVT_SILENCE) {
-            ESP_LOGI(TAG, "Silence timeout — stopping recording");
-            break;
-        }
-
-        // Check knob press (exit conversation)
-        if (knob_btn_pressed()) {
-            knob_exit = true;
-            break;
-        }
+static void turn_stop(const char *why)
+{
+    if (s_turn.stopped) return;
+    s_turn.stopped = true;
+    ESP_LOGI(TAG, "Turn stopped: %s", why);
+    conv_post(CONV_EV_TURN_STOP);
+}
 
-        if (!ws_connected) {
-            EventBits_t bits = xEventGroupWaitBits(s_ws_events,
-                WS_EVT_CONNECTED | WS_EVT_ERROR, pdTRUE, pdFALSE, 0);
-            if (bits & WS_EVT_ERROR) { ws_ok = false; break; }
-            if (bits & WS_EVT_CONNECTED) {
-                ws_connected = true;
-                size_t prebuf = xStreamBufferBytesAvailable(s_ring_buf);
-                ESP_LOGI(TAG, "WS connected, %zu bytes buffered (%.1f s)",
-                         prebuf, (float)prebuf / (SAMPLE_RATE * 2));
-            }
-        }
+// One pass of the uplink: connect, then control frames and audio.  Waits up
+// to 100 ms for the reader, the link or the next conversation event.
+static void turn_pump(void)
+{
+    turn_t *t = &s_turn;
 
-        if (!ws_connected) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-            continue;
+    if (!t->connected) {
+        EventBits_t bits = xEventGroupWaitBits(s_ws_events,
+            WS_EVT_CONNECTED | WS_EVT_ERROR, pdTRUE, pdFALSE, 0);
+        if (bits & WS_EVT_ERROR) {
+            turn_stop("link failed");
+            return;
         }
-
-        if (!header_sent) {
-            wav_hdr_t hdr;
-            build_wav_header(&hdr, max_mono);
-            esp_websocket_client_send_bin(client, (const char *)&hdr,
-                sizeof(wav_hdr_t), pdMS_TO_TICKS(5000));
-            header_sent = true;
+        if (!(bits & WS_EVT_CONNECTED)) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            return;
         }
+        t->connected = true;
+        size_t prebuf = spsc_ring_used(&s_ring);
+        ESP_LOGI(TAG, "WS connected, %zu bytes buffered (%.1f s)",
+                 prebuf, (float)prebuf / (SAMPLE_RATE * 2));
+        uplink_begin(&t->up);
+    }
 
-        size_t got = xStreamBufferReceive(s_ring_buf, s_send_buf,
-                                           SEND_CHUNK, pdMS_TO_TICKS(100));
-        if (got > 0) {
-            int ret = esp_websocket_client_send_bin(client,
-                (const char *)s_send_buf, got, pdMS_TO_TICKS(5000));
-            if (ret < 0) { ws_ok = false; break; }
-            total_mono += got;
-        }
+    t->ended |= ctrl_pump(&t->up, t->rec_base);
+    uplink_pump(&t->up, pdMS_TO_TICKS(100));
+    if (!t->up.ok) {
+        turn_stop("link lost");
+    } else if (t->up.pcm_total >= RECORD_MAX_BYTES) {
+        turn_stop("maximum length");
     }
+}
+
+// Finish the upload (or cancel it on exit).  A turn not worth a reply is
+// reported as CONV_EV_TURN_DROPPED.
+static void turn_end(bool cancel)
+{
+    turn_t *t = &s_turn;
 
+#if CONV_FULL_DUPLEX
+    // Mic stays up for the reply; the reader stops queueing until it plays
+    s_conv_state = CONV_WAITING;
+#else
     // Stop reader + I2S RX (free bus for playback)
-    xTimerStop(s_silence_timer, 0);
     stop_listening();
     audio_speaker_unmute();
+#endif
     xEventGroupClearBits(g_events, EVT_AUDIO_RECORDING);
 
     // If WS never connected, try waiting
-    if (!ws_connected && !knob_exit) {
+    if (!t->connected && !cancel) {
         EventBits_t bits = xEventGroupWaitBits(s_ws_events,
             WS_EVT_CONNECTED | WS_EVT_ERROR,
             pdTRUE, pdFALSE, pdMS_TO_TICKS(8000));
-        ws_connected = !!(bits & WS_EVT_CONNECTED);
-        if (ws_connected) {
-            size_t remaining = xStreamBufferBytesAvailable(s_ring_buf);
-            wav_hdr_t hdr;
-            build_wav_header(&hdr, remaining);
-            esp_websocket_client_send_bin(client, (const char *)&hdr,
-                sizeof(wav_hdr_t), pdMS_TO_TICKS(5000));
-        }
+        t->connected = !!(bits & WS_EVT_CONNECTED);
+        if (t->connected) uplink_begin(&t->up);
     }
 
-    // Drain remaining ring buffer
-    if (ws_connected) {
-        size_t got;
-        while ((got = xStreamBufferReceive(s_ring_buf, s_send_buf, SEND_CHUNK, 0)) > 0) {
-            esp_websocket_client_send_bin(client,
-                (const char *)s_send_buf, got, pdMS_TO_TICKS(5000));
-            total_mono += got;
+    // Drain remaining ring buffer (the dead time the user waits through —
+    // this is where the smaller encoded stream pays off).  The confirmed end
+    // goes out first, so the server can finalise while the tail uploads.
+    if (t->connected) {
+        t->ended |= ctrl_pump(&t->up, t->rec_base);
+        uplink_finish(&t->up);
+        if (cancel) {
+            ctrl_cancel(&t->up, "exit");
+        } else if (t->up.pcm_total < SAMPLE_RATE) {
+            ctrl_cancel(&t->up, "too_short");
+        } else if (!t->ended) {
+            // Max duration: the turn ends with the audio
+            char json[64];
+            ctrl_send(&t->up, json, snprintf(json, sizeof(json),
+                      "{\"type\":\"confirmed_end\",\"sample\":%ld}",
+                      (long)(t->up.pcm_total / sizeof(int16_t))));
         }
     }
 
-    float dur = (float)total_mono / (SAMPLE_RATE * 2);
-    ESP_LOGI(TAG, "Conv streamed %.1f s (%zu B mono)", dur, total_mono);
-
-    if (!ws_connected) {
-        ESP_LOGE(TAG, "WS connect failed");
+    float dur = (float)t->up.pcm_total / (SAMPLE_RATE * 2);
+    ESP_LOGI(TAG, "Conv streamed %.1f s (%zu B PCM → %zu B %s)", dur,
+             t->up.pcm_total, t->up.tx_total, uplink_codec_name(t->up.codec));
+    if (s_ring_overflows) {
+        ESP_LOGW(TAG, "Ring overflowed %lu times, audio lost",
+                 (unsigned long)s_ring_overflows);
+        s_ring_overflows = 0;
     }
-    esp_websocket_client_stop(client);
-    esp_websocket_client_destroy(client);
-    vEventGroupDelete(s_ws_events);
-    s_ws_events = NULL;
 
-    // If knob was pressed, signal caller to exit conversation mode
-    if (knob_exit) {
-        while (knob_btn_pressed()) vTaskDelay(pdMS_TO_TICKS(30));
-        xEventGroupClearBits(g_events, EVT_CONV_MODE);
-        return false;
+    if (!t->connected) {
+        ESP_LOGE(TAG, "WS connect failed");
     }
+    ws_close();
+    if (cancel) return;
 
-    // Too-short recording = noise, go back to listening
-    if (total_mono < SAMPLE_RATE) {
-        ESP_LOGW(TAG, "Too short (%.1f s), likely noise", dur);
-        return false;
+    // Too-short recording = noise; a lost link gets no reply either
+    if (!t->connected || !t->up.ok || t->up.pcm_total < SAMPLE_RATE) {
+        ESP_LOGW(TAG, "Turn dropped (%.1f s%s)", dur, t->up.ok ? "" : ", link lost");
+        conv_post(CONV_EV_TURN_DROPPED);
+        return;
     }
 
-    return true;
+    display_set_state(DISPLAY_STATE_WIFI_OK, "");
+    ESP_LOGI(TAG, "Waiting for server response...");
+    // A reply that started during the upload was not ours to see yet
+    if (xEventGroupGetBits(g_events) & EVT_AUDIO_PLAYING) conv_post(CONV_EV_PLAY_START);
 }
 
-// ── Conversation mode ────────────────────────────────────────────────────────
+// ── Conversation ─────────────────────────────────────────────────────────────
 
-static void enter_conversation_mode(void)
+static void wait_playback_stopped(uint32_t ms)
 {
-    ESP_LOGI(TAG, "Entering conversation mode");
-    xEventGroupSetBits(g_events, EVT_CONV_MODE);
-
-    start_listening();
-    ws_preconnect_start();  // begin WS handshake while waiting for speech onset
-    TickType_t listen_start = xTaskGetTickCount();
-
-    while (xEventGroupGetBits(g_events) & EVT_CONV_MODE) {
-
-        switch (s_conv_state) {
-
-        case CONV_LISTENING: {
-            // Check knob press → exit
-            if (knob_btn_pressed()) {
-                while (knob_btn_pressed()) vTaskDelay(pdMS_TO_TICKS(30));
-                goto exit_conv;
-            }
-
-            // Check listen timeout
-            if ((xTaskGetTickCount() - listen_start) >
-                pdMS_TO_TICKS(LISTEN_TIMEOUT_S * 1000)) {
-                ESP_LOGI(TAG, "Listen timeout, exiting conversation mode");
-                goto exit_conv;
-            }
+    for (uint32_t t = 0; t < ms; t += 10) {
+        if (!(xEventGroupGetBits(g_events) & EVT_AUDIO_PLAYING)) return;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
 
-            // Wait for VAD speech event
-            EventBits_t vad = xEventGroupWaitBits(s_vad_events, VAD_EVT_SPEECH,
-                pdTRUE, pdFALSE, pdMS_TO_TICKS(100));
-            if (!(vad & VAD_EVT_SPEECH)) break;
-
-            // Speech detected → record and send
-            bool sent = conv_record_and_send();
-            if (!sent) {
-                // Noise or knob exit or error
-                if (!(xEventGroupGetBits(g_events) & EVT_CONV_MODE)) {
-                    goto exit_conv;  // knob_exit cleared EVT_CONV_MODE
-                }
-                // Restart listening after noise/error
-                start_listening();
-                ws_preconnect_start();
-                listen_start = xTaskGetTickCount();
-                break;
-            }
+static void conv_exit(void)
+{
+    ws_close();  // discard any pending pre-connect
 
-            // Recording sent successfully → wait for response
-            s_conv_state = CONV_WAITING;
-            s_wait_start = xTaskGetTickCount();
-            ws_preconnect_start();  // pre-connect for next recording round
-            display_set_state(DISPLAY_STATE_WIFI_OK, "");
-            ESP_LOGI(TAG, "Waiting for server response...");
-            break;
-        }
+    // Stop any ongoing playback (first: in full duplex it shares the port
+    // with the mic)
+    if (xEventGroupGetBits(g_events) & EVT_AUDIO_PLAYING) {
+        audio_stop();
+        wait_playback_stopped(2000);
+    }
 
-        case CONV_WAITING: {
-            // Check knob press → exit
-            if (knob_btn_pressed()) {
-                while (knob_btn_pressed()) vTaskDelay(pdMS_TO_TICKS(30));
-                goto exit_conv;
-            }
+    // Ensure reader/I2S stopped, unless keyword spotting keeps the mic
+    if (s_kws_on && s_reader_running) {
+        s_conv_state = CONV_OFF;
+        spsc_ring_trim(&s_ring, 0);   // the reader queues nothing while off
+    } else if (s_reader_running) {
+        stop_listening();
+    } else {
+        i2s_rx_stop();  // might already be stopped
+    }
 
-            // Check if playback started
-            EventBits_t bits = xEventGroupGetBits(g_events);
-            if (bits & EVT_AUDIO_PLAYING) {
-                s_conv_state = CONV_PLAYING;
-                ESP_LOGI(TAG, "Response playing");
-                break;
-            }
+#if CONV_FULL_DUPLEX
+    aec_stats_t es;
+    aec_get_stats(&es);
+    ESP_LOGI(TAG, "AEC: ERLE %ld dB, double talk %lu ms, %lu samples without reference",
+             (long)es.erle_db, (unsigned long)es.doubletalk_ms,
+             (unsigned long)es.ref_missing);
+#endif
 
-            // Timeout waiting for response
-            if ((xTaskGetTickCount() - s_wait_start) >
-                pdMS_TO_TICKS(WAIT_RESPONSE_TIMEOUT_S * 1000)) {
-                ESP_LOGW(TAG, "Response timeout, resuming listening");
-                start_listening();
-                listen_start = xTaskGetTickCount();
-            }
+    audio_speaker_mute();
+    xEventGroupClearBits(g_events, EVT_CONV_MODE | EVT_CONV_LISTENING | EVT_AUDIO_RECORDING);
+    s_conv_state = CONV_OFF;
+    restore_idle_display();
+    ESP_LOGI(TAG, "Exited conversation mode");
+}
 
-            vTaskDelay(pdMS_TO_TICKS(100));
-            break;
+static void conv_dispatch(const conv_input_t *in)
+{
+    // Starting a conversation needs a linked chat and a quiet speaker
+    if (conv_fsm_state(&s_fsm) == CONV_OFF &&
+        (in->ev == CONV_EV_KNOB || in->ev == CONV_EV_WAKE)) {
+        if (xEventGroupGetBits(g_events) & EVT_AUDIO_PLAYING) return;
+        if (!config_has_chat()) {
+            ESP_LOGW(TAG, "No chat linked, ignoring %s", conv_event_name(in->ev));
+            return;
         }
+    }
 
-        case CONV_PLAYING: {
-            // Check knob press → stop playback and exit
-            if (knob_btn_pressed()) {
-                audio_stop();
-                while (knob_btn_pressed()) vTaskDelay(pdMS_TO_TICKS(30));
-                // Wait for playback to actually stop
-                for (int i = 0; i < 20; i++) {
-                    if (!(xEventGroupGetBits(g_events) & EVT_AUDIO_PLAYING)) break;
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                }
-                goto exit_conv;
-            }
-
-            // Check if playback finished
-            EventBits_t bits = xEventGroupGetBits(g_events);
-            if (!(bits & EVT_AUDIO_PLAYING)) {
-                ESP_LOGI(TAG, "Playback done, resuming listening");
-                xEventGroupSetBits(g_events, EVT_CONV_LISTENING);  // immediately show red, not white
-                vTaskDelay(pdMS_TO_TICKS(200));  // brief pause
-                start_listening();
-                ws_preconnect_start();
-                listen_start = xTaskGetTickCount();
-            }
+    conv_step_t st;
+    if (!conv_fsm_handle(&s_fsm, in, &st)) return;
+    ESP_LOGI(TAG, "%s → %s on %s (+%lu ms)", conv_state_name(st.from),
+             conv_state_name(st.to), conv_event_name(st.ev), (unsigned long)st.latency_ms);
 
-            vTaskDelay(pdMS_TO_TICKS(50));
-            break;
-        }
+    if (st.from == CONV_OFF) {
+        ESP_LOGI(TAG, "Entering conversation mode");
+        xEventGroupSetBits(g_events, EVT_CONV_MODE);
+    }
 
-        default:
-            vTaskDelay(pdMS_TO_TICKS(50));
-            break;
-        }
+    uint32_t act = st.actions;
+    if (act & CONV_ACT_STOP_PLAY) {
+        // Barge-in or exit: the reply and whatever of it is still queued
+        audio_stop();
+        stream_player_skip();
+    }
+    if (act & CONV_ACT_CANCEL_TURN) turn_end(true);
+    if (act & CONV_ACT_END_TURN)    turn_end(false);
+    if (act & CONV_ACT_EXIT)        conv_exit();
+    if (act & CONV_ACT_LISTEN)      start_listening();
+    if (act & CONV_ACT_RECORD)      turn_begin();
+    if (act & CONV_ACT_PLAYING) {
+        // Barge-in marks count from here
+        xQueueReset(s_vad_marks);
+        s_conv_state = CONV_PLAYING;
+        xEventGroupClearBits(g_events, EVT_CONV_LISTENING);
+        ESP_LOGI(TAG, "Response playing");
     }
+    if (act & CONV_ACT_PRECONNECT)  ws_preconnect_start();
+}
 
-exit_conv:
-    ws_preconnect_cancel();  // discard any pending pre-connect
+// Playback start / end (playing task)
+static void conv_on_play(bool playing)
+{
+    conv_post(playing ? CONV_EV_PLAY_START : CONV_EV_PLAY_END);
+}
 
-    // Ensure reader/I2S stopped
-    if (s_reader_running) {
-        stop_listening();
-    } else {
-        i2s_rx_stop();  // might already be stopped
-    }
+void record_get_conv_latency(conv_latency_t out[CONV_EV_COUNT])
+{
+    memcpy(out, s_fsm.latency, sizeof(s_fsm.latency));
+}
 
-    // Stop any ongoing playback
-    if (xEventGroupGetBits(g_events) & EVT_AUDIO_PLAYING) {
+// ── Keywords (KWS task) ──────────────────────────────────────────────────────
+// Heard only between conversations.  The wake word is handed to the record
+// task like a knob press; commands act here, on whatever is playing.
+
+#if CONV_KWS
+static void kws_on_word(kws_word_t word)
+{
+    switch (word) {
+    case KWS_WAKE:
+        conv_post(CONV_EV_WAKE);   // a conversation already running ignores it
+        break;
+    case KWS_STOP:
         audio_stop();
+        stream_player_skip();   // and the rest of a streamed reply
+        break;
+    case KWS_LOUDER:
+        audio_volume_step(KWS_VOLUME_STEP);
+        break;
+    case KWS_QUIETER:
+        audio_volume_step(-KWS_VOLUME_STEP);
+        break;
+    default:
+        break;
     }
-
-    audio_speaker_mute();
-    xEventGroupClearBits(g_events,
-        EVT_CONV_MODE | EVT_CONV_LISTENING | EVT_AUDIO_RECORDING);
-    xTimerStop(s_silence_timer, 0);
-    s_conv_state = CONV_OFF;
-    restore_idle_display();
-    ESP_LOGI(TAG, "Exited conversation mode");
 }
+#endif
 
 // ── Record task ──────────────────────────────────────────────────────────────
 
 static void record_task(void *arg)
 {
     touch_init();
-    knob_init();
 
     // Allocate buffers in PSRAM (once, reused across recordings)
-    s_ring_storage = heap_caps_malloc(RING_BUF_BYTES + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_ring_storage = heap_caps_aligned_alloc(DSP_PCM_ALIGN, RING_BUF_BYTES,
+                                             MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     s_send_buf     = heap_caps_malloc(SEND_CHUNK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_enc_buf      = heap_caps_malloc(SEND_CHUNK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     s_reader_stack = heap_caps_malloc(READER_STACK_WORDS * sizeof(StackType_t),
                                        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    s_pre_buf      = heap_caps_malloc(PRE_SPEECH_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!s_ring_storage || !s_send_buf || !s_reader_stack || !s_pre_buf) {
+    if (!s_ring_storage || !s_send_buf || !s_enc_buf || !s_reader_stack) {
         ESP_LOGE(TAG, "Failed to allocate buffers");
         vTaskDelete(NULL);
         return;
     }
-    s_ring_buf = xStreamBufferCreateStatic(RING_BUF_BYTES, 1, s_ring_storage, &s_ring_struct);
+    spsc_ring_init(&s_ring, s_ring_storage, RING_BUF_BYTES);
 
-    // VAD signaling
-    s_vad_events = xEventGroupCreate();
-    s_silence_timer = xTimerCreate("silence", pdMS_TO_TICKS(VAD_SILENCE_TIMEOUT_MS),
-                                    pdFALSE, NULL, silence_timer_cb);
+    // Without Opus the codec= offer falls back to ADPCM / PCM
+    uplink_enc_init();
 
-    ESP_LOGI(TAG, "Ready — conversation mode (VAD), streaming to: %s",
+    // Turn link events; recorder-channel text on a shared socket lands here too
+    s_ws_events = xEventGroupCreate();
+    stream_player_mux_attach(ws_mux_rec);
+
+    // Conversation inputs
+    conv_fsm_config_t fsm_cfg;
+    conv_fsm_config_default(&fsm_cfg);
+    fsm_cfg.listen_timeout_ms = LISTEN_TIMEOUT_S * 1000;
+    fsm_cfg.reply_timeout_ms  = WAIT_RESPONSE_TIMEOUT_S * 1000;
+    fsm_cfg.barge_in          = CONV_FULL_DUPLEX;
+    conv_fsm_init(&s_fsm, &fsm_cfg, conv_clock);
+    s_conv_q = xQueueCreate(CONV_QUEUE_LEN, sizeof(conv_input_t));
+    audio_play_attach(conv_on_play);
+
+    // VAD marks (reader → uplink control frames)
+    s_vad_marks  = xQueueCreate(VAD_MARKS, sizeof(vad_mark_t));
+    vad_config_t vad_cfg;
+    vad_config_default(&vad_cfg, CONV_VAD_ENGINE);
+    vad_init(&s_vad, &vad_cfg);
+
+    io_exp_attach(knob_edge);
+
+#if CONV_KWS
+    // Mic on from here: the reader idles in CONV_OFF feeding the keyword models
+    s_kws_on = kws_init(kws_on_word);
+    if (s_kws_on) mic_start(CONV_OFF);
+#endif
+
+    ESP_LOGI(TAG, "Ready — conversation mode (%s VAD%s), streaming to: %s",
+             vad_engine_name(CONV_VAD_ENGINE), s_kws_on ? ", wake word" : "",
              g_config.stream_recorder_url);
 
     while (1) {
-        // Wait for knob press
-        while (!knob_btn_pressed()) {
-            vTaskDelay(pdMS_TO_TICKS(30));
-        }
-        // Debounce: wait for release
-        while (knob_btn_pressed()) {
-            vTaskDelay(pdMS_TO_TICKS(30));
-        }
+        conv_input_t in;
+        conv_state_t state = conv_fsm_state(&s_fsm);
 
-        // Guard: skip if already playing or no chat linked
-        EventBits_t bits = xEventGroupGetBits(g_events);
-        if (bits & EVT_AUDIO_PLAYING) continue;
-        if (strlen(g_config.chat_id) == 0) {
-            ESP_LOGW(TAG, "No chat linked, ignoring knob press");
+        // Recording: pump the uplink between events
+        if (state == CONV_RECORDING) {
+            turn_pump();
+            if (xQueueReceive(s_conv_q, &in, 0) == pdTRUE) conv_dispatch(&in);
             continue;
         }
 
-        // Toggle conversation mode
-        if (bits & EVT_CONV_MODE) {
-            // Already in conversation mode — signal exit
-            xEventGroupClearBits(g_events, EVT_CONV_MODE);
-            // enter_conversation_mode() will detect this and exit
-            continue;
+        // Listening keeps only the pre-speech look-back in the ring; on onset
+        // it is already queued ahead of the live audio
+        bool    trim = state == CONV_LISTENING || state == CONV_PLAYING;
+        int32_t wait = conv_fsm_wait_ms(&s_fsm);
+        if (trim) {
+            spsc_ring_trim(&s_ring, PRE_SPEECH_BYTES);
+            if (wait < 0 || wait > CONV_TRIM_MS) wait = CONV_TRIM_MS;
         }
 
-        enter_conversation_mode();
+        TickType_t ticks = wait < 0 ? portMAX_DELAY : pdMS_TO_TICKS(wait) + 1;
+        if (xQueueReceive(s_conv_q, &in, ticks) == pdTRUE) {
+            conv_dispatch(&in);
+        } else if (conv_fsm_wait_ms(&s_fsm) == 0) {
+            in = conv_fsm_timeout_input(&s_fsm);
+            conv_dispatch(&in);
+        }
     }
 }
 
@@ -871,9 +1187,9 @@ static StaticTask_t s_record_tcb;
 
 void record_init(void)
 {
-    StackType_t *stack = heap_caps_malloc(8192, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    StackType_t *stack = heap_caps_malloc(RECORD_STACK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     assert(stack);
-    xTaskCreateStaticPinnedToCore(record_task, "record",
-        8192 / sizeof(StackType_t), NULL, 4, stack, &s_record_tcb, 1);
+    s_record_task = xTaskCreateStaticPinnedToCore(record_task, "record",
+        RECORD_STACK / sizeof(StackType_t), NULL, 4, stack, &s_record_tcb, 1);
     ESP_LOGI(TAG, "Record task spawned");
 }
@@ -1,8 +1,12 @@
 #pragma once
+#include "conv_fsm.h"
 #include <stdint.h>
 
 void record_init(void);
 
+// Per conversation event: how long it waited for the record task (metrics)
+void record_get_conv_latency(conv_latency_t out[CONV_EV_COUNT]);
+
 // Live RMS level updated by i2s_reader_task during CONV_LISTENING/CONV_RECORDING.
 // Read by LED task to drive brightness. Range 0–32767, typically 0–2000 for speech.
 extern volatile uint16_t g_audio_rms;
@@ -1,10 +1,8 @@
 #include "scenario_img.h"
 #include "board.h"
 #include "config.h"
-#include "events.h"
 #include "display.h"
-#include "esp_http_client.h"
-#include "esp_crt_bundle.h"
+#include "http_pool.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -85,9 +83,11 @@ static UINT tjpgd_output(JDEC *jd, void *bitmap, JRECT *rect)
 
 // ── Download + decode task ───────────────────────────────────────────────────
 
-static void scenario_task(void *arg)
+static void scenario_fetch(void)
 {
-    if (strlen(g_config.scenario_id) == 0) {
+    char scenario_id[CONFIG_SCENARIO_ID_MAX];
+    config_get_id(CONFIG_ID_SCENARIO, scenario_id, sizeof(scenario_id));
+    if (strlen(scenario_id) == 0) {
         ESP_LOGW(TAG, "No scenario_id — skipping download");
         goto done;
     }
@@ -95,10 +95,7 @@ static void scenario_task(void *arg)
     // Build URL
     char url[256];
     snprintf(url, sizeof(url), "%s/scenarios/%s/picture.jpg?x=%d&y=%d",
-             g_config.server_url, g_config.scenario_id, LCD_H_RES, LCD_V_RES);
-
-    char auth[128];
-    snprintf(auth, sizeof(auth), "Bearer %s", g_config.apikey);
+             g_config.server_url, scenario_id, LCD_H_RES, LCD_V_RES);
 
     ESP_LOGI(TAG, "Downloading scenario: %s", url);
 
@@ -114,21 +111,13 @@ static void scenario_task(void *arg)
     }
 
     // Download JPEG
-    esp_http_client_config_t cfg = {
-        .url               = url,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .event_handler     = on_data,
-        .user_data         = &dl,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    esp_http_client_set_header(client, "Authorization", auth);
-
-    esp_err_t err = esp_http_client_perform(client);
+    esp_http_client_handle_t client = http_pool_acquire(url, on_data, &dl);
+    esp_err_t err = client ? http_pool_perform(client) : ESP_FAIL;
     int status = -1;
     if (err == ESP_OK) {
         status = esp_http_client_get_status_code(client);
     }
-    esp_http_client_cleanup(client);
+    http_pool_release(client, err == ESP_OK);
 
     if (status != 200 || dl.len == 0) {
         ESP_LOGE(TAG, "Download failed: status=%d len=%d", status, dl.len);
@@ -193,19 +182,30 @@ static void scenario_task(void *arg)
     display_set_scenario(fb, jdec.width, jdec.height);
 
 done:
-    // Signal that all image downloads are complete — MQTT can now safely connect
-    xEventGroupSetBits(g_events, EVT_IMAGES_DONE);
-    vTaskDelete(NULL);
+    return;
+}
+
+// Once per start; a start during a download (the doll profile changed)
+// runs one more when it is done
+static void scenario_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        scenario_fetch();
+    }
 }
 
 // Use PSRAM stack to keep internal SRAM free for TLS operations
-static StaticTask_t s_scenario_tcb;
+static StaticTask_t  s_scenario_tcb;
+static TaskHandle_t  s_scenario_task;
 
 void scenario_img_start(void)
 {
-    StackType_t *stack = heap_caps_malloc(8192, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (stack) {
-        xTaskCreateStaticPinnedToCore(scenario_task, "scenario_dl",
+    if (!s_scenario_task) {
+        StackType_t *stack = heap_caps_malloc(8192, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!stack) return;
+        s_scenario_task = xTaskCreateStaticPinnedToCore(scenario_task, "scenario_dl",
             8192 / sizeof(StackType_t), NULL, 3, stack, &s_scenario_tcb, 1);
     }
+    xTaskNotifyGive(s_scenario_task);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
 // Download and display the scenario image on the LCD.
-// Call after g_config.scenario_id and g_config.server_url are populated.
+// Call after g_config.scenario_id and g_config.server_url are populated, and
+// again when scenario_id changes (a download in progress is followed by one more).
 void scenario_img_start(void);
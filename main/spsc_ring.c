@@ -0,0 +1,118 @@
+#include "spsc_ring.h"
+#include <assert.h>
+#include <string.h>
+
+void spsc_ring_init(spsc_ring_t *r, uint8_t *buf, size_t size)
+{
+    assert(size && (size & (size - 1)) == 0);   // indices are masked, not divided
+    r->buf  = buf;
+    r->size = size;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+void spsc_ring_reset(spsc_ring_t *r)
+{
+    atomic_store(&r->head, 0);
+    atomic_store(&r->tail, 0);
+}
+
+size_t spsc_ring_used(spsc_ring_t *r)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    return head - tail;
+}
+
+size_t spsc_ring_free(spsc_ring_t *r)
+{
+    return r->size - spsc_ring_used(r);
+}
+
+size_t spsc_ring_write_pos(spsc_ring_t *r)
+{
+    return atomic_load_explicit(&r->head, memory_order_acquire);
+}
+
+size_t spsc_ring_read_pos(spsc_ring_t *r)
+{
+    return atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+// ── Producer ─────────────────────────────────────────────────────────────────
+
+size_t spsc_ring_reserve(spsc_ring_t *r, uint8_t **span)
+{
+    size_t head   = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail   = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t idx    = head & (r->size - 1);
+    size_t room   = r->size - (head - tail);
+    size_t contig = r->size - idx;
+    *span = r->buf + idx;
+    return room < contig ? room : contig;
+}
+
+void spsc_ring_commit(spsc_ring_t *r, size_t n)
+{
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, head + n, memory_order_release);
+}
+
+size_t spsc_ring_write(spsc_ring_t *r, const void *src, size_t len)
+{
+    const uint8_t *p = src;
+    size_t done = 0;
+    while (done < len) {
+        uint8_t *span;
+        size_t n = spsc_ring_reserve(r, &span);
+        if (n == 0) break;
+        if (n > len - done) n = len - done;
+        memcpy(span, p + done, n);
+        spsc_ring_commit(r, n);
+        done += n;
+    }
+    return done;
+}
+
+// ── Consumer ─────────────────────────────────────────────────────────────────
+
+size_t spsc_ring_peek(spsc_ring_t *r, const uint8_t **span)
+{
+    size_t tail   = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head   = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t idx    = tail & (r->size - 1);
+    size_t used   = head - tail;
+    size_t contig = r->size - idx;
+    *span = r->buf + idx;
+    return used < contig ? used : contig;
+}
+
+void spsc_ring_consume(spsc_ring_t *r, size_t n)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+}
+
+size_t spsc_ring_read(spsc_ring_t *r, void *dst, size_t len)
+{
+    uint8_t *p = dst;
+    size_t done = 0;
+    while (done < len) {
+        const uint8_t *span;
+        size_t n = spsc_ring_peek(r, &span);
+        if (n == 0) break;
+        if (n > len - done) n = len - done;
+        memcpy(p + done, span, n);
+        spsc_ring_consume(r, n);
+        done += n;
+    }
+    return done;
+}
+
+size_t spsc_ring_trim(spsc_ring_t *r, size_t keep)
+{
+    size_t used = spsc_ring_used(r);
+    if (used <= keep) return 0;
+    spsc_ring_consume(r, used - keep);
+    return used - keep;
+}
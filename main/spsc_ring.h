@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer / single-consumer byte ring with zero-copy spans.
+//
+// The producer reserves a contiguous span of free ring memory, fills it in
+// place (e.g. straight from I2S DMA) and commits what it wrote; the consumer
+// peeks a contiguous span of data, uses it in place (encode, send) and
+// consumes it.  The copying read/write helpers handle the wrap for callers
+// that need a fixed-size block regardless of where the ring splits.
+//
+// head/tail are free-running byte counters: head is written only by the
+// producer, tail only by the consumer, so no lock is needed between the two
+// sides (acquire/release ordering publishes the data).  The size must be a
+// power of two: positions map to the buffer by a mask, and the counters
+// wrap at SIZE_MAX without a jump in the index.  No FreeRTOS dependency —
+// blocking and wake-ups are up to the caller.
+
+typedef struct {
+    uint8_t        *buf;
+    size_t          size;
+    _Atomic size_t  head;   // bytes committed (producer)
+    _Atomic size_t  tail;   // bytes consumed (consumer)
+} spsc_ring_t;
+
+void   spsc_ring_init(spsc_ring_t *r, uint8_t *buf, size_t size);   // size: power of two
+void   spsc_ring_reset(spsc_ring_t *r);   // only while neither side is active
+
+size_t spsc_ring_used(spsc_ring_t *r);
+size_t spsc_ring_free(spsc_ring_t *r);
+
+// Stream positions: bytes ever committed / consumed.  Either side can name a
+// byte of the stream by them, whatever the wrap or trims in between.
+size_t spsc_ring_write_pos(spsc_ring_t *r);
+size_t spsc_ring_read_pos(spsc_ring_t *r);
+
+// ── Producer ─────────────────────────────────────────────────────────────────
+// Contiguous free span at the write position; returns its length (may be less
+// than spsc_ring_free() when the free space wraps).
+size_t spsc_ring_reserve(spsc_ring_t *r, uint8_t **span);
+void   spsc_ring_commit(spsc_ring_t *r, size_t n);
+// Copy in across the wrap; returns bytes written (short when full).
+size_t spsc_ring_write(spsc_ring_t *r, const void *src, size_t len);
+
+// ── Consumer ─────────────────────────────────────────────────────────────────
+// Contiguous readable span at the read position; returns its length.
+size_t spsc_ring_peek(spsc_ring_t *r, const uint8_t **span);
+void   spsc_ring_consume(spsc_ring_t *r, size_t n);
+// Copy out across the wrap; returns bytes read (short when empty).
+size_t spsc_ring_read(spsc_ring_t *r, void *dst, size_t len);
+// Drop all but the newest `keep` bytes (a rewindable look-back window: the
+// producer keeps writing, the consumer only decides later where to start).
+// Returns bytes dropped.
+size_t spsc_ring_trim(spsc_ring_t *r, size_t keep);
@@ -1,36 +1,118 @@
 #include "stream_player.h"
 #include "audio.h"
+#include "audio_cache.h"
 #include "config.h"
 #include "events.h"
 #include "display.h"
+#include "net_stats.h"
+#include "mem_budget.h"
 #include "esp_log.h"
 #include "esp_websocket_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/stream_buffer.h"
+#include "freertos/message_buffer.h"
+#include "freertos/semphr.h"
 #include <string.h>
 
 static const char *TAG = "stream_player";
 
-// ── Stream buffer: WS handler (producer) → decode task (consumer) ───────────
-
-#define SP_STREAM_BUF_SIZE  (128 * 1024)
-
-static StreamBufferHandle_t  s_sp_stream;
-static StaticStreamBuffer_t  s_sp_stream_struct;
-static uint8_t              *s_sp_stream_storage;
-
-// ── Current stream state ────────────────────────────────────────────────────
-
-static volatile bool s_stream_active = false;   // between tts_start and tts_end
-static volatile bool s_stream_error  = false;   // tts_error received
-static char          s_current_msg_id[80];
+// ── Utterance queue: WS handler (producer) → decode task (consumer) ─────────
+// Each tts_start opens an utterance slot.  Its binary frames and its closing
+// tts_end / tts_error travel through one message buffer as framed records, so
+// nothing is ever reset underneath the consumer: sentence N+1 streams in while
+// N is still playing, and each keeps its own boundary, ID and error state.
+
+#define SP_QUEUE_BYTES      (128 * 1024)
+#define SP_REC_MAX_PAYLOAD  2048   // binary frames larger than this are split
+#define SP_MAX_UTTERANCES   8      // utterances queued or playing at once
+#define SP_POLL_MS          200    // consumer wait per read while an utterance is open
+#define SP_MEM_WAIT_MS      10000  // queue this long for handshake memory, then connect anyway
+
+// Codecs offered to the server on the /ws-player URL, in order of preference.
+// The server answers per utterance with tts_start's "codec" (absent → MP3).
+// Opus is one packet per binary frame: 20 ms frames at speech bitrates start
+// playing after the first packet instead of after an MP3 frame + bit reservoir.
+#define SP_CODECS           "opus,mp3"
+
+// Single-connection mode: the URL offers mux=1, and a server that supports it
+// answers {"type":"mux"} before anything else.  From then on this socket also
+// carries the recorder's turns (see stream_player.h), so a conversation holds
+// one TLS connection instead of two.  No answer: the recorder opens its own.
+#ifndef SP_MUX
+#define SP_MUX              1
+#endif
+
+#if SP_MUX
+#define SP_URL_OPTS         "&codec=" SP_CODECS "&mux=1"
+#else
+#define SP_URL_OPTS         "&codec=" SP_CODECS
+#endif
+
+typedef enum {
+    SP_REC_START,   // new utterance in hdr.slot
+    SP_REC_DATA,    // MP3 bytes, or exactly one Opus packet
+    SP_REC_END,     // tts_end
+    SP_REC_ERROR,   // tts_error or WS disconnect
+} sp_rec_type_t;
+
+typedef struct {
+    uint8_t  type;   // sp_rec_type_t
+    uint8_t  slot;   // index into s_utts
+    uint16_t lost;   // DATA (Opus): packets dropped right before this one
+} sp_rec_hdr_t;
+
+#define SP_REC_MAX_BYTES    (sizeof(sp_rec_hdr_t) + SP_REC_MAX_PAYLOAD)
+
+typedef enum { UTT_FREE, UTT_OPEN, UTT_ENDED, UTT_FAILED } utt_state_t;
+
+// Slots are handed out round-robin by the WS task and freed in the same
+// order by the consumer once the utterance's last record has been read.
+typedef struct {
+    volatile utt_state_t state;
+    uint32_t             seq;       // monotonic utterance number
+    uint32_t             dropped;   // payload bytes lost to a full queue
+    uint32_t             lost_run;  // Opus packets dropped since the last queued one
+    audio_codec_t        codec;
+    int64_t              requested_us;   // play request (first-sample latency)
+    char                 msg_id[80];
+} sp_utt_t;
+
+static MessageBufferHandle_t s_sp_queue;
+static StaticMessageBuffer_t s_sp_queue_struct;
+static uint8_t              *s_sp_queue_storage;
+static uint8_t              *s_prod_rec;   // record assembly (WS task only)
+static uint8_t              *s_cons_rec;   // record receive (consumer only)
+
+static sp_utt_t s_utts[SP_MAX_UTTERANCES];
+static uint32_t s_utt_seq  = 0;
+static volatile uint32_t s_skip_seq = 0;   // utterances before this are dropped (barge-in)
+static int      s_open_utt = -1;   // slot receiving binary frames (WS task only)
+
+// Consumer side of the queue as an audio_src_t
+typedef struct {
+    int    slot;       // utterance being played, -1 once released
+    size_t rec_len;    // DATA payload bytes staged in s_cons_rec
+    size_t rec_pos;    // ... of which already handed to the engine
+    uint16_t rec_lost; // ... and the packets lost ahead of it (Opus)
+} sp_reader_t;
+
+static sp_reader_t s_reader;
 
 // WS client handle (module-level for pause/resume)
 static esp_websocket_client_handle_t s_ws_client = NULL;
+static SemaphoreHandle_t s_ws_lock;     // s_ws_client swaps: record task, doll sync
+
+static stream_start_cb_t s_start_cb;   // tts_start hook (mqtt.c dedup)
+
+// Single-connection mode (negotiated per connection)
+static volatile bool        s_mux;
+static stream_mux_rec_cb_t  s_mux_rec_cb;
+static uint8_t              s_rx_ch;      // channel of the binary frame being received
+static uint8_t             *s_mux_tx;     // channel byte + payload (record task only)
 
 // ── Text frame accumulation (for fragmented frames) ─────────────────────────
 
@@ -40,20 +122,108 @@ static int  s_text_buf_len = 0;
 
 // ── URL builder (https→wss, same pattern as record.c) ───────────────────────
 
-static void build_ws_player_url(char *url, size_t url_size)
+static void build_ws_player_url(char *url, size_t url_size, const char *chat_id)
 {
     if (strncmp(g_config.stream_player_url, "https://", 8) == 0) {
-        snprintf(url, url_size, "wss://%s/ws-player?chatId=%s&auth=%s",
+        snprintf(url, url_size, "wss://%s/ws-player?chatId=%s&auth=%s" SP_URL_OPTS,
                  g_config.stream_player_url + 8,
-                 g_config.chat_id, g_config.apikey);
+                 chat_id, g_config.apikey);
     } else if (strncmp(g_config.stream_player_url, "http://", 7) == 0) {
-        snprintf(url, url_size, "ws://%s/ws-player?chatId=%s&auth=%s",
+        snprintf(url, url_size, "ws://%s/ws-player?chatId=%s&auth=%s" SP_URL_OPTS,
                  g_config.stream_player_url + 7,
-                 g_config.chat_id, g_config.apikey);
+                 chat_id, g_config.apikey);
     } else {
-        snprintf(url, url_size, "ws://%s/ws-player?chatId=%s&auth=%s",
+        snprintf(url, url_size, "ws://%s/ws-player?chatId=%s&auth=%s" SP_URL_OPTS,
                  g_config.stream_player_url,
-                 g_config.chat_id, g_config.apikey);
+                 chat_id, g_config.apikey);
+    }
+}
+
+// ── Producer (WS task) ──────────────────────────────────────────────────────
+
+// Never blocks: stalling the WS client task would stall the socket instead
+static bool queue_send(sp_rec_type_t type, int slot, uint16_t lost,
+                       const uint8_t *payload, size_t len)
+{
+    sp_rec_hdr_t hdr = { .type = type, .slot = (uint8_t)slot, .lost = lost };
+    memcpy(s_prod_rec, &hdr, sizeof(hdr));
+    if (len) memcpy(s_prod_rec + sizeof(hdr), payload, len);
+    return xMessageBufferSend(s_sp_queue, s_prod_rec, sizeof(hdr) + len, 0)
+           == sizeof(hdr) + len;
+}
+
+static void utt_close(bool failed)
+{
+    if (s_open_utt < 0) return;
+    sp_utt_t *u = &s_utts[s_open_utt];
+    // The slot state is authoritative — the consumer also ends the utterance
+    // on it if the closing record itself did not fit
+    u->state = failed ? UTT_FAILED : UTT_ENDED;
+    queue_send(failed ? SP_REC_ERROR : SP_REC_END, s_open_utt, 0, NULL, 0);
+    if (u->dropped) {
+        ESP_LOGW(TAG, "Utterance #%lu lost %lu bytes to a full queue",
+                 (unsigned long)u->seq, (unsigned long)u->dropped);
+    }
+    s_open_utt = -1;
+}
+
+static void utt_open(const char *msg_id, audio_codec_t codec, int64_t requested_us)
+{
+    utt_close(false);   // tts_start without tts_end: previous one is complete
+
+    int slot = (int)(s_utt_seq % SP_MAX_UTTERANCES);
+    sp_utt_t *u = &s_utts[slot];
+    if (u->state != UTT_FREE) {
+        ESP_LOGW(TAG, "Utterance queue full, dropping %.36s", msg_id);
+        return;
+    }
+    u->seq     = s_utt_seq++;
+    u->dropped  = 0;
+    u->lost_run = 0;
+    u->codec    = codec;
+    u->requested_us = requested_us;
+    strlcpy(u->msg_id, msg_id, sizeof(u->msg_id));
+    u->state   = UTT_OPEN;
+    if (!queue_send(SP_REC_START, slot, 0, NULL, 0)) {
+        u->state = UTT_FREE;
+        ESP_LOGW(TAG, "Queue full, dropping utterance %.36s", msg_id);
+        return;
+    }
+    s_open_utt = slot;
+    xEventGroupSetBits(g_events, EVT_STREAM_PLAYING);
+}
+
+// An Opus packet that cannot be queued intact is counted, not split: the
+// consumer conceals it from the count carried by the next packet
+static void utt_packet(const uint8_t *data, size_t len, bool whole)
+{
+    sp_utt_t *u = &s_utts[s_open_utt];
+    uint16_t lost = u->lost_run > UINT16_MAX ? UINT16_MAX : (uint16_t)u->lost_run;
+    if (whole && len <= AUDIO_SRC_PACKET_MAX &&
+        queue_send(SP_REC_DATA, s_open_utt, lost, data, len)) {
+        u->lost_run = 0;
+        return;
+    }
+    u->lost_run++;
+    u->dropped += len;
+}
+
+// whole = the binary frame arrived in one piece (packet codecs need that)
+static void utt_data(const uint8_t *data, size_t len, bool whole)
+{
+    if (s_open_utt < 0) return;
+    if (s_utts[s_open_utt].codec == AUDIO_CODEC_OPUS) {
+        utt_packet(data, len, whole);
+        return;
+    }
+    while (len > 0) {
+        size_t n = len < SP_REC_MAX_PAYLOAD ? len : SP_REC_MAX_PAYLOAD;
+        if (!queue_send(SP_REC_DATA, s_open_utt, 0, data, n)) {
+            s_utts[s_open_utt].dropped += len;
+            return;
+        }
+        data += n;
+        len  -= n;
     }
 }
 
@@ -67,28 +237,42 @@ static void handle_text_frame(const char *json_str, int len)
         return;
     }
 
+    // Recorder channel: record.c parses its own messages
+    const char *ch = cJSON_GetStringValue(cJSON_GetObjectItem(json, "ch"));
+    if (ch && strcmp(ch, "rec") == 0) {
+        if (s_mux_rec_cb) s_mux_rec_cb(json_str, len);
+        cJSON_Delete(json);
+        return;
+    }
+
     const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
     if (!type) { cJSON_Delete(json); return; }
 
-    if (strcmp(type, "tts_start") == 0) {
-        const char *mid = cJSON_GetStringValue(cJSON_GetObjectItem(json, "messageId"));
-        if (mid) {
-            strlcpy(s_current_msg_id, mid, sizeof(s_current_msg_id));
-            s_stream_active = true;
-            s_stream_error  = false;
-            xStreamBufferReset(s_sp_stream);
-            xEventGroupSetBits(g_events, EVT_STREAM_PLAYING);
-            ESP_LOGI(TAG, "tts_start: %.36s", mid);
+    if (strcmp(type, "mux") == 0) {
+        s_mux = SP_MUX;
+        ESP_LOGI(TAG, "Server multiplexes: recorder turns share this socket");
+    } else if (strcmp(type, "tts_start") == 0) {
+        const char *mid   = cJSON_GetStringValue(cJSON_GetObjectItem(json, "messageId"));
+        const char *codec = cJSON_GetStringValue(cJSON_GetObjectItem(json, "codec"));
+        int64_t     req_us = esp_timer_get_time();
+        if (mid && s_start_cb && !s_start_cb(mid, &req_us)) {
+            ESP_LOGI(TAG, "tts_start: %.36s already playing over HTTP, dropped", mid);
+            utt_close(false);   // its frames must not extend the previous one
+        } else if (mid) {
+            bool opus = codec && strcmp(codec, "opus") == 0;
+            ESP_LOGI(TAG, "tts_start: %.36s (#%lu, %s)", mid, (unsigned long)s_utt_seq,
+                     opus ? "opus" : "mp3");
+            utt_open(mid, opus ? AUDIO_CODEC_OPUS : AUDIO_CODEC_MP3, req_us);
         }
     } else if (strcmp(type, "tts_end") == 0) {
-        ESP_LOGI(TAG, "tts_end: %.36s", s_current_msg_id);
-        s_stream_active = false;
+        if (s_open_utt >= 0) ESP_LOGI(TAG, "tts_end: %.36s", s_utts[s_open_utt].msg_id);
+        utt_close(false);
     } else if (strcmp(type, "tts_error") == 0) {
         const char *err = cJSON_GetStringValue(cJSON_GetObjectItem(json, "error"));
-        ESP_LOGE(TAG, "tts_error: %.36s — %s", s_current_msg_id,
+        ESP_LOGE(TAG, "tts_error: %.36s — %s",
+                 s_open_utt >= 0 ? s_utts[s_open_utt].msg_id : "-",
                  err ? err : "unknown");
-        s_stream_active = false;
-        s_stream_error  = true;
+        utt_close(true);
     }
 
     cJSON_Delete(json);
@@ -96,23 +280,38 @@ static void handle_text_frame(const char *json_str, int len)
 
 // ── WebSocket event handler ─────────────────────────────────────────────────
 
+static int64_t s_connect_us;   // BEFORE_CONNECT → CONNECTED (net_stats)
+
 static void sp_ws_event_handler(void *arg, esp_event_base_t base,
                                  int32_t event_id, void *event_data)
 {
     esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
 
     switch (event_id) {
+    case WEBSOCKET_EVENT_BEFORE_CONNECT:
+        // The first connect reserved in ws_start(); an auto-reconnect takes
+        // what is free without waiting, as a stall here would hold up ws_stop()
+        if (!mem_budget_conn_begin(MEM_USER_PLAYER, 0)) {
+            ESP_LOGW(TAG, "Reconnecting without a memory reservation");
+        }
+        s_connect_us = esp_timer_get_time();
+        break;
+
     case WEBSOCKET_EVENT_CONNECTED:
         ESP_LOGI(TAG, "Connected to stream-player");
+        mem_budget_conn_up(MEM_USER_PLAYER);
+        net_stats_connect(NET_LINK_PLAYER, (uint32_t)((esp_timer_get_time() - s_connect_us) / 1000));
         xEventGroupSetBits(g_events, EVT_STREAM_CONNECTED);
         break;
 
     case WEBSOCKET_EVENT_DISCONNECTED:
         ESP_LOGW(TAG, "Disconnected from stream-player");
         xEventGroupClearBits(g_events, EVT_STREAM_CONNECTED);
-        if (s_stream_active) {
-            s_stream_active = false;
-            s_stream_error  = true;
+        mem_budget_conn_end(MEM_USER_PLAYER);
+        utt_close(true);
+        if (s_mux) {
+            s_mux = false;   // re-offered on reconnect
+            if (s_mux_rec_cb) s_mux_rec_cb(NULL, 0);
         }
         break;
 
@@ -137,16 +336,20 @@ static void sp_ws_event_handler(void *arg, esp_event_base_t base,
                 s_text_buf_len = 0;
             }
         } else if (data->op_code == 0x02) {
-            // Binary frame — MP3 audio chunk
-            if (s_stream_active && data->data_len > 0) {
-                size_t sent = xStreamBufferSend(s_sp_stream,
-                    (const uint8_t *)data->data_ptr, data->data_len,
-                    0);  // non-blocking — never stall WS client task
-                if ((int)sent < data->data_len) {
-                    ESP_LOGW(TAG, "Stream buffer overflow, lost %d bytes",
-                             data->data_len - (int)sent);
+            // Binary frame — MP3 chunk or Opus packet of the open utterance
+            const uint8_t *p = (const uint8_t *)data->data_ptr;
+            size_t         n = data->data_len > 0 ? (size_t)data->data_len : 0;
+            bool       whole = data->payload_offset == 0 &&
+                               data->data_len == data->payload_len;
+            if (s_mux) {
+                // The channel byte leads the frame's first fragment
+                if (data->payload_offset == 0 && n > 0) {
+                    s_rx_ch = *p++;
+                    n--;
                 }
+                if (s_rx_ch != STREAM_CH_PLAY) break;
             }
+            if (n > 0) utt_data(p, n, whole);
         }
         break;
 
@@ -159,34 +362,162 @@ static void sp_ws_event_handler(void *arg, esp_event_base_t base,
     }
 }
 
-// ── Decode task — reads MP3 from stream buffer, decodes + plays ─────────────
+// ── Consumer (sp_decode task) ───────────────────────────────────────────────
+
+// Next record, payload left in s_cons_rec after the header.  -1 on timeout.
+static int queue_recv(sp_rec_hdr_t *hdr, TickType_t wait)
+{
+    size_t n = xMessageBufferReceive(s_sp_queue, s_cons_rec, SP_REC_MAX_BYTES, wait);
+    if (n < sizeof(sp_rec_hdr_t)) return -1;
+    memcpy(hdr, s_cons_rec, sizeof(*hdr));
+    return (int)(n - sizeof(*hdr));
+}
+
+static void utt_release(int slot)
+{
+    sp_utt_t *u = &s_utts[slot];
+    ESP_LOGI(TAG, "Utterance #%lu %.36s %s", (unsigned long)u->seq, u->msg_id,
+             u->state == UTT_FAILED ? "failed" : "done");
+    u->state = UTT_FREE;
+}
+
+// Point the reader (and the engine, via src->codec) at a new utterance.  Only
+// MP3 is captured for the audio cache: it stores a byte stream, and Opus
+// cannot be decoded without its packet boundaries.
+static void reader_start(audio_src_t *src, sp_reader_t *r, int slot)
+{
+    r->slot    = slot;
+    src->codec = s_utts[slot].codec;
+    if (src->codec == AUDIO_CODEC_MP3) {
+        audio_cache_capture_begin(s_utts[slot].msg_id);
+    } else {
+        audio_cache_capture_end(true);   // commits a preceding MP3 utterance
+    }
+}
+
+// Current utterance is over.  If the server already queued the next one, hand
+// over gaplessly; otherwise end the playback session.
+static int reader_finish(audio_src_t *src, sp_reader_t *r, bool failed)
+{
+    // A gap in the bytes makes the capture worthless; a clean end is committed
+    // by the engine (or continued, if the next utterance has the same ID)
+    if (failed || s_utts[r->slot].dropped) audio_cache_capture_end(false);
+    utt_release(r->slot);
+    r->slot = -1;
+
+    sp_rec_hdr_t hdr;
+    while (queue_recv(&hdr, 0) >= 0) {
+        if (hdr.type == SP_REC_START) {
+            reader_start(src, r, hdr.slot);
+            ESP_LOGI(TAG, "Gapless hand-over to #%lu %.36s",
+                     (unsigned long)s_utts[r->slot].seq, s_utts[r->slot].msg_id);
+            return AUDIO_SRC_NEXT;
+        }
+        if (hdr.type != SP_REC_DATA) utt_release(hdr.slot);   // tail of a dropped one
+    }
+    return failed ? AUDIO_SRC_ERR : AUDIO_SRC_EOF;
+}
+
+static int sp_read(audio_src_t *src, uint8_t *dst, size_t max)
+{
+    sp_reader_t *r = src->u.custom.ctx;
+
+    while (r->rec_pos == r->rec_len) {
+        if (r->slot < 0) return AUDIO_SRC_EOF;
+
+        sp_rec_hdr_t hdr;
+        int len = queue_recv(&hdr, pdMS_TO_TICKS(SP_POLL_MS));
+        if (len < 0) {
+            // Queue drained: an utterance closed while its END record did not
+            // fit still ends here
+            utt_state_t st = s_utts[r->slot].state;
+            if (st == UTT_OPEN) return 0;
+            return reader_finish(src, r, st == UTT_FAILED);
+        }
+
+        switch (hdr.type) {
+        case SP_REC_DATA:
+            if (hdr.slot == r->slot) {
+                r->rec_len  = (size_t)len;
+                r->rec_pos  = 0;
+                r->rec_lost = hdr.lost;
+            }
+            break;
+        case SP_REC_START:
+            // Previous utterance's END was lost; this one follows it directly
+            if (s_utts[r->slot].state != UTT_ENDED || s_utts[r->slot].dropped)
+                audio_cache_capture_end(false);
+            utt_release(r->slot);
+            reader_start(src, r, hdr.slot);
+            ESP_LOGI(TAG, "Gapless hand-over to #%lu %.36s",
+                     (unsigned long)s_utts[r->slot].seq, s_utts[r->slot].msg_id);
+            return AUDIO_SRC_NEXT;
+        default:   // END / ERROR
+            if (hdr.slot == r->slot) return reader_finish(src, r, hdr.type == SP_REC_ERROR);
+            utt_release(hdr.slot);
+            break;
+        }
+    }
+
+    size_t n = r->rec_len - r->rec_pos;
+    if (n > max) n = max;
+    memcpy(dst, s_cons_rec + sizeof(sp_rec_hdr_t) + r->rec_pos, n);
+    r->rec_pos += n;
+    src->lost   = r->rec_lost;   // Opus: a record is one packet, n == rec_len
+    r->rec_lost = 0;
+    return (int)n;
+}
+
+// Closed slots whose records are all consumed (closing record lost to a full
+// queue) — only called while the queue is empty.
+static void reap_closed_utterances(void)
+{
+    for (int i = 0; i < SP_MAX_UTTERANCES; i++) {
+        if (s_utts[i].state == UTT_ENDED || s_utts[i].state == UTT_FAILED) {
+            utt_release(i);
+        }
+    }
+}
 
 static void sp_decode_task(void *arg)
 {
     while (1) {
-        // Block until data arrives in the stream buffer
-        uint8_t peek;
-        size_t got = xStreamBufferReceive(s_sp_stream, &peek, 1,
-                                           pdMS_TO_TICKS(5000));
-        if (got == 0) continue;
+        // Block until the next utterance starts; anything else here is the
+        // remainder of an utterance that was skipped or stopped
+        sp_rec_hdr_t hdr;
+        if (queue_recv(&hdr, pdMS_TO_TICKS(5000)) < 0) {
+            reap_closed_utterances();
+            continue;
+        }
+        if (hdr.type == SP_REC_END || hdr.type == SP_REC_ERROR) {
+            utt_release(hdr.slot);
+            continue;
+        }
+        if (hdr.type != SP_REC_START) continue;
+
+        sp_utt_t *u = &s_utts[hdr.slot];
 
-        // Check guards
+        // Check guards — the skipped utterance's records drain through here
         EventBits_t bits = xEventGroupGetBits(g_events);
         if (bits & EVT_AUDIO_RECORDING) {
-            ESP_LOGW(TAG, "Recording in progress, discarding stream");
-            while (s_stream_active || xStreamBufferBytesAvailable(s_sp_stream) > 0) {
-                uint8_t discard[256];
-                xStreamBufferReceive(s_sp_stream, discard, sizeof(discard),
-                                      pdMS_TO_TICKS(100));
-            }
+            ESP_LOGW(TAG, "Recording in progress, discarding %.36s", u->msg_id);
+            xEventGroupClearBits(g_events, EVT_STREAM_PLAYING);
+            continue;
+        }
+        if ((int32_t)(u->seq - s_skip_seq) < 0) {
+            ESP_LOGI(TAG, "Barge-in, skipping #%lu %.36s", (unsigned long)u->seq, u->msg_id);
             xEventGroupClearBits(g_events, EVT_STREAM_PLAYING);
             continue;
         }
 
-        ESP_LOGI(TAG, "Starting stream playback for %.36s", s_current_msg_id);
-        audio_stream_play(s_sp_stream, &s_stream_active, &s_stream_error, peek);
+        ESP_LOGI(TAG, "Starting stream playback with #%lu %.36s",
+                 (unsigned long)u->seq, u->msg_id);
+        s_reader = (sp_reader_t){};
+        audio_src_t src = { .read = sp_read, .u.custom.ctx = &s_reader };
+        reader_start(&src, &s_reader, hdr.slot);
+        if (!audio_stream_play(&src, u->requested_us)) audio_cache_capture_end(false);
         xEventGroupClearBits(g_events, EVT_STREAM_PLAYING);
-        ESP_LOGI(TAG, "Stream playback finished for %.36s", s_current_msg_id);
+        ESP_LOGI(TAG, "Stream playback finished");
     }
 }
 
@@ -194,19 +525,11 @@ static void sp_decode_task(void *arg)
 
 static StaticTask_t s_connect_tcb;
 
-static void sp_connect_task(void *arg)
+// Caller holds s_ws_lock
+static void ws_start(const char *chat_id)
 {
-    xEventGroupWaitBits(g_events, EVT_DOLL_READY | EVT_IMAGES_DONE,
-                        pdFALSE, pdTRUE, portMAX_DELAY);
-
-    if (strlen(g_config.chat_id) == 0) {
-        ESP_LOGW(TAG, "No chat linked — stream-player disabled");
-        vTaskDelete(NULL);
-        return;
-    }
-
     char url[384];
-    build_ws_player_url(url, sizeof(url));
+    build_ws_player_url(url, sizeof(url), chat_id);
 
     esp_websocket_client_config_t ws_cfg = {
         .uri                    = url,
@@ -222,19 +545,60 @@ static void sp_connect_task(void *arg)
         ws_cfg.crt_bundle_attach = esp_crt_bundle_attach;
     }
 
+    // Queue for room to handshake here, on the caller's task, not on the WS
+    // task where stopping the client would have to wait it out
+    if (!mem_budget_conn_begin(MEM_USER_PLAYER, SP_MEM_WAIT_MS)) {
+        ESP_LOGW(TAG, "Connecting without a memory reservation");
+    }
+
     s_ws_client = esp_websocket_client_init(&ws_cfg);
-    esp_websocket_register_events(s_ws_client, WEBSOCKET_EVENT_ANY,
-                                   sp_ws_event_handler, NULL);
-    esp_websocket_client_start(s_ws_client);
-    ESP_LOGI(TAG, "Connecting to stream-player (chatId=%.36s)", g_config.chat_id);
+    if (s_ws_client) {
+        esp_websocket_register_events(s_ws_client, WEBSOCKET_EVENT_ANY,
+                                       sp_ws_event_handler, NULL);
+        if (esp_websocket_client_start(s_ws_client) == ESP_OK) return;
+        esp_websocket_client_destroy(s_ws_client);
+        s_ws_client = NULL;
+    }
+    ESP_LOGE(TAG, "WS client failed to start");
+    mem_budget_conn_end(MEM_USER_PLAYER);
+}
 
-    // Start decode task (PSRAM stack, Core 0 for audio decode)
+// Caller holds s_ws_lock
+static void ws_stop(void)
+{
+    esp_websocket_client_stop(s_ws_client);
+    esp_websocket_client_destroy(s_ws_client);
+    s_ws_client = NULL;
+    xEventGroupClearBits(g_events, EVT_STREAM_CONNECTED);
+    mem_budget_conn_end(MEM_USER_PLAYER);
+}
+
+static void sp_connect_task(void *arg)
+{
+    xEventGroupWaitBits(g_events, EVT_DOLL_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    // Start decode task (PSRAM stack, same core as the other audio decoder);
+    // also without a chat, in case the doll profile links one later
     static StaticTask_t s_dec_tcb;
     StackType_t *dec_stack = heap_caps_malloc(32768,
                                               MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     assert(dec_stack);
     xTaskCreateStaticPinnedToCore(sp_decode_task, "sp_decode",
-        32768 / sizeof(StackType_t), NULL, 5, dec_stack, &s_dec_tcb, 0);
+        32768 / sizeof(StackType_t), NULL, 5, dec_stack, &s_dec_tcb,
+        AUDIO_DECODE_CORE);
+
+    char chat_id[CONFIG_CHAT_ID_MAX];
+    config_get_id(CONFIG_ID_CHAT, chat_id, sizeof(chat_id));
+    if (strlen(chat_id) == 0) {
+        ESP_LOGW(TAG, "No chat linked — stream-player idle");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    xSemaphoreTake(s_ws_lock, portMAX_DELAY);
+    if (!s_ws_client) ws_start(chat_id);
+    xSemaphoreGive(s_ws_lock);
+    ESP_LOGI(TAG, "Connecting to stream-player (chatId=%.36s)", chat_id);
 
     vTaskDelete(NULL);
 }
@@ -243,13 +607,21 @@ static void sp_connect_task(void *arg)
 
 void stream_player_init(void)
 {
-    // Allocate stream buffer in PSRAM
-    s_sp_stream_storage = heap_caps_malloc(SP_STREAM_BUF_SIZE + 1,
-                                           MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    assert(s_sp_stream_storage);
-    s_sp_stream = xStreamBufferCreateStatic(SP_STREAM_BUF_SIZE, 1,
-                                             s_sp_stream_storage,
-                                             &s_sp_stream_struct);
+    // Allocate utterance queue and record buffers in PSRAM
+    s_sp_queue_storage = heap_caps_malloc(SP_QUEUE_BYTES + 1,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_prod_rec         = heap_caps_malloc(SP_REC_MAX_BYTES,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_cons_rec         = heap_caps_malloc(SP_REC_MAX_BYTES,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_mux_tx           = heap_caps_malloc(1 + STREAM_MUX_MSG_MAX,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    assert(s_sp_queue_storage && s_prod_rec && s_cons_rec && s_mux_tx);
+    s_sp_queue = xMessageBufferCreateStatic(SP_QUEUE_BYTES, s_sp_queue_storage,
+                                            &s_sp_queue_struct);
+
+    s_ws_lock = xSemaphoreCreateMutex();
+    assert(s_ws_lock);
 
     // Spawn connect task (PSRAM stack)
     StackType_t *stack = heap_caps_malloc(4096,
@@ -261,41 +633,89 @@ void stream_player_init(void)
     ESP_LOGI(TAG, "Stream-player module initialized");
 }
 
+// The utterance being played is stopped by the caller (audio_stop()); the rest
+// of the reply already queued drains through the decode task unplayed
+void stream_player_skip(void)
+{
+    s_skip_seq = s_utt_seq;
+    ESP_LOGI(TAG, "Skipping queued utterances before #%lu", (unsigned long)s_skip_seq);
+}
+
+void stream_player_start_attach(stream_start_cb_t cb)
+{
+    s_start_cb = cb;
+}
+
 void stream_player_pause(void)
 {
+    // Multiplexed there is no second connection to make room for, and this
+    // one carries the recording
+    if (s_mux) return;
+    xSemaphoreTake(s_ws_lock, portMAX_DELAY);
     if (s_ws_client) {
-        esp_websocket_client_stop(s_ws_client);
-        esp_websocket_client_destroy(s_ws_client);
-        s_ws_client = NULL;
+        ws_stop();
         ESP_LOGI(TAG, "Paused (destroyed WS client to free TLS memory)");
     }
+    xSemaphoreGive(s_ws_lock);
 }
 
 void stream_player_resume(void)
 {
-    if (s_ws_client) return;              // already running
-    if (strlen(g_config.chat_id) == 0) return;
+    char chat_id[CONFIG_CHAT_ID_MAX];
+    config_get_id(CONFIG_ID_CHAT, chat_id, sizeof(chat_id));
+    xSemaphoreTake(s_ws_lock, portMAX_DELAY);
+    // Not already running, and linked to a chat
+    if (!s_ws_client && strlen(chat_id) > 0) {
+        ws_start(chat_id);
+        ESP_LOGI(TAG, "Resumed (recreated WS client, reconnecting)");
+    }
+    xSemaphoreGive(s_ws_lock);
+}
 
-    char url[384];
-    build_ws_player_url(url, sizeof(url));
+void stream_player_chat_changed(const char *chat_id)
+{
+    if (!(xEventGroupGetBits(g_events) & EVT_DOLL_READY)) return;   // not started yet
+    xSemaphoreTake(s_ws_lock, portMAX_DELAY);
+    if (s_ws_client) ws_stop();
+    if (strlen(chat_id) > 0) {
+        ws_start(chat_id);
+        ESP_LOGI(TAG, "Chat changed, reconnecting (chatId=%.36s)", chat_id);
+    } else {
+        ESP_LOGI(TAG, "Chat unlinked, disconnected");
+    }
+    xSemaphoreGive(s_ws_lock);
+}
 
-    esp_websocket_client_config_t ws_cfg = {
-        .uri                    = url,
-        .buffer_size            = 4096,
-        .disable_auto_reconnect = false,
-        .reconnect_timeout_ms   = 5000,
-        .pingpong_timeout_sec   = 30,
-        .task_stack             = 8192,
-        .task_prio              = 3,
-    };
+// ── Single-connection mode ──────────────────────────────────────────────────
 
-    if (strncmp(url, "wss://", 6) == 0) {
-        ws_cfg.crt_bundle_attach = esp_crt_bundle_attach;
-    }
+bool stream_player_mux_ready(void)
+{
+    return s_mux && s_ws_client &&
+           (xEventGroupGetBits(g_events) & EVT_STREAM_CONNECTED);
+}
 
-    s_ws_client = esp_websocket_client_init(&ws_cfg);
-    esp_websocket_register_events(s_ws_client, WEBSOCKET_EVENT_ANY,
-                                   sp_ws_event_handler, NULL);
-    esp_websocket_client_start(s_ws_client);
-    ESP_LOGI(TAG, "Resumed (recreated WS client, reconnecting)");
+void stream_player_mux_attach(stream_mux_rec_cb_t cb)
+{
+    s_mux_rec_cb = cb;
+}
+
+int stream_player_mux_send(stream_ch_t ch, const void *data, size_t len, uint32_t timeout_ms)
+{
+    if (!s_mux || !s_ws_client || len > STREAM_MUX_MSG_MAX) return -1;
+    s_mux_tx[0] = (uint8_t)ch;
+    memcpy(s_mux_tx + 1, data, len);
+    return esp_websocket_client_send_bin(s_ws_client, (const char *)s_mux_tx, (int)len + 1,
+                                         pdMS_TO_TICKS(timeout_ms));
+}
+
+// json is one object; the channel goes in as its first member
+int stream_player_mux_send_text(stream_ch_t ch, const char *json, int len, uint32_t timeout_ms)
+{
+    if (!s_mux || !s_ws_client || len < 2 || json[0] != '{') return -1;
+    char buf[256];
+    int  n = snprintf(buf, sizeof(buf), "{\"ch\":\"%s\"%s%.*s",
+                      ch == STREAM_CH_REC ? "rec" : "play",
+                      json[1] == '}' ? "" : ",", len - 1, json + 1);
+    if (n >= (int)sizeof(buf)) return -1;
+    return esp_websocket_client_send_text(s_ws_client, buf, n, pdMS_TO_TICKS(timeout_ms));
 }
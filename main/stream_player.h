@@ -1,5 +1,40 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 void stream_player_init(void);
 void stream_player_pause(void);   // disconnect WS to free TLS memory for recording
 void stream_player_resume(void);  // reconnect WS after recording
+void stream_player_skip(void);    // barge-in: drop every utterance received so far
+void stream_player_chat_changed(const char *chat_id);   // chat changed: reconnect (or stop)
+
+// Called on the WS task at each tts_start; returning false drops that
+// utterance (its message is already playing another way, see mqtt.c).
+// *requested_us holds the tts_start's esp_timer time; the hook moves it back
+// to the MQTT play that asked for the message, when that arrived first.
+typedef bool (*stream_start_cb_t)(const char *msg_id, int64_t *requested_us);
+void stream_player_start_attach(stream_start_cb_t cb);
+
+// ── Single-connection mode ───────────────────────────────────────────────────
+// When the server accepts the mux=1 offer on /ws-player, that one socket also
+// carries the recorder's turns (record.c).  Binary frames start with a
+// channel byte; text frames carry "ch":"play" / "ch":"rec" (none: play).
+
+typedef enum {
+    STREAM_CH_PLAY = 1,   // TTS down (tts_start / audio / tts_end)
+    STREAM_CH_REC  = 2,   // microphone turn up, codec answer down
+} stream_ch_t;
+
+#define STREAM_MUX_MSG_MAX  4096   // largest payload stream_player_mux_send takes
+
+// Recorder-channel text from the server (WS task); NULL when the link drops
+typedef void (*stream_mux_rec_cb_t)(const char *json, int len);
+
+bool stream_player_mux_ready(void);
+void stream_player_mux_attach(stream_mux_rec_cb_t cb);
+
+// Record task only.  <0 when the link is not (or no longer) multiplexed.
+int  stream_player_mux_send(stream_ch_t ch, const void *data, size_t len, uint32_t timeout_ms);
+int  stream_player_mux_send_text(stream_ch_t ch, const char *json, int len, uint32_t timeout_ms);
@@ -0,0 +1,265 @@
+#include "time_sync.h"
+#include "events.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_sntp.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+static const char *TAG = "time_sync";
+
+#define TIME_SYNC_NVS_NS        "time"
+#define TIME_SYNC_SAVE_MS       (60 * 60 * 1000)   // last trusted time to NVS, hourly
+#define TIME_SYNC_RTC_PPM       50000              // RC slow clock, worst case 5%
+#define TIME_SYNC_MAX_ERR_S     (6 * 60 * 60)      // RTC trusted within this
+#define TIME_SYNC_HTTP_STEP_S   2                  // Date header: 1 s resolution
+#define TIME_SYNC_STACK         3072               // internal RAM: writes NVS
+#ifndef TIME_SYNC_NTP_SERVER
+#define TIME_SYNC_NTP_SERVER    "pool.ntp.org"
+#endif
+
+#define RTC_MAGIC               0x54494D45u        // "TIME"
+
+// Survive deep sleep and software resets, like the clock itself
+static RTC_DATA_ATTR uint32_t s_rtc_magic;
+static RTC_DATA_ATTR int64_t  s_rtc_synced;        // epoch s of the last trusted sync
+
+static portMUX_TYPE       s_lock = portMUX_INITIALIZER_UNLOCKED;
+static time_src_t         s_src;
+static int64_t            s_anchor_mono_us;        // esp_timer and epoch when the clock
+static int64_t            s_anchor_epoch_us;       // was last set: what "now" should be
+static TaskHandle_t       s_saver;
+static time_sync_stats_t  s_stats;
+
+static uint32_t uptime_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// ── Calendar ─────────────────────────────────────────────────────────────────
+
+static int month_index(const char *mon)
+{
+    static const char k_months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char *p = strstr(k_months, mon);
+    if (!p || strlen(mon) != 3 || (p - k_months) % 3) return -1;   // not "anF"
+    return (int)(p - k_months) / 3;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date (month 0..11); no
+// timegm() in newlib, and mktime() would depend on TZ
+static int64_t days_from_civil(int y, int m, int d)
+{
+    m += 1;
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int     yoe = (int)(y - era * 400);
+    int     doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int     doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static int month_days(int y, int m)
+{
+    return m == 11 ? 31 : (int)(days_from_civil(y, m + 1, 1) - days_from_civil(y, m, 1));
+}
+
+static int64_t to_epoch(int y, int mon, int d, int hh, int mm, int ss)
+{
+    return days_from_civil(y, mon, d) * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
+// __DATE__ "Oct 16 2026", __TIME__ "14:03:59"; local time of the build
+// host, hours off at most
+static int64_t build_epoch(void)
+{
+    char mon[4];
+    int d, y, hh, mm, ss;
+    if (sscanf(__DATE__, "%3s %d %d", mon, &d, &y) != 3) return 0;
+    if (sscanf(__TIME__, "%d:%d:%d", &hh, &mm, &ss) != 3) return 0;
+    int m = month_index(mon);
+    return m < 0 ? 0 : to_epoch(y, m, d, hh, mm, ss);
+}
+
+// ── Clock ────────────────────────────────────────────────────────────────────
+
+static int64_t now_epoch_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void anchor(int64_t epoch_us)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_anchor_mono_us  = esp_timer_get_time();
+    s_anchor_epoch_us = epoch_us;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static void set_clock(int64_t epoch_us)
+{
+    struct timeval tv = { .tv_sec = epoch_us / 1000000, .tv_usec = epoch_us % 1000000 };
+    settimeofday(&tv, NULL);
+    anchor(epoch_us);
+}
+
+// The clock now reads epoch_us, from a trusted source
+static void trusted(time_src_t src, int64_t epoch_us)
+{
+    taskENTER_CRITICAL(&s_lock);
+    int64_t expected = s_anchor_epoch_us + (esp_timer_get_time() - s_anchor_mono_us);
+    bool first = !s_stats.trusted_ms;
+    s_src = src;
+    if (first) {
+        s_stats.trusted_ms = uptime_ms();
+        s_stats.step_ms    = (int32_t)((epoch_us - expected) / 1000);
+    }
+    if (src == TIME_SRC_SNTP && !s_stats.sntp_ms) s_stats.sntp_ms = uptime_ms();
+    taskEXIT_CRITICAL(&s_lock);
+
+    s_rtc_synced = epoch_us / 1000000;
+    s_rtc_magic  = RTC_MAGIC;
+    anchor(epoch_us);
+
+    if (first) {
+        ESP_LOGI(TAG, "Clock trusted (%s), %+ld ms from the restored %s time",
+                 time_src_name(src), (long)s_stats.step_ms, time_src_name(s_stats.restored));
+        xEventGroupSetBits(g_events, EVT_TIME_SYNCED);
+        if (s_saver) xTaskNotifyGive(s_saver);
+    }
+}
+
+// ── Restore ──────────────────────────────────────────────────────────────────
+
+static int64_t nvs_epoch(void)
+{
+    nvs_handle_t h;
+    int64_t t = 0;
+    if (nvs_open(TIME_SYNC_NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        nvs_get_i64(h, "epoch", &t);
+        nvs_close(h);
+    }
+    return t;
+}
+
+void time_sync_restore(void)
+{
+    int64_t now   = now_epoch_us() / 1000000;
+    int64_t floor = build_epoch();
+
+    // The clock ran on through deep sleep or a reset: trusted if the
+    // drift since the last sync can't have reached TIME_SYNC_MAX_ERR_S
+    if (s_rtc_magic == RTC_MAGIC && now >= s_rtc_synced && now >= floor) {
+        int64_t err = (now - s_rtc_synced) * TIME_SYNC_RTC_PPM / 1000000;
+        s_stats.restored = s_src = TIME_SRC_RTC;
+        anchor(now_epoch_us());
+        ESP_LOGI(TAG, "RTC clock kept, ±%lld s", (long long)err);
+        if (err <= TIME_SYNC_MAX_ERR_S) {
+            s_stats.trusted_ms = uptime_ms();
+            xEventGroupSetBits(g_events, EVT_TIME_SYNCED);
+        }
+        return;
+    }
+
+    // Power was lost: a lower bound is the best there is, and enough for
+    // certificate dates unless one was issued while the doll was off
+    int64_t saved = nvs_epoch();
+    time_src_t src = saved > floor ? TIME_SRC_NVS : TIME_SRC_BUILD;
+    int64_t t = saved > floor ? saved : floor;
+    if (t > now) {
+        set_clock(t * 1000000);
+        s_stats.restored = s_src = src;
+        ESP_LOGI(TAG, "Clock set from %s to %lld (lower bound)", time_src_name(src), (long long)t);
+    } else {
+        anchor(now_epoch_us());
+    }
+}
+
+// ── Background refinement ───────────────────────────────────────────────────
+
+static void on_sntp(struct timeval *tv)
+{
+    trusted(TIME_SRC_SNTP, (int64_t)tv->tv_sec * 1000000 + tv->tv_usec);
+}
+
+void time_sync_http_date(const char *date)
+{
+    if (s_src == TIME_SRC_SNTP || !date) return;
+
+    char mon[4];
+    int d, y, hh, mm, ss;
+    if (sscanf(date, "%*3s, %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6) return;
+    int m = month_index(mon);
+    if (m < 0 || y < 1970 || y > 9999 || d < 1 || d > month_days(y, m) ||
+        hh < 0 || hh > 23 || mm < 0 || mm > 59 || ss < 0 || ss > 60) {
+        return;
+    }
+
+    int64_t t = to_epoch(y, m, d, hh, mm, ss);
+    int64_t diff = t - now_epoch_us() / 1000000;
+    if (s_src == TIME_SRC_HTTP && diff > -TIME_SYNC_HTTP_STEP_S && diff < TIME_SYNC_HTTP_STEP_S) return;
+
+    set_clock(t * 1000000);
+    trusted(TIME_SRC_HTTP, t * 1000000);
+}
+
+// Keeps NVS within an hour of the truth, for the next cold boot
+static void saver_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TIME_SYNC_SAVE_MS));
+        if (s_src < TIME_SRC_HTTP) continue;
+
+        nvs_handle_t h;
+        if (nvs_open(TIME_SYNC_NVS_NS, NVS_READWRITE, &h) != ESP_OK) continue;
+        nvs_set_i64(h, "epoch", now_epoch_us() / 1000000);
+        if (nvs_commit(h) == ESP_OK) s_stats.saves++;
+        nvs_close(h);
+    }
+}
+
+void time_sync_start(void)
+{
+    xTaskCreatePinnedToCore(saver_task, "time_save", TIME_SYNC_STACK, NULL, 1, &s_saver, 1);
+    if (s_src >= TIME_SRC_HTTP) xTaskNotifyGive(s_saver);
+
+    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, TIME_SYNC_NTP_SERVER);
+    sntp_set_time_sync_notification_cb(on_sntp);
+    esp_sntp_init();
+}
+
+// ── Queries ──────────────────────────────────────────────────────────────────
+
+bool time_sync_trusted(void)
+{
+    return xEventGroupGetBits(g_events) & EVT_TIME_SYNCED;
+}
+
+bool time_sync_wait(uint32_t timeout_ms)
+{
+    return xEventGroupWaitBits(g_events, EVT_TIME_SYNCED, pdFALSE, pdTRUE,
+                               pdMS_TO_TICKS(timeout_ms)) & EVT_TIME_SYNCED;
+}
+
+const char *time_src_name(time_src_t src)
+{
+    static const char *const k_names[] = { "none", "build", "nvs", "rtc", "http", "sntp" };
+    return (unsigned)src < sizeof(k_names) / sizeof(k_names[0]) ? k_names[src] : "?";
+}
+
+void time_sync_get_stats(time_sync_stats_t *out)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    out->source = s_src;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Wall-clock time for TLS certificate checks, without waiting on SNTP.
+//
+// HTTPS used to wait up to 10 s for pool.ntp.org on every boot, and for
+// the full 10 s on networks that block NTP.  Now time_sync_restore() sets
+// the clock before the network is up, from the best source on hand:
+//   - RTC: the system clock kept running through deep sleep or a reset.
+//     Its error is bounded by TIME_SYNC_RTC_PPM times the time since the
+//     last trusted sync.
+//   - NVS: the last trusted time, saved hourly.  This is only a lower
+//     bound, because the power-off time is unknown.
+//   - Build: the firmware's build date, also a lower bound.
+// Certificates are valid for months, so a lower bound is normally enough.
+// The first HTTPS response's Date header then corrects the clock to the
+// second, and SNTP refines it in the background.  If a request fails
+// before the clock is trusted, time_sync_wait() waits for either source.
+
+typedef enum {
+    TIME_SRC_NONE,
+    TIME_SRC_BUILD,
+    TIME_SRC_NVS,
+    TIME_SRC_RTC,
+    TIME_SRC_HTTP,     // Date header of an HTTPS response
+    TIME_SRC_SNTP,
+} time_src_t;
+
+typedef struct {
+    time_src_t source;        // current
+    time_src_t restored;      // what time_sync_restore() found
+    int32_t    step_ms;       // first trusted correction of the restored clock
+    uint32_t   trusted_ms;    // ms since boot when the clock became trusted, 0 until then
+    uint32_t   sntp_ms;       // ms since boot of the first SNTP sync, 0 until then
+    uint32_t   saves;         // NVS writes
+} time_sync_stats_t;
+
+// Before the network: NVS must be initialised
+void time_sync_restore(void);
+
+// Once Wi-Fi is up: SNTP in the background, and the hourly save
+void time_sync_start(void);
+
+// Date header value ("Sun, 06 Nov 1994 08:49:37 GMT") of an HTTPS response
+void time_sync_http_date(const char *date);
+
+// Trusted: SNTP, a Date header, or the RTC within TIME_SYNC_MAX_ERR_S
+bool time_sync_trusted(void);
+bool time_sync_wait(uint32_t timeout_ms);
+
+const char *time_src_name(time_src_t src);    // "sntp", "http", ...
+void time_sync_get_stats(time_sync_stats_t *out);
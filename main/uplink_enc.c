@@ -0,0 +1,219 @@
+#include "uplink_enc.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "opus.h"
+#include <string.h>
+
+static const char *TAG = "uplink";
+
+static uplink_codec_t s_codec;
+static OpusEncoder   *s_opus;
+
+// IMA-ADPCM predictor state, carried across blocks (each block header
+// re-seeds it, so a decoder can start at any block)
+static int s_adpcm_pred;
+static int s_adpcm_index;
+
+// ── IMA-ADPCM ────────────────────────────────────────────────────────────────
+
+static const int16_t s_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767,
+};
+
+static const int8_t s_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+static uint8_t adpcm_nibble(int sample)
+{
+    int step = s_step_table[s_adpcm_index];
+    int diff = sample - s_adpcm_pred;
+    uint8_t code = 0;
+    if (diff < 0) { code = 8; diff = -diff; }
+
+    // Quantise, reconstructing exactly as the decoder will
+    int delta = step >> 3;
+    if (diff >= step)        { code |= 4; diff -= step;        delta += step; }
+    if (diff >= (step >> 1)) { code |= 2; diff -= step >> 1;   delta += step >> 1; }
+    if (diff >= (step >> 2)) { code |= 1;                      delta += step >> 2; }
+
+    s_adpcm_pred += (code & 8) ? -delta : delta;
+    if (s_adpcm_pred >  32767) s_adpcm_pred =  32767;
+    if (s_adpcm_pred < -32768) s_adpcm_pred = -32768;
+
+    s_adpcm_index += s_index_table[code];
+    if (s_adpcm_index < 0)  s_adpcm_index = 0;
+    if (s_adpcm_index > 88) s_adpcm_index = 88;
+    return code;
+}
+
+// Microsoft IMA-ADPCM mono block: {s16 first sample, u8 step index, u8 0},
+// then the remaining samples as nibbles, low nibble first
+static int adpcm_encode_block(const int16_t *pcm, uint8_t *out)
+{
+    s_adpcm_pred = pcm[0];
+    out[0] = (uint8_t)(pcm[0] & 0xFF);
+    out[1] = (uint8_t)((uint16_t)pcm[0] >> 8);
+    out[2] = (uint8_t)s_adpcm_index;
+    out[3] = 0;
+    for (int i = 1, o = 4; i < UPLINK_ADPCM_SAMPLES; i += 2, o++) {
+        uint8_t lo = adpcm_nibble(pcm[i]);
+        uint8_t hi = adpcm_nibble(pcm[i + 1]);
+        out[o] = lo | (hi << 4);
+    }
+    return UPLINK_ADPCM_BLOCK;
+}
+
+// ── WAV headers ──────────────────────────────────────────────────────────────
+// A streamed recording's length is unknown up front: RIFF and data sizes are
+// 0xFFFFFFFF, the usual marker for "read to end of stream".
+
+#define WAV_SIZE_UNKNOWN    0xFFFFFFFFu
+
+typedef struct __attribute__((packed)) {
+    char     riff[4];           // "RIFF"
+    uint32_t file_size;         // total file size - 8 (unknown when streaming)
+    char     wave[4];           // "WAVE"
+    char     fmt_id[4];         // "fmt "
+    uint32_t fmt_size;          // 16 (PCM) / 20 (IMA-ADPCM)
+    uint16_t audio_format;      // 1 = PCM, 0x11 = IMA-ADPCM
+    uint16_t channels;          // 1
+    uint32_t sample_rate;       // 16000
+    uint32_t byte_rate;
+    uint16_t block_align;       // bytes per sample frame / ADPCM block
+    uint16_t bits_per_sample;   // 16 / 4
+} wav_fmt_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t cb_size;           // 2
+    uint16_t samples_per_block;
+} wav_ima_ext_t;
+
+typedef struct __attribute__((packed)) {
+    char     data_id[4];        // "data"
+    uint32_t data_size;         // unknown when streaming
+} wav_data_t;
+
+size_t uplink_enc_header(uint8_t *out, size_t out_max)
+{
+    if (s_codec == UPLINK_CODEC_OPUS) return 0;
+
+    bool   ima = (s_codec == UPLINK_CODEC_ADPCM);
+    size_t len = sizeof(wav_fmt_t) + (ima ? sizeof(wav_ima_ext_t) : 0) + sizeof(wav_data_t);
+    if (len > out_max) return 0;
+
+    wav_fmt_t f = {
+        .file_size    = WAV_SIZE_UNKNOWN,
+        .fmt_size     = ima ? 20 : 16,
+        .audio_format = ima ? 0x11 : 1,
+        .channels     = 1,
+        .sample_rate  = UPLINK_SAMPLE_RATE,
+        .byte_rate    = ima ? UPLINK_SAMPLE_RATE * UPLINK_ADPCM_BLOCK / UPLINK_ADPCM_SAMPLES
+                            : UPLINK_SAMPLE_RATE * 2,
+        .block_align  = ima ? UPLINK_ADPCM_BLOCK : 2,
+        .bits_per_sample = ima ? 4 : 16,
+    };
+    memcpy(f.riff,   "RIFF", 4);
+    memcpy(f.wave,   "WAVE", 4);
+    memcpy(f.fmt_id, "fmt ", 4);
+    wav_data_t d = { .data_size = WAV_SIZE_UNKNOWN };
+    memcpy(d.data_id, "data", 4);
+
+    uint8_t *p = out;
+    memcpy(p, &f, sizeof(f)); p += sizeof(f);
+    if (ima) {
+        wav_ima_ext_t x = { .cb_size = 2, .samples_per_block = UPLINK_ADPCM_SAMPLES };
+        memcpy(p, &x, sizeof(x)); p += sizeof(x);
+    }
+    memcpy(p, &d, sizeof(d));
+    return len;
+}
+
+// ── Public API ───────────────────────────────────────────────────────────────
+
+bool uplink_enc_init(void)
+{
+    // Only used while recording, when the TLS/WiFi heap is busiest — PSRAM
+    int size = opus_encoder_get_size(1);
+    s_opus = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_opus) {
+        ESP_LOGE(TAG, "Opus encoder alloc failed (%d B)", size);
+        return false;
+    }
+    int err = opus_encoder_init(s_opus, UPLINK_SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP);
+    if (err != OPUS_OK) {
+        ESP_LOGE(TAG, "Opus encoder init failed: %s", opus_strerror(err));
+        heap_caps_free(s_opus);
+        s_opus = NULL;
+        return false;
+    }
+    opus_encoder_ctl(s_opus, OPUS_SET_BITRATE(UPLINK_OPUS_BITRATE));
+    opus_encoder_ctl(s_opus, OPUS_SET_COMPLEXITY(UPLINK_OPUS_COMPLEXITY));
+    opus_encoder_ctl(s_opus, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    ESP_LOGI(TAG, "Opus encoder ready (%d B, %d bps)", size, UPLINK_OPUS_BITRATE);
+    return true;
+}
+
+const char *uplink_enc_offer(void)
+{
+    return s_opus ? "opus,adpcm,pcm" : "adpcm,pcm";
+}
+
+void uplink_enc_begin(uplink_codec_t codec)
+{
+    s_codec       = codec;
+    s_adpcm_pred  = 0;
+    s_adpcm_index = 0;
+    if (codec == UPLINK_CODEC_OPUS) opus_encoder_ctl(s_opus, OPUS_RESET_STATE);
+}
+
+const char *uplink_codec_name(uplink_codec_t codec)
+{
+    switch (codec) {
+    case UPLINK_CODEC_ADPCM: return "adpcm";
+    case UPLINK_CODEC_OPUS:  return "opus";
+    default:                 return "pcm";
+    }
+}
+
+bool uplink_codec_parse(const char *name, uplink_codec_t *out)
+{
+    for (uplink_codec_t c = UPLINK_CODEC_PCM; c <= UPLINK_CODEC_OPUS; c++) {
+        if (strcmp(name, uplink_codec_name(c)) == 0) {
+            *out = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t uplink_enc_frame_samples(void)
+{
+    switch (s_codec) {
+    case UPLINK_CODEC_ADPCM: return UPLINK_ADPCM_SAMPLES;
+    case UPLINK_CODEC_OPUS:  return UPLINK_OPUS_SAMPLES;
+    default:                 return 0;
+    }
+}
+
+int uplink_enc_encode(const int16_t *pcm, uint8_t *out, size_t out_max)
+{
+    switch (s_codec) {
+    case UPLINK_CODEC_ADPCM:
+        if (out_max < UPLINK_ADPCM_BLOCK) return -1;
+        return adpcm_encode_block(pcm, out);
+    case UPLINK_CODEC_OPUS: {
+        int n = opus_encode(s_opus, pcm, UPLINK_OPUS_SAMPLES, out, (opus_int32)out_max);
+        if (n < 0) ESP_LOGW(TAG, "Opus encode failed: %s", opus_strerror(n));
+        return n;
+    }
+    default:
+        return -1;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Microphone uplink encoder: sits between record.c's PCM ring (16 kHz mono
+// s16) and the /ws-stream WebSocket.  One encoder, used only by the record
+// task.
+//
+//   PCM    raw s16, behind a streaming WAV header (legacy servers)
+//   ADPCM  IMA-ADPCM in 256-byte WAV blocks (505 samples) — 4:1, near-free
+//   OPUS   one 20 ms packet per WebSocket binary message, no header
+//
+// The codec is negotiated per connection, see record.c.
+
+typedef enum {
+    UPLINK_CODEC_PCM = 0,
+    UPLINK_CODEC_ADPCM,
+    UPLINK_CODEC_OPUS,
+} uplink_codec_t;
+
+#define UPLINK_SAMPLE_RATE      16000
+#define UPLINK_ADPCM_BLOCK      256                             // bytes per block
+#define UPLINK_ADPCM_SAMPLES    ((UPLINK_ADPCM_BLOCK - 4) * 2 + 1)   // 505
+#define UPLINK_OPUS_SAMPLES     (UPLINK_SAMPLE_RATE / 50)       // 20 ms
+#define UPLINK_OPUS_BITRATE     24000
+#define UPLINK_OPUS_COMPLEXITY  3      // keeps encode well under real time on the S3
+#define UPLINK_OPUS_MAX_PACKET  400    // > 20 ms at UPLINK_OPUS_BITRATE with margin
+
+bool        uplink_enc_init(void);
+
+// Codecs this build can encode, in order of preference, for the codec= offer
+// (Opus drops out if its encoder could not be allocated).
+const char *uplink_enc_offer(void);
+
+void        uplink_enc_begin(uplink_codec_t codec);   // start of a recording
+const char *uplink_codec_name(uplink_codec_t codec);
+bool        uplink_codec_parse(const char *name, uplink_codec_t *out);
+
+// PCM samples that make up one encoder frame (0 for PCM: any amount).
+size_t      uplink_enc_frame_samples(void);
+
+// Encode one full frame (uplink_enc_frame_samples() samples) into out.
+// Returns encoded bytes, <0 on encoder failure.
+int         uplink_enc_encode(const int16_t *pcm, uint8_t *out, size_t out_max);
+
+// Stream header to send before the first frame (WAV for PCM / ADPCM with the
+// data size left open, nothing for Opus).  Returns its length.
+size_t      uplink_enc_header(uint8_t *out, size_t out_max);
@@ -0,0 +1,278 @@
+#include "vad.h"
+#include <math.h>
+#include <string.h>
+
+#define ADAPTIVE_FRAME      160     // 10 ms
+#define RMS_FRAME           512     // one reader chunk (32 ms), as the original detector
+#define RMS_END_MS          1500
+
+#define BAND_HZ             1000.0f // speech-band biquad centre ...
+#define BAND_Q              0.5f    // ... ~450–2200 Hz at -3 dB
+
+#define FLOOR_FALL          0.3f    // floor follows quieter frames almost at once
+#define FLOOR_TRACK         0.05f   // noise-like frames pull the floor up smoothly
+#define FLOOR_CREEP_DB      0.05f   // louder non-speech: +5 dB/s (noise got louder)
+#define FLOOR_CREEP_SPEECH  0.01f   // in speech: +1 dB/s, so a noise step cannot hold speech open forever
+
+#define MOD_BLOCK_FRAMES    50      // speech-level modulation measured per 0.5 s ...
+#define MOD_MIN_DB          6.0f    // ... speech swings more than this within a block ...
+#define MOD_FLAT_BLOCKS     3       // ... and 1.5 s without a swing is steady noise, not speech
+
+#define PAUSE_MIN_FRAMES    10      // gaps shorter than 100 ms are not pauses
+#define PAUSE_SMOOTH        0.25f
+#define HANG_PAUSE_MULT     2.0f    // hangover = 2 × typical pause + margin
+#define HANG_MARGIN_MS      200
+
+void vad_config_default(vad_config_t *cfg, vad_engine_t engine)
+{
+    *cfg = (vad_config_t){
+        .engine              = engine,
+        .rms_threshold       = 200,
+        .rms_confirm_frames  = 3,
+        .onset_snr_db        = 12.0f,
+        .stay_snr_db         = 6.0f,
+        .min_level_db        = 30.0f,
+        .zcr_max             = 0.30f,
+        .onset_frames        = 8,
+        .hang_min_ms         = 400,
+        .hang_max_ms         = 1500,
+        .hang_init_ms        = 900,
+        .pause_ms            = 250,
+        .barge_snr_db        = 6.0f,
+        .barge_frames        = 15,
+        .rms_barge_threshold = 400,
+        .rms_barge_frames    = 5,
+    };
+}
+
+const char *vad_engine_name(vad_engine_t engine)
+{
+    return engine == VAD_ENGINE_RMS ? "rms" : "adaptive";
+}
+
+static int frame_ms(const vad_t *v)
+{
+    return v->frame_len * 1000 / VAD_SAMPLE_RATE;
+}
+
+static void update_hangover(vad_t *v)
+{
+    int ms = (int)(HANG_PAUSE_MULT * v->pause_ms) + HANG_MARGIN_MS;
+    if (ms < v->cfg.hang_min_ms) ms = v->cfg.hang_min_ms;
+    if (ms > v->cfg.hang_max_ms) ms = v->cfg.hang_max_ms;
+    v->hang_frames = (ms + frame_ms(v) - 1) / frame_ms(v);
+}
+
+void vad_init(vad_t *v, const vad_config_t *cfg)
+{
+    memset(v, 0, sizeof(*v));
+    v->cfg = *cfg;
+
+    if (cfg->engine == VAD_ENGINE_RMS) {
+        v->frame_len   = RMS_FRAME;
+        v->hang_frames = (RMS_END_MS + frame_ms(v) - 1) / frame_ms(v);
+        return;
+    }
+
+    v->frame_len = ADAPTIVE_FRAME;
+
+    // RBJ band-pass (0 dB peak), transposed direct form II
+    float w0    = 2.0f * (float)M_PI * BAND_HZ / VAD_SAMPLE_RATE;
+    float alpha = sinf(w0) / (2.0f * BAND_Q);
+    float a0    = 1.0f + alpha;
+    v->b0 =  alpha / a0;
+    v->b2 = -alpha / a0;
+    v->a1 = -2.0f * cosf(w0) / a0;
+    v->a2 = (1.0f - alpha) / a0;
+
+    v->pause_ms = (cfg->hang_init_ms - HANG_MARGIN_MS) / HANG_PAUSE_MULT;
+    update_hangover(v);
+}
+
+void vad_rearm(vad_t *v, bool barge_in)
+{
+    v->barge     = barge_in;
+    v->speech    = false;
+    v->paused    = false;
+    v->run       = 0;
+    v->gap       = 0;
+    v->carry_len = 0;
+}
+
+// ── Engines: one frame → is it speech ───────────────────────────────────────
+
+static bool rms_frame(vad_t *v, const int16_t *x)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < v->frame_len; i++) sum += (int32_t)x[i] * x[i];
+    float rms = sqrtf((float)sum / v->frame_len);
+    v->level_db = 20.0f * log10f(rms + 1.0f);
+    v->snr_db   = 0;
+
+    uint16_t thr = (v->barge && !v->speech) ? v->cfg.rms_barge_threshold
+                                            : v->cfg.rms_threshold;
+    return rms > thr;
+}
+
+static bool adaptive_frame(vad_t *v, const int16_t *x)
+{
+    float e = 0, z1 = v->z1, z2 = v->z2, prev = 0;
+    int   crossings = 0;
+    for (int i = 0; i < v->frame_len; i++) {
+        float in = x[i];
+        float y  = v->b0 * in + z1;
+        z1 = -v->a1 * y + z2;
+        z2 = v->b2 * in - v->a2 * y;
+        e += y * y;
+        if ((y < 0) != (prev < 0)) crossings++;
+        prev = y;
+    }
+    v->z1 = z1;
+    v->z2 = z2;
+
+    float level = 10.0f * log10f(e / v->frame_len + 1.0f);
+    float zcr   = (float)crossings / v->frame_len;
+
+    if (!v->floor_init) {
+        v->floor_db   = level;
+        v->floor_init = true;
+    }
+    float snr = level - v->floor_db;
+    v->level_db = level;
+    v->snr_db   = snr;
+
+    float thr = v->speech ? v->cfg.stay_snr_db
+                          : v->cfg.onset_snr_db + (v->barge ? v->cfg.barge_snr_db : 0);
+    bool speech = level >= v->cfg.min_level_db && snr > thr;
+    // Broadband hiss passes the band filter with a high crossing rate; real
+    // speech that marginal is voiced and crosses far less often
+    if (speech && zcr > v->cfg.zcr_max && snr < thr + 6.0f) speech = false;
+
+    // Syllables make speech swing by well over MOD_MIN_DB every few hundred
+    // ms; a fan or hiss that stepped up while the floor was frozen does not
+    if (v->speech) {
+        if (v->mod_frames++ == 0 || level < v->mod_min) v->mod_min = level;
+        if (v->mod_frames == 1   || level > v->mod_max) v->mod_max = level;
+        if (v->mod_frames == MOD_BLOCK_FRAMES) {
+            v->mod_flat   = v->mod_max - v->mod_min < MOD_MIN_DB ? v->mod_flat + 1 : 0;
+            v->mod_frames = 0;
+            if (v->mod_flat >= MOD_FLAT_BLOCKS) {
+                v->floor_db = v->mod_min;   // re-seat the floor on the noise
+                v->mod_flat = 0;
+                return false;
+            }
+        }
+    }
+
+    // Noise floor: minimum tracking, biased to fall
+    if (snr < 0)                        v->floor_db += FLOOR_FALL * snr;
+    else if (v->speech)                 v->floor_db += FLOOR_CREEP_SPEECH;
+    else if (snr < v->cfg.stay_snr_db)  v->floor_db += FLOOR_TRACK * snr;
+    else                                v->floor_db += FLOOR_CREEP_DB;
+
+    return speech;
+}
+
+// ── Onset / hangover state machine (shared) ──────────────────────────────────
+
+static vad_event_t vad_frame(vad_t *v, const int16_t *x)
+{
+    bool adaptive = v->cfg.engine == VAD_ENGINE_ADAPTIVE;
+    bool speech   = adaptive ? adaptive_frame(v, x) : rms_frame(v, x);
+    v->frames++;
+
+    if (!v->speech) {
+        int need = adaptive ? (v->barge ? v->cfg.barge_frames : v->cfg.onset_frames)
+                            : (v->barge ? v->cfg.rms_barge_frames : v->cfg.rms_confirm_frames);
+        v->run = speech ? v->run + 1 : 0;
+        if (v->run < need) return VAD_NONE;
+        v->speech     = true;
+        v->gap        = 0;
+        v->paused     = false;
+        v->mod_frames = 0;
+        v->mod_flat   = 0;
+        v->lag        = (size_t)v->run * v->frame_len;
+        return VAD_ONSET;
+    }
+
+    if (speech) {
+        // Resumed after a pause: learn how long this talker pauses mid-turn
+        if (adaptive && v->gap >= PAUSE_MIN_FRAMES) {
+            v->pause_ms += PAUSE_SMOOTH * (v->gap * frame_ms(v) - v->pause_ms);
+            update_hangover(v);
+        }
+        v->gap = 0;
+        if (!v->paused) return VAD_NONE;
+        v->paused = false;
+        v->lag    = 0;
+        return VAD_RESUME;
+    }
+
+    v->lag = (size_t)++v->gap * v->frame_len;
+    if (v->gap >= v->hang_frames) {
+        v->speech = false;
+        v->paused = false;
+        v->run    = 0;
+        return VAD_END;
+    }
+    if (!v->paused && v->gap * frame_ms(v) >= v->cfg.pause_ms) {
+        v->paused = true;
+        return VAD_PAUSE;
+    }
+    return VAD_NONE;
+}
+
+vad_event_t vad_step(vad_t *v, const int16_t *pcm, size_t n, size_t *used)
+{
+    vad_event_t ev = VAD_NONE;
+    size_t      i  = 0;
+
+    while (i < n && ev == VAD_NONE) {
+        const int16_t *frame;
+        size_t want = (size_t)(v->frame_len - v->carry_len);
+
+        if (v->carry_len == 0 && n - i >= want) {
+            frame = pcm + i;           // whole frame in place
+            i += want;
+        } else {
+            size_t take = n - i < want ? n - i : want;
+            memcpy(v->carry + v->carry_len, pcm + i, take * sizeof(int16_t));
+            v->carry_len += (int)take;
+            i += take;
+            if (v->carry_len < v->frame_len) break;
+            frame = v->carry;
+        }
+        v->carry_len = 0;
+
+        ev = vad_frame(v, frame);
+    }
+    *used = i;
+    return ev;
+}
+
+vad_event_t vad_process(vad_t *v, const int16_t *pcm, size_t n, size_t *at)
+{
+    vad_event_t first = VAD_NONE;
+    size_t      i     = 0;
+
+    while (i < n) {
+        size_t      used;
+        vad_event_t ev = vad_step(v, pcm + i, n - i, &used);
+        i += used;
+        if (ev != VAD_NONE && first == VAD_NONE) {
+            first = ev;
+            if (at) *at = i;
+        }
+    }
+    return first;
+}
+
+size_t vad_event_lag(const vad_t *v)
+{
+    return v->lag;
+}
+
+int vad_hangover_ms(const vad_t *v)
+{
+    return v->hang_frames * frame_ms(v);
+}
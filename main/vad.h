@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Voice activity detection for the conversation mic path.
+//
+// Plain C with no FreeRTOS or IDF dependency: the firmware reader task and
+// the host evaluation tool (tools/vad_eval.c) run exactly this code.  Feed
+// 16 kHz mono PCM in any chunking; the engine works on its own fixed frames
+// and reports onset and end of speech.
+//
+// Engines:
+//   VAD_ENGINE_RMS       the original detector — fixed RMS threshold per
+//                        32 ms chunk, 3-chunk onset, fixed 1.5 s end (kept as
+//                        the evaluation baseline)
+//   VAD_ENGINE_ADAPTIVE  speech-band energy against a tracked noise floor
+//                        (SNR, not absolute level, decides), zero-crossing
+//                        veto for hiss, and a hangover that adapts to the
+//                        talker's own pauses
+
+#define VAD_SAMPLE_RATE     16000
+#define VAD_FRAME_MAX       512     // largest engine frame (RMS: one reader chunk)
+
+typedef enum {
+    VAD_ENGINE_RMS,
+    VAD_ENGINE_ADAPTIVE,
+} vad_engine_t;
+
+typedef enum {
+    VAD_NONE,
+    VAD_ONSET,   // speech confirmed
+    VAD_PAUSE,   // speech stopped for pause_ms: probable end, hangover running
+    VAD_RESUME,  // speech back before the hangover ran out (the pause was not the end)
+    VAD_END,     // hangover expired after speech
+} vad_event_t;
+
+typedef struct {
+    vad_engine_t engine;
+
+    // RMS engine
+    uint16_t rms_threshold;
+    int      rms_confirm_frames;
+
+    // Adaptive engine (dB are 10·log10 of mean band power)
+    float onset_snr_db;     // frame is speech above floor + this ...
+    float stay_snr_db;      // ... and stays speech above floor + this
+    float min_level_db;     // absolute floor for speech (digital silence, dead mic)
+    float zcr_max;          // crossings per sample above which a marginal frame is hiss
+    int   onset_frames;     // consecutive speech frames to confirm onset (10 ms each)
+    int   hang_min_ms;      // adaptive end-of-speech hangover bounds
+    int   hang_max_ms;
+    int   hang_init_ms;     // before any pause of this talker has been seen
+
+    int   pause_ms;         // silence after which VAD_PAUSE reports a probable end (both engines)
+
+    // Barge-in (speech over playback): stricter onset
+    float    barge_snr_db;          // adaptive: added to onset_snr_db
+    int      barge_frames;
+    uint16_t rms_barge_threshold;   // RMS engine
+    int      rms_barge_frames;
+} vad_config_t;
+
+typedef struct {
+    vad_config_t cfg;
+    int      frame_len;          // samples per engine frame
+    int16_t  carry[VAD_FRAME_MAX];
+    int      carry_len;
+    uint32_t frames;             // frames processed
+
+    bool     barge;              // stricter onset (playback running)
+    bool     speech;             // between ONSET and END
+    int      run;                // consecutive speech frames (before onset)
+    int      gap;                // consecutive non-speech frames (in speech)
+    int      hang_frames;        // current hangover
+    bool     paused;             // VAD_PAUSE sent, no VAD_RESUME / VAD_END yet
+    size_t   lag;                // see vad_event_lag()
+
+    // Adaptive engine
+    float    b0, b2, a1, a2;     // speech-band biquad (b1 = 0)
+    float    z1, z2;
+    float    floor_db;
+    bool     floor_init;
+    float    pause_ms;           // smoothed intra-utterance pause
+    float    mod_min, mod_max;   // level range in the current modulation block
+    int      mod_frames;
+    int      mod_flat;           // consecutive blocks without a speech-like swing
+
+    // Last frame, for metering and tuning
+    float    level_db;
+    float    snr_db;
+} vad_t;
+
+void vad_config_default(vad_config_t *cfg, vad_engine_t engine);
+void vad_init(vad_t *v, const vad_config_t *cfg);
+
+// Back to "no speech" (new listening phase).  The noise floor and the
+// talker's pause statistics are kept.
+void vad_rearm(vad_t *v, bool barge_in);
+
+// Process n samples.  Returns the first event seen in them; *at (optional)
+// is the sample offset into pcm at which it was decided.
+vad_event_t vad_process(vad_t *v, const int16_t *pcm, size_t n, size_t *at);
+
+// As vad_process, but stops right after an event: *used samples were
+// consumed (call again with the rest).  For callers that need every event.
+vad_event_t vad_step(vad_t *v, const int16_t *pcm, size_t n, size_t *used);
+
+// How far before its decision point the last event's evidence starts, in
+// samples: the speech run behind VAD_ONSET, the silence behind VAD_PAUSE /
+// VAD_END.  0 for VAD_RESUME.
+size_t vad_event_lag(const vad_t *v);
+
+static inline bool vad_in_speech(const vad_t *v) { return v->speech; }
+
+// Hangover currently applied at end of speech (ms)
+int vad_hangover_ms(const vad_t *v);
+
+const char *vad_engine_name(vad_engine_t engine);
@@ -0,0 +1,225 @@
+// Boot graph on the host: runs main/boot_graph.c (the exact firmware code)
+// on the IDF / FreeRTOS stand-ins in tools/host, with stages that sleep,
+// fail or wait for each other, and checks what the scheduler did.
+//
+// Build and run (host):
+//   make boot-graph-test
+//   build-host/boot_graph_test [-v]      (-v: firmware log on stderr)
+//
+// Covers: dependents of a failed stage skipped (transitively) while the
+// rest still runs; stages held back until their internal RAM is free, or
+// started anyway with nothing else running; at most BOOT_WORKERS at once;
+// boot_graph_wait() on done, failed, skipped and still-running stages.
+// Times are real (ms sleeps), with margins wide enough for a loaded host.
+//
+// Exit status 0 when every check passes.
+
+#include "boot_graph.h"
+#include "events.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "idf_host.h"
+#include <stdio.h>
+#include <string.h>
+
+EventGroupHandle_t g_events;
+
+static int s_failed;
+static int s_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        s_checks++;                                             \
+        if (!(cond)) {                                          \
+            s_failed++;                                         \
+            printf("   FAIL %s:%d  ", __func__, __LINE__);      \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static const boot_timing_t *timing(int i)
+{
+    const boot_timing_t *t;
+    boot_stage_timings(&t);
+    return &t[i];
+}
+
+// Stages running right now, and the most at once
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static int          s_running, s_running_max;
+
+static void busy(uint32_t ms)
+{
+    taskENTER_CRITICAL(&s_lock);
+    if (++s_running > s_running_max) s_running_max = s_running;
+    taskEXIT_CRITICAL(&s_lock);
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    taskENTER_CRITICAL(&s_lock);
+    s_running--;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static bool ok_20(void)   { busy(20); return true; }
+static bool ok_50(void)   { busy(50); return true; }
+static bool fail_20(void) { busy(20); return false; }
+
+// ── Failure ──────────────────────────────────────────────────────────────────
+
+enum { F_A, F_B, F_C, F_D, F_E, F_F, F_G, F_COUNT };
+
+static bool     s_wait_failed, s_wait_skipped, s_wait_done;
+static uint32_t s_wait_skipped_ms;
+
+static bool f_e(void)
+{
+    s_wait_failed = boot_graph_wait(F_B, 2000);   // b fails meanwhile
+    busy(20);
+    return true;
+}
+
+static bool f_g(void)
+{
+    uint32_t t0 = now_ms();
+    s_wait_skipped    = boot_graph_wait(F_D, 2000);
+    s_wait_skipped_ms = now_ms() - t0;
+    s_wait_done       = boot_graph_wait(F_A, 2000);
+    return true;
+}
+
+#define D(x) BOOT_DEP(F_##x)
+
+static void test_failure(void)
+{
+    static const boot_stage_t k_stages[F_COUNT] = {
+        [F_A] = { "a", ok_20,   0 },
+        [F_B] = { "b", fail_20, D(A) },
+        [F_C] = { "c", ok_20,   D(B) },          // skipped: b failed
+        [F_D] = { "d", ok_20,   D(C) },          // skipped: c was
+        [F_E] = { "e", f_e,     D(A) },
+        [F_F] = { "f", ok_20,   D(A) | D(B) },   // skipped: one of two failed
+        [F_G] = { "g", f_g,     0 },
+    };
+    boot_graph_run(k_stages, F_COUNT);
+
+    static const boot_result_t k_want[F_COUNT] = {
+        BOOT_DONE, BOOT_FAILED, BOOT_SKIPPED, BOOT_SKIPPED, BOOT_DONE, BOOT_SKIPPED, BOOT_DONE,
+    };
+    for (int i = 0; i < F_COUNT; i++) {
+        CHECK(timing(i)->result == k_want[i], "%s: result %d, want %d",
+              k_stages[i].name, timing(i)->result, k_want[i]);
+    }
+    CHECK(timing(F_C)->start_ms >= timing(F_B)->end_ms, "c skipped before b failed");
+    CHECK(timing(F_B)->start_ms >= timing(F_A)->end_ms, "b started before a finished");
+
+    CHECK(!s_wait_failed, "boot_graph_wait() on a failed stage returned true");
+    CHECK(!s_wait_skipped, "boot_graph_wait() on a skipped stage returned true");
+    CHECK(s_wait_skipped_ms < 1000, "boot_graph_wait() on a skipped stage took %lu ms",
+          (unsigned long)s_wait_skipped_ms);
+    CHECK(s_wait_done, "boot_graph_wait() on a done stage returned false");
+}
+
+#undef D
+
+// ── RAM gating ───────────────────────────────────────────────────────────────
+
+enum { R_SMALL, R_BIG, R_HUGE, R_COUNT };
+
+// Finishing frees the RAM the big stage is waiting for
+static bool r_small(void)
+{
+    busy(50);
+    host_internal_free = 128 * 1024;
+    return true;
+}
+
+// Then eats it all: the huge stage can only go once nothing else runs
+static bool r_big(void)
+{
+    host_internal_free = 8 * 1024;
+    busy(50);
+    return true;
+}
+
+static void test_ram(void)
+{
+    static const boot_stage_t k_stages[R_COUNT] = {
+        [R_SMALL] = { "small", r_small, 0 },
+        [R_BIG]   = { "big",   r_big,   0, 64 * 1024 },
+        [R_HUGE]  = { "huge",  ok_20,   0, 1024 * 1024 },
+    };
+    host_internal_free = 40 * 1024;
+    boot_graph_run(k_stages, R_COUNT);
+
+    const boot_timing_t *small = timing(R_SMALL), *big = timing(R_BIG), *huge = timing(R_HUGE);
+    CHECK(small->result == BOOT_DONE && big->result == BOOT_DONE && huge->result == BOOT_DONE,
+          "results %d %d %d", small->result, big->result, huge->result);
+    CHECK(big->start_ms >= small->end_ms, "big started at %lu ms with 40 KB free, small ended %lu",
+          (unsigned long)big->start_ms, (unsigned long)small->end_ms);
+    CHECK(big->ready_ms <= small->start_ms + 10, "big became ready at %lu ms, not at once",
+          (unsigned long)big->ready_ms);
+    CHECK(huge->start_ms >= big->end_ms, "huge started beside big");
+}
+
+// ── Workers and waits ────────────────────────────────────────────────────────
+
+enum { W_SLOW, W_WAITER, W_1, W_2, W_3, W_4, W_5, W_COUNT };
+
+static bool     s_early, s_late;
+static uint32_t s_late_ms;
+
+static bool w_slow(void)
+{
+    busy(150);
+    return true;
+}
+
+static bool w_waiter(void)
+{
+    s_early   = boot_graph_wait(W_SLOW, 20);               // still running
+    s_late    = boot_graph_wait(W_SLOW, portMAX_DELAY);
+    s_late_ms = now_ms();
+    return true;
+}
+
+static void test_workers(void)
+{
+    static const boot_stage_t k_stages[W_COUNT] = {
+        [W_SLOW]   = { "slow",   w_slow,   0 },
+        [W_WAITER] = { "waiter", w_waiter, 0 },
+        [W_1]      = { "w1",     ok_50,    0 },
+        [W_2]      = { "w2",     ok_50,    0 },
+        [W_3]      = { "w3",     ok_50,    0 },
+        [W_4]      = { "w4",     ok_50,    0 },
+        [W_5]      = { "w5",     ok_50,    0 },
+    };
+    host_internal_free = 256 * 1024;
+    s_running_max      = 0;
+    boot_graph_run(k_stages, W_COUNT);
+
+    int done = 0;
+    for (int i = 0; i < W_COUNT; i++) done += timing(i)->result == BOOT_DONE;
+    CHECK(done == W_COUNT, "%d/%d stages done", done, W_COUNT);
+    // waiter blocks a worker without counting as busy(): at most 3 beside it
+    CHECK(s_running_max <= 3, "%d stages ran at once beside the waiter", s_running_max);
+    CHECK(!s_early, "boot_graph_wait() returned true before the stage ended");
+    CHECK(s_late && s_late_ms >= timing(W_SLOW)->end_ms, "boot_graph_wait() returned %d at %lu ms, "
+          "stage ended %lu", s_late, (unsigned long)s_late_ms, (unsigned long)timing(W_SLOW)->end_ms);
+}
+
+int main(int argc, char **argv)
+{
+    host_log_on = argc > 1 && !strcmp(argv[1], "-v");
+    g_events    = xEventGroupCreate();
+
+    printf("── boot_graph\n");
+    test_failure();
+    test_ram();
+    test_workers();
+    printf("   %d/%d checks ok\n", s_checks - s_failed, s_checks);
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+// Conversation state machine on a fake clock: replays scripted input
+// timelines through main/conv_fsm.c (the exact firmware code) the way
+// record.c drives it, and checks the transitions and their latency.
+//
+// Build and run (host):
+//   make conv-sim
+//   build-host/conv_sim [-v]
+//
+// The record task is modelled as one worker that handles queued inputs in
+// order and is busy for a fixed time per action (ACTION_MS).  Turn actions
+// block it longest (the upload drain), so events posted meanwhile wait, and
+// that wait is the latency reported.  Everything is integer milliseconds on
+// a clock only this tool advances, so every run prints the same numbers.
+//
+// Exit status 0 when every scenario reaches its expected states within its
+// latency bound.
+
+#include "conv_fsm.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_INPUTS   32
+#define MAX_STEPS    32
+
+// Worker busy time per action (ms), roughly what the firmware spends
+static const uint32_t ACTION_MS[8] = {
+    [0] = 1,     // STOP_PLAY    audio_stop + stream_player_skip
+    [1] = 20,    // CANCEL_TURN  cancel frame, close the link
+    [2] = 150,   // END_TURN     drain the ring, confirmed end, close
+    [3] = 40,    // EXIT         playback stop, mic off
+    [4] = 2,     // LISTEN       reader state switch
+    [5] = 5,     // RECORD       trim, open the link
+    [6] = 1,     // PLAYING
+    [7] = 2,     // PRECONNECT   WS client start
+};
+
+typedef struct {
+    uint32_t     at_ms;
+    conv_event_t ev;
+} script_t;
+
+typedef struct {
+    const char   *name;
+    script_t      in[MAX_INPUTS];      // ends with END
+    conv_state_t  expect[MAX_STEPS];   // states entered, in order
+    int           n_expect;
+    uint32_t      max_latency_ms;      // bound for every transition
+    uint32_t      run_ms;              // simulate this long
+} scenario_t;
+
+static uint32_t s_now;
+static uint32_t fake_clock(void) { return s_now; }
+
+static int s_verbose;
+
+// ── Scenarios ────────────────────────────────────────────────────────────────
+
+#define EV(t, e) { (t), CONV_EV_##e }
+#define END      { 0, CONV_EV_COUNT }
+
+static const scenario_t k_scenarios[] = {
+    {
+        .name = "turn, reply, knob exit",
+        .in = {
+            EV(0, KNOB), EV(1200, SPEECH), EV(3400, SILENCE),
+            EV(4100, PLAY_START), EV(7000, PLAY_END), EV(9000, KNOB), END
+        },
+        .expect = { CONV_LISTENING, CONV_RECORDING, CONV_WAITING, CONV_PLAYING,
+                    CONV_LISTENING, CONV_OFF },
+        .n_expect = 6, .max_latency_ms = 5, .run_ms = 10000,
+    },
+    {
+        // The reply starts while the upload still drains: PLAY_START waits
+        // out END_TURN, then is handled in WAITING
+        .name = "reply during the upload drain",
+        .in = {
+            EV(0, WAKE), EV(500, SPEECH), EV(2000, SILENCE), EV(2100, PLAY_START),
+            EV(5000, PLAY_END), END
+        },
+        .expect = { CONV_LISTENING, CONV_RECORDING, CONV_WAITING, CONV_PLAYING,
+                    CONV_LISTENING },
+        .n_expect = 5, .max_latency_ms = 60, .run_ms = 6000,
+    },
+    {
+        .name = "barge-in over the reply",
+        .in = {
+            EV(0, KNOB), EV(300, SPEECH), EV(1500, SILENCE), EV(2000, PLAY_START),
+            EV(2600, SPEECH), EV(3900, SILENCE), EV(4200, PLAY_END), EV(4500, PLAY_START),
+            EV(6000, PLAY_END), END
+        },
+        .expect = { CONV_LISTENING, CONV_RECORDING, CONV_WAITING, CONV_PLAYING,
+                    CONV_RECORDING, CONV_WAITING, CONV_PLAYING, CONV_LISTENING },
+        .n_expect = 8, .max_latency_ms = 5, .run_ms = 7000,
+    },
+    {
+        .name = "too short, then listen timeout",
+        .in = {
+            EV(0, KNOB), EV(100, SPEECH), EV(400, SILENCE), EV(560, TURN_DROPPED), END
+        },
+        .expect = { CONV_LISTENING, CONV_RECORDING, CONV_WAITING, CONV_LISTENING, CONV_OFF },
+        .n_expect = 5, .max_latency_ms = 5, .run_ms = 70000,
+    },
+    {
+        .name = "no reply: wait timeout",
+        .in = { EV(0, KNOB), EV(100, SPEECH), EV(2000, TURN_STOP), END },
+        .expect = { CONV_LISTENING, CONV_RECORDING, CONV_WAITING, CONV_LISTENING },
+        .n_expect = 4, .max_latency_ms = 5, .run_ms = 40000,
+    },
+    {
+        .name = "knob while recording cancels the turn",
+        .in = { EV(0, KNOB), EV(800, SPEECH), EV(1500, KNOB), EV(1600, SILENCE), END },
+        .expect = { CONV_LISTENING, CONV_RECORDING, CONV_OFF },
+        .n_expect = 3, .max_latency_ms = 5, .run_ms = 3000,
+    },
+};
+
+// ── Worker model ─────────────────────────────────────────────────────────────
+
+static uint32_t busy_ms(uint32_t actions)
+{
+    uint32_t ms = 0;
+    for (int i = 0; i < 8; i++) {
+        if (actions & (1u << i)) ms += ACTION_MS[i];
+    }
+    return ms;
+}
+
+static int run(const scenario_t *sc)
+{
+    conv_fsm_config_t cfg;
+    conv_fsm_config_default(&cfg);
+    s_now = 0;
+    conv_fsm_t f;
+    conv_fsm_init(&f, &cfg, fake_clock);
+
+    int n_in = 0;
+    while (n_in < MAX_INPUTS && sc->in[n_in].ev != CONV_EV_COUNT) n_in++;
+
+    conv_state_t seen[MAX_STEPS];
+    int          n_seen = 0;
+    uint32_t     worst  = 0;
+    int          next   = 0;      // next scripted input not yet handled
+
+    printf("── %s\n", sc->name);
+    while (s_now <= sc->run_ms) {
+        // Next thing the worker wakes for: a queued input, or the deadline
+        conv_input_t in;
+        int32_t wait = conv_fsm_wait_ms(&f);
+        bool have = next < n_in;
+        uint32_t in_at = have ? sc->in[next].at_ms : 0;
+
+        if (have && (wait < 0 || in_at <= s_now + (uint32_t)wait)) {
+            if (in_at > s_now) s_now = in_at;
+            in = (conv_input_t){ .ev = sc->in[next].ev, .at_ms = in_at };
+            next++;
+        } else if (wait >= 0) {
+            s_now += (uint32_t)wait;
+            in = conv_fsm_timeout_input(&f);
+        } else {
+            break;
+        }
+        if (s_now > sc->run_ms) break;
+
+        conv_step_t st;
+        if (!conv_fsm_handle(&f, &in, &st)) {
+            if (s_verbose) printf("   %6lu  %-11s ignored in %s\n", (unsigned long)s_now,
+                                  conv_event_name(in.ev), conv_state_name(conv_fsm_state(&f)));
+            continue;
+        }
+        printf("   %6lu  %-11s %-9s → %-9s +%lu ms\n", (unsigned long)st.at_ms,
+               conv_event_name(st.ev), conv_state_name(st.from), conv_state_name(st.to),
+               (unsigned long)st.latency_ms);
+        if (n_seen < MAX_STEPS) seen[n_seen++] = st.to;
+        if (st.latency_ms > worst) worst = st.latency_ms;
+        s_now += busy_ms(st.actions);
+    }
+
+    bool ok = n_seen == sc->n_expect && worst <= sc->max_latency_ms;
+    for (int i = 0; ok && i < n_seen; i++) ok = seen[i] == sc->expect[i];
+    printf("   %s (%d transitions, worst latency %lu ms, bound %lu ms)\n",
+           ok ? "ok" : "FAIL", n_seen, (unsigned long)worst,
+           (unsigned long)sc->max_latency_ms);
+    if (!ok) {
+        printf("   expected:");
+        for (int i = 0; i < sc->n_expect; i++) printf(" %s", conv_state_name(sc->expect[i]));
+        printf("\n");
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+    int failed = 0;
+    int n = (int)(sizeof(k_scenarios) / sizeof(k_scenarios[0]));
+    for (int i = 0; i < n; i++) failed += run(&k_scenarios[i]);
+    printf("%d/%d scenarios ok\n", n - failed, n);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,366 @@
+// PCM kernels on the host: checks main/dsp_pcm.c (the exact firmware code,
+// scalar path) against the formulas in dsp_pcm.h, then times each kernel.
+//
+// Build and run (host):
+//   make dsp-test
+//   build-host/dsp_test [-b]      (-b: benchmark only)
+//
+// Lengths cover empty, single, odd tails around the 8-sample PIE block and
+// inputs longer than the sumsq accumulator chunk; in-place calls cover every
+// aliasing case the header allows.  The same comparisons against the PIE
+// path run on the S3 in dsp_pcm_selftest(), called from audio_init().
+//
+// Exit status 0 when every check passes.
+
+#include "dsp_pcm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_N        4096
+#define BENCH_N      1024          // one playback chunk, in samples
+#define BENCH_ITERS  20000
+
+static const size_t k_lens[] = { 0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 257, 1031, MAX_N };
+#define N_LENS (sizeof(k_lens) / sizeof(k_lens[0]))
+
+static const uint16_t k_gains[] = { 0, 1, 2048, 4095, DSP_GAIN_UNITY, DSP_GAIN_UNITY + 1, 65535 };
+#define N_GAINS (sizeof(k_gains) / sizeof(k_gains[0]))
+
+static int s_failed;
+static int s_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        s_checks++;                                             \
+        if (!(cond)) {                                          \
+            s_failed++;                                         \
+            printf("   FAIL %s:%d  ", __func__, __LINE__);      \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+// ── Input ────────────────────────────────────────────────────────────────────
+
+static uint32_t s_lcg = 1;
+
+static int16_t sample(void)
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    if ((s_lcg >> 30) == 0) return (s_lcg & 0x100) ? 32767 : -32768;
+    return (int16_t)(s_lcg >> 16);
+}
+
+static void fill(int16_t *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = sample();
+}
+
+static int16_t sat16(int32_t v)
+{
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : (int16_t)v;
+}
+
+// Buffers 16-byte aligned like the firmware's, with a canary after the end
+static int16_t s_a[2 * MAX_N + 16] __attribute__((aligned(DSP_PCM_ALIGN)));
+static int16_t s_b[2 * MAX_N + 16] __attribute__((aligned(DSP_PCM_ALIGN)));
+static int16_t s_x[2 * MAX_N + 16] __attribute__((aligned(DSP_PCM_ALIGN)));
+static int16_t s_y[2 * MAX_N + 16] __attribute__((aligned(DSP_PCM_ALIGN)));
+
+#define CANARY  0x5A5A
+
+static void guard(int16_t *x, size_t n)
+{
+    for (size_t i = n; i < n + 16; i++) x[i] = CANARY;
+}
+
+static int intact(const int16_t *x, size_t n)
+{
+    for (size_t i = n; i < n + 16; i++) if (x[i] != CANARY) return 0;
+    return 1;
+}
+
+// ── Checks ───────────────────────────────────────────────────────────────────
+
+static void test_sumsq(void)
+{
+    for (size_t t = 0; t < N_LENS; t++) {
+        size_t n = k_lens[t];
+        fill(s_a, n);
+        uint64_t want = 0;
+        for (size_t i = 0; i < n; i++) want += (int64_t)s_a[i] * s_a[i];
+        CHECK(dsp_sumsq_s16(s_a, n) == want, "n=%zu", n);
+        CHECK(dsp_sumsq_s16_scalar(s_a, n) == want, "scalar n=%zu", n);
+    }
+
+    // Full scale for a whole chunk: the largest sum the mic path can see
+    for (size_t i = 0; i < 2 * MAX_N; i++) s_a[i] = -32768;
+    CHECK(dsp_sumsq_s16(s_a, 2 * MAX_N) == (uint64_t)2 * MAX_N * 32768 * 32768, "full scale");
+    CHECK(dsp_rms_s16(s_a, 2 * MAX_N) == 32768, "rms full scale: %u", dsp_rms_s16(s_a, 2 * MAX_N));
+    CHECK(dsp_rms_s16(s_a, 0) == 0, "rms empty");
+    for (size_t i = 0; i < 64; i++) s_a[i] = (i & 1) ? 1000 : -1000;
+    CHECK(dsp_rms_s16(s_a, 64) == 1000, "rms square wave: %u", dsp_rms_s16(s_a, 64));
+}
+
+static void test_interleave(void)
+{
+    for (size_t t = 0; t < N_LENS; t++) {
+        size_t n = k_lens[t];
+        fill(s_a, n);
+        fill(s_b, n);
+        guard(s_x, 2 * n);
+        dsp_interleave_s16(s_x, s_a, s_b, n);
+        int ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_x[2 * i] == s_a[i] && s_x[2 * i + 1] == s_b[i];
+        CHECK(ok && intact(s_x, 2 * n), "n=%zu", n);
+
+        // In place over the left channel, and mono → stereo
+        memcpy(s_y, s_a, n * sizeof(int16_t));
+        guard(s_y, 2 * n);
+        dsp_interleave_s16(s_y, s_y, s_b, n);
+        CHECK(!memcmp(s_x, s_y, 2 * n * sizeof(int16_t)) && intact(s_y, 2 * n), "dst==l n=%zu", n);
+
+        memcpy(s_y, s_a, n * sizeof(int16_t));
+        dsp_interleave_s16(s_y, s_y, s_y, n);
+        ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_y[2 * i] == s_a[i] && s_y[2 * i + 1] == s_a[i];
+        CHECK(ok, "dst==l==r n=%zu", n);
+    }
+}
+
+static void test_deinterleave(void)
+{
+    for (size_t t = 0; t < N_LENS; t++) {
+        size_t n = k_lens[t];
+        fill(s_a, 2 * n);
+        guard(s_x, n);
+        guard(s_y, n);
+        dsp_deinterleave_s16(s_x, s_y, s_a, n);
+        int ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_x[i] == s_a[2 * i] && s_y[i] == s_a[2 * i + 1];
+        CHECK(ok && intact(s_x, n) && intact(s_y, n), "n=%zu", n);
+
+        // One output NULL
+        memset(s_y, 0, n * sizeof(int16_t));
+        dsp_deinterleave_s16(NULL, s_y, s_a, n);
+        ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_y[i] == s_a[2 * i + 1];
+        CHECK(ok, "l=NULL n=%zu", n);
+
+        // In place: left over src (audio.c's downmix), then right over src
+        memcpy(s_b, s_a, 2 * n * sizeof(int16_t));
+        dsp_deinterleave_s16(s_b, NULL, s_b, n);
+        ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_b[i] == s_a[2 * i];
+        CHECK(ok, "l==src n=%zu", n);
+
+        memcpy(s_b, s_a, 2 * n * sizeof(int16_t));
+        dsp_deinterleave_s16(NULL, s_b, s_b, n);
+        ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_b[i] == s_a[2 * i + 1];
+        CHECK(ok, "r==src n=%zu", n);
+
+        memcpy(s_b, s_a, 2 * n * sizeof(int16_t));
+        dsp_deinterleave_s16(s_b, s_y, s_b, n);
+        ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_b[i] == s_a[2 * i] && s_y[i] == s_a[2 * i + 1];
+        CHECK(ok, "l==src, r separate n=%zu", n);
+    }
+}
+
+static void test_gain(void)
+{
+    for (size_t t = 0; t < N_LENS; t++) {
+        size_t n = k_lens[t];
+        fill(s_a, n);
+        for (size_t g = 0; g < N_GAINS; g++) {
+            guard(s_x, n);
+            dsp_gain_s16(s_x, s_a, n, k_gains[g]);
+            int ok = 1;
+            for (size_t i = 0; i < n; i++) {
+                ok &= s_x[i] == sat16((int32_t)(((int64_t)s_a[i] * k_gains[g]) >> 12));
+            }
+            CHECK(ok && intact(s_x, n), "n=%zu gain=%u", n, k_gains[g]);
+
+            memcpy(s_y, s_a, n * sizeof(int16_t));
+            dsp_gain_s16(s_y, s_y, n, k_gains[g]);
+            CHECK(!memcmp(s_x, s_y, n * sizeof(int16_t)), "in place n=%zu gain=%u", n, k_gains[g]);
+        }
+    }
+    s_a[0] = 30000;
+    dsp_gain_s16(s_x, s_a, 1, 65535);
+    CHECK(s_x[0] == 32767, "saturates high");
+    s_a[0] = -30000;
+    dsp_gain_s16(s_x, s_a, 1, 65535);
+    CHECK(s_x[0] == -32768, "saturates low");
+}
+
+static void test_mix(void)
+{
+    for (size_t t = 0; t < N_LENS; t++) {
+        size_t n = k_lens[t];
+        fill(s_a, n);
+        fill(s_b, n);
+        guard(s_x, n);
+        dsp_mix_s16(s_x, s_a, s_b, n);
+        int ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_x[i] == sat16((int32_t)s_a[i] + s_b[i]);
+        CHECK(ok && intact(s_x, n), "n=%zu", n);
+
+        memcpy(s_y, s_a, n * sizeof(int16_t));
+        dsp_mix_s16(s_y, s_y, s_b, n);
+        CHECK(!memcmp(s_x, s_y, n * sizeof(int16_t)), "dst==a n=%zu", n);
+        memcpy(s_y, s_b, n * sizeof(int16_t));
+        dsp_mix_s16(s_y, s_a, s_y, n);
+        CHECK(!memcmp(s_x, s_y, n * sizeof(int16_t)), "dst==b n=%zu", n);
+    }
+}
+
+static void test_downmix(void)
+{
+    for (size_t l = 0; l < N_LENS; l++) {
+        size_t n = k_lens[l];
+        fill(s_a, 2 * n);
+        guard(s_x, n);
+        dsp_downmix_s16(s_x, s_a, n);
+        int ok = 1;
+        for (size_t i = 0; i < n; i++) ok &= s_x[i] == (int16_t)((s_a[2 * i] + s_a[2 * i + 1]) >> 1);
+        CHECK(ok && intact(s_x, n), "n=%zu", n);
+
+        memcpy(s_y, s_a, 2 * n * sizeof(int16_t));
+        dsp_downmix_s16(s_y, s_y, n);
+        CHECK(!memcmp(s_x, s_y, n * sizeof(int16_t)), "in place n=%zu", n);
+    }
+    s_a[0] = s_a[1] = INT16_MAX;
+    s_a[2] = s_a[3] = INT16_MIN;
+    dsp_downmix_s16(s_x, s_a, 2);
+    CHECK(s_x[0] == INT16_MAX && s_x[1] == INT16_MIN, "full scale %d %d", s_x[0], s_x[1]);
+}
+
+// RMS of a resampled tone, skipping the filter's settling time
+static double tone_rms(int in_hz, int out_hz, double tone_hz)
+{
+    static int16_t out[2 * MAX_N + 16];
+    for (size_t i = 0; i < MAX_N; i++) s_a[i] = (int16_t)lrint(16000 * sin(2 * M_PI * tone_hz * i / in_hz));
+    dsp_resampler_t rs;
+    dsp_resampler_init(&rs, in_hz, out_hz);
+    size_t n  = dsp_resample_s16(&rs, s_a, MAX_N, out, sizeof(out) / 2);
+    double sq = 0;
+    for (size_t i = 64; i < n; i++) sq += (double)out[i] * out[i];
+    return sqrt(sq / (double)(n - 64));
+}
+
+// Downsampling removes what the new rate cannot carry, and keeps speech
+static void test_anti_alias(void)
+{
+    const double in_rms = 16000 / sqrt(2);
+    static const int k_down[] = { 22050, 24000, 44100, 48000 };
+    for (size_t r = 0; r < sizeof(k_down) / sizeof(k_down[0]); r++) {
+        double pass = 20 * log10(tone_rms(k_down[r], 16000, 1000) / in_rms);
+        double stop = 20 * log10(tone_rms(k_down[r], 16000, 9500) / in_rms);
+        CHECK(pass > -0.5, "%d→16000: 1 kHz at %.1f dB", k_down[r], pass);
+        CHECK(stop < -40, "%d→16000: 9.5 kHz aliases at %.1f dB", k_down[r], stop);
+    }
+    // Upsampling has nothing to alias: no filter, the tone passes
+    double up = 20 * log10(tone_rms(8000, 16000, 2000) / in_rms);
+    CHECK(up > -1.5, "8000→16000: 2 kHz at %.1f dB", up);
+}
+
+// Feeding a stream in pieces must give the same output as in one call
+static void test_resample(void)
+{
+    static const int k_rates[][2] = { { 16000, 16000 }, { 22050, 16000 }, { 24000, 16000 },
+                                      { 44100, 16000 }, { 8000, 16000 } };
+    static int16_t whole[2 * MAX_N + 16], parts[2 * MAX_N + 16];
+
+    fill(s_a, MAX_N);
+    for (size_t r = 0; r < sizeof(k_rates) / sizeof(k_rates[0]); r++) {
+        dsp_resampler_t rs;
+        dsp_resampler_init(&rs, k_rates[r][0], k_rates[r][1]);
+        size_t nw = dsp_resample_s16(&rs, s_a, MAX_N, whole, sizeof(whole) / 2);
+
+        dsp_resampler_init(&rs, k_rates[r][0], k_rates[r][1]);
+        size_t np = 0;
+        for (size_t off = 0, t = 1; off < MAX_N; t++) {
+            size_t n = k_lens[t % N_LENS];
+            if (n > MAX_N - off) n = MAX_N - off;
+            np += dsp_resample_s16(&rs, s_a + off, n, parts + np, sizeof(parts) / 2 - np);
+            off += n;
+        }
+        CHECK(nw == np && !memcmp(whole, parts, nw * sizeof(int16_t)),
+              "%d→%d whole %zu parts %zu", k_rates[r][0], k_rates[r][1], nw, np);
+
+        // The last input sample is held back as `prev` for the next chunk,
+        // so the count is that of MAX_N - 1 samples, within one
+        size_t want = (size_t)((uint64_t)(MAX_N - 1) * k_rates[r][1] / k_rates[r][0]);
+        CHECK(nw + 1 >= want && nw <= want + 1, "%d→%d %zu samples, want %zu",
+              k_rates[r][0], k_rates[r][1], nw, want);
+    }
+
+    // Same rate is the identity, one sample behind
+    dsp_resampler_t rs;
+    dsp_resampler_init(&rs, 16000, 16000);
+    size_t n = dsp_resample_s16(&rs, s_a, 257, whole, sizeof(whole) / 2);
+    CHECK(n == 256 && !memcmp(whole, s_a, n * sizeof(int16_t)), "identity %zu", n);
+}
+
+// ── Benchmark ────────────────────────────────────────────────────────────────
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile uint64_t s_sink;
+
+#define BENCH(name, expr) do {                                              \
+        double t0 = now_ns();                                               \
+        for (int it = 0; it < BENCH_ITERS; it++) { expr; }                  \
+        double ns = (now_ns() - t0) / BENCH_ITERS;                          \
+        printf("   %-22s %8.0f ns/chunk  %6.2f ns/sample\n",                \
+               name, ns, ns / BENCH_N);                                     \
+    } while (0)
+
+static void bench(void)
+{
+    dsp_resampler_t rs;
+    dsp_resampler_init(&rs, 24000, 16000);
+    fill(s_a, 2 * BENCH_N);
+    fill(s_b, 2 * BENCH_N);
+
+    printf("── benchmark, %d-sample chunks, scalar path\n", BENCH_N);
+    BENCH("sumsq", s_sink += dsp_sumsq_s16(s_a, BENCH_N));
+    BENCH("interleave", dsp_interleave_s16(s_x, s_a, s_b, BENCH_N));
+    BENCH("deinterleave", dsp_deinterleave_s16(s_x, s_y, s_a, BENCH_N));
+    BENCH("deinterleave in place", dsp_deinterleave_s16(s_b, NULL, s_b, BENCH_N));
+    BENCH("gain 0.5", dsp_gain_s16(s_x, s_a, BENCH_N, 2048));
+    BENCH("gain 2.0", dsp_gain_s16(s_x, s_a, BENCH_N, 8192));
+    BENCH("mix", dsp_mix_s16(s_x, s_a, s_b, BENCH_N));
+    BENCH("downmix", dsp_downmix_s16(s_x, s_a, BENCH_N));
+    BENCH("resample 24k→16k", s_sink += dsp_resample_s16(&rs, s_a, BENCH_N, s_x, 2 * BENCH_N));
+}
+
+int main(int argc, char **argv)
+{
+    int bench_only = argc > 1 && !strcmp(argv[1], "-b");
+
+    if (!bench_only) {
+        printf("── kernels\n");
+        test_sumsq();
+        test_interleave();
+        test_deinterleave();
+        test_gain();
+        test_mix();
+        test_downmix();
+        test_resample();
+        test_anti_alias();
+        CHECK(dsp_pcm_selftest(), "dsp_pcm_selftest");
+        printf("   %d/%d checks ok\n", s_checks - s_failed, s_checks);
+    }
+    bench();
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in, see idf_host.h: no RTC memory or IRAM, plain statics
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in, see idf_host.h
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT       (1 << 2)
+#define MALLOC_CAP_DMA        (1 << 3)
+#define MALLOC_CAP_INTERNAL   (1 << 11)
+#define MALLOC_CAP_SPIRAM     (1 << 10)
+
+void  *heap_caps_malloc(size_t size, uint32_t caps);
+void  *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void   heap_caps_free(void *p);
+size_t heap_caps_get_free_size(uint32_t caps);           // host_internal_free
+size_t heap_caps_get_minimum_free_size(uint32_t caps);   // same
@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in, see idf_host.h: SNTP never syncs
+#include <sys/time.h>
+
+#define SNTP_OPMODE_POLL 0
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+void esp_sntp_setoperatingmode(int mode);
+void esp_sntp_setservername(int idx, const char *server);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb);
+void esp_sntp_init(void);
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in, see idf_host.h
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);   // µs since process start
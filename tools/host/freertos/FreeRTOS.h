@@ -0,0 +1,36 @@
+#pragma once
+
+// Host stand-in, see idf_host.h
+#include "esp_attr.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t   BaseType_t;
+typedef uint32_t  UBaseType_t;
+typedef uint32_t  TickType_t;
+typedef uint8_t   StackType_t;
+typedef struct { int unused; } StaticTask_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFu)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+#define configASSERT(x)         assert(x)
+
+// Every critical section takes the same recursive mutex
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+#define taskENTER_CRITICAL(mux)         host_critical_enter(mux)
+#define taskEXIT_CRITICAL(mux)          host_critical_exit(mux)
+#define taskENTER_CRITICAL_ISR(mux)     host_critical_enter(mux)
+#define taskEXIT_CRITICAL_ISR(mux)      host_critical_exit(mux)
+#define portYIELD_FROM_ISR(woken)       ((void)(woken))
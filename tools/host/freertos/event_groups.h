@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in, see idf_host.h
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_events *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t        xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits);
+EventBits_t        xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits);
+EventBits_t        xEventGroupGetBits(EventGroupHandle_t g);
+EventBits_t        xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear,
+                                       BaseType_t all, TickType_t ticks);
@@ -0,0 +1,23 @@
+#pragma once
+
+// Host stand-in, see idf_host.h: a task is a detached thread
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t   xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                     void *arg, UBaseType_t prio, TaskHandle_t *out, BaseType_t core);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                           void *arg, UBaseType_t prio, StackType_t *stack_buf,
+                                           StaticTask_t *tcb, BaseType_t core);
+#define xTaskCreate(fn, name, stack, arg, prio, out) \
+    xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, 0)
+
+void       vTaskDelete(TaskHandle_t task);   // NULL only: the calling task
+void       vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+uint32_t   ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void       vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
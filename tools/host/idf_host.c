@@ -0,0 +1,435 @@
+// Host stand-ins for the IDF and FreeRTOS calls the tested modules make; see
+// idf_host.h.  Built into every tools/*_test.c that needs them.
+
+#include "idf_host.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+volatile size_t host_internal_free = 256 * 1024;
+bool            host_log_on;
+
+// ── Time ─────────────────────────────────────────────────────────────────────
+
+static int64_t mono_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t         s_t0_us;
+static pthread_mutex_t s_critical;
+
+__attribute__((constructor)) static void host_start(void)
+{
+    s_t0_us = mono_us();
+
+    pthread_mutexattr_t a;
+    pthread_mutexattr_init(&a);
+    pthread_mutexattr_settype(&a, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_critical, &a);
+    pthread_mutexattr_destroy(&a);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return mono_us() - s_t0_us;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+// Condition variables run on CLOCK_MONOTONIC, like the tick
+static void cond_init(pthread_cond_t *c)
+{
+    pthread_condattr_t a;
+    pthread_condattr_init(&a);
+    pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &a);
+    pthread_condattr_destroy(&a);
+}
+
+static struct timespec deadline(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec  += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+// Wait on c until woken or the deadline; false once it has passed
+static bool cond_wait(pthread_cond_t *c, pthread_mutex_t *m, TickType_t ticks,
+                      const struct timespec *until)
+{
+    if (ticks == portMAX_DELAY) return pthread_cond_wait(c, m) == 0;
+    return pthread_cond_timedwait(c, m, until) == 0;
+}
+
+// ── Critical sections ────────────────────────────────────────────────────────
+
+void host_critical_enter(portMUX_TYPE *mux)
+{
+    pthread_mutex_lock(&s_critical);
+}
+
+void host_critical_exit(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&s_critical);
+}
+
+// ── Tasks and notifications ──────────────────────────────────────────────────
+
+struct host_task {
+    TaskFunction_t  fn;
+    void           *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint32_t        notify;
+};
+
+static __thread struct host_task *s_self;
+
+static void *task_main(void *p)
+{
+    s_self = p;
+    s_self->fn(s_self->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    t->fn  = fn;
+    t->arg = arg;
+    pthread_mutex_init(&t->lock, NULL);
+    cond_init(&t->cond);
+    if (out) *out = t;
+
+    pthread_attr_t a;
+    pthread_attr_init(&a);
+    pthread_attr_setdetachstate(&a, PTHREAD_CREATE_DETACHED);
+    pthread_t th;
+    int err = pthread_create(&th, &a, task_main, t);
+    pthread_attr_destroy(&a);
+    return err == 0 ? pdPASS : pdFAIL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                           void *arg, UBaseType_t prio, StackType_t *stack_buf,
+                                           StaticTask_t *tcb, BaseType_t core)
+{
+    TaskHandle_t t = NULL;
+    xTaskCreatePinnedToCore(fn, name, stack, arg, prio, &t, core);
+    return t;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    assert(task == NULL || task == s_self);
+    pthread_exit(NULL);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task *t = s_self;
+    assert(t);
+    struct timespec until = deadline(ticks);
+    pthread_mutex_lock(&t->lock);
+    while (t->notify == 0 && cond_wait(&t->cond, &t->lock, ticks, &until)) {}
+    uint32_t n = t->notify;
+    if (n) t->notify = clear ? 0 : n - 1;
+    pthread_mutex_unlock(&t->lock);
+    return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t)
+{
+    pthread_mutex_lock(&t->lock);
+    t->notify++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t *woken)
+{
+    xTaskNotifyGive(t);
+    if (woken) *woken = pdTRUE;
+}
+
+// ── Queues ───────────────────────────────────────────────────────────────────
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;      // any change: waiters recheck
+    size_t          len, size, head, count;
+    uint8_t        *items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    q->len   = len;
+    q->size  = item_size;
+    q->items = calloc(len, item_size);
+    pthread_mutex_init(&q->lock, NULL);
+    cond_init(&q->cond);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    free(q->items);
+    free(q);
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+    struct timespec until = deadline(ticks);
+    pthread_mutex_lock(&q->lock);
+    bool ok = true;
+    while (q->count == q->len && (ok = cond_wait(&q->cond, &q->lock, ticks, &until))) {}
+    if (q->count < q->len) {
+        size_t slot;
+        if (front) {
+            q->head = (q->head + q->len - 1) % q->len;
+            slot    = q->head;
+        } else {
+            slot = (q->head + q->count) % q->len;
+        }
+        memcpy(q->items + slot * q->size, item, q->size);
+        q->count++;
+        pthread_cond_broadcast(&q->cond);
+        ok = true;
+    } else {
+        ok = false;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_send(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_send(q, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    struct timespec until = deadline(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && cond_wait(&q->cond, &q->lock, ticks, &until)) {}
+    bool ok = q->count > 0;
+    if (ok) {
+        memcpy(item, q->items + q->head * q->size, q->size);
+        q->head = (q->head + 1) % q->len;
+        q->count--;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = (UBaseType_t)q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+// ── Event groups ─────────────────────────────────────────────────────────────
+
+struct host_events {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    EventBits_t     bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_events *g = calloc(1, sizeof(*g));
+    pthread_mutex_init(&g->lock, NULL);
+    cond_init(&g->cond);
+    return g;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits)
+{
+    pthread_mutex_lock(&g->lock);
+    g->bits |= bits;
+    EventBits_t now = g->bits;
+    pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits)
+{
+    pthread_mutex_lock(&g->lock);
+    EventBits_t was = g->bits;
+    g->bits &= ~bits;
+    pthread_mutex_unlock(&g->lock);
+    return was;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g)
+{
+    pthread_mutex_lock(&g->lock);
+    EventBits_t now = g->bits;
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear,
+                                BaseType_t all, TickType_t ticks)
+{
+    struct timespec until = deadline(ticks);
+    pthread_mutex_lock(&g->lock);
+    for (;;) {
+        EventBits_t hit = g->bits & bits;
+        if (all ? hit == bits : hit != 0) break;
+        if (!cond_wait(&g->cond, &g->lock, ticks, &until)) break;
+    }
+    EventBits_t now = g->bits;
+    EventBits_t hit = now & bits;
+    if (clear && (all ? hit == bits : hit != 0)) g->bits &= ~bits;
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+// ── Heap ─────────────────────────────────────────────────────────────────────
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *p)
+{
+    free(p);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return host_internal_free;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return host_internal_free;
+}
+
+// ── NVS: one namespace of i64 values ─────────────────────────────────────────
+
+#define HOST_NVS_MAX 16
+
+static struct {
+    char    key[16];
+    int64_t val;
+} s_nvs[HOST_NVS_MAX];
+static int s_nvs_n;
+
+void host_nvs_erase(void)
+{
+    s_nvs_n = 0;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    *out = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t h)
+{
+}
+
+esp_err_t nvs_get_i64(nvs_handle_t h, const char *key, int64_t *out)
+{
+    for (int i = 0; i < s_nvs_n; i++) {
+        if (strcmp(s_nvs[i].key, key) == 0) {
+            *out = s_nvs[i].val;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_i64(nvs_handle_t h, const char *key, int64_t val)
+{
+    int i = 0;
+    while (i < s_nvs_n && strcmp(s_nvs[i].key, key) != 0) i++;
+    if (i == HOST_NVS_MAX) return ESP_ERR_NO_MEM;
+    if (i == s_nvs_n) s_nvs_n++;
+    snprintf(s_nvs[i].key, sizeof(s_nvs[i].key), "%s", key);
+    s_nvs[i].val = val;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    return ESP_OK;
+}
+
+// ── SNTP: never syncs ────────────────────────────────────────────────────────
+
+void esp_sntp_setoperatingmode(int mode) {}
+void esp_sntp_setservername(int idx, const char *server) {}
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) {}
+void esp_sntp_init(void) {}
+
+// ── Misc ─────────────────────────────────────────────────────────────────────
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+void host_log(char level, const char *tag, const char *fmt, ...)
+{
+    if (!host_log_on) return;
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "%c (%lld) %s: ", level, (long long)(esp_timer_get_time() / 1000), tag);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Just enough of ESP-IDF and FreeRTOS, on pthreads, to build firmware modules
+// unchanged on the host for tools/*_test.c.  The headers next to this one
+// stand in for the IDF ones (cc -Itools/host -Imain ...).
+//
+// Tasks are detached threads; queues, event groups and task notifications
+// are mutex + condition variable; critical sections share one recursive
+// mutex.  A tick is 1 ms and esp_timer counts from process start, both on
+// CLOCK_MONOTONIC.  Only what the tested modules call is here: anything else
+// fails to link, which is the cue to add it.
+
+// Internal RAM heap_caps_get_free_size() reports; tests move it
+extern volatile size_t host_internal_free;
+
+// ESP_LOGx prints to stderr when set (tests take -v)
+extern bool host_log_on;
+
+void host_log(char level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Forget every NVS value (a fresh flash)
+void host_nvs_erase(void);
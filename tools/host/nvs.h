@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in, see idf_host.h: one in-memory namespace of i64 values
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out);
+void      nvs_close(nvs_handle_t h);
+esp_err_t nvs_get_i64(nvs_handle_t h, const char *key, int64_t *out);
+esp_err_t nvs_set_i64(nvs_handle_t h, const char *key, int64_t val);
+esp_err_t nvs_commit(nvs_handle_t h);
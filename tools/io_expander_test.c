@@ -0,0 +1,200 @@
+// IO expander debounce on the host: builds main/io_expander.c (the exact
+// firmware code, included here to reach debounce() and its state) against
+// the IDF stand-ins in tools/host, with a fake port 0 behind the I2C calls.
+//
+// Build and run (host):
+//   make io-expander-test
+//   build-host/io_expander_test [-v]      (-v: firmware log on stderr)
+//
+// Feeds debounce() samples at chosen times: an edge is delivered only
+// once the pin has held for its debounce time (knob 30 ms, charger pins
+// 300 ms), a bounce restarts the wait, and the return value is the time
+// to the next settle.  Then runs the service task on the polled build
+// (IO_EXP_INT_GPIO -1): the boot state is not an edge, a press arrives
+// after its debounce, and failed reads are counted.
+//
+// Exit status 0 when every check passes.
+
+#include "io_expander.c"
+
+#include <stdio.h>
+#include <string.h>
+
+static volatile uint8_t s_fake_port0 = 0xFF;     // what the expander answers
+static volatile bool    s_fake_fail;
+
+esp_err_t i2c_bus_write(i2c_client_t c, uint8_t addr, const uint8_t *data, size_t len)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_read_reg(i2c_client_t c, uint8_t addr, uint8_t reg, uint8_t *val)
+{
+    if (s_fake_fail) return ESP_FAIL;
+    *val = s_fake_port0;
+    return ESP_OK;
+}
+
+static int s_failed;
+static int s_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        s_checks++;                                             \
+        if (!(cond)) {                                          \
+            s_failed++;                                         \
+            printf("   FAIL %s:%d  ", __func__, __LINE__);      \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+#define KNOB    (1u << KNOB_BTN_BIT)
+#define VBUS    (1u << PWR_VBUS_DET_BIT)
+#define CHRG    (1u << PWR_CHRG_DET_BIT)
+
+// Edges as the callbacks saw them
+static int              s_edges[IO_EXP_PIN_COUNT];
+static bool             s_last[IO_EXP_PIN_COUNT];
+static volatile int     s_second;
+static volatile uint32_t s_knob_at_ms;
+
+static void on_edge(io_exp_pin_t pin, bool active)
+{
+    s_edges[pin]++;
+    s_last[pin] = active;
+    if (pin == IO_EXP_KNOB) s_knob_at_ms = now_ms();
+}
+
+static void on_edge_2(io_exp_pin_t pin, bool active)
+{
+    s_second++;
+}
+
+static int edges(void)
+{
+    int n = 0;
+    for (int p = 0; p < IO_EXP_PIN_COUNT; p++) n += s_edges[p];
+    return n;
+}
+
+// Active low: a pressed / asserted pin reads 0
+static uint8_t low(uint8_t bits)
+{
+    return 0xFF & ~bits;
+}
+
+// ── Debounce ─────────────────────────────────────────────────────────────────
+
+static void test_knob(void)
+{
+    printf("── knob (30 ms)\n");
+    int32_t r = debounce(low(KNOB), 1000);
+    CHECK(r == 30 && edges() == 0, "press: %ld ms left, %d edges", (long)r, edges());
+    r = debounce(low(KNOB), 1020);
+    CHECK(r == 10 && edges() == 0, "held 20 ms: %ld ms left, %d edges", (long)r, edges());
+    r = debounce(low(KNOB), 1030);
+    CHECK(r == -1 && s_edges[IO_EXP_KNOB] == 1 && s_last[IO_EXP_KNOB],
+          "held 30 ms: %ld, %d edges", (long)r, s_edges[IO_EXP_KNOB]);
+    CHECK(io_exp_active(IO_EXP_KNOB), "knob not active after its edge");
+    CHECK(s_second == 1, "second callback ran %d times", s_second);
+    CHECK(debounce(low(KNOB), 1500) == -1 && edges() == 1, "a steady pin settled again");
+
+    // Bounce on release: back to the settled state cancels, the next change restarts
+    r = debounce(0xFF, 2000);
+    CHECK(r == 30, "release: %ld ms left", (long)r);
+    r = debounce(low(KNOB), 2010);
+    CHECK(r == -1, "bounce back to pressed: %ld, want nothing pending", (long)r);
+    r = debounce(0xFF, 2015);
+    CHECK(r == 30, "release again: %ld ms left, want the full 30", (long)r);
+    r = debounce(0xFF, 2040);
+    CHECK(r == 5 && s_edges[IO_EXP_KNOB] == 1, "25 ms after the last bounce: %ld, %d edges",
+          (long)r, s_edges[IO_EXP_KNOB]);
+    r = debounce(0xFF, 2045);
+    CHECK(r == -1 && s_edges[IO_EXP_KNOB] == 2 && !s_last[IO_EXP_KNOB],
+          "released: %ld, %d edges", (long)r, s_edges[IO_EXP_KNOB]);
+    CHECK(!io_exp_active(IO_EXP_KNOB), "knob still active");
+}
+
+static void test_power(void)
+{
+    printf("── charger pins (300 ms)\n");
+    int base = edges();
+    int32_t r = debounce(low(VBUS), 3000);
+    CHECK(r == 300, "plug: %ld ms left", (long)r);
+
+    // The sooner of two pending pins
+    r = debounce(low(VBUS | KNOB), 3100);
+    CHECK(r == 30, "knob beside vbus: %ld ms left", (long)r);
+    r = debounce(low(VBUS | KNOB), 3130);
+    CHECK(r == 170 && s_edges[IO_EXP_KNOB] == 3 && s_edges[IO_EXP_VBUS] == 0,
+          "knob settled: %ld ms to vbus, knob %d vbus %d edges", (long)r,
+          s_edges[IO_EXP_KNOB], s_edges[IO_EXP_VBUS]);
+    r = debounce(low(VBUS | KNOB), 3299);
+    CHECK(r == 1 && s_edges[IO_EXP_VBUS] == 0, "vbus at 299 ms: %ld, %d edges", (long)r,
+          s_edges[IO_EXP_VBUS]);
+    r = debounce(low(VBUS | KNOB), 3300);
+    CHECK(r == -1 && s_edges[IO_EXP_VBUS] == 1 && io_exp_active(IO_EXP_VBUS),
+          "vbus at 300 ms: %ld, %d edges", (long)r, s_edges[IO_EXP_VBUS]);
+
+    // Charging flickers on plug-in: no edge until it holds
+    r = debounce(low(VBUS | KNOB | CHRG), 4000);
+    CHECK(r == 300, "chrg: %ld", (long)r);
+    r = debounce(low(VBUS | KNOB), 4200);
+    CHECK(r == -1, "chrg flicker off: %ld", (long)r);
+    r = debounce(low(VBUS | KNOB | CHRG), 4250);
+    r = debounce(low(VBUS | KNOB | CHRG), 4500);
+    CHECK(r == 50 && s_edges[IO_EXP_CHRG] == 0, "chrg 250 ms after the flicker: %ld, %d edges",
+          (long)r, s_edges[IO_EXP_CHRG]);
+    r = debounce(low(VBUS | KNOB | CHRG), 4550);
+    CHECK(r == -1 && s_edges[IO_EXP_CHRG] == 1 && io_exp_active(IO_EXP_CHRG),
+          "chrg held: %ld, %d edges", (long)r, s_edges[IO_EXP_CHRG]);
+    CHECK(edges() - base == 3 && s_stats.edges == (uint32_t)edges(),
+          "%d edges, stats %lu", edges() - base, (unsigned long)s_stats.edges);
+    CHECK(!io_exp_active(IO_EXP_STDBY), "stdby active without a change");
+}
+
+// ── Service task ─────────────────────────────────────────────────────────────
+
+static void test_task(void)
+{
+    printf("── service task (polled, %d ms)\n", IO_EXP_POLL_MS);
+    memset(s_edges, 0, sizeof(s_edges));
+    s_stats = (io_exp_stats_t){ 0 };
+
+    // Plugged in at boot: that is the state, not an edge
+    s_fake_port0 = low(VBUS);
+    CHECK(io_exp_init(), "init failed");
+    CHECK(io_exp_active(IO_EXP_VBUS) && !io_exp_active(IO_EXP_KNOB), "boot state not cached");
+    vTaskDelay(pdMS_TO_TICKS(3 * IO_EXP_POLL_MS));
+    CHECK(edges() == 0, "%d edges for the boot state", edges());
+
+    uint32_t t0 = now_ms();
+    s_fake_port0 = low(VBUS | KNOB);
+    for (int i = 0; i < 100 && !s_edges[IO_EXP_KNOB]; i++) vTaskDelay(pdMS_TO_TICKS(10));
+    uint32_t took = s_knob_at_ms - t0;
+    CHECK(s_edges[IO_EXP_KNOB] == 1 && took >= IO_EXP_KNOB_DEB_MS && took <= IO_EXP_POLL_MS + 200,
+          "press delivered %d times, after %lu ms", s_edges[IO_EXP_KNOB], (unsigned long)took);
+    CHECK(io_exp_active(IO_EXP_KNOB), "knob not active");
+
+    // A failed read changes nothing and is counted
+    uint32_t reads = s_stats.reads;
+    s_fake_fail = true;
+    vTaskDelay(pdMS_TO_TICKS(3 * IO_EXP_POLL_MS));
+    s_fake_fail = false;
+    CHECK(s_stats.errors >= 2 && s_stats.reads > reads, "errors %lu reads %lu",
+          (unsigned long)s_stats.errors, (unsigned long)(s_stats.reads - reads));
+    CHECK(io_exp_active(IO_EXP_KNOB) && edges() == 1, "state changed on a failed read");
+}
+
+int main(int argc, char **argv)
+{
+    host_log_on = argc > 1 && !strcmp(argv[1], "-v");
+
+    io_exp_attach(on_edge);
+    io_exp_attach(on_edge_2);
+    test_knob();
+    test_power();
+    test_task();
+    printf("   %d/%d checks ok\n", s_checks - s_failed, s_checks);
+    return s_failed ? 1 : 0;
+}
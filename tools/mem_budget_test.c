@@ -0,0 +1,194 @@
+// Internal-RAM budget on the host: builds main/mem_budget.c (the exact
+// firmware code) against the IDF stand-ins in tools/host, with the free
+// internal heap set by the test.
+//
+// Build and run (host):
+//   make mem-budget-test
+//   build-host/mem_budget_test [-v]      (-v: firmware log on stderr)
+//
+// Checks the admit decision (budget, the background users' headroom, the
+// floor under the heap that is free right now), give clamping, the
+// connection helpers in and out of order, and a queued reservation that is
+// granted or denied, with what the stats report for each.
+//
+// Exit status 0 when every check passes.
+
+#include "mem_budget.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "idf_host.h"
+#include <stdio.h>
+#include <string.h>
+
+static int s_failed;
+static int s_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        s_checks++;                                             \
+        if (!(cond)) {                                          \
+            s_failed++;                                         \
+            printf("   FAIL %s:%d  ", __func__, __LINE__);      \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+#define KB          1024
+#define FLOOR       (24 * KB)           // MEM_BUDGET_FLOOR
+#define BUDGET      (176 * KB)          // init with 200 KB free
+
+static mem_budget_stats_t stats(void)
+{
+    mem_budget_stats_t st;
+    mem_budget_get_stats(&st);
+    return st;
+}
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// ── Admit ────────────────────────────────────────────────────────────────────
+
+static void test_admit(void)
+{
+    printf("── admit\n");
+    host_internal_free = 200 * KB;
+    mem_budget_init();
+    CHECK(stats().budget == BUDGET, "budget %lu, want free less the floor",
+          (unsigned long)stats().budget);
+
+    // Budget: foreground users may fill it exactly
+    CHECK(mem_budget_take(MEM_USER_PLAYER, 100 * KB, 0), "player 100 KB");
+    CHECK(mem_budget_take(MEM_USER_MQTT, 76 * KB, 0), "mqtt up to the budget");
+    CHECK(stats().reserved == BUDGET, "reserved %lu", (unsigned long)stats().reserved);
+    CHECK(!mem_budget_take(MEM_USER_RECORDER, 1, 0), "a byte over the budget was admitted");
+    mem_budget_give(MEM_USER_MQTT, 76 * KB);
+
+    // Headroom: HTTP leaves a handshake for the conversation, others do not
+    CHECK(!mem_budget_take(MEM_USER_HTTP, 48 * KB, 0), "http took the conversation's headroom");
+    CHECK(mem_budget_take(MEM_USER_HTTP, 44 * KB, 0), "http with the headroom left");
+    CHECK(mem_budget_take(MEM_USER_RECORDER, 32 * KB, 0), "recorder into the headroom");
+    CHECK(stats().held[MEM_USER_HTTP] == 44 * KB && stats().held[MEM_USER_RECORDER] == 32 * KB,
+          "held http %lu recorder %lu", (unsigned long)stats().held[MEM_USER_HTTP],
+          (unsigned long)stats().held[MEM_USER_RECORDER]);
+    mem_budget_give(MEM_USER_HTTP, 44 * KB);
+    mem_budget_give(MEM_USER_RECORDER, 32 * KB);
+    mem_budget_give(MEM_USER_PLAYER, 100 * KB);
+    CHECK(stats().reserved == 0, "reserved %lu after giving all back",
+          (unsigned long)stats().reserved);
+    CHECK(stats().reserved_max == BUDGET, "reserved_max %lu", (unsigned long)stats().reserved_max);
+
+    // Floor: within the budget, but the heap itself is short right now
+    host_internal_free = FLOOR + 32 * KB - 1;
+    CHECK(!mem_budget_take(MEM_USER_PLAYER, 32 * KB, 0), "admitted into the floor");
+    host_internal_free = FLOOR + 32 * KB;
+    CHECK(mem_budget_take(MEM_USER_PLAYER, 32 * KB, 0), "denied with exactly enough free");
+    CHECK(!mem_budget_take(MEM_USER_HTTP, 1, 0), "http admitted without its headroom free");
+    mem_budget_give(MEM_USER_PLAYER, 32 * KB);
+    CHECK(stats().free_min == FLOOR + 32 * KB, "free_min %lu", (unsigned long)stats().free_min);
+
+    // Give clamps to what the user holds
+    host_internal_free = 200 * KB;
+    CHECK(mem_budget_take(MEM_USER_MQTT, 10 * KB, 0), "mqtt 10 KB");
+    CHECK(mem_budget_take(MEM_USER_PLAYER, 10 * KB, 0), "player 10 KB");
+    mem_budget_give(MEM_USER_MQTT, 50 * KB);
+    CHECK(stats().held[MEM_USER_MQTT] == 0 && stats().reserved == 10 * KB,
+          "over-give: mqtt %lu, reserved %lu", (unsigned long)stats().held[MEM_USER_MQTT],
+          (unsigned long)stats().reserved);
+    mem_budget_give(MEM_USER_PLAYER, 10 * KB);
+    CHECK(mem_budget_take(MEM_USER_HTTP, 0, 0), "zero bytes always admitted");
+    // Each refusal above counts, even without waiting
+    CHECK(stats().waits == 4 && stats().denied == 4, "waits %lu denied %lu, want the 4 refusals",
+          (unsigned long)stats().waits, (unsigned long)stats().denied);
+}
+
+// ── Connection helpers ───────────────────────────────────────────────────────
+
+static void test_conn(void)
+{
+    printf("── connection helpers\n");
+    CHECK(mem_budget_conn_begin(MEM_USER_PLAYER, 0), "handshake reservation");
+    CHECK(stats().held[MEM_USER_PLAYER] == MEM_TLS_HANDSHAKE, "held %lu",
+          (unsigned long)stats().held[MEM_USER_PLAYER]);
+    CHECK(mem_budget_conn_begin(MEM_USER_PLAYER, 0), "second begin");
+    CHECK(stats().held[MEM_USER_PLAYER] == MEM_TLS_HANDSHAKE, "second begin took more: %lu",
+          (unsigned long)stats().held[MEM_USER_PLAYER]);
+
+    mem_budget_conn_up(MEM_USER_PLAYER);
+    mem_budget_conn_up(MEM_USER_PLAYER);
+    CHECK(stats().held[MEM_USER_PLAYER] == MEM_TLS_CONN, "connected holds %lu",
+          (unsigned long)stats().held[MEM_USER_PLAYER]);
+
+    // A reconnect tops the connection's share back up to a handshake
+    host_internal_free = FLOOR + (MEM_TLS_HANDSHAKE - MEM_TLS_CONN);
+    CHECK(mem_budget_conn_begin(MEM_USER_PLAYER, 0), "reconnect needs only the difference");
+    CHECK(stats().held[MEM_USER_PLAYER] == MEM_TLS_HANDSHAKE, "held %lu",
+          (unsigned long)stats().held[MEM_USER_PLAYER]);
+    host_internal_free = 200 * KB;
+
+    mem_budget_conn_end(MEM_USER_PLAYER);
+    mem_budget_conn_end(MEM_USER_PLAYER);
+    mem_budget_conn_up(MEM_USER_MQTT);               // never began
+    mem_budget_conn_end(MEM_USER_MQTT);
+    CHECK(stats().reserved == 0 && stats().held[MEM_USER_PLAYER] == 0,
+          "out of order left %lu reserved", (unsigned long)stats().reserved);
+}
+
+// ── Waiting ──────────────────────────────────────────────────────────────────
+
+static volatile bool s_contended;
+
+// Sees the waiter queued, then frees the heap it is waiting for
+static void release_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(60));
+    s_contended = mem_budget_contended();
+    host_internal_free = 200 * KB;
+    vTaskDelete(NULL);
+}
+
+static void test_wait(void)
+{
+    printf("── waiting\n");
+    mem_budget_stats_t before = stats();
+
+    // Denied: nothing frees up within the wait
+    host_internal_free = FLOOR;
+    uint32_t t0 = now_ms();
+    CHECK(!mem_budget_conn_begin(MEM_USER_RECORDER, 100), "admitted with no room");
+    uint32_t took = now_ms() - t0;
+    CHECK(took >= 100 && took < 1000, "denied after %lu ms, want the 100 ms wait",
+          (unsigned long)took);
+    CHECK(stats().held[MEM_USER_RECORDER] == 0, "denied reservation holds %lu",
+          (unsigned long)stats().held[MEM_USER_RECORDER]);
+    CHECK(stats().waits == before.waits + 1 && stats().denied == before.denied + 1,
+          "waits %lu denied %lu", (unsigned long)stats().waits, (unsigned long)stats().denied);
+    CHECK(stats().wait_ms_max >= 100, "wait_ms_max %lu", (unsigned long)stats().wait_ms_max);
+    CHECK(!mem_budget_contended(), "still contended after the wait");
+
+    // Granted: the heap frees up partway through
+    xTaskCreate(release_task, "release", 2048, NULL, 5, NULL);
+    t0 = now_ms();
+    CHECK(mem_budget_conn_begin(MEM_USER_RECORDER, 2000), "denied after the heap freed up");
+    took = now_ms() - t0;
+    CHECK(took >= 60 && took < 1000, "granted after %lu ms", (unsigned long)took);
+    CHECK(s_contended, "not contended while waiting");
+    CHECK(stats().waits == before.waits + 2 && stats().denied == before.denied + 1,
+          "waits %lu denied %lu", (unsigned long)stats().waits, (unsigned long)stats().denied);
+    mem_budget_conn_end(MEM_USER_RECORDER);
+    CHECK(stats().reserved == 0, "reserved %lu", (unsigned long)stats().reserved);
+}
+
+int main(int argc, char **argv)
+{
+    host_log_on = argc > 1 && !strcmp(argv[1], "-v");
+
+    test_admit();
+    test_conn();
+    test_wait();
+    printf("   %d/%d checks ok\n", s_checks - s_failed, s_checks);
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,401 @@
+// SPSC byte ring on the host: checks main/spsc_ring.c (the exact firmware
+// code) single-threaded and under two threads, then compares its throughput
+// with a stream-buffer-style ring.
+//
+// Build and run (host):
+//   make spsc-test
+//   build-host/spsc_test [-b]      (-b: benchmark only)
+//
+// The stream buffer cannot run outside FreeRTOS, so the benchmark models it:
+// a copying ring whose send and receive take a lock for every call and wake
+// the other side through a condition variable, as xStreamBufferSend/Receive
+// do with their critical section and task notification.  Both rings wait on
+// the same binary-semaphore stand-in, so the difference is the per-call lock
+// and the copy out that the zero-copy peek avoids.  Absolute figures are the
+// host's; the ratio is what carries over.
+//
+// Exit status 0 when every check passes.
+
+#include "spsc_ring.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RING_BYTES    (128 * 1024)           // as audio.c's PCM ring
+#define PUSH_BYTES    4608                   // one MP3 frame, 1152 stereo samples
+#define PULL_BYTES    2048                   // PCM_WRITE_CHUNK
+#define STRESS_BYTES  (64u * 1024 * 1024)
+#define BENCH_FRAMES  (16u * 1024)           // 72 MB
+
+static int s_failed;
+static int s_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        s_checks++;                                             \
+        if (!(cond)) {                                          \
+            s_failed++;                                         \
+            printf("   FAIL %s:%d  ", __func__, __LINE__);      \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static uint8_t s_buf[RING_BYTES];
+
+static uint8_t pattern(size_t pos)
+{
+    return (uint8_t)(pos * 131 + (pos >> 9));
+}
+
+// Start both counters at pos, as if that many bytes had gone through
+static void seek(spsc_ring_t *r, size_t pos)
+{
+    atomic_store(&r->head, pos);
+    atomic_store(&r->tail, pos);
+}
+
+// ── Single thread ────────────────────────────────────────────────────────────
+
+static void test_empty_full(void)
+{
+    spsc_ring_t r;
+    uint8_t tmp[64];
+    spsc_ring_init(&r, s_buf, 64);
+    CHECK(spsc_ring_used(&r) == 0 && spsc_ring_free(&r) == 64, "empty");
+    CHECK(spsc_ring_read(&r, tmp, sizeof(tmp)) == 0, "read from empty");
+
+    for (size_t i = 0; i < 64; i++) tmp[i] = pattern(i);
+    CHECK(spsc_ring_write(&r, tmp, 40) == 40, "write 40");
+    CHECK(spsc_ring_write(&r, tmp + 40, 40) == 24, "short write when full");
+    CHECK(spsc_ring_used(&r) == 64 && spsc_ring_free(&r) == 0, "full");
+
+    uint8_t *span;
+    CHECK(spsc_ring_reserve(&r, &span) == 0, "no span when full");
+    memset(tmp, 0, sizeof(tmp));
+    CHECK(spsc_ring_read(&r, tmp, sizeof(tmp)) == 64, "read all");
+    int ok = 1;
+    for (size_t i = 0; i < 64; i++) ok &= tmp[i] == pattern(i);
+    CHECK(ok, "contents");
+    CHECK(spsc_ring_write_pos(&r) == 64 && spsc_ring_read_pos(&r) == 64, "positions");
+}
+
+// Every offset of the wrap, every length: copies and spans agree
+static void test_wrap(void)
+{
+    spsc_ring_t r;
+    uint8_t in[64], out[64];
+    for (size_t i = 0; i < sizeof(in); i++) in[i] = pattern(i);
+
+    for (size_t start = 0; start < 64; start++) {
+        for (size_t len = 1; len <= 64; len++) {
+            spsc_ring_init(&r, s_buf, 64);
+            seek(&r, start);
+
+            uint8_t *wspan;
+            size_t room = spsc_ring_reserve(&r, &wspan);
+            if (room != 64 - start || wspan != s_buf + start) {
+                CHECK(0, "reserve at %zu: %zu", start, room);
+                return;
+            }
+            memset(out, 0, sizeof(out));
+            size_t w = spsc_ring_write(&r, in, len);
+
+            const uint8_t *rspan;
+            size_t contig = spsc_ring_peek(&r, &rspan);
+            size_t want   = len < 64 - start ? len : 64 - start;
+            size_t got    = spsc_ring_read(&r, out, len);
+            if (w != len || got != len || contig != want || rspan != s_buf + start ||
+                memcmp(in, out, len) || spsc_ring_used(&r) != 0) {
+                CHECK(0, "start %zu len %zu: wrote %zu read %zu contig %zu", start, len, w,
+                      got, contig);
+                return;
+            }
+        }
+    }
+    CHECK(1, "wrap");
+}
+
+static void test_trim(void)
+{
+    spsc_ring_t r;
+    uint8_t in[48], out[48];
+    for (size_t i = 0; i < sizeof(in); i++) in[i] = pattern(i);
+    spsc_ring_init(&r, s_buf, 64);
+    seek(&r, 50);
+
+    spsc_ring_write(&r, in, 48);
+    CHECK(spsc_ring_trim(&r, 100) == 0 && spsc_ring_used(&r) == 48, "keep more than used");
+    CHECK(spsc_ring_trim(&r, 16) == 32 && spsc_ring_used(&r) == 16, "keep 16");
+    CHECK(spsc_ring_read_pos(&r) == 50 + 32, "read pos after trim");
+    CHECK(spsc_ring_read(&r, out, 48) == 16 && !memcmp(out, in + 32, 16), "newest kept");
+    spsc_ring_write(&r, in, 10);
+    CHECK(spsc_ring_trim(&r, 0) == 10 && spsc_ring_used(&r) == 0, "trim all");
+}
+
+// Counters are free-running: crossing SIZE_MAX must not move the index
+static void test_counter_wrap(void)
+{
+    spsc_ring_t r;
+    uint8_t in[100], out[100];
+    for (size_t i = 0; i < sizeof(in); i++) in[i] = pattern(i);
+    spsc_ring_init(&r, s_buf, 64);
+    seek(&r, (size_t)-10);
+
+    for (int lap = 0; lap < 4; lap++) {
+        size_t w = spsc_ring_write(&r, in, 50);
+        size_t used = spsc_ring_used(&r);
+        size_t got = spsc_ring_read(&r, out, sizeof(out));
+        CHECK(w == 50 && used == 50 && got == 50 && !memcmp(in, out, 50),
+              "lap %d: wrote %zu used %zu read %zu", lap, w, used, got);
+    }
+    CHECK(spsc_ring_write_pos(&r) == (size_t)-10 + 200, "position wrapped");
+}
+
+// ── Two threads ──────────────────────────────────────────────────────────────
+// Producer writes a known byte sequence in uneven pieces, the consumer checks
+// every byte, starting just short of the counter wrap.
+
+static spsc_ring_t s_ring;
+
+static uint32_t lcg(uint32_t *s)
+{
+    *s = *s * 1664525u + 1013904223u;
+    return *s >> 8;
+}
+
+static void *stress_producer(void *arg)
+{
+    uint32_t seed = 1;
+    size_t   pos  = 0;
+    while (pos < STRESS_BYTES) {
+        uint8_t *span;
+        size_t room = spsc_ring_reserve(&s_ring, &span);
+        size_t n = lcg(&seed) % 5000 + 1;
+        if (n > room) n = room;
+        if (n > STRESS_BYTES - pos) n = STRESS_BYTES - pos;
+        if (n == 0) sched_yield();
+        for (size_t i = 0; i < n; i++) span[i] = pattern(pos + i);
+        spsc_ring_commit(&s_ring, n);
+        pos += n;
+    }
+    return NULL;
+}
+
+static void *stress_consumer(void *arg)
+{
+    uint32_t seed = 2;
+    size_t   pos  = 0;
+    bool    *ok   = arg;
+    uint8_t  tmp[3000];
+    while (pos < STRESS_BYTES) {
+        size_t n;
+        if (lcg(&seed) & 1) {
+            const uint8_t *span;
+            n = spsc_ring_peek(&s_ring, &span);
+            for (size_t i = 0; i < n; i++) *ok &= span[i] == pattern(pos + i);
+            spsc_ring_consume(&s_ring, n);
+        } else {
+            n = spsc_ring_read(&s_ring, tmp, lcg(&seed) % sizeof(tmp) + 1);
+            for (size_t i = 0; i < n; i++) *ok &= tmp[i] == pattern(pos + i);
+        }
+        if (n == 0) sched_yield();
+        pos += n;
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    static uint8_t buf[4096];
+    bool ok = true;
+    spsc_ring_init(&s_ring, buf, sizeof(buf));
+    seek(&s_ring, (size_t)-(STRESS_BYTES / 2));
+
+    pthread_t p, c;
+    pthread_create(&c, NULL, stress_consumer, &ok);
+    pthread_create(&p, NULL, stress_producer, NULL);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    CHECK(ok && spsc_ring_used(&s_ring) == 0, "%u MB through a 4 KB ring", STRESS_BYTES >> 20);
+}
+
+// ── Benchmark ────────────────────────────────────────────────────────────────
+
+// Binary semaphore, as audio.c's s_pcm_data / s_pcm_space
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    bool            given;
+} binsem_t;
+
+#define BINSEM_INIT { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false }
+
+static void binsem_give(binsem_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->given = true;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void binsem_take(binsem_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    while (!s->given) pthread_cond_wait(&s->cond, &s->lock);
+    s->given = false;
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Stream-buffer model: indices under a lock on every call, copy in, copy out
+typedef struct {
+    pthread_mutex_t lock;
+    uint8_t        *buf;
+    size_t          size, head, tail;   // head/tail in [0, size]
+    size_t          used;
+} sbuf_t;
+
+static size_t sbuf_send(sbuf_t *b, const uint8_t *p, size_t len)
+{
+    pthread_mutex_lock(&b->lock);
+    size_t n = b->size - b->used;
+    if (n > len) n = len;
+    size_t head = b->head;
+    pthread_mutex_unlock(&b->lock);
+
+    size_t first = b->size - head < n ? b->size - head : n;
+    memcpy(b->buf + head, p, first);
+    memcpy(b->buf, p + first, n - first);
+
+    pthread_mutex_lock(&b->lock);
+    b->head = (head + n) % b->size;
+    b->used += n;
+    pthread_mutex_unlock(&b->lock);
+    return n;
+}
+
+static size_t sbuf_receive(sbuf_t *b, uint8_t *p, size_t len)
+{
+    pthread_mutex_lock(&b->lock);
+    size_t n = b->used < len ? b->used : len;
+    size_t tail = b->tail;
+    pthread_mutex_unlock(&b->lock);
+
+    size_t first = b->size - tail < n ? b->size - tail : n;
+    memcpy(p, b->buf + tail, first);
+    memcpy(p + first, b->buf, n - first);
+
+    pthread_mutex_lock(&b->lock);
+    b->tail = (tail + n) % b->size;
+    b->used -= n;
+    pthread_mutex_unlock(&b->lock);
+    return n;
+}
+
+typedef struct {
+    bool           spsc;        // else the stream-buffer model
+    sbuf_t         sb;
+    binsem_t       data, space;
+    volatile uint64_t sink;
+} bench_t;
+
+static uint8_t s_frame[PUSH_BYTES];
+static uint8_t s_chunk[PULL_BYTES];
+
+static void *bench_producer(void *arg)
+{
+    bench_t *b = arg;
+    for (size_t f = 0; f < BENCH_FRAMES; f++) {
+        const uint8_t *p = s_frame;
+        size_t left = PUSH_BYTES;
+        while (left) {
+            size_t n = b->spsc ? spsc_ring_write(&s_ring, p, left) : sbuf_send(&b->sb, p, left);
+            if (n) binsem_give(&b->data);
+            p += n;
+            left -= n;
+            if (left) binsem_take(&b->space);
+        }
+    }
+    return NULL;
+}
+
+static void *bench_consumer(void *arg)
+{
+    bench_t *b = arg;
+    for (size_t done = 0; done < (size_t)BENCH_FRAMES * PUSH_BYTES; ) {
+        size_t n;
+        if (b->spsc) {
+            // The writer task: the span goes to i2s_channel_write in place
+            const uint8_t *span;
+            n = spsc_ring_peek(&s_ring, &span);
+            if (n > PULL_BYTES) n = PULL_BYTES;
+            if (n) b->sink += span[0] + span[n - 1];
+            spsc_ring_consume(&s_ring, n);
+        } else {
+            n = sbuf_receive(&b->sb, s_chunk, PULL_BYTES);
+            if (n) b->sink += s_chunk[0] + s_chunk[n - 1];
+        }
+        if (n) binsem_give(&b->space);
+        else   binsem_take(&b->data);
+        done += n;
+    }
+    return NULL;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double bench_run(bool spsc)
+{
+    bench_t b = { .spsc = spsc, .data = BINSEM_INIT, .space = BINSEM_INIT };
+    pthread_mutex_init(&b.sb.lock, NULL);
+    b.sb.buf  = s_buf;
+    b.sb.size = RING_BYTES;
+    spsc_ring_init(&s_ring, s_buf, RING_BYTES);
+
+    pthread_t p, c;
+    double t0 = now_s();
+    pthread_create(&c, NULL, bench_consumer, &b);
+    pthread_create(&p, NULL, bench_producer, &b);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    return (double)BENCH_FRAMES * PUSH_BYTES / (now_s() - t0) / (1 << 20);
+}
+
+static void bench(void)
+{
+    printf("── benchmark, %u frames of %d bytes, %d-byte reads, %d KB ring\n",
+           BENCH_FRAMES, PUSH_BYTES, PULL_BYTES, RING_BYTES >> 10);
+    double sb = 0, sp = 0;
+    for (int i = 0; i < 3; i++) {     // best of three: scheduling noise
+        double a = bench_run(false), b = bench_run(true);
+        if (a > sb) sb = a;
+        if (b > sp) sp = b;
+    }
+    printf("   stream buffer model    %8.0f MB/s\n", sb);
+    printf("   spsc_ring, span out    %8.0f MB/s  (%.2fx)\n", sp, sp / sb);
+}
+
+int main(int argc, char **argv)
+{
+    int bench_only = argc > 1 && !strcmp(argv[1], "-b");
+
+    if (!bench_only) {
+        printf("── spsc_ring\n");
+        test_empty_full();
+        test_wrap();
+        test_trim();
+        test_counter_wrap();
+        test_threads();
+        printf("   %d/%d checks ok\n", s_checks - s_failed, s_checks);
+    }
+    bench();
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""Local stand-in for the stream-player / stream-recorder servers.
+
+Speaks both WebSocket layouts the firmware knows, so either path can be
+exercised against a laptop instead of the backend:
+
+  two sockets   /ws-player (TTS down) + one /ws-stream per turn (mic up)
+  multiplexed   /ws-player?mux=1 answered with {"type":"mux"}; the recorder's
+                turns then ride the same socket (see main/stream_player.h):
+                binary frames lead with a channel byte (1 play, 2 rec), text
+                frames carry "ch":"play" / "ch":"rec"
+
+Each turn is written to --out as a WAV (the device sends a streaming WAV
+header for pcm / adpcm; the sizes are patched on close).  Control frames are
+logged.  With --reply, every turn that ends cleanly is answered with that MP3
+as a streamed utterance on the player channel.
+
+Point the device at it with SECRET_STREAM_PLAYER_URL / SECRET_STREAM_RECORDER_URL
+(http://<laptop-ip>:8080) in .env.
+
+  tools/stream_server.py --reply hello.mp3            # multiplexed
+  tools/stream_server.py --no-mux                     # force the fallback
+
+Standard library only (asyncio + a minimal RFC 6455 server side).
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import struct
+import time
+import urllib.parse
+
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+OP_CONT, OP_TEXT, OP_BIN, OP_CLOSE, OP_PING, OP_PONG = 0x0, 0x1, 0x2, 0x8, 0x9, 0xA
+
+CH_PLAY = 1
+CH_REC = 2
+
+REPLY_CHUNK = 2048  # MP3 bytes per binary frame, as the backend sends
+
+
+def log(tag, msg):
+    print(f"{time.strftime('%H:%M:%S')} [{tag}] {msg}", flush=True)
+
+
+# ── Minimal WebSocket (server side) ─────────────────────────────────────────
+
+
+class WebSocket:
+    def __init__(self, reader, writer, path, query):
+        self.reader = reader
+        self.writer = writer
+        self.path = path
+        self.query = query
+        self.lock = asyncio.Lock()
+
+    @classmethod
+    async def accept(cls, reader, writer):
+        request = await reader.readuntil(b"\r\n\r\n")
+        lines = request.decode("latin-1").split("\r\n")
+        _, target, _ = lines[0].split(" ", 2)
+        headers = {}
+        for line in lines[1:]:
+            if ":" in line:
+                k, v = line.split(":", 1)
+                headers[k.strip().lower()] = v.strip()
+        key = headers.get("sec-websocket-key")
+        if not key:
+            writer.write(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n")
+            await writer.drain()
+            writer.close()
+            return None
+        accept = base64.b64encode(hashlib.sha1(key.encode() + WS_GUID).digest()).decode()
+        writer.write(
+            (
+                "HTTP/1.1 101 Switching Protocols\r\n"
+                "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                f"Sec-WebSocket-Accept: {accept}\r\n\r\n"
+            ).encode()
+        )
+        await writer.drain()
+        url = urllib.parse.urlsplit(target)
+        query = {k: v[0] for k, v in urllib.parse.parse_qs(url.query).items()}
+        return cls(reader, writer, url.path, query)
+
+    async def _frame(self):
+        b0, b1 = await self.reader.readexactly(2)
+        n = b1 & 0x7F
+        if n == 126:
+            (n,) = struct.unpack(">H", await self.reader.readexactly(2))
+        elif n == 127:
+            (n,) = struct.unpack(">Q", await self.reader.readexactly(8))
+        mask = await self.reader.readexactly(4) if b1 & 0x80 else None
+        data = await self.reader.readexactly(n)
+        if mask:
+            data = bytes(c ^ mask[i & 3] for i, c in enumerate(data))
+        return bool(b0 & 0x80), b0 & 0x0F, data
+
+    async def recv(self):
+        """Next whole message as (opcode, bytes); None once closed."""
+        opcode, parts = None, []
+        while True:
+            try:
+                fin, op, data = await self._frame()
+            except (asyncio.IncompleteReadError, ConnectionError):
+                return None
+            if op == OP_PING:
+                await self._send(OP_PONG, data)
+                continue
+            if op == OP_PONG:
+                continue
+            if op == OP_CLOSE:
+                try:
+                    await self._send(OP_CLOSE, data[:2])
+                except ConnectionError:
+                    pass
+                return None
+            if op != OP_CONT:
+                opcode, parts = op, []
+            parts.append(data)
+            if fin:
+                return opcode, b"".join(parts)
+
+    async def _send(self, op, data):
+        n = len(data)
+        if n < 126:
+            hdr = struct.pack(">BB", 0x80 | op, n)
+        elif n < 65536:
+            hdr = struct.pack(">BBH", 0x80 | op, 126, n)
+        else:
+            hdr = struct.pack(">BBQ", 0x80 | op, 127, n)
+        async with self.lock:
+            self.writer.write(hdr + data)
+            await self.writer.drain()
+
+    async def send_text(self, obj):
+        await self._send(OP_TEXT, json.dumps(obj, separators=(",", ":")).encode())
+
+    async def send_bin(self, data):
+        await self._send(OP_BIN, data)
+
+    def close(self):
+        self.writer.close()
+
+
+# ── Turns (recorder side) ───────────────────────────────────────────────────
+
+
+class Turn:
+    """One user turn: audio in, control frames logged, WAV out."""
+
+    def __init__(self, server, chat_id, offer):
+        self.server = server
+        self.chat_id = chat_id
+        self.codec = server.pick_codec(offer)
+        self.audio = bytearray()
+        self.cancelled = None
+        self.ended = False
+        self.t0 = time.monotonic()
+
+    def answer(self):
+        return {"type": "codec", "codec": self.codec, "control": True}
+
+    def on_audio(self, data):
+        self.audio += data
+
+    def on_control(self, msg):
+        kind = msg.get("type")
+        if kind == "cancel" and msg.get("reason") != "resumed":
+            self.cancelled = msg.get("reason")
+        if kind == "confirmed_end":
+            self.ended = True
+        ms = (time.monotonic() - self.t0) * 1000
+        log("rec", f"+{ms:6.0f} ms {json.dumps(msg)}")
+
+    async def close(self):
+        n = len(self.audio)
+        if self.cancelled or n == 0:
+            log("rec", f"turn dropped ({self.cancelled or 'no audio'})")
+            return
+        path = self.server.save(self.audio, self.codec)
+        log("rec", f"turn {n} B {self.codec} → {path}")
+        await self.server.reply(self.chat_id)
+
+
+# ── Server ──────────────────────────────────────────────────────────────────
+
+
+class StreamServer:
+    def __init__(self, args):
+        self.args = args
+        self.players = {}  # chatId → (ws, mux)
+        self.turns = 0
+        os.makedirs(args.out, exist_ok=True)
+
+    def pick_codec(self, offer):
+        offered = [c for c in (offer or "pcm").split(",") if c]
+        for c in self.args.codec.split(","):
+            if c in offered:
+                return c
+        return "pcm"
+
+    def save(self, audio, codec):
+        self.turns += 1
+        ext = "opus.bin" if codec == "opus" else "wav"
+        path = os.path.join(self.args.out, f"turn{self.turns:03d}.{ext}")
+        data = bytearray(audio)
+        if data[:4] == b"RIFF" and len(data) >= 44:
+            # Streaming header: RIFF and data sizes were left open
+            struct.pack_into("<I", data, 4, len(data) - 8)
+            pos = 12
+            while pos + 8 <= len(data):
+                cid, size = data[pos : pos + 4], struct.unpack_from("<I", data, pos + 4)[0]
+                if cid == b"data":
+                    struct.pack_into("<I", data, pos + 4, len(data) - pos - 8)
+                    break
+                pos += 8 + size
+        with open(path, "wb") as f:
+            f.write(data)
+        return path
+
+    async def reply(self, chat_id):
+        if not self.args.reply or chat_id not in self.players:
+            return
+        ws, mux = self.players[chat_id]
+        with open(self.args.reply, "rb") as f:
+            mp3 = f.read()
+        msg_id = f"standin-{self.turns:03d}"
+        tag = {"ch": "play"} if mux else {}
+        log("play", f"reply {msg_id} ({len(mp3)} B)")
+        await ws.send_text({**tag, "type": "tts_start", "messageId": msg_id, "codec": "mp3"})
+        for i in range(0, len(mp3), REPLY_CHUNK):
+            chunk = mp3[i : i + REPLY_CHUNK]
+            await ws.send_bin(bytes([CH_PLAY]) + chunk if mux else chunk)
+            await asyncio.sleep(0.02)
+        await ws.send_text({**tag, "type": "tts_end"})
+
+    # /ws-player: TTS down; with mux also the recorder channel
+    async def player(self, ws):
+        chat_id = ws.query.get("chatId", "")
+        mux = ws.query.get("mux") == "1" and not self.args.no_mux
+        log("play", f"connected chatId={chat_id} codec={ws.query.get('codec')} mux={mux}")
+        self.players[chat_id] = (ws, mux)
+        if mux:
+            await ws.send_text({"type": "mux"})
+
+        turn = None
+        while (msg := await ws.recv()) is not None:
+            op, data = msg
+            if op == OP_BIN and mux and data and data[0] == CH_REC:
+                if turn:
+                    turn.on_audio(data[1:])
+            elif op == OP_TEXT:
+                obj = json.loads(data)
+                if obj.get("ch") != "rec":
+                    log("play", f"unexpected {obj}")
+                elif obj.get("type") == "open":
+                    if turn:
+                        await turn.close()
+                    turn = Turn(self, chat_id, obj.get("codec"))
+                    log("rec", f"turn opened (shared socket), codec {turn.codec}")
+                    await ws.send_text({"ch": "rec", **turn.answer()})
+                elif obj.get("type") == "close":
+                    if turn:
+                        await turn.close()
+                    turn = None
+                elif turn:
+                    turn.on_control({k: v for k, v in obj.items() if k != "ch"})
+        if self.players.get(chat_id, (None,))[0] is ws:
+            del self.players[chat_id]
+        log("play", "disconnected")
+
+    # /ws-stream: one socket per turn (two-socket layout)
+    async def recorder(self, ws):
+        turn = Turn(self, ws.query.get("chatId", ""), ws.query.get("codec"))
+        log("rec", f"turn opened (own socket), codec {turn.codec}")
+        await ws.send_text(turn.answer())
+        while (msg := await ws.recv()) is not None:
+            op, data = msg
+            if op == OP_BIN:
+                turn.on_audio(data)
+            elif op == OP_TEXT:
+                turn.on_control(json.loads(data))
+        await turn.close()
+
+    async def handle(self, reader, writer):
+        try:
+            ws = await WebSocket.accept(reader, writer)
+            if not ws:
+                return
+            if ws.path == "/ws-player":
+                await self.player(ws)
+            elif ws.path == "/ws-stream":
+                await self.recorder(ws)
+            else:
+                log("http", f"unknown path {ws.path}")
+            ws.close()
+        except (asyncio.IncompleteReadError, ConnectionError) as e:
+            log("http", f"connection lost: {e!r}")
+
+
+async def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--host", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--no-mux", action="store_true", help="ignore mux=1 (two-socket fallback)")
+    ap.add_argument("--codec", default="pcm,adpcm",
+                    help="uplink codecs to accept, in order of preference (default pcm,adpcm)")
+    ap.add_argument("--reply", help="MP3 streamed back after every turn")
+    ap.add_argument("--out", default="build-host/turns", help="where turns are saved")
+    args = ap.parse_args()
+
+    server = StreamServer(args)
+    srv = await asyncio.start_server(server.handle, args.host, args.port)
+    log("http", f"listening on {args.host}:{args.port} ({'two sockets' if args.no_mux else 'mux offered'})")
+    async with srv:
+        await srv.serve_forever()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,280 @@
+// Wall-clock restore on the host: builds main/time_sync.c (the exact
+// firmware code, included here to reach its calendar helpers and RTC state)
+// against the IDF stand-ins in tools/host, on a fake wall clock.
+//
+// Build and run (host):
+//   make time-sync-test
+//   build-host/time_sync_test [-v]      (-v: firmware log on stderr)
+//
+// Checks the epoch math against libc's timegm() across leap years and
+// century rules, the Date-header parser on well-formed and malformed
+// values, and time_sync_restore(): when the RTC clock is trusted (drift
+// bound), and the NVS / build-date lower bounds after a power loss.
+//
+// Exit status 0 when every check passes.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+// The firmware's clock calls land on the fake clock below
+static int64_t s_wall_us;
+int host_gettimeofday(struct timeval *tv, void *tz);
+int host_settimeofday(const struct timeval *tv, const void *tz);
+#define gettimeofday host_gettimeofday
+#define settimeofday host_settimeofday
+
+#include "time_sync.c"
+
+EventGroupHandle_t g_events;
+
+int host_gettimeofday(struct timeval *tv, void *tz)
+{
+    tv->tv_sec  = s_wall_us / 1000000;
+    tv->tv_usec = s_wall_us % 1000000;
+    return 0;
+}
+
+int host_settimeofday(const struct timeval *tv, const void *tz)
+{
+    s_wall_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    return 0;
+}
+
+static int s_failed;
+static int s_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        s_checks++;                                             \
+        if (!(cond)) {                                          \
+            s_failed++;                                         \
+            printf("   FAIL %s:%d  ", __func__, __LINE__);      \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static int64_t wall_s(void)
+{
+    return s_wall_us / 1000000;
+}
+
+// Power-on state: module statics as after a reset, RTC memory kept
+static void reboot(int64_t wall)
+{
+    s_wall_us = wall * 1000000;
+    s_src     = TIME_SRC_NONE;
+    s_stats   = (time_sync_stats_t){};
+    xEventGroupClearBits(g_events, EVT_TIME_SYNCED);
+}
+
+static bool synced(void)
+{
+    return xEventGroupGetBits(g_events) & EVT_TIME_SYNCED;
+}
+
+// ── Calendar ─────────────────────────────────────────────────────────────────
+
+static int64_t libc_epoch(int y, int m, int d)
+{
+    struct tm tm = { .tm_year = y - 1900, .tm_mon = m, .tm_mday = d };
+    return (int64_t)timegm(&tm);
+}
+
+static void test_calendar(void)
+{
+    // Every day from 1900 to 2400: century years, the 400-year rule, and
+    // the epoch itself
+    int     bad = 0;
+    int64_t prev = days_from_civil(1899, 11, 31);
+    for (int y = 1900; y <= 2400; y++) {
+        for (int m = 0; m < 12; m++) {
+            for (int d = 1; d <= month_days(y, m); d++) {
+                int64_t days = days_from_civil(y, m, d);
+                if (days != prev + 1 || days * 86400 != libc_epoch(y, m, d)) {
+                    if (bad++ < 5) printf("   %04d-%02d-%02d → %lld\n", y, m + 1, d, (long long)days);
+                }
+                prev = days;
+            }
+        }
+    }
+    CHECK(bad == 0, "%d days off timegm() or not consecutive", bad);
+
+    CHECK(days_from_civil(1970, 0, 1) == 0, "epoch");
+    CHECK(days_from_civil(1969, 11, 31) == -1, "day before the epoch");
+    CHECK(days_from_civil(2000, 1, 29) == 11016, "2000-02-29");
+    CHECK(days_from_civil(2024, 2, 1) == 19783, "2024-03-01");
+    CHECK(days_from_civil(2100, 2, 1) == 47541, "2100-03-01");
+
+    static const int k_feb[][2] = { { 1900, 28 }, { 2000, 29 }, { 2023, 28 },
+                                    { 2024, 29 }, { 2100, 28 }, { 2400, 29 } };
+    for (size_t i = 0; i < sizeof(k_feb) / sizeof(k_feb[0]); i++) {
+        CHECK(month_days(k_feb[i][0], 1) == k_feb[i][1], "February %d: %d days",
+              k_feb[i][0], month_days(k_feb[i][0], 1));
+    }
+
+    CHECK(month_index("Jan") == 0 && month_index("Dec") == 11, "month names");
+    CHECK(month_index("anF") < 0 && month_index("Ja") < 0 && month_index("jan") < 0 &&
+          month_index("Janu") < 0, "month name fragments");
+}
+
+// ── Date header ──────────────────────────────────────────────────────────────
+
+static void test_http_date(void)
+{
+    static const struct {
+        const char *date;
+        int64_t     epoch;
+    } k_ok[] = {
+        { "Sun, 06 Nov 1994 08:49:37 GMT", 784111777 },       // RFC 9110's example
+        { "Thu, 01 Jan 1970 00:00:00 GMT", 0 },
+        { "Thu, 29 Feb 2024 23:59:59 GMT", 1709251199 },
+        { "Fri, 01 Mar 2024 00:00:00 GMT", 1709251200 },
+        { "Tue, 19 Jan 2038 03:14:08 GMT", 2147483648LL },    // past int32
+        { "Mon, 01 Mar 2100 12:00:00 GMT", 4107585600LL },
+    };
+    for (size_t i = 0; i < sizeof(k_ok) / sizeof(k_ok[0]); i++) {
+        reboot(1000000000);
+        s_src = TIME_SRC_BUILD;
+        time_sync_http_date(k_ok[i].date);
+        CHECK(s_src == TIME_SRC_HTTP && wall_s() == k_ok[i].epoch && synced(),
+              "\"%s\" → %lld (%s), want %lld", k_ok[i].date, (long long)wall_s(),
+              time_src_name(s_src), (long long)k_ok[i].epoch);
+    }
+
+    static const char *const k_bad[] = {
+        "",
+        "garbage",
+        "Sun, 06 Nov 1994",                       // no time
+        "Sun, 06 Nov 1994 08:49 GMT",             // no seconds
+        "Sunday, 06-Nov-94 08:49:37 GMT",         // RFC 850, obsolete
+        "Sun Nov  6 08:49:37 1994",               // asctime, obsolete
+        "Sun, 06 Xyz 1994 08:49:37 GMT",
+        "Sun, 06 anF 1994 08:49:37 GMT",          // inside "JanFeb"
+        "Sun, 00 Nov 1994 08:49:37 GMT",
+        "Sun, 31 Nov 1994 08:49:37 GMT",
+        "Thu, 29 Feb 2023 08:49:37 GMT",          // not a leap year
+        "Mon, 29 Feb 2100 08:49:37 GMT",          // nor a century
+        "Sun, 06 Nov 1994 24:00:00 GMT",
+        "Sun, 06 Nov 1994 08:60:00 GMT",
+        "Sun, 06 Nov 1994 08:49:61 GMT",
+        "Sun, 06 Nov 1969 08:49:37 GMT",          // before the epoch
+        "Sun, -6 Nov 1994 08:49:37 GMT",
+    };
+    for (size_t i = 0; i < sizeof(k_bad) / sizeof(k_bad[0]); i++) {
+        reboot(1000000000);
+        s_src = TIME_SRC_BUILD;
+        time_sync_http_date(k_bad[i]);
+        CHECK(s_src == TIME_SRC_BUILD && wall_s() == 1000000000 && !synced(),
+              "\"%s\" accepted → %lld", k_bad[i], (long long)wall_s());
+    }
+    reboot(1000000000);
+    time_sync_http_date(NULL);
+    CHECK(wall_s() == 1000000000 && !synced(), "NULL accepted");
+
+    // SNTP is never overridden; a later header steps only past the jitter
+    reboot(1000000000);
+    s_src = TIME_SRC_SNTP;
+    time_sync_http_date("Sun, 06 Nov 1994 08:49:37 GMT");
+    CHECK(wall_s() == 1000000000, "Date header over SNTP");
+
+    reboot(784111777);
+    s_src = TIME_SRC_HTTP;
+    s_wall_us += 500000;
+    time_sync_http_date("Sun, 06 Nov 1994 08:49:38 GMT");
+    CHECK(s_wall_us == 784111777500000LL, "1 s off, stepped to %lld", (long long)s_wall_us);
+    time_sync_http_date("Sun, 06 Nov 1994 08:49:40 GMT");
+    CHECK(wall_s() == 784111780, "2 s step not taken: %lld", (long long)wall_s());
+}
+
+// ── Restore ──────────────────────────────────────────────────────────────────
+
+// The RTC clock's worst-case error reaches TIME_SYNC_MAX_ERR_S this long
+// after the last sync
+#define TRUST_S  ((int64_t)TIME_SYNC_MAX_ERR_S * 1000000 / TIME_SYNC_RTC_PPM)
+
+static void test_restore(void)
+{
+    const int64_t floor  = build_epoch();
+    const int64_t synced_at = floor + 86400;
+    CHECK(floor > 1700000000, "build date %lld", (long long)floor);
+
+    // Deep sleep or reset: the clock kept running since the last sync
+    static const struct {
+        int64_t after_s;
+        bool    trusted;
+    } k_rtc[] = {
+        { 0, true }, { 3600, true }, { TRUST_S, true },
+        { TRUST_S + 20, false }, { 30 * 86400, false },
+    };
+    for (size_t i = 0; i < sizeof(k_rtc) / sizeof(k_rtc[0]); i++) {
+        s_rtc_magic  = RTC_MAGIC;
+        s_rtc_synced = synced_at;
+        reboot(synced_at + k_rtc[i].after_s);
+        time_sync_restore();
+        CHECK(s_stats.restored == TIME_SRC_RTC && wall_s() == synced_at + k_rtc[i].after_s,
+              "+%lld s: restored %s", (long long)k_rtc[i].after_s, time_src_name(s_stats.restored));
+        CHECK(synced() == k_rtc[i].trusted && (s_stats.trusted_ms != 0) == k_rtc[i].trusted,
+              "+%lld s: trusted %d, want %d", (long long)k_rtc[i].after_s, synced(),
+              k_rtc[i].trusted);
+    }
+
+    // A clock behind the last sync, or behind the build, did not keep running
+    host_nvs_erase();
+    s_rtc_magic  = RTC_MAGIC;
+    s_rtc_synced = synced_at;
+    reboot(synced_at - 10);
+    time_sync_restore();
+    CHECK(s_stats.restored == TIME_SRC_NONE && !synced(), "clock behind the last sync: %s",
+          time_src_name(s_stats.restored));
+    s_rtc_synced = synced_at;
+    reboot(floor - 10);
+    time_sync_restore();
+    CHECK(s_stats.restored == TIME_SRC_BUILD && wall_s() == floor && !synced(),
+          "clock behind the build: %s", time_src_name(s_stats.restored));
+
+    // Power loss, nothing saved: the build date, untrusted
+    s_rtc_magic = 0;
+    reboot(0);
+    time_sync_restore();
+    CHECK(s_stats.restored == TIME_SRC_BUILD && wall_s() == floor && !synced(),
+          "cold, no NVS: %s %lld", time_src_name(s_stats.restored), (long long)wall_s());
+
+    // Power loss with a saved time past the build date: that, untrusted
+    nvs_handle_t h;
+    nvs_open(TIME_SYNC_NVS_NS, NVS_READWRITE, &h);
+    nvs_set_i64(h, "epoch", synced_at);
+    reboot(0);
+    time_sync_restore();
+    CHECK(s_stats.restored == TIME_SRC_NVS && wall_s() == synced_at && !synced(),
+          "cold, NVS: %s %lld", time_src_name(s_stats.restored), (long long)wall_s());
+
+    // ... but one older than the build is ignored
+    nvs_set_i64(h, "epoch", floor - 86400);
+    reboot(0);
+    time_sync_restore();
+    CHECK(s_stats.restored == TIME_SRC_BUILD && wall_s() == floor, "cold, stale NVS: %s",
+          time_src_name(s_stats.restored));
+
+    // A clock already past both bounds is left alone
+    reboot(synced_at + 86400);
+    time_sync_restore();
+    CHECK(s_stats.restored == TIME_SRC_NONE && wall_s() == synced_at + 86400,
+          "clock ahead of the bounds moved to %lld", (long long)wall_s());
+}
+
+int main(int argc, char **argv)
+{
+    host_log_on = argc > 1 && !strcmp(argv[1], "-v");
+    g_events    = xEventGroupCreate();
+
+    printf("── time_sync\n");
+    test_calendar();
+    test_http_date();
+    test_restore();
+    printf("   %d/%d checks ok\n", s_checks - s_failed, s_checks);
+    return s_failed ? 1 : 0;
+}
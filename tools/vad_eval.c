@@ -0,0 +1,377 @@
+// Offline VAD evaluation: replays WAV files through main/vad.c (the exact
+// firmware code) the way record.c drives it, and scores the result against
+// labels.
+//
+// Build and run (host):
+//   make vad-eval
+//   build-host/vad_eval [options] corpus/*.wav
+//
+// Labels: next to each foo.wav, foo.txt in Audacity label format — one turn
+// per line, "start<TAB>end[<TAB>text]" in seconds.  A turn is everything
+// one recording should capture, pauses included.  No label file means the
+// whole file is non-speech (false-trigger material).
+//
+// Input: 16-bit PCM WAV, any rate or channel count (first channel, resampled
+// to 16 kHz with the firmware's dsp_resample_s16).
+//
+// Options:
+//   -e rms|adaptive   engine (default: both, side by side)
+//   -n noise.wav      mix this noise in (looped) ...
+//   -s snr_db         ... at this SNR against the labelled speech (default 10)
+//   -O db  -S db      adaptive onset / stay SNR
+//   -f frames         adaptive onset frames
+//   -m ms  -M ms      adaptive hangover min / max
+//   -p ms             probable-end (VAD_PAUSE) silence, both engines
+//   -v                per-file detail
+
+#include "vad.h"
+#include "dsp_pcm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK           512      // samples per reader chunk (I2S_READ_BYTES / 4)
+#define RECORD_MAX_S    20       // record.c caps a turn here
+#define ONSET_TOL_S     0.2      // onset this early still counts as the turn's
+#define MAX_TURNS       256
+#define MAX_DETECT      512
+#define MAX_SCORED      16384
+
+typedef struct {
+    double start, end;
+    double pause;      // probable end (VAD_PAUSE) that the end confirmed
+    int    resumes;    // probable ends taken back (speculation wasted)
+} span_t;
+
+typedef struct {
+    int16_t *pcm;
+    size_t   n;
+} audio_t;
+
+// ── WAV ──────────────────────────────────────────────────────────────────────
+
+static uint32_t rd32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+static int wav_load(const char *path, audio_t *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); return -1; }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc((size_t)size);
+    if (!buf || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(buf);
+        return -1;
+    }
+    fclose(f);
+
+    int rc = -1;
+    if (size < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        goto done;
+    }
+
+    int channels = 0, rate = 0, bits = 0, format = 0;
+    const uint8_t *data = NULL;
+    size_t data_len = 0;
+    for (long pos = 12; pos + 8 <= size; ) {
+        uint32_t len = rd32(buf + pos + 4);
+        const uint8_t *body = buf + pos + 8;
+        if ((long)len > size - pos - 8) len = (uint32_t)(size - pos - 8);   // streamed WAV
+        if (!memcmp(buf + pos, "fmt ", 4) && len >= 16) {
+            format   = rd16(body);
+            channels = rd16(body + 2);
+            rate     = (int)rd32(body + 4);
+            bits     = rd16(body + 14);
+        } else if (!memcmp(buf + pos, "data", 4)) {
+            data     = body;
+            data_len = len;
+        }
+        pos += 8 + len + (len & 1);
+    }
+    if (format != 1 || bits != 16 || channels < 1 || !data) {
+        fprintf(stderr, "%s: need 16-bit PCM (format %d, %d bits)\n", path, format, bits);
+        goto done;
+    }
+
+    size_t frames = data_len / (2 * (size_t)channels);
+    int16_t *mono = malloc(frames * sizeof(int16_t) + 1);
+    for (size_t i = 0; i < frames; i++) {
+        mono[i] = (int16_t)rd16(data + i * 2 * channels);
+    }
+
+    if (rate == VAD_SAMPLE_RATE) {
+        out->pcm = mono;
+        out->n   = frames;
+    } else {
+        size_t cap = (size_t)((double)frames * VAD_SAMPLE_RATE / rate) + 2;
+        dsp_resampler_t rs;
+        dsp_resampler_init(&rs, rate, VAD_SAMPLE_RATE);
+        out->pcm = malloc(cap * sizeof(int16_t));
+        out->n   = dsp_resample_s16(&rs, mono, frames, out->pcm, cap);
+        free(mono);
+    }
+    rc = 0;
+done:
+    free(buf);
+    return rc;
+}
+
+static int labels_load(const char *wav, span_t *turns, int max)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s", wav);
+    char *dot = strrchr(path, '.');
+    if (dot) strcpy(dot, ".txt");
+
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int n = 0;
+    char line[512];
+    while (n < max && fgets(line, sizeof(line), f)) {
+        double s, e;
+        if (sscanf(line, "%lf %lf", &s, &e) == 2 && e > s) {
+            turns[n++] = (span_t){ .start = s, .end = e };
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+// ── Noise mixing ─────────────────────────────────────────────────────────────
+
+static double power(const int16_t *x, size_t n)
+{
+    double p = 0;
+    for (size_t i = 0; i < n; i++) p += (double)x[i] * x[i];
+    return n ? p / n : 0;
+}
+
+static void mix_noise(audio_t *a, const span_t *turns, int n_turns,
+                      const audio_t *noise, double snr_db)
+{
+    double ps = 0;
+    size_t ns = 0;
+    for (int t = 0; t < n_turns; t++) {
+        size_t s = (size_t)(turns[t].start * VAD_SAMPLE_RATE);
+        size_t e = (size_t)(turns[t].end * VAD_SAMPLE_RATE);
+        if (e > a->n) e = a->n;
+        if (s >= e) continue;
+        ps += power(a->pcm + s, e - s) * (double)(e - s);
+        ns += e - s;
+    }
+    ps = ns ? ps / ns : power(a->pcm, a->n);
+    double pn = power(noise->pcm, noise->n);
+    if (pn <= 0 || ps <= 0) return;
+
+    double g = sqrt(ps / (pn * pow(10.0, snr_db / 10.0)));
+    for (size_t i = 0; i < a->n; i++) {
+        double v = a->pcm[i] + g * noise->pcm[i % noise->n];
+        a->pcm[i] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+    }
+}
+
+// ── Replay (mirrors record.c's listening / recording loop) ──────────────────
+
+static int replay(const audio_t *a, const vad_config_t *cfg, span_t *det, int max)
+{
+    vad_t v;
+    vad_init(&v, cfg);
+    vad_rearm(&v, false);
+
+    int    n = 0;
+    bool   recording = false;
+    size_t rec_start = 0;
+
+    for (size_t pos = 0; pos < a->n; pos += CHUNK) {
+        size_t len = a->n - pos < CHUNK ? a->n - pos : CHUNK;
+
+        // Every event, as the reader forwards them to the recorder socket
+        for (size_t off = 0; off < len; ) {
+            size_t      used;
+            vad_event_t ev = vad_step(&v, a->pcm + pos + off, len - off, &used);
+            off += used;
+            double t = (double)(pos + off) / VAD_SAMPLE_RATE;
+
+            if (!recording && ev == VAD_ONSET && n < max) {
+                recording = true;
+                rec_start = pos + off;
+                det[n] = (span_t){ .start = t, .pause = NAN };
+            } else if (recording && ev == VAD_PAUSE) {
+                det[n].pause = t;
+            } else if (recording && ev == VAD_RESUME) {
+                det[n].pause = NAN;
+                det[n].resumes++;
+            }
+        }
+
+        if (recording) {
+            // The record task polls, so the end lands on the chunk boundary
+            bool end = !vad_in_speech(&v);
+            bool cap = pos + len - rec_start >= (size_t)RECORD_MAX_S * VAD_SAMPLE_RATE;
+            if (end || cap) {
+                det[n++].end = (double)(pos + len) / VAD_SAMPLE_RATE;
+                recording = false;
+                vad_rearm(&v, false);
+            }
+        }
+    }
+    if (recording) det[n++].end = (double)a->n / VAD_SAMPLE_RATE;
+    return n;
+}
+
+// ── Scoring ──────────────────────────────────────────────────────────────────
+
+typedef struct {
+    int     turns, missed, cut, false_triggers;
+    double  speech_s, total_s;
+    int     resumes;
+    double  onset_ms[MAX_SCORED], end_ms[MAX_SCORED], pause_ms[MAX_SCORED];
+    int     n_onset, n_end, n_pause;
+} score_t;
+
+static void score_file(score_t *sc, const span_t *turns, int n_turns,
+                       const span_t *det, int n_det, double dur, const char *name,
+                       bool verbose)
+{
+    sc->total_s += dur;
+    bool used[MAX_DETECT] = { false };
+
+    for (int t = 0; t < n_turns; t++) {
+        sc->turns++;
+        sc->speech_s += turns[t].end - turns[t].start;
+
+        int first = -1, last = -1;
+        for (int d = 0; d < n_det; d++) {
+            if (det[d].start >= turns[t].start - ONSET_TOL_S && det[d].start < turns[t].end) {
+                if (first < 0) first = d;
+                last = d;
+                used[d] = true;
+            }
+        }
+        for (int d = first; d >= 0 && d <= last; d++) sc->resumes += det[d].resumes;
+        if (first < 0) {
+            sc->missed++;
+            if (verbose) printf("  %s: turn %.2f-%.2f missed\n", name, turns[t].start, turns[t].end);
+            continue;
+        }
+        double on  = (det[first].start - turns[t].start) * 1000;
+        double end = (det[last].end - turns[t].end) * 1000;
+        if (sc->n_onset < MAX_SCORED) sc->onset_ms[sc->n_onset++] = on;
+        // Split into several recordings, or ended before the speech did
+        bool cut = last != first || end < 0;
+        if (cut) sc->cut++;
+        else if (sc->n_end < MAX_SCORED) sc->end_ms[sc->n_end++] = end;
+        double pause = (det[last].pause - turns[t].end) * 1000;
+        if (!cut && !isnan(pause) && sc->n_pause < MAX_SCORED) sc->pause_ms[sc->n_pause++] = pause;
+        if (verbose) {
+            printf("  %s: turn %.2f-%.2f onset %+.0f ms, probable end %+.0f ms, end %+.0f ms, "
+                   "%d resumed%s\n", name, turns[t].start, turns[t].end, on, pause, end,
+                   det[first].resumes, cut ? " CUT" : "");
+        }
+    }
+    for (int d = 0; d < n_det; d++) {
+        if (used[d]) continue;
+        sc->false_triggers++;
+        if (verbose) printf("  %s: false trigger %.2f-%.2f\n", name, det[d].start, det[d].end);
+    }
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double pct(double *v, int n, double p)
+{
+    if (n == 0) return NAN;
+    qsort(v, (size_t)n, sizeof(double), cmp_double);
+    return v[(int)(p * (n - 1) + 0.5)];
+}
+
+static void report(const char *engine, score_t *sc)
+{
+    double quiet_h = (sc->total_s - sc->speech_s) / 3600.0;
+    printf("%-9s turns %4d  missed %3d  cut %3d  onset p50/p90 %5.0f/%5.0f ms  "
+           "probable end p50 %5.0f ms (%d resumed)  end p50/p90 %5.0f/%5.0f ms  "
+           "false %3d (%.1f/h)\n",
+           engine, sc->turns, sc->missed, sc->cut,
+           pct(sc->onset_ms, sc->n_onset, 0.5), pct(sc->onset_ms, sc->n_onset, 0.9),
+           pct(sc->pause_ms, sc->n_pause, 0.5), sc->resumes,
+           pct(sc->end_ms, sc->n_end, 0.5), pct(sc->end_ms, sc->n_end, 0.9),
+           sc->false_triggers, quiet_h > 0 ? sc->false_triggers / quiet_h : 0.0);
+}
+
+// ── Main ─────────────────────────────────────────────────────────────────────
+
+int main(int argc, char **argv)
+{
+    int         engines[2] = { VAD_ENGINE_RMS, VAD_ENGINE_ADAPTIVE };
+    int         n_engines  = 2;
+    const char *noise_path = NULL;
+    double      snr_db     = 10;
+    bool        verbose    = false;
+    vad_config_t tune;
+    vad_config_default(&tune, VAD_ENGINE_ADAPTIVE);
+    int         pause_ms   = tune.pause_ms;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        const char *o = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(o, "-v")) { verbose = true; continue; }
+        if (!val) { fprintf(stderr, "%s needs a value\n", o); return 2; }
+        i++;
+        if      (!strcmp(o, "-e")) { engines[0] = strcmp(val, "rms") ? VAD_ENGINE_ADAPTIVE : VAD_ENGINE_RMS; n_engines = 1; }
+        else if (!strcmp(o, "-n")) noise_path = val;
+        else if (!strcmp(o, "-s")) snr_db = atof(val);
+        else if (!strcmp(o, "-O")) tune.onset_snr_db = (float)atof(val);
+        else if (!strcmp(o, "-S")) tune.stay_snr_db  = (float)atof(val);
+        else if (!strcmp(o, "-f")) tune.onset_frames = atoi(val);
+        else if (!strcmp(o, "-m")) tune.hang_min_ms  = atoi(val);
+        else if (!strcmp(o, "-M")) tune.hang_max_ms  = atoi(val);
+        else if (!strcmp(o, "-p")) pause_ms          = atoi(val);
+        else { fprintf(stderr, "unknown option %s\n", o); return 2; }
+    }
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [-e rms|adaptive] [-n noise.wav -s snr_db] "
+                        "[-O db] [-S db] [-f frames] [-m ms] [-M ms] [-p ms] [-v] file.wav...\n", argv[0]);
+        return 2;
+    }
+
+    audio_t noise = {0};
+    if (noise_path && wav_load(noise_path, &noise) < 0) return 1;
+
+    static score_t sc[2];
+
+    for (; i < argc; i++) {
+        audio_t a;
+        if (wav_load(argv[i], &a) < 0) continue;
+        span_t turns[MAX_TURNS];
+        int n_turns = labels_load(argv[i], turns, MAX_TURNS);
+        if (noise.n) mix_noise(&a, turns, n_turns, &noise, snr_db);
+
+        for (int e = 0; e < n_engines; e++) {
+            vad_config_t cfg;
+            if (engines[e] == VAD_ENGINE_ADAPTIVE) cfg = tune;
+            else vad_config_default(&cfg, VAD_ENGINE_RMS);
+            cfg.pause_ms = pause_ms;
+
+            span_t det[MAX_DETECT];
+            int n_det = replay(&a, &cfg, det, MAX_DETECT);
+            if (verbose) printf("%s [%s]\n", argv[i], vad_engine_name(engines[e]));
+            score_file(&sc[e], turns, n_turns, det, n_det,
+                       (double)a.n / VAD_SAMPLE_RATE, argv[i], verbose);
+        }
+        free(a.pcm);
+    }
+
+    for (int e = 0; e < n_engines; e++) report(vad_engine_name(engines[e]), &sc[e]);
+    return 0;
+}